@@ -0,0 +1,45 @@
+/**
+ *  bench.h
+ *  
+ *  DESCRIPTION: Shared helpers for the DxWiFi micro-benchmarks
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ */
+
+#ifndef DXWIFI_BENCH_H
+#define DXWIFI_BENCH_H
+
+#include <time.h>
+#include <stdint.h>
+
+
+/**
+ *  DESCRIPTION:    Reads the monotonic clock
+ * 
+ *  RETURNS:
+ *      
+ *      uint64_t:   Current time in nanoseconds
+ * 
+ */
+static inline uint64_t bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+/**
+ *  DESCRIPTION:    Keeps the compiler from optimizing away a computed value
+ * 
+ *  ARGUMENTS:
+ * 
+ *      p:          Pointer to the value that must be kept
+ * 
+ */
+static inline void bench_do_not_optimize(const void* p) {
+    __asm__ volatile("" : : "g"(p) : "memory");
+}
+
+
+#endif // DXWIFI_BENCH_H
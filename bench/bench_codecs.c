@@ -0,0 +1,181 @@
+/**
+ *  bench_codecs.c
+ *
+ *  DESCRIPTION: Compares encode time, decode time and decode overhead of every
+ *  FEC codec in the registry across object sizes
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  USAGE: bench_codecs [coderate] [trials]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bench/bench.h>
+
+#include <libdxwifi/fec.h>
+#include <libdxwifi/details/logging.h>
+
+
+#define BENCH_DFLT_CODERATE 0.5
+#define BENCH_DFLT_TRIALS   3
+
+// Object sizes in source symbols, the first ones are small enough for a 2D
+// parity grid, 907 is a 1MB object
+static const unsigned BENCH_OBJECT_SYMBOLS[] = { 4, 12, 16, 64, 200, 907 };
+
+#define BENCH_NB_OBJECT_SIZES (sizeof(BENCH_OBJECT_SYMBOLS) / sizeof(BENCH_OBJECT_SYMBOLS[0]))
+
+
+/**
+ *  DESCRIPTION:    Decodes the frames listed in order, leaving the encoded
+ *                  message untouched
+ *
+ *  ARGUMENTS:
+ *
+ *      encoded:    Encoded message
+ *
+ *      order:      Frame indices to keep
+ *
+ *      count:      Number of frames to keep
+ *
+ *      msg:        Original message
+ *
+ *      msglen:     Size of the original message
+ *
+ *      elapsed_ns: Set to the time spent decoding
+ *
+ *  RETURNS:
+ *
+ *      bool:       true if the message decoded and matched the original
+ *
+ */
+static bool decode_frames(const uint8_t* encoded, const unsigned* order, unsigned count, const uint8_t* msg, size_t msglen, uint64_t* elapsed_ns) {
+    uint8_t* received = malloc((size_t) count * DXWIFI_RS_LDPC_FRAME_SIZE);
+    for(unsigned i = 0; i < count; ++i) {
+        memcpy(received + (size_t) i * DXWIFI_RS_LDPC_FRAME_SIZE, encoded + (size_t) order[i] * DXWIFI_RS_LDPC_FRAME_SIZE, DXWIFI_RS_LDPC_FRAME_SIZE);
+    }
+
+    void* decoded = NULL;
+    uint64_t start = bench_now_ns();
+    ssize_t nbytes = dxwifi_decode(received, (size_t) count * DXWIFI_RS_LDPC_FRAME_SIZE, &decoded);
+    *elapsed_ns = bench_now_ns() - start;
+
+    bool ok = nbytes == (ssize_t) msglen && memcmp(decoded, msg, msglen) == 0;
+
+    free(decoded);
+    free(received);
+    return ok;
+}
+
+
+/**
+ *  DESCRIPTION:    Shuffles frame indices
+ *
+ */
+static void shuffle(unsigned* order, unsigned n) {
+    for(unsigned i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    for(unsigned i = n - 1; i > 0; --i) {
+        unsigned j = rand() % (i + 1);
+        unsigned tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+}
+
+
+int main(int argc, char** argv) {
+    float coderate  = argc > 1 ? atof(argv[1]) : BENCH_DFLT_CODERATE;
+    unsigned trials = argc > 2 ? (unsigned)atoi(argv[2]) : BENCH_DFLT_TRIALS;
+
+    if(coderate <= 0.0 || coderate > 1.0 || trials == 0) {
+        fprintf(stderr, "Usage: %s [coderate] [trials]\n", argv[0]);
+        return 1;
+    }
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_OFF);
+    srand(1);
+
+    printf("coderate: %.3f, trials: %u\n", coderate, trials);
+    printf("Decode time is with half of the repair symbols lost. Overhead is the extra\n");
+    printf("symbols past K needed to decode a random subset of frames.\n\n");
+    printf("%-16s %6s %6s %12s %12s %12s %10s\n", "codec", "K", "N", "encode ms", "decode ms", "encode MB/s", "overhead");
+
+    int failures = 0;
+    for(size_t s = 0; s < BENCH_NB_OBJECT_SIZES; ++s) {
+        unsigned k    = BENCH_OBJECT_SYMBOLS[s];
+        size_t msglen = (size_t) k * DXWIFI_FEC_SYMBOL_SIZE;
+
+        uint8_t* msg = malloc(msglen);
+        for(size_t i = 0; i < msglen; ++i) {
+            msg[i] = rand();
+        }
+
+        for(dxwifi_fec_codec_t codec = 0; codec < DXWIFI_FEC_CODEC_COUNT; ++codec) {
+            uint64_t encode_ns = 0, decode_ns = 0, elapsed = 0;
+            unsigned extra = 0, n = 0;
+            bool supported = true;
+
+            for(unsigned t = 0; t < trials && supported; ++t) {
+                void* encoded = NULL;
+
+                uint64_t start = bench_now_ns();
+                ssize_t enclen = dxwifi_encode_with_codec(msg, msglen, coderate, codec, &encoded);
+                encode_ns += bench_now_ns() - start;
+
+                if(enclen < 0) {
+                    supported = false;
+                    break;
+                }
+                n = enclen / DXWIFI_RS_LDPC_FRAME_SIZE;
+
+                unsigned* order = malloc(n * sizeof(unsigned));
+                shuffle(order, n);
+
+                // Lose half the repair budget
+                if(!decode_frames(encoded, order, k + (n - k) / 2, msg, msglen, &elapsed)) {
+                    fprintf(stderr, "%s K=%u: decode with half the repair symbols lost failed\n", dxwifi_fec_codec_to_str(codec), k);
+                    ++failures;
+                }
+                decode_ns += elapsed;
+
+                // Fewest frames of this order that decode, more never hurt
+                unsigned lo = k, hi = n;
+                while(lo < hi) {
+                    unsigned mid = lo + (hi - lo) / 2;
+                    if(decode_frames(encoded, order, mid, msg, msglen, &elapsed)) {
+                        hi = mid;
+                    }
+                    else {
+                        lo = mid + 1;
+                    }
+                }
+                extra += lo - k;
+
+                free(order);
+                free(encoded);
+            }
+
+            if(!supported) {
+                printf("%-16s %6u %6s %12s %12s %12s %10s\n", dxwifi_fec_codec_to_str(codec), k, "-", "n/a", "n/a", "n/a", "n/a");
+                continue;
+            }
+            printf("%-16s %6u %6u %12.3f %12.3f %12.2f %9.2f%%\n",
+                dxwifi_fec_codec_to_str(codec),
+                k,
+                n,
+                encode_ns / 1e6 / trials,
+                decode_ns / 1e6 / trials,
+                (msglen * trials / 1e6) / (encode_ns / 1e9),
+                100.0 * extra / ((double) k * trials)
+            );
+        }
+        free(msg);
+    }
+    return failures != 0;
+}
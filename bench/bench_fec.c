@@ -0,0 +1,821 @@
+/**
+ *  bench_fec.c
+ *
+ *  DESCRIPTION: Sweeps dxwifi_encode() and dxwifi_decode() across object
+ *  sizes, coderates and simulated channels. Each row reports throughput,
+ *  decode overhead, how often the object decoded, the time spent in the
+ *  LDPC, RS and CRC stages and the peak RSS. Rows are written as a table or
+ *  as CSV, and a CSV from an earlier run can be given as a baseline to flag
+ *  rows that got slower or decoded less often.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  USAGE: bench_fec [-k kb,...] [-r coderate,...] [-c channel,...] [-t trials]
+ *                   [-f table|csv] [-b baseline.csv] [-T threshold_pct]
+ *
+ *  Channels are `clean`, `ber:<ber>` or `loss:<frame_loss>[:<burst_len>[:<ber>]]`.
+ *  Lost frames are dropped the way an unordered receiver drops them, bursts
+ *  longer than one frame follow a Gilbert-Elliott model.
+ *
+ *  Exits with 2 if any metric regressed past the threshold against the
+ *  baseline. Channels are seeded per trial so runs see the same losses.
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <bench/bench.h>
+
+#include <libdxwifi/fec.h>
+#include <libdxwifi/details/logging.h>
+
+
+#define BENCH_DFLT_SIZES        "16,256,1024"
+#define BENCH_DFLT_CODERATES    "0.5,0.667,0.8"
+#define BENCH_DFLT_CHANNELS     "clean,loss:0.05,loss:0.1:4,ber:1e-4"
+#define BENCH_DFLT_TRIALS       4
+#define BENCH_DFLT_THRESHOLD    10.0
+
+#define BENCH_LIST_MAX          16
+#define BENCH_LINE_MAX          1024
+#define BENCH_CHANNEL_MAX       32
+
+
+typedef struct {
+    char spec[BENCH_CHANNEL_MAX];   /* As given on the command line         */
+    double frame_loss;              /* Long run chance a frame is lost      */
+    double burst_len;               /* Mean frames lost in a row            */
+    double ber;                     /* Bit error rate of arriving frames    */
+} bench_channel;
+
+
+typedef enum {
+    BENCH_K = 0,
+    BENCH_N,
+    BENCH_SUCCESS,
+    BENCH_ENCODE_MBPS,
+    BENCH_DECODE_MBPS,
+    BENCH_OVERHEAD,
+    BENCH_SETUP_US,
+    BENCH_LDPC_ENCODE_US,
+    BENCH_RS_ENCODE_US,
+    BENCH_RS_DECODE_US,
+    BENCH_CRC_US,
+    BENCH_PLACE_US,
+    BENCH_LDPC_DECODE_US,
+    BENCH_PEAK_RSS_KB,
+    BENCH_NB_METRICS
+} bench_metric_t;
+
+
+/**
+ *  Column of the output and how it's compared against a baseline. Changes are
+ *  relative to the larger of the baseline and the floor, and skipped when both
+ *  values are under the floor where timer noise dominates.
+ */
+typedef struct {
+    const char* name;       /* CSV column name                          */
+    const char* format;     /* Table format                             */
+    int better;             /* 1 if higher is better, -1 if lower, 0 if
+                               the metric isn't compared                */
+    double floor;           /* Smallest value worth comparing           */
+} bench_column;
+
+
+static const bench_column BENCH_COLUMNS[BENCH_NB_METRICS] = {
+    [BENCH_K]               = { "k",                "%6.0f",   0, 0.0    },
+    [BENCH_N]               = { "n",                "%6.0f",   0, 0.0    },
+    [BENCH_SUCCESS]         = { "success",          "%8.3f",   1, 0.01   },
+    [BENCH_ENCODE_MBPS]     = { "encode_mbps",      "%8.1f",   1, 0.01   },
+    [BENCH_DECODE_MBPS]     = { "decode_mbps",      "%8.1f",   1, 0.01   },
+    [BENCH_OVERHEAD]        = { "overhead_pct",     "%8.2f",  -1, 1.0    },
+    [BENCH_SETUP_US]        = { "setup_us",         "%9.0f",  -1, 50.0   },
+    [BENCH_LDPC_ENCODE_US]  = { "ldpc_encode_us",   "%9.0f",  -1, 50.0   },
+    [BENCH_RS_ENCODE_US]    = { "rs_encode_us",     "%9.0f",  -1, 50.0   },
+    [BENCH_RS_DECODE_US]    = { "rs_decode_us",     "%9.0f",  -1, 50.0   },
+    [BENCH_CRC_US]          = { "crc_us",           "%9.0f",  -1, 50.0   },
+    [BENCH_PLACE_US]        = { "place_us",         "%9.0f",  -1, 50.0   },
+    [BENCH_LDPC_DECODE_US]  = { "ldpc_decode_us",   "%9.0f",  -1, 50.0   },
+    [BENCH_PEAK_RSS_KB]     = { "peak_rss_kb",      "%9.0f",  -1, 1024.0 },
+};
+
+// Short table headers, the CSV uses the column names
+static const char* BENCH_TABLE_HEADERS[BENCH_NB_METRICS] = {
+    "%6s", "%6s", "%8s", "%8s", "%8s", "%8s", "%9s", "%9s", "%9s", "%9s", "%9s", "%9s", "%9s", "%9s"
+};
+
+static const char* BENCH_TABLE_NAMES[BENCH_NB_METRICS] = {
+    "K", "N", "success", "enc MB/s", "dec MB/s", "overhd%", "setup us", "ldpc enc", "rs enc", "rs dec", "crc us", "place us", "ldpc dec", "rss KB"
+};
+
+
+typedef struct {
+    unsigned object_kb;                 /* Object size in KB                */
+    float coderate;                     /* Requested coderate               */
+    char channel[BENCH_CHANNEL_MAX];    /* Channel spec                     */
+    double value[BENCH_NB_METRICS];     /* Measured metrics                 */
+} bench_result;
+
+
+typedef struct {
+    bench_result* rows;
+    size_t count;
+    size_t capacity;
+} bench_results;
+
+
+static double uniform() {
+    return (rand() + 1.0) / ((double) RAND_MAX + 2.0);
+}
+
+
+static uint64_t fastest(uint64_t best, uint64_t sample) {
+    return sample < best ? sample : best;
+}
+
+
+static void push_result(bench_results* results, const bench_result* row) {
+    if(results->count == results->capacity) {
+        results->capacity = results->capacity ? 2 * results->capacity : 64;
+        results->rows = realloc(results->rows, results->capacity * sizeof(bench_result));
+        if(!results->rows) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    results->rows[results->count++] = *row;
+}
+
+
+// Rows are matched on the object size, the coderate as printed and the channel
+static bool same_row(const bench_result* a, const bench_result* b) {
+    return a->object_kb == b->object_kb
+        && fabsf(a->coderate - b->coderate) < 0.0005
+        && strcmp(a->channel, b->channel) == 0;
+}
+
+
+/**
+ *  DESCRIPTION:    Parses a channel spec
+ *
+ *  ARGUMENTS:
+ *
+ *      spec:       `clean`, `ber:<ber>` or `loss:<frame_loss>[:<burst_len>[:<ber>]]`
+ *
+ *      channel:    Set to the parsed channel
+ *
+ *  RETURNS:
+ *
+ *      bool:       false if the spec is malformed or out of range
+ *
+ */
+static bool parse_channel(const char* spec, bench_channel* channel) {
+    if(strlen(spec) >= BENCH_CHANNEL_MAX) {
+        return false;
+    }
+    strcpy(channel->spec, spec);
+    channel->frame_loss = 0.0;
+    channel->burst_len  = 1.0;
+    channel->ber        = 0.0;
+
+    char trailing;
+    if(strcmp(spec, "clean") == 0) {
+        return true;
+    }
+    else if(strncmp(spec, "ber:", 4) == 0) {
+        if(sscanf(spec + 4, "%lf%c", &channel->ber, &trailing) != 1) {
+            return false;
+        }
+    }
+    else if(strncmp(spec, "loss:", 5) == 0) {
+        int nfields = sscanf(spec + 5, "%lf:%lf:%lf%c", &channel->frame_loss, &channel->burst_len, &channel->ber, &trailing);
+        if(nfields < 1 || nfields > 3) {
+            return false;
+        }
+    }
+    else {
+        return false;
+    }
+    return 0.0 <= channel->frame_loss && channel->frame_loss < 1.0
+        && channel->burst_len >= 1.0
+        && 0.0 <= channel->ber && channel->ber < 1.0;
+}
+
+
+/**
+ *  DESCRIPTION:    Splits a comma separated list in place
+ *
+ *  ARGUMENTS:
+ *
+ *      list:       List to split, commas are overwritten
+ *
+ *      items:      Set to the start of each item
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Number of items, 0 if there are too many
+ *
+ */
+static size_t split_list(char* list, char** items) {
+    size_t count = 0;
+    for(char* item = strtok(list, ","); item; item = strtok(NULL, ",")) {
+        if(count == BENCH_LIST_MAX) {
+            return 0;
+        }
+        items[count++] = item;
+    }
+    return count;
+}
+
+
+/**
+ *  DESCRIPTION:    Passes the encoded frames through the channel. Lost frames
+ *                  are dropped and bits are flipped in the ones that arrive.
+ *
+ *  ARGUMENTS:
+ *
+ *      channel:    Channel model
+ *
+ *      encoded:    Encoded message
+ *
+ *      nframes:    Number of frames in the encoded message
+ *
+ *      frame_size: Size of each frame
+ *
+ *      received:   Set to the frames that arrived
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Size of the received message in bytes
+ *
+ */
+static size_t apply_channel(const bench_channel* channel, const uint8_t* encoded, size_t nframes, size_t frame_size, uint8_t* received) {
+    // Gilbert-Elliott chances giving the requested loss rate and mean burst
+    double p_good_to_bad = channel->frame_loss / (channel->burst_len * (1.0 - channel->frame_loss));
+    double p_bad_to_good = 1.0 / channel->burst_len;
+
+    size_t nbytes = 0;
+    bool bad = false;
+    for(size_t i = 0; i < nframes; ++i) {
+        if(channel->burst_len > 1.0) {
+            bad = uniform() < (bad ? 1.0 - p_bad_to_good : p_good_to_bad);
+        }
+        else {
+            bad = uniform() < channel->frame_loss;
+        }
+        if(bad) {
+            continue;
+        }
+        memcpy(received + nbytes, encoded + i * frame_size, frame_size);
+        nbytes += frame_size;
+    }
+
+    // Skip ahead a geometric number of bits between errors
+    if(channel->ber > 0) {
+        double bit = -log(uniform()) / channel->ber;
+        while(bit < 8.0 * nbytes) {
+            size_t pos = (size_t) bit;
+            received[pos / 8] ^= 1 << (pos % 8);
+            bit += 1.0 + -log(uniform()) / channel->ber;
+        }
+    }
+    return nbytes;
+}
+
+
+/**
+ *  DESCRIPTION:    Decodes the received frames listed in order
+ *
+ *  ARGUMENTS:
+ *
+ *      received:   Received frames
+ *
+ *      order:      Frame indices to keep
+ *
+ *      count:      Number of frames to keep
+ *
+ *      msg:        Original message
+ *
+ *      msglen:     Size of the original message
+ *
+ *  RETURNS:
+ *
+ *      bool:       true if the message decoded and matched the original
+ *
+ */
+static bool decode_subset(const uint8_t* received, const unsigned* order, unsigned count, const uint8_t* msg, size_t msglen) {
+    uint8_t* subset = malloc((size_t) count * DXWIFI_RS_LDPC_FRAME_SIZE);
+    for(unsigned i = 0; i < count; ++i) {
+        memcpy(subset + (size_t) i * DXWIFI_RS_LDPC_FRAME_SIZE, received + (size_t) order[i] * DXWIFI_RS_LDPC_FRAME_SIZE, DXWIFI_RS_LDPC_FRAME_SIZE);
+    }
+
+    void* decoded = NULL;
+    ssize_t nbytes = dxwifi_decode(subset, (size_t) count * DXWIFI_RS_LDPC_FRAME_SIZE, &decoded);
+    bool ok = nbytes == (ssize_t) msglen && memcmp(decoded, msg, msglen) == 0;
+
+    free(decoded);
+    free(subset);
+    return ok;
+}
+
+
+/**
+ *  DESCRIPTION:    Fewest received frames that still decode, taken in a
+ *                  random order. More frames never hurt so a binary search
+ *                  over the count finds it.
+ *
+ *  ARGUMENTS:
+ *
+ *      received:   Received frames, all of which decode together
+ *
+ *      nframes:    Number of received frames
+ *
+ *      k:          Source symbols in the object
+ *
+ *      msg:        Original message
+ *
+ *      msglen:     Size of the original message
+ *
+ *  RETURNS:
+ *
+ *      unsigned:   Frames needed to decode
+ *
+ */
+static unsigned frames_needed(const uint8_t* received, unsigned nframes, unsigned k, const uint8_t* msg, size_t msglen) {
+    unsigned* order = malloc(nframes * sizeof(unsigned));
+    for(unsigned i = 0; i < nframes; ++i) {
+        order[i] = i;
+    }
+    for(unsigned i = nframes - 1; i > 0; --i) {
+        unsigned j = rand() % (i + 1);
+        unsigned tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    unsigned lo = k < nframes ? k : nframes, hi = nframes;
+    while(lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        if(decode_subset(received, order, mid, msg, msglen)) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+    free(order);
+    return lo;
+}
+
+
+// Best effort, kernels without clear_refs leave the high water mark alone
+static void reset_peak_rss() {
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if(fp) {
+        fputs("5", fp);
+        fclose(fp);
+    }
+}
+
+
+static double peak_rss_kb() {
+    char line[BENCH_LINE_MAX];
+    double kb = 0.0;
+
+    FILE* fp = fopen("/proc/self/status", "r");
+    if(!fp) {
+        return kb;
+    }
+    while(fgets(line, sizeof(line), fp)) {
+        if(sscanf(line, "VmHWM: %lf", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+
+/**
+ *  DESCRIPTION:    Encodes, sends and decodes one object for every trial
+ *
+ *  ARGUMENTS:
+ *
+ *      channel:    Channel model
+ *
+ *      msg:        Message to send
+ *
+ *      msglen:     Size of the message
+ *
+ *      coderate:   FEC coderate
+ *
+ *      trials:     Number of times the object is sent
+ *
+ *      row:        Metrics are written here
+ *
+ *  RETURNS:
+ *
+ *      bool:       false if the object couldn't be encoded
+ *
+ */
+static bool run_row(const bench_channel* channel, const uint8_t* msg, size_t msglen, float coderate, unsigned trials, bench_result* row) {
+    // Throughput is from the fastest trial, the slower ones mostly measure
+    // the machine. Stages are averaged since losses decide which ones run.
+    uint64_t encode_ns = UINT64_MAX, decode_ns = UINT64_MAX;
+    uint64_t encode_stages[DXWIFI_FEC_STAGE_COUNT] = { 0 };
+    uint64_t decode_stages[DXWIFI_FEC_STAGE_COUNT] = { 0 };
+    unsigned decoded = 0, extra = 0, k = 0, n = 0;
+
+    dxwifi_fec_params params = DXWIFI_FEC_PARAMS_DFLT_INITIALIZER;
+    params.coderate = coderate;
+
+    reset_peak_rss();
+
+    for(unsigned t = 0; t < trials; ++t) {
+        void* encoded = NULL;
+        dxwifi_fec_stats stats;
+        uint64_t start = bench_now_ns();
+        ssize_t enclen = dxwifi_encode_with_params((void*) msg, msglen, &params, &encoded, &stats);
+        encode_ns = fastest(encode_ns, bench_now_ns() - start);
+
+        if(enclen < 0) {
+            fprintf(stderr, "%uKB at %.3f: encode failed - %s\n", row->object_kb, coderate, dxwifi_fec_error_to_str(enclen));
+            return false;
+        }
+        for(int s = 0; s < DXWIFI_FEC_STAGE_COUNT; ++s) {
+            encode_stages[s] += stats.stage_ns[s];
+        }
+        k = stats.k;
+        n = stats.n;
+
+        // Every row sees the same channel realizations
+        srand(t + 1);
+        uint8_t* received = malloc(enclen);
+        size_t reclen = apply_channel(channel, encoded, n, DXWIFI_RS_LDPC_FRAME_SIZE, received);
+
+        void* out = NULL;
+        ssize_t nbytes = -1;
+        if(reclen) {
+            start = bench_now_ns();
+            nbytes = dxwifi_decode_with_stats(received, reclen, &out, &stats);
+            decode_ns = fastest(decode_ns, bench_now_ns() - start);
+
+            for(int s = 0; s < DXWIFI_FEC_STAGE_COUNT; ++s) {
+                decode_stages[s] += stats.stage_ns[s];
+            }
+        }
+
+        if(nbytes == (ssize_t) msglen && memcmp(out, msg, msglen) == 0) {
+            ++decoded;
+            extra += frames_needed(received, reclen / DXWIFI_RS_LDPC_FRAME_SIZE, k, msg, msglen) - k;
+        }
+        free(out);
+        free(received);
+        free(encoded);
+    }
+
+    // Nothing arrived in any trial
+    decode_ns = decode_ns == UINT64_MAX ? 0 : decode_ns;
+
+    double* v = row->value;
+    v[BENCH_K]              = k;
+    v[BENCH_N]              = n;
+    v[BENCH_SUCCESS]        = (double) decoded / trials;
+    v[BENCH_ENCODE_MBPS]    = encode_ns ? 1e3 * msglen / encode_ns : 0.0;
+    v[BENCH_DECODE_MBPS]    = decode_ns ? 1e3 * msglen / decode_ns : 0.0;
+    v[BENCH_OVERHEAD]       = decoded ? 100.0 * extra / ((double) k * decoded) : NAN;
+    v[BENCH_SETUP_US]       = (encode_stages[DXWIFI_FEC_STAGE_SETUP] + decode_stages[DXWIFI_FEC_STAGE_SETUP]) / 1e3 / trials;
+    v[BENCH_LDPC_ENCODE_US] = (encode_stages[DXWIFI_FEC_STAGE_SOURCE] + encode_stages[DXWIFI_FEC_STAGE_REPAIR]) / 1e3 / trials;
+    v[BENCH_RS_ENCODE_US]   = encode_stages[DXWIFI_FEC_STAGE_RS_ENCODE] / 1e3 / trials;
+    v[BENCH_RS_DECODE_US]   = decode_stages[DXWIFI_FEC_STAGE_RS_DECODE] / 1e3 / trials;
+    v[BENCH_CRC_US]         = decode_stages[DXWIFI_FEC_STAGE_OTI_SEARCH] / 1e3 / trials;
+    v[BENCH_PLACE_US]       = decode_stages[DXWIFI_FEC_STAGE_PLACE] / 1e3 / trials;
+    v[BENCH_LDPC_DECODE_US] = (decode_stages[DXWIFI_FEC_STAGE_IT_DECODE] + decode_stages[DXWIFI_FEC_STAGE_ML_DECODE] + decode_stages[DXWIFI_FEC_STAGE_COPY]) / 1e3 / trials;
+    v[BENCH_PEAK_RSS_KB]    = peak_rss_kb();
+    return true;
+}
+
+
+static void print_header(bool csv) {
+    if(csv) {
+        printf("object_kb,coderate,channel");
+        for(int m = 0; m < BENCH_NB_METRICS; ++m) {
+            printf(",%s", BENCH_COLUMNS[m].name);
+        }
+        printf("\n");
+        return;
+    }
+    printf("%6s %8s %-16s", "KB", "coderate", "channel");
+    for(int m = 0; m < BENCH_NB_METRICS; ++m) {
+        printf(" ");
+        printf(BENCH_TABLE_HEADERS[m], BENCH_TABLE_NAMES[m]);
+    }
+    printf("\n");
+}
+
+
+static void print_row(const bench_result* row, bool csv) {
+    if(csv) {
+        printf("%u,%.3f,%s", row->object_kb, row->coderate, row->channel);
+        for(int m = 0; m < BENCH_NB_METRICS; ++m) {
+            if(isnan(row->value[m])) {
+                printf(",");
+            }
+            else {
+                printf(",%.3f", row->value[m]);
+            }
+        }
+        printf("\n");
+        return;
+    }
+    printf("%6u %8.3f %-16s", row->object_kb, row->coderate, row->channel);
+    for(int m = 0; m < BENCH_NB_METRICS; ++m) {
+        printf(" ");
+        if(isnan(row->value[m])) {
+            printf(BENCH_TABLE_HEADERS[m], "-");
+        }
+        else {
+            printf(BENCH_COLUMNS[m].format, row->value[m]);
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+
+/**
+ *  DESCRIPTION:    Reads rows written by an earlier run with -f csv
+ *
+ *  ARGUMENTS:
+ *
+ *      path:       Path to the CSV
+ *
+ *      baseline:   Rows are appended here
+ *
+ *  RETURNS:
+ *
+ *      bool:       false if the file couldn't be read or has no known columns
+ *
+ *  NOTES: Columns are matched by name so baselines from runs with fewer
+ *  columns still compare the ones they have, missing ones are NAN.
+ *
+ */
+static bool read_baseline(const char* path, bench_results* baseline) {
+    char line[BENCH_LINE_MAX];
+
+    FILE* fp = fopen(path, "r");
+    if(!fp) {
+        perror(path);
+        return false;
+    }
+
+    // Map CSV columns to metrics, -1 for columns we don't know
+    int columns[BENCH_NB_METRICS + 3];
+    int ncolumns = 0;
+    if(fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        for(char* name = strtok(line, ","); name && ncolumns < BENCH_NB_METRICS + 3; name = strtok(NULL, ",")) {
+            columns[ncolumns] = -1;
+            for(int m = 0; m < BENCH_NB_METRICS; ++m) {
+                if(strcmp(name, BENCH_COLUMNS[m].name) == 0) {
+                    columns[ncolumns] = m;
+                }
+            }
+            ++ncolumns;
+        }
+    }
+    if(ncolumns <= 3) {
+        fprintf(stderr, "%s: not a bench_fec CSV\n", path);
+        fclose(fp);
+        return false;
+    }
+
+    while(fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        bench_result row = { .object_kb = 0 };
+        for(int m = 0; m < BENCH_NB_METRICS; ++m) {
+            row.value[m] = NAN;
+        }
+
+        // strsep() keeps empty fields, they're metrics that weren't measured
+        char* cursor = line;
+        char* field  = NULL;
+        for(int c = 0; c < ncolumns && (field = strsep(&cursor, ",")); ++c) {
+            if(c == 0) {
+                row.object_kb = strtoul(field, NULL, 10);
+            }
+            else if(c == 1) {
+                row.coderate = strtof(field, NULL);
+            }
+            else if(c == 2) {
+                snprintf(row.channel, sizeof(row.channel), "%s", field);
+            }
+            else if(columns[c] >= 0 && *field) {
+                row.value[columns[c]] = strtod(field, NULL);
+            }
+        }
+        if(row.object_kb) {
+            push_result(baseline, &row);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+
+/**
+ *  DESCRIPTION:    Compares every row against its baseline row and lists the
+ *                  metrics that changed by more than the threshold
+ *
+ *  ARGUMENTS:
+ *
+ *      stream:     Where the comparison is written
+ *
+ *      results:    Rows from this run
+ *
+ *      baseline:   Rows from the baseline
+ *
+ *      threshold:  Relative change in percent worth reporting
+ *
+ *  RETURNS:
+ *
+ *      unsigned:   Number of regressions
+ *
+ */
+static unsigned compare_baseline(FILE* stream, const bench_results* results, const bench_results* baseline, double threshold) {
+    unsigned compared = 0, missing = 0, regressions = 0, improvements = 0;
+
+    fprintf(stream, "\nChanges of more than %.1f%% against the baseline:\n\n", threshold);
+    fprintf(stream, "%6s %8s %-16s %-16s %12s %12s %9s\n", "KB", "coderate", "channel", "metric", "baseline", "current", "change");
+
+    for(size_t i = 0; i < results->count; ++i) {
+        const bench_result* row  = &results->rows[i];
+        const bench_result* base = NULL;
+        for(size_t j = 0; j < baseline->count && !base; ++j) {
+            base = same_row(row, &baseline->rows[j]) ? &baseline->rows[j] : NULL;
+        }
+        if(!base) {
+            ++missing;
+            continue;
+        }
+        ++compared;
+
+        for(int m = 0; m < BENCH_NB_METRICS; ++m) {
+            const bench_column* column = &BENCH_COLUMNS[m];
+            double before = base->value[m], after = row->value[m];
+
+            if(column->better == 0 || isnan(before) || isnan(after)) {
+                continue;
+            }
+            if(fabs(before) < column->floor && fabs(after) < column->floor) {
+                continue;
+            }
+            double change = 100.0 * (after - before) / fmax(fabs(before), column->floor);
+            if(fabs(change) <= threshold) {
+                continue;
+            }
+            bool regressed = (change < 0) == (column->better > 0);
+            regressions  += regressed;
+            improvements += !regressed;
+
+            fprintf(stream, "%6u %8.3f %-16s %-16s %12.3f %12.3f %+8.1f%% %s\n",
+                row->object_kb,
+                row->coderate,
+                row->channel,
+                column->name,
+                before,
+                after,
+                change,
+                regressed ? "REGRESSION" : "improved"
+            );
+        }
+    }
+    fprintf(stream, "\n%u regressions, %u improvements over %u rows, %u rows not in the baseline\n", regressions, improvements, compared, missing);
+    return regressions;
+}
+
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-k kb,...] [-r coderate,...] [-c channel,...] [-t trials]\n", prog);
+    fprintf(stderr, "       %*s [-f table|csv] [-b baseline.csv] [-T threshold_pct]\n\n", (int) strlen(prog), "");
+    fprintf(stderr, "Channels are clean, ber:<ber> or loss:<frame_loss>[:<burst_len>[:<ber>]]\n");
+    fprintf(stderr, "Defaults: -k %s -r %s -c %s -t %d -T %.0f\n", BENCH_DFLT_SIZES, BENCH_DFLT_CODERATES, BENCH_DFLT_CHANNELS, BENCH_DFLT_TRIALS, BENCH_DFLT_THRESHOLD);
+}
+
+
+int main(int argc, char** argv) {
+    char sizes_arg[BENCH_LINE_MAX]      = BENCH_DFLT_SIZES;
+    char coderates_arg[BENCH_LINE_MAX]  = BENCH_DFLT_CODERATES;
+    char channels_arg[BENCH_LINE_MAX]   = BENCH_DFLT_CHANNELS;
+    unsigned trials                     = BENCH_DFLT_TRIALS;
+    double threshold                    = BENCH_DFLT_THRESHOLD;
+    const char* baseline_path           = NULL;
+    bool csv                            = false;
+
+    int opt;
+    while((opt = getopt(argc, argv, "k:r:c:t:f:b:T:h")) != -1) {
+        switch(opt) {
+        case 'k': snprintf(sizes_arg, sizeof(sizes_arg), "%s", optarg); break;
+        case 'r': snprintf(coderates_arg, sizeof(coderates_arg), "%s", optarg); break;
+        case 'c': snprintf(channels_arg, sizeof(channels_arg), "%s", optarg); break;
+        case 't': trials = (unsigned) atoi(optarg); break;
+        case 'b': baseline_path = optarg; break;
+        case 'T': threshold = atof(optarg); break;
+        case 'f':
+            if(strcmp(optarg, "csv") != 0 && strcmp(optarg, "table") != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            csv = strcmp(optarg, "csv") == 0;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    char* items[BENCH_LIST_MAX];
+    unsigned sizes[BENCH_LIST_MAX];
+    float coderates[BENCH_LIST_MAX];
+    bench_channel channels[BENCH_LIST_MAX];
+
+    size_t nsizes = split_list(sizes_arg, items);
+    for(size_t i = 0; i < nsizes; ++i) {
+        sizes[i] = (unsigned) atoi(items[i]);
+        nsizes   = sizes[i] ? nsizes : 0;
+    }
+    size_t ncoderates = split_list(coderates_arg, items);
+    for(size_t i = 0; i < ncoderates; ++i) {
+        coderates[i] = atof(items[i]);
+        ncoderates   = (0.0 < coderates[i] && coderates[i] <= 1.0) ? ncoderates : 0;
+    }
+    size_t nchannels = split_list(channels_arg, items);
+    for(size_t i = 0; i < nchannels; ++i) {
+        if(!parse_channel(items[i], &channels[i])) {
+            fprintf(stderr, "Invalid channel: %s\n", items[i]);
+            nchannels = 0;
+        }
+    }
+    if(nsizes == 0 || ncoderates == 0 || nchannels == 0 || trials == 0 || threshold < 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bench_results baseline = { .rows = NULL };
+    if(baseline_path && !read_baseline(baseline_path, &baseline)) {
+        return 1;
+    }
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_OFF);
+
+    if(!csv) {
+        printf("trials: %u\n", trials);
+        printf("Overhead is the extra symbols past K needed to decode a random order of the\n");
+        printf("received frames. MB/s is from the fastest trial, stage times are means per\n");
+        printf("object and peak RSS is per row.\n\n");
+    }
+    print_header(csv);
+
+    int failures = 0;
+    bench_results results = { .rows = NULL };
+    for(size_t s = 0; s < nsizes; ++s) {
+        size_t msglen = (size_t) sizes[s] * 1024;
+        uint8_t* msg = malloc(msglen);
+        srand(1);
+        for(size_t i = 0; i < msglen; ++i) {
+            msg[i] = rand();
+        }
+
+        for(size_t r = 0; r < ncoderates; ++r) {
+            for(size_t c = 0; c < nchannels; ++c) {
+                bench_result row = { .object_kb = sizes[s], .coderate = coderates[r] };
+                strcpy(row.channel, channels[c].spec);
+
+                if(!run_row(&channels[c], msg, msglen, coderates[r], trials, &row)) {
+                    ++failures;
+                    continue;
+                }
+                print_row(&row, csv);
+                push_result(&results, &row);
+            }
+        }
+        free(msg);
+    }
+
+    unsigned regressions = 0;
+    if(baseline_path) {
+        regressions = compare_baseline(csv ? stderr : stdout, &results, &baseline, threshold);
+    }
+    free(results.rows);
+    free(baseline.rows);
+
+    if(regressions) {
+        return 2;
+    }
+    return failures != 0;
+}
@@ -0,0 +1,215 @@
+/**
+ *  bench_frame_size.c
+ *
+ *  DESCRIPTION: Goodput of an object sent over a lossy channel for every
+ *  number of RS blocks per frame, at DSSS and OFDM data rates
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  USAGE: bench_frame_size [frame_loss] [ber] [object_kb] [trials]
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bench/bench.h>
+
+#include <libdxwifi/fec.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/ieee80211.h>
+
+
+#define BENCH_DFLT_FRAME_LOSS   0.05
+#define BENCH_DFLT_BER          1e-4
+#define BENCH_DFLT_OBJECT_KB    128
+#define BENCH_DFLT_TRIALS       2
+
+// MAC header and FCS, the radiotap header never goes over the air
+#define BENCH_MAC_OVERHEAD (sizeof(ieee80211_hdr) + IEEE80211_FCS_SIZE)
+
+
+/**
+ *  Per frame timing of a PHY. Injected frames still wait DIFS plus on average
+ *  half the minimum contention window before they go out.
+ */
+typedef struct {
+    const char* name;       /* Column name                          */
+    double rate_mbps;       /* Data rate                            */
+    double preamble_us;     /* PLCP preamble and header             */
+    double difs_us;         /* DCF interframe space                 */
+    double slot_us;         /* Backoff slot time                    */
+    unsigned cw_min;        /* Minimum contention window            */
+    bool ofdm;              /* Payload sent in 4us OFDM symbols?    */
+} bench_phy;
+
+
+static const bench_phy BENCH_PHYS[] = {
+    { "1M DSSS",   1.0, 192.0, 50.0, 20.0, 31, false },
+    { "6M OFDM",   6.0,  20.0, 34.0,  9.0, 15, true  },
+    { "24M OFDM", 24.0,  20.0, 34.0,  9.0, 15, true  },
+    { "54M OFDM", 54.0,  20.0, 34.0,  9.0, 15, true  },
+};
+
+#define BENCH_NB_PHYS (sizeof(BENCH_PHYS) / sizeof(BENCH_PHYS[0]))
+
+
+/**
+ *  DESCRIPTION:    Airtime of one data frame
+ *
+ *  ARGUMENTS:
+ *
+ *      phy:        PHY the frame is sent with
+ *
+ *      payload:    Payload size in bytes
+ *
+ *  RETURNS:
+ *
+ *      double:     Microseconds the frame holds the channel for
+ *
+ */
+static double frame_airtime_us(const bench_phy* phy, size_t payload) {
+    double bits = 8.0 * (payload + BENCH_MAC_OVERHEAD);
+    double access_us = phy->difs_us + phy->slot_us * phy->cw_min / 2.0;
+
+    if(phy->ofdm) {
+        // 16 service bits and 6 tail bits, padded to whole symbols
+        double bits_per_symbol = 4.0 * phy->rate_mbps;
+        return access_us + phy->preamble_us + 4.0 * ceil((16 + bits + 6) / bits_per_symbol);
+    }
+    return access_us + phy->preamble_us + bits / phy->rate_mbps;
+}
+
+
+static double uniform() {
+    return (rand() + 1.0) / ((double) RAND_MAX + 2.0);
+}
+
+
+/**
+ *  DESCRIPTION:    Passes the encoded frames through the channel, dropping
+ *                  whole frames and flipping bits in the ones that arrive
+ *
+ *  ARGUMENTS:
+ *
+ *      encoded:    Encoded message
+ *
+ *      nframes:    Number of frames in the encoded message
+ *
+ *      frame_size: Size of each frame
+ *
+ *      frame_loss: Probability a frame is lost
+ *
+ *      ber:        Bit error rate of the frames that arrive
+ *
+ *      received:   Set to the frames that arrived
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Size of the received message in bytes
+ *
+ */
+static size_t apply_channel(const uint8_t* encoded, size_t nframes, size_t frame_size, double frame_loss, double ber, uint8_t* received) {
+    size_t nbytes = 0;
+    for(size_t i = 0; i < nframes; ++i) {
+        if(uniform() < frame_loss) {
+            continue;
+        }
+        memcpy(received + nbytes, encoded + i * frame_size, frame_size);
+        nbytes += frame_size;
+    }
+
+    // Skip ahead a geometric number of bits between errors
+    if(ber > 0) {
+        double bit = -log(uniform()) / ber;
+        while(bit < 8.0 * nbytes) {
+            size_t pos = (size_t) bit;
+            received[pos / 8] ^= 1 << (pos % 8);
+            bit += 1.0 + -log(uniform()) / ber;
+        }
+    }
+    return nbytes;
+}
+
+
+int main(int argc, char** argv) {
+    double frame_loss   = argc > 1 ? atof(argv[1]) : BENCH_DFLT_FRAME_LOSS;
+    double ber          = argc > 2 ? atof(argv[2]) : BENCH_DFLT_BER;
+    unsigned object_kb  = argc > 3 ? (unsigned)atoi(argv[3]) : BENCH_DFLT_OBJECT_KB;
+    unsigned trials     = argc > 4 ? (unsigned)atoi(argv[4]) : BENCH_DFLT_TRIALS;
+
+    if(frame_loss < 0.0 || frame_loss >= 1.0 || ber < 0.0 || ber >= 1.0 || object_kb == 0 || trials == 0) {
+        fprintf(stderr, "Usage: %s [frame_loss] [ber] [object_kb] [trials]\n", argv[0]);
+        return 1;
+    }
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_OFF);
+    srand(1);
+
+    size_t msglen = (size_t) object_kb * 1024;
+    uint8_t* msg = malloc(msglen);
+    for(size_t i = 0; i < msglen; ++i) {
+        msg[i] = rand();
+    }
+
+    dxwifi_fec_params params = DXWIFI_FEC_PARAMS_DFLT_INITIALIZER;
+
+    printf("object: %uKB, coderate: %.3f, frame loss: %.3f, BER: %g, trials: %u\n", object_kb, params.coderate, frame_loss, ber, trials);
+    printf("Goodput in Mbps is the object size over the airtime of every frame sent,\n");
+    printf("counting DIFS, mean backoff, preamble, MAC header and FCS, zero if decoding failed.\n\n");
+    printf("%6s %6s %6s %6s %9s %9s", "blocks", "frame", "symbol", "N", "decoded", "decode ms");
+    for(size_t p = 0; p < BENCH_NB_PHYS; ++p) {
+        printf(" %9s", BENCH_PHYS[p].name);
+    }
+    printf("\n");
+
+    int failures = 0;
+    for(uint8_t blocks = 1; blocks <= DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX; ++blocks) {
+        params.frame_blocks = blocks;
+        size_t frame_size   = DXWIFI_RS_LDPC_FRAME_SIZE_FOR(blocks);
+
+        unsigned decoded = 0;
+        size_t nframes = 0;
+        uint64_t decode_ns = 0;
+        double goodput[BENCH_NB_PHYS] = { 0 };
+
+        for(unsigned t = 0; t < trials; ++t) {
+            void* encoded = NULL;
+            ssize_t enclen = dxwifi_encode_with_params(msg, msglen, &params, &encoded, NULL);
+            if(enclen < 0) {
+                fprintf(stderr, "blocks=%u: encode failed - %s\n", blocks, dxwifi_fec_error_to_str(enclen));
+                ++failures;
+                break;
+            }
+            nframes = enclen / frame_size;
+
+            uint8_t* received = malloc(enclen);
+            size_t reclen = apply_channel(encoded, nframes, frame_size, frame_loss, ber, received);
+
+            void* out = NULL;
+            uint64_t start = bench_now_ns();
+            ssize_t nbytes = dxwifi_decode(received, reclen, &out);
+            decode_ns += bench_now_ns() - start;
+
+            if(nbytes == (ssize_t) msglen && memcmp(out, msg, msglen) == 0) {
+                ++decoded;
+                for(size_t p = 0; p < BENCH_NB_PHYS; ++p) {
+                    goodput[p] += 8.0 * msglen / (nframes * frame_airtime_us(&BENCH_PHYS[p], frame_size));
+                }
+            }
+            free(out);
+            free(received);
+            free(encoded);
+        }
+
+        printf("%6u %6zu %6zu %6zu %5u/%-3u %9.1f", blocks, frame_size, DXWIFI_FEC_SYMBOL_SIZE_FOR(blocks), nframes, decoded, trials, decode_ns / 1e6 / trials);
+        for(size_t p = 0; p < BENCH_NB_PHYS; ++p) {
+            printf(" %9.3f", goodput[p] / trials);
+        }
+        printf("\n");
+    }
+    free(msg);
+    return failures != 0;
+}
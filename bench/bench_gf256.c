@@ -0,0 +1,172 @@
+/**
+ *  bench_gf256.c
+ *
+ *  DESCRIPTION: Measures the throughput of each OpenFEC Reed-Solomon GF(2^8)
+ *  multiply-accumulate kernel supported by this CPU
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  USAGE: bench_gf256 [symbol_size] [iterations]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <of_openfec_api.h>
+#include <reed-solomon_gf_2_8/of_reed-solomon_gf_2_8.h>
+
+#include <bench/bench.h>
+
+#include <libdxwifi/fec.h>
+
+
+#define BENCH_DFLT_ITERATIONS 200
+
+// Source symbols per pass, the size of a small DxWiFi object
+#define BENCH_NB_SOURCES 32
+
+// Repair rows built per pass, 1 is the plain addmul
+static const unsigned BENCH_ROW_COUNTS[] = { 1, 4, 16, 32 };
+
+#define BENCH_NB_ROW_COUNTS (sizeof(BENCH_ROW_COUNTS) / sizeof(BENCH_ROW_COUNTS[0]))
+
+#define BENCH_MAX_ROWS 32
+
+
+/**
+ *  DESCRIPTION:    Checks a kernel against the generic one on random data with
+ *                  every row count, zero coefficients and misaligned symbols
+ *
+ *  ARGUMENTS:
+ *
+ *      kernel:     Kernel under test
+ *
+ *      generic:    Reference kernel
+ *
+ *      symbol_size: Size of each symbol
+ *
+ *  RETURNS:
+ *
+ *      bool:       true if every result matched
+ *
+ */
+static bool verify_kernel(of_rs_addmul_kernel_t kernel, of_rs_addmul_kernel_t generic, unsigned symbol_size) {
+    const unsigned pad      = 32;
+    const unsigned nb_src   = 5;
+    const unsigned stride   = symbol_size + pad;
+
+    uint8_t* expected   = malloc(BENCH_MAX_ROWS * stride);
+    uint8_t* actual     = malloc(BENCH_MAX_ROWS * stride);
+    uint8_t* sources    = malloc(nb_src * stride);
+    uint8_t coefs[BENCH_MAX_ROWS * 5];
+    uint8_t* src[5];
+    uint8_t* exp_rows[BENCH_MAX_ROWS];
+    uint8_t* act_rows[BENCH_MAX_ROWS];
+
+    bool ok = true;
+    for(unsigned align = 0; align < pad && ok; ++align) {
+        for(unsigned rows = 1; rows <= BENCH_MAX_ROWS && ok; rows += 7) {
+            for(unsigned i = 0; i < nb_src * stride; ++i) {
+                sources[i] = rand();
+            }
+            for(unsigned i = 0; i < nb_src; ++i) {
+                src[i] = sources + i * stride + (align * (i + 1)) % pad;
+            }
+            for(unsigned i = 0; i < rows * nb_src; ++i) {
+                coefs[i] = (i % 3 == 0) ? 0 : rand();
+            }
+            for(unsigned i = 0; i < BENCH_MAX_ROWS * stride; ++i) {
+                expected[i] = actual[i] = rand();
+            }
+            for(unsigned r = 0; r < rows; ++r) {
+                exp_rows[r] = expected + r * stride + align;
+                act_rows[r] = actual + r * stride + align;
+            }
+            generic(exp_rows, rows, src, nb_src, coefs, symbol_size);
+            kernel(act_rows, rows, src, nb_src, coefs, symbol_size);
+            ok = memcmp(expected, actual, BENCH_MAX_ROWS * stride) == 0;
+        }
+    }
+    free(expected);
+    free(actual);
+    free(sources);
+    return ok;
+}
+
+
+int main(int argc, char** argv) {
+    unsigned symbol_size    = argc > 1 ? (unsigned)atoi(argv[1]) : DXWIFI_FEC_SYMBOL_SIZE;
+    unsigned iterations     = argc > 2 ? atoi(argv[2]) : BENCH_DFLT_ITERATIONS;
+
+    if(symbol_size == 0 || iterations == 0) {
+        fprintf(stderr, "Usage: %s [symbol_size] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t* sources = malloc((size_t)BENCH_NB_SOURCES * symbol_size);
+    uint8_t* repairs = malloc((size_t)BENCH_MAX_ROWS * symbol_size);
+    uint8_t coefs[BENCH_MAX_ROWS * BENCH_NB_SOURCES];
+    uint8_t* src[BENCH_NB_SOURCES];
+    uint8_t* dst[BENCH_MAX_ROWS];
+
+    for(size_t i = 0; i < (size_t)BENCH_NB_SOURCES * symbol_size; ++i) {
+        sources[i] = rand();
+    }
+    for(unsigned i = 0; i < BENCH_MAX_ROWS * BENCH_NB_SOURCES; ++i) {
+        coefs[i] = 1 + rand() % 255;
+    }
+    for(unsigned i = 0; i < BENCH_NB_SOURCES; ++i) {
+        src[i] = sources + (size_t)i * symbol_size;
+    }
+    for(unsigned i = 0; i < BENCH_MAX_ROWS; ++i) {
+        dst[i] = repairs + (size_t)i * symbol_size;
+    }
+
+    of_rs_addmul_kernel_t generic = of_rs_find_addmul_kernel("generic");
+
+    printf("symbol size:        %u\n", symbol_size);
+    printf("source symbols:     %u\n", BENCH_NB_SOURCES);
+    printf("iterations:         %u\n", iterations);
+    printf("selected kernel:    %s\n", of_rs_get_current_addmul_kernel_name());
+    printf("%-10s", "kernel");
+    for(unsigned r = 0; r < BENCH_NB_ROW_COUNTS; ++r) {
+        printf("  %6u rows", BENCH_ROW_COUNTS[r]);
+    }
+    printf("   (GB/s of products)\n");
+
+    int mismatches = 0;
+    const char* name = NULL;
+    for(UINT32 k = 0; (name = of_rs_get_addmul_kernel_name(k)) != NULL; ++k) {
+        of_rs_addmul_kernel_t kernel = of_rs_find_addmul_kernel(name);
+        if(!kernel) {
+            printf("%-10s  not supported\n", name);
+            continue;
+        }
+        if(!verify_kernel(kernel, generic, symbol_size)) {
+            printf("%-10s  MISMATCH\n", name);
+            ++mismatches;
+            continue;
+        }
+
+        printf("%-10s", name);
+        for(unsigned r = 0; r < BENCH_NB_ROW_COUNTS; ++r) {
+            unsigned rows = BENCH_ROW_COUNTS[r];
+
+            uint64_t start = bench_now_ns();
+            for(unsigned it = 0; it < iterations; ++it) {
+                kernel(dst, rows, src, BENCH_NB_SOURCES, coefs, symbol_size);
+                bench_do_not_optimize(repairs);
+            }
+            uint64_t elapsed = bench_now_ns() - start;
+
+            printf("  %11.2f", (double)iterations * rows * BENCH_NB_SOURCES * symbol_size / elapsed);
+        }
+        printf("\n");
+    }
+    free(sources);
+    free(repairs);
+
+    return mismatches != 0;
+}
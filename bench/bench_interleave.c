@@ -0,0 +1,264 @@
+/**
+ *  bench_interleave.c
+ *
+ *  DESCRIPTION: Decoding of an object sent over a bursty lossy channel for
+ *  every RS interleave depth, and the least LDPC repair each one gets by with
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  USAGE: bench_interleave [frame_loss] [burst_len] [ber] [object_kb] [trials]
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bench/bench.h>
+
+#include <libdxwifi/fec.h>
+#include <libdxwifi/details/logging.h>
+
+
+#define BENCH_DFLT_FRAME_LOSS   0.05
+#define BENCH_DFLT_BURST_LEN    2.0
+#define BENCH_DFLT_BER          0.0
+#define BENCH_DFLT_OBJECT_KB    256
+#define BENCH_DFLT_TRIALS       4
+
+// Value the receiver fills lost frames with in ordered mode
+#define BENCH_NOISE_VALUE 0xff
+
+static const uint8_t BENCH_DEPTHS[] = { 1, 8, 12, 16 };
+
+#define BENCH_NB_DEPTHS (sizeof(BENCH_DEPTHS) / sizeof(BENCH_DEPTHS[0]))
+
+// Coderates tried from the least repair to the most
+static const float BENCH_CODERATES[] = { 0.95, 0.9, 0.85, 0.8, 0.75, 0.667, 0.6, 0.5 };
+
+#define BENCH_NB_CODERATES (sizeof(BENCH_CODERATES) / sizeof(BENCH_CODERATES[0]))
+
+
+/**
+ *  Two state Gilbert-Elliott channel, every frame sent in the bad state is
+ *  lost. Bursts last `burst_len` frames on average and the long run loss rate
+ *  is `frame_loss`.
+ */
+typedef struct {
+    double p_good_to_bad;   /* Chance a burst starts after a received frame */
+    double p_bad_to_good;   /* Chance a burst ends after a lost frame       */
+    double ber;             /* Bit error rate of the frames that arrive     */
+} bench_channel;
+
+
+static double uniform() {
+    return (rand() + 1.0) / ((double) RAND_MAX + 2.0);
+}
+
+
+/**
+ *  DESCRIPTION:    Passes the encoded frames through the channel the way an
+ *                  ordered receiver with noise enabled writes them out. Lost
+ *                  frames are filled with noise, except for those before the
+ *                  first and after the last received frame which are missing.
+ *
+ *  ARGUMENTS:
+ *
+ *      channel:    Channel model
+ *
+ *      encoded:    Encoded message
+ *
+ *      nframes:    Number of frames in the encoded message
+ *
+ *      frame_size: Size of each frame
+ *
+ *      received:   Set to the captured message
+ *
+ *      nlost:      Set to the number of frames lost
+ *
+ *  RETURNS:
+ *
+ *      size_t:     Size of the captured message in bytes
+ *
+ */
+static size_t apply_channel(const bench_channel* channel, const uint8_t* encoded, size_t nframes, size_t frame_size, uint8_t* received, size_t* nlost) {
+    size_t first = nframes, last = 0;
+    bool bad = false;
+
+    *nlost = 0;
+    for(size_t i = 0; i < nframes; ++i) {
+        bad = uniform() < (bad ? 1.0 - channel->p_bad_to_good : channel->p_good_to_bad);
+
+        uint8_t* frame = received + i * frame_size;
+        if(bad) {
+            memset(frame, BENCH_NOISE_VALUE, frame_size);
+            ++*nlost;
+            continue;
+        }
+        memcpy(frame, encoded + i * frame_size, frame_size);
+
+        // Skip ahead a geometric number of bits between errors
+        if(channel->ber > 0) {
+            double bit = -log(uniform()) / channel->ber;
+            while(bit < 8.0 * frame_size) {
+                size_t pos = (size_t) bit;
+                frame[pos / 8] ^= 1 << (pos % 8);
+                bit += 1.0 + -log(uniform()) / channel->ber;
+            }
+        }
+        first = first < i ? first : i;
+        last  = i;
+    }
+    if(first == nframes) {
+        return 0;
+    }
+    memmove(received, received + first * frame_size, (last + 1 - first) * frame_size);
+    return (last + 1 - first) * frame_size;
+}
+
+
+/**
+ *  DESCRIPTION:    Encodes, sends and decodes the message once
+ *
+ *  ARGUMENTS:
+ *
+ *      channel:    Channel model
+ *
+ *      params:     FEC parameters
+ *
+ *      msg:        Message to send
+ *
+ *      msglen:     Size of the message
+ *
+ *      seed:       Seeds the channel, equal seeds lose the same frames
+ *
+ *      nframes:    Set to the number of frames sent
+ *
+ *      nlost:      Set to the number of frames lost
+ *
+ *      decode_ns:  Incremented by the time spent decoding
+ *
+ *      systematic: Incremented if the decode skipped LDPC decoding, may be 
+ *                  NULL
+ *
+ *  RETURNS:
+ *
+ *      bool:       true if the message decoded and matched the original
+ *
+ */
+static bool send_once(const bench_channel* channel, const dxwifi_fec_params* params, const uint8_t* msg, size_t msglen, unsigned seed, size_t* nframes, size_t* nlost, uint64_t* decode_ns, unsigned* systematic) {
+    size_t frame_size = DXWIFI_RS_LDPC_FRAME_SIZE_FOR(params->frame_blocks);
+
+    void* encoded = NULL;
+    ssize_t enclen = dxwifi_encode_with_params((void*) msg, msglen, params, &encoded, NULL);
+    if(enclen < 0) {
+        return false;
+    }
+    *nframes = enclen / frame_size;
+
+    srand(seed);
+    uint8_t* received = malloc(enclen);
+    size_t reclen = apply_channel(channel, encoded, *nframes, frame_size, received, nlost);
+
+    void* out = NULL;
+    dxwifi_fec_stats stats = { .systematic = false };
+    uint64_t start = bench_now_ns();
+    ssize_t nbytes = reclen ? dxwifi_decode_with_stats(received, reclen, &out, systematic ? &stats : NULL) : -1;
+    *decode_ns += bench_now_ns() - start;
+
+    if(systematic) {
+        *systematic += stats.systematic;
+    }
+
+    bool ok = nbytes == (ssize_t) msglen && memcmp(out, msg, msglen) == 0;
+
+    free(out);
+    free(received);
+    free(encoded);
+    return ok;
+}
+
+
+int main(int argc, char** argv) {
+    double frame_loss   = argc > 1 ? atof(argv[1]) : BENCH_DFLT_FRAME_LOSS;
+    double burst_len    = argc > 2 ? atof(argv[2]) : BENCH_DFLT_BURST_LEN;
+    double ber          = argc > 3 ? atof(argv[3]) : BENCH_DFLT_BER;
+    unsigned object_kb  = argc > 4 ? (unsigned)atoi(argv[4]) : BENCH_DFLT_OBJECT_KB;
+    unsigned trials     = argc > 5 ? (unsigned)atoi(argv[5]) : BENCH_DFLT_TRIALS;
+
+    if(frame_loss < 0.0 || frame_loss >= 1.0 || burst_len < 1.0 || ber < 0.0 || ber >= 1.0 || object_kb == 0 || trials == 0) {
+        fprintf(stderr, "Usage: %s [frame_loss] [burst_len] [ber] [object_kb] [trials]\n", argv[0]);
+        return 1;
+    }
+
+    bench_channel channel = {
+        .p_good_to_bad  = frame_loss / (burst_len * (1.0 - frame_loss)),
+        .p_bad_to_good  = 1.0 / burst_len,
+        .ber            = ber
+    };
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_OFF);
+    srand(1);
+
+    size_t msglen = (size_t) object_kb * 1024;
+    uint8_t* msg = malloc(msglen);
+    for(size_t i = 0; i < msglen; ++i) {
+        msg[i] = rand();
+    }
+
+    dxwifi_fec_params params = DXWIFI_FEC_PARAMS_DFLT_INITIALIZER;
+    const float coderate = params.coderate;
+
+    printf("object: %uKB, coderate: %.3f, frame loss: %.3f, mean burst: %.1f frames, BER: %g, trials: %u\n", object_kb, coderate, frame_loss, burst_len, ber, trials);
+    printf("Frames are lost in bursts and kept in place as an ordered receiver with noise\n");
+    printf("does. Systematic decodes needed no LDPC repair, RS filled every lost frame.\n");
+    printf("Best coderate is the highest one that decoded every trial.\n\n");
+    printf("%6s %6s %8s %9s %11s %9s %13s\n", "depth", "N", "lost", "decoded", "systematic", "decode ms", "best coderate");
+
+    for(size_t d = 0; d < BENCH_NB_DEPTHS; ++d) {
+        params.interleave_depth = BENCH_DEPTHS[d];
+        params.coderate         = coderate;
+
+        unsigned decoded = 0;
+        size_t nframes = 0, nlost = 0, lost_total = 0;
+        uint64_t decode_ns = 0;
+
+        unsigned systematic = 0;
+        for(unsigned t = 0; t < trials; ++t) {
+            decoded += send_once(&channel, &params, msg, msglen, t + 1, &nframes, &nlost, &decode_ns, &systematic);
+            lost_total += nlost;
+        }
+
+        // Same channel realizations with less and less repair
+        float best = 0.0;
+        for(size_t c = 0; c < BENCH_NB_CODERATES && best == 0.0; ++c) {
+            params.coderate = BENCH_CODERATES[c];
+
+            bool all = true;
+            uint64_t unused = 0;
+            for(unsigned t = 0; t < trials && all; ++t) {
+                size_t n = 0, lost = 0;
+                all = send_once(&channel, &params, msg, msglen, t + 1, &n, &lost, &unused, NULL);
+            }
+            best = all ? BENCH_CODERATES[c] : 0.0;
+        }
+
+        printf("%6u %6zu %8.1f %5u/%-3u %7u/%-3u %9.1f",
+            BENCH_DEPTHS[d],
+            nframes,
+            (double) lost_total / trials,
+            decoded, trials,
+            systematic, trials,
+            decode_ns / 1e6 / trials
+        );
+        if(best > 0.0) {
+            printf(" %13.3f\n", best);
+        }
+        else {
+            printf(" %13s\n", "none");
+        }
+    }
+    free(msg);
+    return 0;
+}
@@ -0,0 +1,458 @@
+/**
+ *  bench_link.c
+ *
+ *  DESCRIPTION: Runs files through the whole offline link in one process.
+ *  The transmitter encodes and injects into a pipe, a receiver on another
+ *  thread captures from the pipe and reorders the frames, and the capture is
+ *  decoded and checked against the original. Reports goodput, CPU time per
+ *  stage and percentiles of the per-frame latency through the pipe.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  USAGE: bench_link [-r coderate] [-b frame_blocks] [-t trials] [-k kb]
+ *                    [-f table|csv] [file ...]
+ *
+ *  A random object of -k KB is sent when no files are given.
+ *
+ *  NOTES: Only test builds (TestDebug, TestRel) carry the savefile transport
+ *  this is built on. Each frame is flushed into the pipe as it's injected so
+ *  latency isn't hidden in stdio buffering.
+ *
+ */
+
+#define _GNU_SOURCE // memfd_create
+
+#include <math.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <bench/bench.h>
+
+#include <libdxwifi/fec.h>
+#include <libdxwifi/receiver.h>
+#include <libdxwifi/transmitter.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/metrics.h>
+
+
+#if defined(DXWIFI_TESTS)
+
+#define BENCH_DFLT_TRIALS       3
+#define BENCH_DFLT_OBJECT_KB    1024
+
+#define BENCH_CAPTURE_FILE      "dxwifi-bench-capture"
+
+
+/**
+ *  Where the CPU went for one trip over the link. The capture thread belongs
+ *  to the receiver so it's whatever the process used that the other threads
+ *  didn't, including opening both ends of the pipe.
+ */
+typedef struct {
+    uint64_t encode_ns;     /* FEC encoding                                 */
+    uint64_t transmit_ns;   /* Frame building, handlers and injection       */
+    uint64_t capture_ns;    /* Capture thread and link setup                */
+    uint64_t process_ns;    /* Frame validation, reordering and writing     */
+    uint64_t decode_ns;     /* FEC decoding                                 */
+} bench_cpu;
+
+
+typedef struct {
+    dxwifi_receiver receiver;   /* Reads from the pipe                      */
+    int fd;                     /* Capture output                           */
+    dxwifi_rx_stats stats;      /* Set when the capture finishes            */
+    uint64_t cpu_ns;            /* CPU the receiving thread used            */
+} bench_rx;
+
+
+static uint64_t cpu_now_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+// Pushes each frame through the pipe before the next one is built
+static bool flush_savefile(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user) {
+    pcap_dump_flush((pcap_dumper_t*) user);
+    return true;
+}
+
+
+static void* receive(void* args) {
+    bench_rx* rx = (bench_rx*) args;
+
+    // Blocks until the transmitter opens the other end
+    init_receiver(&rx->receiver, NULL);
+
+    uint64_t start = cpu_now_ns(CLOCK_THREAD_CPUTIME_ID);
+    receiver_activate_capture(&rx->receiver, rx->fd, &rx->stats);
+    rx->cpu_ns = cpu_now_ns(CLOCK_THREAD_CPUTIME_ID) - start;
+
+    close_receiver(&rx->receiver);
+    return NULL;
+}
+
+
+static void reset_histogram(dxwifi_histogram* hist) {
+    for(size_t i = 0; i <= hist->nbounds; ++i) {
+        atomic_store(&hist->buckets[i], 0);
+    }
+    atomic_store(&hist->sum, 0);
+}
+
+
+/**
+ *  DESCRIPTION:    Estimates a percentile from a histogram the way Prometheus'
+ *                  histogram_quantile() does, interpolating inside a bucket
+ *
+ *  ARGUMENTS:
+ *
+ *      hist:       Histogram to read
+ *
+ *      q:          Quantile between 0 and 1
+ *
+ *  RETURNS:
+ *
+ *      double:     Estimated value in recorded units, NAN if the histogram is
+ *                  empty. Values past the last bound report the last bound.
+ *
+ */
+static double histogram_percentile(const dxwifi_histogram* hist, double q) {
+    uint64_t counts[DXWIFI_METRICS_BOUNDS_MAX + 1];
+    uint64_t total = 0;
+    for(size_t i = 0; i <= hist->nbounds; ++i) {
+        counts[i] = atomic_load(&hist->buckets[i]);
+        total += counts[i];
+    }
+    if(total == 0) {
+        return NAN;
+    }
+
+    double rank = q * total;
+    uint64_t below = 0;
+    for(size_t i = 0; i < hist->nbounds; ++i) {
+        if(below + counts[i] >= rank && counts[i] > 0) {
+            double lower = i ? hist->bounds[i - 1] : 0.0;
+            return lower + (hist->bounds[i] - lower) * (rank - below) / counts[i];
+        }
+        below += counts[i];
+    }
+    return hist->bounds[hist->nbounds - 1];
+}
+
+
+/**
+ *  DESCRIPTION:    Sends a message over the link once
+ *
+ *  ARGUMENTS:
+ *
+ *      fifo:       Pipe between the transmitter and receiver
+ *
+ *      msg:        Message to send
+ *
+ *      msglen:     Size of the message
+ *
+ *      params:     FEC parameters
+ *
+ *      cpu:        Incremented by the CPU used in each stage
+ *
+ *      nframes:    Set to the number of data frames sent
+ *
+ *      link_ns:    Incremented by the time from opening the link until the
+ *                  capture finished
+ *
+ *  RETURNS:
+ *
+ *      bool:       true if the message decoded and matched the original
+ *
+ */
+static bool send_once(const char* fifo, const uint8_t* msg, size_t msglen, const dxwifi_fec_params* params, bench_cpu* cpu, uint32_t* nframes, uint64_t* link_ns) {
+    uint64_t start = cpu_now_ns(CLOCK_THREAD_CPUTIME_ID);
+    void* encoded = NULL;
+    ssize_t enclen = dxwifi_encode_with_params((void*) msg, msglen, params, &encoded, NULL);
+    cpu->encode_ns += cpu_now_ns(CLOCK_THREAD_CPUTIME_ID) - start;
+
+    if(enclen < 0) {
+        fprintf(stderr, "Encode failed - %s\n", dxwifi_fec_error_to_str(enclen));
+        return false;
+    }
+
+    bench_rx rx = { .receiver = DXWIFI_RECEIVER_DFLT_INITIALIZER };
+    rx.receiver.savefile = fifo;
+    rx.fd = memfd_create(BENCH_CAPTURE_FILE, 0);
+    if(rx.fd < 0) {
+        perror("memfd_create");
+        free(encoded);
+        return false;
+    }
+
+    dxwifi_transmitter tx = DXWIFI_TRANSMITTER_DFLT_INITIALIZER;
+    tx.savefile     = fifo;
+    tx.payload_size = DXWIFI_RS_LDPC_FRAME_SIZE_FOR(params->frame_blocks);
+
+    uint64_t link_start = bench_now_ns();
+    uint64_t process_start = cpu_now_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+    pthread_t receiver;
+    pthread_create(&receiver, NULL, receive, &rx);
+
+    init_transmitter(&tx, NULL);
+    attach_postinject_handler(&tx, flush_savefile, tx.dumper);
+
+    dxwifi_tx_stats stats;
+    start = cpu_now_ns(CLOCK_THREAD_CPUTIME_ID);
+    transmit_bytes(&tx, encoded, enclen, &stats);
+    cpu->transmit_ns += cpu_now_ns(CLOCK_THREAD_CPUTIME_ID) - start;
+
+    // End of file stops the capture if the EOT didn't
+    close_transmitter(&tx);
+    pthread_join(receiver, NULL);
+
+    *link_ns += bench_now_ns() - link_start;
+    uint64_t process_ns = cpu_now_ns(CLOCK_PROCESS_CPUTIME_ID) - process_start;
+    uint64_t accounted  = rx.cpu_ns + (cpu_now_ns(CLOCK_THREAD_CPUTIME_ID) - start);
+    cpu->capture_ns += process_ns > accounted ? process_ns - accounted : 0;
+    cpu->process_ns += rx.cpu_ns;
+    *nframes = stats.data_frame_count;
+    free(encoded);
+
+    bool ok = false;
+    struct stat st;
+    if(fstat(rx.fd, &st) == 0 && st.st_size > 0) {
+        void* captured = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, rx.fd, 0);
+        if(captured != MAP_FAILED) {
+            void* out = NULL;
+            start = cpu_now_ns(CLOCK_THREAD_CPUTIME_ID);
+            ssize_t nbytes = dxwifi_decode(captured, st.st_size, &out);
+            cpu->decode_ns += cpu_now_ns(CLOCK_THREAD_CPUTIME_ID) - start;
+
+            ok = nbytes == (ssize_t) msglen && memcmp(out, msg, msglen) == 0;
+            free(out);
+            munmap(captured, st.st_size);
+        }
+    }
+    close(rx.fd);
+    return ok;
+}
+
+
+static void print_header(bool csv) {
+    if(csv) {
+        printf("object,bytes,frames,trials,decoded,goodput_mbps,link_mbps,"
+               "encode_cpu_ms,transmit_cpu_ms,capture_cpu_ms,process_cpu_ms,decode_cpu_ms,"
+               "latency_p50_us,latency_p90_us,latency_p99_us,inject_p50_us,inject_p99_us\n");
+        return;
+    }
+    printf("%-20s %9s %6s %7s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n",
+        "object", "bytes", "frames", "decoded", "goodput", "link", "encode", "transmit", "capture", "process", "decode",
+        "lat p50", "lat p90", "lat p99", "inj p50", "inj p99");
+    printf("%-20s %9s %6s %7s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n",
+        "", "", "", "", "Mbps", "Mbps", "cpu ms", "cpu ms", "cpu ms", "cpu ms", "cpu ms", "us", "us", "us", "us", "us");
+}
+
+
+/**
+ *  DESCRIPTION:    Sends one object over the link for every trial and prints
+ *                  its row
+ *
+ *  ARGUMENTS:
+ *
+ *      name:       Object name for the output
+ *
+ *      msg:        Object to send
+ *
+ *      msglen:     Size of the object
+ *
+ *      params:     FEC parameters
+ *
+ *      trials:     Number of times the object is sent
+ *
+ *      fifo:       Pipe between the transmitter and receiver
+ *
+ *      csv:        Print CSV instead of a table?
+ *
+ *  RETURNS:
+ *
+ *      unsigned:   Number of trials that failed to decode
+ *
+ */
+static unsigned bench_object(const char* name, const uint8_t* msg, size_t msglen, const dxwifi_fec_params* params, unsigned trials, const char* fifo, bool csv) {
+    bench_cpu cpu = { 0 };
+    uint32_t nframes = 0;
+    uint64_t link_ns = 0;
+    unsigned decoded = 0;
+
+    reset_histogram(&__dxwifi_rx_metrics.frame_latency);
+    reset_histogram(&__dxwifi_tx_metrics.inject_latency);
+
+    uint64_t start = bench_now_ns();
+    for(unsigned t = 0; t < trials; ++t) {
+        decoded += send_once(fifo, msg, msglen, params, &cpu, &nframes, &link_ns);
+    }
+    uint64_t elapsed_ns = bench_now_ns() - start;
+
+    const dxwifi_histogram* latency = &__dxwifi_rx_metrics.frame_latency;
+    const dxwifi_histogram* inject  = &__dxwifi_tx_metrics.inject_latency;
+    double row[] = {
+        decoded ? 8e3 * msglen * decoded / elapsed_ns : 0.0,
+        8e3 * msglen * trials / link_ns,
+        cpu.encode_ns / 1e6 / trials,
+        cpu.transmit_ns / 1e6 / trials,
+        cpu.capture_ns / 1e6 / trials,
+        cpu.process_ns / 1e6 / trials,
+        cpu.decode_ns / 1e6 / trials,
+        histogram_percentile(latency, 0.50) / 1e3,
+        histogram_percentile(latency, 0.90) / 1e3,
+        histogram_percentile(latency, 0.99) / 1e3,
+        histogram_percentile(inject, 0.50) / 1e3,
+        histogram_percentile(inject, 0.99) / 1e3
+    };
+
+    if(csv) {
+        printf("%s,%zu,%u,%u,%u", name, msglen, nframes, trials, decoded);
+        for(size_t i = 0; i < sizeof(row) / sizeof(row[0]); ++i) {
+            printf(",%.3f", row[i]);
+        }
+    }
+    else {
+        printf("%-20.20s %9zu %6u %3u/%-3u", name, msglen, nframes, decoded, trials);
+        for(size_t i = 0; i < sizeof(row) / sizeof(row[0]); ++i) {
+            printf(" %8.2f", row[i]);
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+    return trials - decoded;
+}
+
+
+// Maps a file into a private copy, NULL on failure
+static uint8_t* read_object(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    uint8_t* data = NULL;
+    if(fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = malloc(st.st_size);
+        if(data && read(fd, data, st.st_size) != st.st_size) {
+            free(data);
+            data = NULL;
+        }
+        *size = st.st_size;
+    }
+    if(!data) {
+        fprintf(stderr, "%s: failed to read\n", path);
+    }
+    close(fd);
+    return data;
+}
+
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-r coderate] [-b frame_blocks] [-t trials] [-k kb] [-f table|csv] [file ...]\n", prog);
+}
+
+
+int main(int argc, char** argv) {
+    dxwifi_fec_params params = DXWIFI_FEC_PARAMS_DFLT_INITIALIZER;
+    unsigned trials     = BENCH_DFLT_TRIALS;
+    unsigned object_kb  = BENCH_DFLT_OBJECT_KB;
+    bool csv            = false;
+
+    int opt;
+    while((opt = getopt(argc, argv, "r:b:t:k:f:h")) != -1) {
+        switch(opt) {
+        case 'r': params.coderate = atof(optarg); break;
+        case 'b': params.frame_blocks = (uint8_t) atoi(optarg); break;
+        case 't': trials = (unsigned) atoi(optarg); break;
+        case 'k': object_kb = (unsigned) atoi(optarg); break;
+        case 'f':
+            if(strcmp(optarg, "csv") != 0 && strcmp(optarg, "table") != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            csv = strcmp(optarg, "csv") == 0;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(params.coderate <= 0.0 || params.coderate > 1.0 || params.frame_blocks == 0 || params.frame_blocks > DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX || trials == 0 || object_kb == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char dir[] = "/tmp/dxwifi-bench-XXXXXX";
+    if(!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char fifo[sizeof(dir) + 8];
+    snprintf(fifo, sizeof(fifo), "%s/link", dir);
+    if(mkfifo(fifo, S_IRUSR | S_IWUSR) < 0) {
+        perror("mkfifo");
+        rmdir(dir);
+        return 1;
+    }
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_OFF);
+
+    if(!csv) {
+        printf("coderate: %.3f, RS blocks per frame: %u, trials: %u\n", params.coderate, params.frame_blocks, trials);
+        printf("Goodput is decoded bits over the whole trip, encode to decode, link is over\n");
+        printf("injection to the end of capture. CPU is per trip. Latency is from each frame's\n");
+        printf("injection to the receiver processing it, estimated from histogram buckets.\n\n");
+    }
+    print_header(csv);
+
+    unsigned failures = 0;
+    if(optind == argc) {
+        size_t msglen = (size_t) object_kb * 1024;
+        uint8_t* msg = malloc(msglen);
+        srand(1);
+        for(size_t i = 0; i < msglen; ++i) {
+            msg[i] = rand();
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "random %uKB", object_kb);
+
+        failures += bench_object(name, msg, msglen, &params, trials, fifo, csv);
+        free(msg);
+    }
+    for(int i = optind; i < argc; ++i) {
+        size_t msglen = 0;
+        uint8_t* msg = read_object(argv[i], &msglen);
+        if(!msg) {
+            ++failures;
+            continue;
+        }
+        const char* name = strrchr(argv[i], '/');
+        failures += bench_object(name ? name + 1 : argv[i], msg, msglen, &params, trials, fifo, csv);
+        free(msg);
+    }
+
+    unlink(fifo);
+    rmdir(dir);
+    return failures != 0;
+}
+
+#else
+
+int main() {
+    fprintf(stderr, "bench_link runs over the savefile transport, build with CMAKE_BUILD_TYPE=TestRel\n");
+    return 1;
+}
+
+#endif // DXWIFI_TESTS
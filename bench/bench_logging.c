@@ -0,0 +1,119 @@
+/**
+ *  bench_logging.c
+ *
+ *  DESCRIPTION: Per packet cost of the receiver's frame logging with every log
+ *  statement compiled in, while the logging module filters them out
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  USAGE: bench_logging [packets] [frame_size]
+ *
+ */
+
+// Keep debug and trace statements in release builds of the benchmark
+#define DXWIFI_LOG_LEVEL 6
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_RECEIVER
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bench/bench.h>
+
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/logging.h>
+
+
+#define BENCH_DFLT_PACKETS      100000
+#define BENCH_DFLT_FRAME_SIZE   1275
+
+
+// Discards messages after they were formatted
+static void null_logger(dxwifi_log_module_t module, dxwifi_log_level_t log_level, const char* fmt, va_list args) {
+    __DXWIFI_UTILS_UNUSED(module, log_level);
+
+    char msg[64];
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    bench_do_not_optimize(msg);
+}
+
+
+// What the receiver logs for each data frame
+static void log_packet(const uint8_t* frame, int frame_no, int caplen, int ant_signal) {
+    log_debug("%d - ( %s ) Packet Length: %d, Antenna Signal: %ddBm", frame_no, "2021-01-01 00:00:00", caplen, ant_signal);
+    log_hexdump(frame, caplen);
+}
+
+
+// The same statements when the module was looked up from the file name and
+// everything was formatted before the level check
+static void log_packet_unfiltered(const uint8_t* frame, int frame_no, int caplen, int ant_signal) {
+    dxwifi_log_module_t module = file_to_log_module(__FILE__);
+    __dxwifi_log(module, DXWIFI_LOG_DEBUG, "%d - ( %s ) Packet Length: %d, Antenna Signal: %ddBm", frame_no, "2021-01-01 00:00:00", caplen, ant_signal);
+
+    module = file_to_log_module(__FILE__);
+    __dxwifi_log_hexdump(module, frame, caplen);
+}
+
+
+typedef void (*bench_log_fn)(const uint8_t* frame, int frame_no, int caplen, int ant_signal);
+
+
+/**
+ *  DESCRIPTION:    Times logging a stream of packets
+ *
+ *  ARGUMENTS:
+ *
+ *      log_fn:     Logs one packet
+ *
+ *      frame:      Captured frame
+ *
+ *      frame_size: Size of the captured frame
+ *
+ *      packets:    Number of packets to log
+ *
+ *  RETURNS:
+ *
+ *      double:     Nanoseconds per packet
+ *
+ */
+static double time_packets(bench_log_fn log_fn, const uint8_t* frame, int frame_size, unsigned packets) {
+    uint64_t start = bench_now_ns();
+    for(unsigned i = 0; i < packets; ++i) {
+        log_fn(frame, i, frame_size, -40);
+        bench_do_not_optimize(frame);
+    }
+    return (double)(bench_now_ns() - start) / packets;
+}
+
+
+int main(int argc, char** argv) {
+    unsigned packets    = argc > 1 ? (unsigned)atoi(argv[1]) : BENCH_DFLT_PACKETS;
+    int frame_size      = argc > 2 ? atoi(argv[2]) : BENCH_DFLT_FRAME_SIZE;
+
+    if(packets == 0 || frame_size <= 0) {
+        fprintf(stderr, "Usage: %s [packets] [frame_size]\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t* frame = malloc(frame_size);
+    for(int i = 0; i < frame_size; ++i) {
+        frame[i] = rand();
+    }
+
+    set_logger(DXWIFI_LOG_ALL_MODULES, null_logger);
+
+    printf("packets: %u, frame size: %d\n", packets, frame_size);
+    printf("Each packet logs a debug line and a hexdump of the frame, the way the\n");
+    printf("receiver does. The enabled row formats everything into a null logger.\n\n");
+    printf("%-36s %12s\n", "logging", "ns/packet");
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_INFO);
+    printf("%-36s %12.1f\n", "filtered at the call site", time_packets(log_packet, frame, frame_size, packets));
+    printf("%-36s %12.1f\n", "file lookup, formatted then filtered", time_packets(log_packet_unfiltered, frame, frame_size, packets));
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_TRACE);
+    printf("%-36s %12.1f\n", "enabled", time_packets(log_packet, frame, frame_size, packets));
+
+    free(frame);
+    return 0;
+}
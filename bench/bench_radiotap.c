@@ -0,0 +1,141 @@
+/**
+ *  bench_radiotap.c
+ * 
+ *  DESCRIPTION: Compares the radiotap iterator against the learned layout fast
+ *  path over every frame in a savefile
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ *  USAGE: bench_radiotap <savefile> [iterations]
+ * 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pcap.h>
+
+#include <bench/bench.h>
+
+#include <libdxwifi/receiver.h>
+#include <libdxwifi/details/logging.h>
+
+
+#define BENCH_DFLT_ITERATIONS 1000
+
+
+typedef struct {
+    uint8_t*    data;       /* Copy of the captured frame */
+    uint32_t    caplen;     /* Captured length            */
+} captured_frame;
+
+
+/**
+ *  DESCRIPTION:    Loads every frame in a savefile into memory
+ * 
+ *  ARGUMENTS:
+ * 
+ *      savefile:   Path to the savefile
+ * 
+ *      count:      Set to the number of frames loaded
+ * 
+ *  RETURNS:
+ * 
+ *      captured_frame*: Allocated array of frames
+ * 
+ */
+static captured_frame* load_frames(const char* savefile, size_t* count) {
+    char err_buff[PCAP_ERRBUF_SIZE];
+    struct pcap_pkthdr* hdr = NULL;
+    const uint8_t* data = NULL;
+
+    pcap_t* handle = pcap_open_offline(savefile, err_buff);
+    if(!handle) {
+        fprintf(stderr, "Failed to open %s: %s\n", savefile, err_buff);
+        exit(1);
+    }
+
+    size_t capacity = 1024;
+    captured_frame* frames = malloc(capacity * sizeof(captured_frame));
+
+    *count = 0;
+    while(pcap_next_ex(handle, &hdr, &data) == 1) {
+        if(*count == capacity) {
+            capacity *= 2;
+            frames = realloc(frames, capacity * sizeof(captured_frame));
+        }
+        frames[*count].data = malloc(hdr->caplen);
+        frames[*count].caplen = hdr->caplen;
+        memcpy(frames[*count].data, data, hdr->caplen);
+        ++*count;
+    }
+    pcap_close(handle);
+
+    return frames;
+}
+
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s <savefile> [iterations]\n", argv[0]);
+        return 1;
+    }
+    unsigned iterations = argc > 2 ? atoi(argv[2]) : BENCH_DFLT_ITERATIONS;
+
+    set_log_level(DXWIFI_LOG_ALL_MODULES, DXWIFI_LOG_OFF);
+
+    size_t count = 0;
+    captured_frame* frames = load_frames(argv[1], &count);
+    if(count == 0) {
+        fprintf(stderr, "No frames in %s\n", argv[1]);
+        return 1;
+    }
+
+    dxwifi_rx_radiotap_hdr slow, fast;
+    dxwifi_rx_radiotap_layout layout;
+    memset(&layout, 0x00, sizeof(layout));
+
+    // Both paths must agree before timing means anything
+    size_t mismatches = 0;
+    for(size_t i = 0; i < count; ++i) {
+        slow = parse_radiotap_header(frames[i].data, frames[i].caplen);
+        fast = parse_radiotap_header_cached(&layout, frames[i].data, frames[i].caplen);
+        mismatches += memcmp(&slow, &fast, sizeof(dxwifi_rx_radiotap_hdr)) != 0;
+    }
+
+    uint64_t start = bench_now_ns();
+    for(unsigned n = 0; n < iterations; ++n) {
+        for(size_t i = 0; i < count; ++i) {
+            slow = parse_radiotap_header(frames[i].data, frames[i].caplen);
+            bench_do_not_optimize(&slow);
+        }
+    }
+    uint64_t iterator_ns = bench_now_ns() - start;
+
+    memset(&layout, 0x00, sizeof(layout));
+    start = bench_now_ns();
+    for(unsigned n = 0; n < iterations; ++n) {
+        for(size_t i = 0; i < count; ++i) {
+            fast = parse_radiotap_header_cached(&layout, frames[i].data, frames[i].caplen);
+            bench_do_not_optimize(&fast);
+        }
+    }
+    uint64_t cached_ns = bench_now_ns() - start;
+
+    double total = (double)count * iterations;
+    printf("frames:             %zu\n", count);
+    printf("iterations:         %u\n", iterations);
+    printf("mismatches:         %zu\n", mismatches);
+    printf("layout reusable:    %s\n", layout.valid ? "yes" : "no");
+    printf("iterator:           %.2f ns/frame\n", iterator_ns / total);
+    printf("cached layout:      %.2f ns/frame\n", cached_ns / total);
+    printf("speedup:            %.2fx\n", (double)iterator_ns / cached_ns);
+
+    for(size_t i = 0; i < count; ++i) {
+        free(frames[i].data);
+    }
+    free(frames);
+
+    return mismatches != 0;
+}
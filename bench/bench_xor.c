@@ -0,0 +1,148 @@
+/**
+ *  bench_xor.c
+ * 
+ *  DESCRIPTION: Measures the throughput of each OpenFEC symbol XOR kernel
+ *  supported by this CPU
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ *  USAGE: bench_xor [symbol_size] [iterations]
+ * 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <of_openfec_api.h>
+#include <linear_binary_codes_utils/of_symbol.h>
+
+#include <bench/bench.h>
+
+#include <libdxwifi/fec.h>
+
+
+#define BENCH_DFLT_ITERATIONS 20000
+
+// Enough symbols to stay in cache without every access hitting the same lines
+#define BENCH_NB_SYMBOLS 64
+
+// Source counts to time, 1 is of_add_to_symbol, 8 a full multi-symbol batch
+static const unsigned BENCH_FROM_SIZES[] = { 1, 2, 4, 8 };
+
+#define BENCH_NB_FROM_SIZES (sizeof(BENCH_FROM_SIZES) / sizeof(BENCH_FROM_SIZES[0]))
+
+
+/**
+ *  DESCRIPTION:    Checks a kernel against the generic one on random data with
+ *                  every source count and misaligned symbols
+ * 
+ *  ARGUMENTS:
+ * 
+ *      kernel:     Kernel under test
+ * 
+ *      generic:    Reference kernel
+ * 
+ *      symbol_size: Size of each symbol
+ * 
+ *  RETURNS:
+ * 
+ *      bool:       true if every result matched
+ * 
+ */
+static bool verify_kernel(of_xor_kernel_t kernel, of_xor_kernel_t generic, unsigned symbol_size) {
+    const unsigned pad = 32;
+    uint8_t* expected   = malloc(symbol_size + pad);
+    uint8_t* actual     = malloc(symbol_size + pad);
+    uint8_t* sources    = malloc(8 * (symbol_size + pad));
+    const uint8_t* from[8];
+
+    bool ok = true;
+    for(unsigned align = 0; align < pad && ok; ++align) {
+        for(unsigned n = 1; n <= 8 && ok; ++n) {
+            for(unsigned i = 0; i < 8 * (symbol_size + pad); ++i) {
+                sources[i] = rand();
+            }
+            for(unsigned i = 0; i < n; ++i) {
+                from[i] = sources + i * (symbol_size + pad) + (align * (i + 1)) % pad;
+            }
+            for(unsigned i = 0; i < symbol_size + pad; ++i) {
+                expected[i] = actual[i] = rand();
+            }
+            generic(expected + align, from, n, symbol_size);
+            kernel(actual + align, from, n, symbol_size);
+            ok = memcmp(expected, actual, symbol_size + pad) == 0;
+        }
+    }
+    free(expected);
+    free(actual);
+    free(sources);
+    return ok;
+}
+
+
+int main(int argc, char** argv) {
+    unsigned symbol_size    = argc > 1 ? (unsigned)atoi(argv[1]) : DXWIFI_FEC_SYMBOL_SIZE;
+    unsigned iterations     = argc > 2 ? atoi(argv[2]) : BENCH_DFLT_ITERATIONS;
+
+    if(symbol_size == 0 || iterations == 0) {
+        fprintf(stderr, "Usage: %s [symbol_size] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    of_symbol_init_xor_kernel();
+
+    uint8_t* symbols = malloc((size_t)BENCH_NB_SYMBOLS * symbol_size);
+    for(size_t i = 0; i < (size_t)BENCH_NB_SYMBOLS * symbol_size; ++i) {
+        symbols[i] = rand();
+    }
+
+    of_xor_kernel_t generic = of_symbol_find_xor_kernel("generic");
+
+    printf("symbol size:        %u\n", symbol_size);
+    printf("iterations:         %u\n", iterations);
+    printf("selected kernel:    %s\n", of_symbol_get_current_xor_kernel_name());
+    printf("%-10s", "kernel");
+    for(unsigned s = 0; s < BENCH_NB_FROM_SIZES; ++s) {
+        printf("  %7u src", BENCH_FROM_SIZES[s]);
+    }
+    printf("   (GB/s of source data)\n");
+
+    int mismatches = 0;
+    const char* name = NULL;
+    for(UINT32 k = 0; (name = of_symbol_get_xor_kernel_name(k)) != NULL; ++k) {
+        of_xor_kernel_t kernel = of_symbol_find_xor_kernel(name);
+        if(!kernel) {
+            printf("%-10s  not supported\n", name);
+            continue;
+        }
+        if(!verify_kernel(kernel, generic, symbol_size)) {
+            printf("%-10s  MISMATCH\n", name);
+            ++mismatches;
+            continue;
+        }
+
+        printf("%-10s", name);
+        for(unsigned s = 0; s < BENCH_NB_FROM_SIZES; ++s) {
+            unsigned n = BENCH_FROM_SIZES[s];
+            const uint8_t* from[8];
+
+            uint64_t start = bench_now_ns();
+            for(unsigned it = 0; it < iterations; ++it) {
+                unsigned base = it % (BENCH_NB_SYMBOLS - n);
+                for(unsigned i = 0; i < n; ++i) {
+                    from[i] = symbols + (size_t)(base + i + 1) * symbol_size;
+                }
+                kernel(symbols + (size_t)base * symbol_size, from, n, symbol_size);
+                bench_do_not_optimize(symbols);
+            }
+            uint64_t elapsed = bench_now_ns() - start;
+
+            printf("  %11.2f", (double)iterations * n * symbol_size / elapsed);
+        }
+        printf("\n");
+    }
+    free(symbols);
+
+    return mismatches != 0;
+}
@@ -31,6 +31,7 @@ static struct argp_option opts[] = {
     { 0, 0, 0, 0, "Help Options", HELP_GROUP },
     { "verbose",    'v', 0, 0, "Verbosity level",           HELP_GROUP },
     { "quiet",      'q', 0, 0, "Silence any output",        HELP_GROUP },
+    { "stats",      's', 0, 0, "Print per-stage FEC timing to stderr", HELP_GROUP },
 
 
     { 0 } // Final zero field is required by argp
@@ -73,6 +74,10 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
     case 'q':
         args->quiet = true;
         break;
+
+    case 's':
+        args->stats = true;
+        break;
     
     default:
         status = ARGP_ERR_UNKNOWN;
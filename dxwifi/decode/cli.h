@@ -10,6 +10,7 @@ typedef struct {
     const char* file_out;
     int         verbosity;
     bool        quiet;
+    bool        stats;
 } cli_args;
 
 
@@ -4,6 +4,8 @@
  */
 
 
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_DECODE
+
 #include <math.h>
 #include <errno.h>
 #include <stdio.h>
@@ -28,7 +30,8 @@ int main(int argc, char** argv) {
         .file_in    = NULL,
         .file_out   = NULL,
         .verbosity  = DXWIFI_LOG_INFO,
-        .quiet      = false
+        .quiet      = false,
+        .stats      = false
     };
 
     parse_args(argc, argv, &args);
@@ -52,7 +55,7 @@ void decode_file(cli_args* args) {
     int fd_in = open(args->file_in, O_RDWR);
     assert_M(fd_in > 0, "Failed to open file: %s - %s", args->file_in, strerror(errno));
 
-    int open_flags  = O_WRONLY | O_CREAT | O_TRUNC;
+    int open_flags  = O_RDWR   | O_CREAT | O_TRUNC;
     mode_t mode     = S_IRUSR  | S_IWUSR | S_IROTH | S_IWOTH; 
 
     int fd_out      = args->file_out ? open(args->file_out, open_flags, mode) : STDOUT_FILENO;
@@ -63,17 +66,21 @@ void decode_file(cli_args* args) {
     void* file_data = mmap(NULL, file_size, PROT_WRITE, MAP_SHARED, fd_in, 0);
     assert_M(file_data != MAP_FAILED, "Failed to map file to memory - %s", strerror(errno));
 
-    // Decode file
-    void* decoded_msg = NULL;
-    ssize_t msglen = dxwifi_decode(file_data, file_size, &decoded_msg);
-
-    if(msglen > 0) {
+    // Decode file, straight into the output when it can be mapped
+    dxwifi_fec_stats stats;
+    ssize_t msglen = dxwifi_decode_to_file(file_data, file_size, fd_out, &stats);
 
-        log_info("Successfully decoded %s. Decoded file size: %d", args->file_in, msglen);
+    if(args->stats) {
+        dxwifi_write_fec_stats(stderr, &stats);
+    }
 
-        int nbytes = write(fd_out, decoded_msg, msglen);
-        assert_M(nbytes == msglen, "Partial write occured: %d/%d - %s", nbytes, msglen, strerror(errno));
-        free(decoded_msg);
+    if(msglen > 0) {
+        log_info(
+            "Successfully decoded %s. Decoded file size: %d%s", 
+            args->file_in, 
+            msglen, 
+            stats.systematic ? " (systematic)" : ""
+        );
     }
     else {
         log_error("Decode failed - %s", dxwifi_fec_error_to_str(msglen));
@@ -6,8 +6,10 @@
 
 #include <argp.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <dxwifi/encode/cli.h>
+#include <libdxwifi/fec.h>
 #include <libdxwifi/details/utils.h>
 
 #define PRIMARY_GROUP   0
@@ -28,17 +30,33 @@ static char doc[] =
 static struct argp_option opts[] = {
     { "output",         'o', "<path>",              0, "Output file path",                                   PRIMARY_GROUP },
     { "coderate",       'c', "[0,1]",               0, "Rate of repair symbols ",                            PRIMARY_GROUP },
+    { "frame-blocks",   'b', "[1,9]",               0, "RS blocks per frame (default: 5)",                   PRIMARY_GROUP },
+    { "interleave",     'i', "1|[8,16]",            0, "Frames each RS codeword is spread across (default: 1)", PRIMARY_GROUP },
+    { "codec",          'C', "auto|ldpc|rs|2d",     0, "OpenFEC codec, auto picks RS when N <= 255 and LDPC otherwise (default: auto)", PRIMARY_GROUP },
 
 
     { 0, 0, 0, 0, "Help Options", HELP_GROUP },
     { "verbose",    'v', 0, 0, "Verbosity level",           HELP_GROUP },
     { "quiet",      'q', 0, 0, "Silence any output",        HELP_GROUP },
+    { "stats",      's', 0, 0, "Print per-stage FEC timing to stderr", HELP_GROUP },
 
 
     { 0 } // Final zero field is required by argp
 };
 
 
+// Codec names accepted by --codec
+static const struct {
+    const char*         name;
+    dxwifi_fec_codec_t  codec;
+} codec_names[] = {
+    { "auto",   DXWIFI_FEC_CODEC_AUTO           },
+    { "ldpc",   DXWIFI_FEC_CODEC_LDPC_STAIRCASE },
+    { "rs",     DXWIFI_FEC_CODEC_RS_GF_2_8      },
+    { "2d",     DXWIFI_FEC_CODEC_2D_PARITY      },
+};
+
+
 static error_t parse_opt(int key, char* arg, struct argp_state *state) {
 
     error_t status = 0;
@@ -72,6 +90,35 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         }
         break;
 
+    case 'b':
+        if(atoi(arg) < 1 || atoi(arg) > DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX) {
+            argp_error(state, "Frame blocks must be a value between 1 and %d", DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX);
+            argp_usage(state);
+        }
+        args->frame_blocks = atoi(arg);
+        break;
+
+    case 'i':
+        if(atoi(arg) != 1 && (atoi(arg) < DXWIFI_FEC_INTERLEAVE_DEPTH_MIN || atoi(arg) > DXWIFI_FEC_INTERLEAVE_DEPTH_MAX)) {
+            argp_error(state, "Interleave depth must be 1 or a value between %d and %d", DXWIFI_FEC_INTERLEAVE_DEPTH_MIN, DXWIFI_FEC_INTERLEAVE_DEPTH_MAX);
+            argp_usage(state);
+        }
+        args->interleave_depth = atoi(arg);
+        break;
+
+    case 'C': {
+            size_t i = 0;
+            while(i < NELEMS(codec_names) && strcmp(codec_names[i].name, arg) != 0) {
+                ++i;
+            }
+            if(i == NELEMS(codec_names)) {
+                argp_error(state, "Codec must be one of auto, ldpc, rs or 2d");
+                argp_usage(state);
+            }
+            args->codec = codec_names[i].codec;
+        }
+        break;
+
     case 'o':
         args->file_out = arg;
         break;
@@ -83,6 +130,10 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
     case 'q':
         args->quiet = true;
         break;
+
+    case 's':
+        args->stats = true;
+        break;
     
     default:
         status = ARGP_ERR_UNKNOWN;
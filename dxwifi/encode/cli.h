@@ -2,15 +2,22 @@
  *  cli.h - Command line interface for `encode`
  */
 
+#include <stdint.h>
 #include <stdbool.h>
 
+#include <libdxwifi/fec.h>
+
 
 typedef struct {
     const char* file_in;
     const char* file_out;
     float       coderate;
+    uint8_t     frame_blocks;
+    uint8_t     interleave_depth;
+    dxwifi_fec_codec_t codec;
     int         verbosity;
     bool        quiet;
+    bool        stats;
 } cli_args;
 
 
@@ -5,6 +5,8 @@
  * 
  */
 
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_ENCODE
+
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -28,8 +30,12 @@ int main(int argc, char **argv) {
         .file_in = NULL,
         .file_out = NULL,
         .coderate = 0.667,
+        .frame_blocks = DXWIFI_RSCODE_BLOCKS_PER_FRAME,
+        .interleave_depth = 1,
+        .codec = DXWIFI_FEC_CODEC_AUTO,
         .verbosity = DXWIFI_LOG_INFO,
-        .quiet = false
+        .quiet = false,
+        .stats = false
     };
     parse_args(argc, argv, &args);
 
@@ -63,8 +69,19 @@ void encode_file(cli_args *args) {
     assert_M(file_data != MAP_FAILED, "Failed to map file to memory - %s", strerror(errno));
 
     // FEC Encode File-In
+    dxwifi_fec_params params = DXWIFI_FEC_PARAMS_DFLT_INITIALIZER;
+    params.coderate         = args->coderate;
+    params.frame_blocks     = args->frame_blocks;
+    params.interleave_depth = args->interleave_depth;
+    params.codec            = args->codec;
+
     void *encoded_message = NULL;
-    size_t msg_size = dxwifi_encode(file_data, file_size, args->coderate, &encoded_message);
+    dxwifi_fec_stats stats;
+    size_t msg_size = dxwifi_encode_with_params(file_data, file_size, &params, &encoded_message, args->stats ? &stats : NULL);
+
+    if (args->stats) {
+        dxwifi_write_fec_stats(stderr, &stats);
+    }
 
     if (msg_size > 0) { // FEC encode success, write out encoded message
 
@@ -8,6 +8,7 @@
  */
 
 #include <argp.h>
+#include <limits.h>
 #include <stdlib.h>
 
 #include <dxwifi/rx/cli.h>
@@ -32,6 +33,10 @@ typedef enum {
     NO_OPTIMIZE,
     SENDER_ADDR,
     MAX_DISTANCE,
+    KERNEL_BUFFER,
+    FRAME_RATE,
+    IMMEDIATE,
+    TSTAMP_TYPE,
 } pcap_settings_t;
 
 
@@ -50,9 +55,11 @@ static struct argp_option opts[] = {
     { "timeout",        't', "<seconds>",           0, "Number of seconds to wait for a packet (default: infinity)",            PRIMARY_GROUP },
     { "dispatch-count", 'c', "<number>",            0, "Number of packets to process at a time",                                PRIMARY_GROUP },
     { "buffsize",       'b', "<nbytes>",            0, "Size of intermediate packet buffer in bytes",                           PRIMARY_GROUP },
+    { "ring-size",      'r', "<frames>",            0, "Number of captured frames that can wait to be processed",               PRIMARY_GROUP },
     { "append",         'a', 0,                     0, "Open files in append mode",                                             PRIMARY_GROUP },
     { "ordered",        'o', 0,                     0, "Expect packets to have sequence informations",                          PRIMARY_GROUP },
     { "add-noise",      'n', 0,                     0, "Add noise for missing packets",                                         PRIMARY_GROUP },
+    { "noise-value",    'N', "<byte>",              0, "Byte value used for noise, 0 leaves holes in regular files (default: 0xff)", PRIMARY_GROUP },
 
     { 0, 0, 0, 0, "The following settings are only applicable when outputting to a directory",      DIRECTORY_MODE_GROUP },
     { "prefix",         'p', "<file-prefix>",       0, "What to name each created file",            DIRECTORY_MODE_GROUP },
@@ -65,11 +72,18 @@ static struct argp_option opts[] = {
     { "no-optimize",    GET_KEY(NO_OPTIMIZE,    PCAP_SETTINGS_GROUP),    0,              OPTION_NO_USAGE,    "Do not optimize the BPF expression",   PCAP_SETTINGS_GROUP },
     { "sender-address", GET_KEY(SENDER_ADDR,    PCAP_SETTINGS_GROUP),    "<macaddr>",    OPTION_NO_USAGE,    "Transmitters MAC address",             PCAP_SETTINGS_GROUP },
     { "max-distance",   GET_KEY(MAX_DISTANCE,   PCAP_SETTINGS_GROUP),    "<number>",     OPTION_NO_USAGE,    "Maximum hamming distance for the address", PCAP_SETTINGS_GROUP},
+    { "kernel-buffer",  GET_KEY(KERNEL_BUFFER,  PCAP_SETTINGS_GROUP),    "<nbytes>",     OPTION_NO_USAGE,    "Size of the kernel capture buffer",    PCAP_SETTINGS_GROUP },
+    { "frame-rate",     GET_KEY(FRAME_RATE,     PCAP_SETTINGS_GROUP),    "<fps>",        OPTION_NO_USAGE,    "Expected frames per second, sizes the kernel buffer when --kernel-buffer is not set", PCAP_SETTINGS_GROUP },
+    { "immediate",      GET_KEY(IMMEDIATE,      PCAP_SETTINGS_GROUP),    0,              OPTION_NO_USAGE,    "Deliver packets as soon as they arrive", PCAP_SETTINGS_GROUP },
+    { "tstamp-type",    GET_KEY(TSTAMP_TYPE,    PCAP_SETTINGS_GROUP),    "<type>",       OPTION_NO_USAGE,    "Timestamp source, see pcap-tstamp(7)", PCAP_SETTINGS_GROUP },
 
     { 0, 0, 0, 0, "Help options", HELP_GROUP },
     { "verbose", 'v', 0, 0, "Verbosity level",              HELP_GROUP },
     { "syslog",  's', 0, 0, "Use SysLog for messages",      HELP_GROUP }, 
     { "quiet",   'q', 0, 0, "Silence any output",           HELP_GROUP },
+    { "async-log", 'A', 0, 0, "Format log messages on a background thread", HELP_GROUP },
+    { "metrics-socket", 'M', "<path>", 0, "Serve live metrics in Prometheus text format on a Unix socket", HELP_GROUP },
+    { "status-shm",     'S', "<name>", 0, "Publish live status in shared memory at /dev/shm/<name>", HELP_GROUP },
 
 #if defined(DXWIFI_TESTS)
     { 0, 0, 0, 0, "WARNING! You are running a test build!", TEST_GROUP },
@@ -145,6 +159,21 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
            }
         break;
 
+    case 'r':
+        args->rx.ring_capacity = atoi(arg);
+        if(  args->rx.ring_capacity < DXWIFI_RX_RING_CAPACITY_MIN
+          || args->rx.ring_capacity > DXWIFI_RX_RING_CAPACITY_MAX ) {
+              argp_error(
+                  state,
+                  "Ring size of `%s` is not in range (%d,%d)\n",
+                  arg,
+                  DXWIFI_RX_RING_CAPACITY_MIN,
+                  DXWIFI_RX_RING_CAPACITY_MAX
+              );
+              argp_usage(state);
+           }
+        break;
+
     case 'v':
         ++args->verbosity;
         break;
@@ -169,10 +198,33 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         args->rx.add_noise = true;
         break;
 
+    case 'N': {
+            char* end = NULL;
+            unsigned long value = strtoul(arg, &end, 0);
+            if(*arg == '\0' || *end != '\0' || value > UINT8_MAX) {
+                argp_error(state, "Noise value of `%s` is not a byte value\n", arg);
+                argp_usage(state);
+            }
+            args->rx.noise_value = (uint8_t)value;
+        }
+        break;
+
     case 's':
         args->use_syslog = true;
         break;
 
+    case 'A':
+        args->async_log = true;
+        break;
+
+    case 'M':
+        args->metrics_socket = arg;
+        break;
+
+    case 'S':
+        args->status_shm = arg;
+        break;
+
     case GET_KEY(SNAPLEN, PCAP_SETTINGS_GROUP):
         args->rx.snaplen = atoi(arg);
         break;
@@ -200,6 +252,33 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         args->rx.max_hamming_dist = atoi(arg);
         break;
 
+    case GET_KEY(KERNEL_BUFFER, PCAP_SETTINGS_GROUP):
+        args->rx.buffer_size = atoi(arg);
+        if(args->rx.buffer_size < 0) {
+            argp_error(state, "Kernel buffer size must be positive");
+            argp_usage(state);
+        }
+        break;
+
+    case GET_KEY(FRAME_RATE, PCAP_SETTINGS_GROUP): {
+            char* end = NULL;
+            long value = strtol(arg, &end, 10);
+            if(*arg == '\0' || *end != '\0' || value < 1 || value > INT_MAX) {
+                argp_error(state, "Frame rate of `%s` must be a positive integer", arg);
+                argp_usage(state);
+            }
+            args->rx.frame_rate = (unsigned)value;
+        }
+        break;
+
+    case GET_KEY(IMMEDIATE, PCAP_SETTINGS_GROUP):
+        args->rx.immediate = true;
+        break;
+
+    case GET_KEY(TSTAMP_TYPE, PCAP_SETTINGS_GROUP):
+        args->rx.tstamp_type = arg;
+        break;
+
 #if defined(DXWIFI_TESTS)
     case ARGP_KEY_INIT:
         args->rx.savefile = NULL;
@@ -24,6 +24,9 @@ typedef struct {
     bool            quiet;
     bool            append;
     bool            use_syslog;
+    bool            async_log;
+    const char*     metrics_socket;
+    const char*     status_shm;
     const char*     device;
     const char*     output_path;
     const char*     file_prefix;
@@ -38,6 +41,9 @@ typedef struct {
         .quiet          = false,\
         .append         = false,\
         .use_syslog     = false,\
+        .async_log      = false,\
+        .metrics_socket = NULL,\
+        .status_shm     = NULL,\
         .device         = "mon0",\
         .output_path    = ".",\
         .file_prefix    = "rx",\
@@ -7,6 +7,8 @@
  * 
  */
 
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_RX
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -23,7 +25,10 @@
 #include <libdxwifi/receiver.h>
 #include <libdxwifi/details/assert.h>
 #include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/metrics.h>
+#include <libdxwifi/details/shm_status.h>
 #include <libdxwifi/details/syslogger.h>
+#include <libdxwifi/details/async_logger.h>
 
 
 #define RX_TEMP_FILE "/tmp/rx.raw"
@@ -44,15 +49,31 @@ int main(int argc, char** argv) {
     if(args.use_syslog) {
         set_logger(DXWIFI_LOG_ALL_MODULES, syslogger);
     }
+    if(args.async_log && start_async_logger(args.use_syslog ? syslogger : default_logger, DXWIFI_ASYNC_LOG_DFLT_CAPACITY)) {
+        set_logger(DXWIFI_LOG_ALL_MODULES, async_logger);
+    }
 
     set_log_level(DXWIFI_LOG_ALL_MODULES, args.verbosity);
 
+    if(args.metrics_socket && !start_metrics_server(args.metrics_socket, DXWIFI_METRICS_RX)) {
+        log_fatal("Failed to serve metrics on %s", args.metrics_socket);
+        stop_async_logger(DXWIFI_ASYNC_LOG_DFLT_FLUSH_MS);
+        exit(EXIT_FAILURE);
+    }
+    if(args.status_shm) {
+        open_status_segment(args.status_shm, DXWIFI_STATUS_RX, args.device);
+    }
+
     init_receiver(receiver, args.device);
 
     receive(&args, receiver);
 
     close_receiver(receiver);
 
+    close_status_segment();
+    stop_metrics_server();
+    stop_async_logger(DXWIFI_ASYNC_LOG_DFLT_FLUSH_MS);
+
     exit(0);
 }
 
@@ -68,6 +89,14 @@ int main(int argc, char** argv) {
 void log_rx_stats(dxwifi_rx_stats stats) {
     char* channel_flags_str = radiotap_channel_flags_to_str(stats.rtap.channel.flags);
 
+    log_info(
+        "Capture ended - received: %d, dropped (kernel): %d, ring high-water: %d/%d",
+        stats.pcap_stats.ps_recv,
+        stats.pcap_stats.ps_drop,
+        stats.ring_high_water,
+        stats.ring_capacity
+    );
+
     log_debug(
         "Receiver Capture Stats\n"
         "\tTotal Payload Size:          %d\n"
@@ -85,6 +114,8 @@ void log_rx_stats(dxwifi_rx_stats stats) {
         "\tPackets Dropped (receiver):  %d\n"
         "\tPackets Dropped (Kernel):    %d\n"
         "\tPackets Dropped (NIC):       %d\n"
+        "\tCapture Ring High-Water:     %d/%d\n"
+        "\tCapture Ring Full:           %d\n"
         "\tNote: Packet drop data is platform dependent.\n"
         "\tBlocks lost is only tracked when `ordered` flag is set",
         stats.total_payload_size,
@@ -101,7 +132,10 @@ void log_rx_stats(dxwifi_rx_stats stats) {
         stats.pcap_stats.ps_recv,
         stats.packets_dropped,
         stats.pcap_stats.ps_drop,
-        stats.pcap_stats.ps_ifdrop
+        stats.pcap_stats.ps_ifdrop,
+        stats.ring_high_water,
+        stats.ring_capacity,
+        stats.ring_full_count
     );
     if((stats.rtap.mcs.flags & 0x03) == 0){
         log_debug("MCS Bandwidth = 20");
@@ -208,7 +242,7 @@ dxwifi_rx_state_t open_file_and_capture(const char* path, dxwifi_receiver* rx, b
     int temp_fd     = 0;
 
     int temp_flags  = O_RDWR   | O_CREAT | O_TRUNC;
-    int open_flags  = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+    int open_flags  = O_RDWR   | O_CREAT | (append ? O_APPEND : O_TRUNC);
     mode_t mode     = S_IRUSR  | S_IWUSR | S_IROTH | S_IWOTH; 
     
     dxwifi_rx_state_t state = DXWIFI_RX_ERROR;
@@ -232,15 +266,17 @@ dxwifi_rx_state_t open_file_and_capture(const char* path, dxwifi_receiver* rx, b
                 }
                 else {
 
-                    void *decoded_message = NULL;
-                    ssize_t decoded_size = dxwifi_decode(encoded_data, temp_file_size, &decoded_message);
+                    status_set_state(DXWIFI_STATUS_DECODING);
+                    dxwifi_fec_stats fec_stats;
+                    ssize_t decoded_size = dxwifi_decode_to_file(encoded_data, temp_file_size, fd_out, &fec_stats);
+                    status_set_decoded(decoded_size);
 
                     if(decoded_size > 0) {
-                        log_info("Decoding Success for RX'd file, File Size: %d", decoded_size);
-
-                        ssize_t nbytes = write(fd_out, decoded_message, decoded_size);
-                        assert_M(decoded_size == nbytes, "Partial write occured: %d/%d - %s", nbytes, decoded_size, strerror(errno));
-                        free(decoded_message);
+                        log_info(
+                            "Decoding Success for RX'd file, File Size: %d, Systematic: %s", 
+                            decoded_size, 
+                            fec_stats.systematic ? "yes" : "no"
+                        );
                     }
                     else{
                         log_error("Failed to Decode Rx'd file, Error: %s", dxwifi_fec_error_to_str(decoded_size));
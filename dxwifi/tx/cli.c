@@ -64,8 +64,12 @@ static struct argp_option opts[] = {
     { "pid-file",       'P',  "<file-path>",        0,  "Location of the Daemon's PID File",                                             PRIMARY_GROUP },
     { "packet-loss",    'p',  "<float>",            0,  "Numbers of packets dropped",                                                    PRIMARY_GROUP },
     { "error-rate" ,    'e',  "<float>",            0,  "Numbers bits flipped",                                                          PRIMARY_GROUP },
+    { "seed",           'z',  "<number>",           0,  "Seed for the simulated packet loss and bit errors (default: time)",             PRIMARY_GROUP },
     { "enable-pa",      'E',  0,                    0,  "Enable Power Amplifer (Only works on OreSat DxWiFi board)",                     PRIMARY_GROUP },
     { "coderate",       'c',  "<float>",            0,  "Coderate for FEC encoding",                                                     PRIMARY_GROUP },
+    { "kernel-buffer",  'k',  "<nbytes>",           0,  "Size of the kernel packet buffer in bytes (default: pcap default)",             PRIMARY_GROUP },
+    { "frame-blocks",   'b',  "<1-9>",              0,  "RS blocks per frame, larger frames spend less airtime on headers (default: 5)", PRIMARY_GROUP },
+    { "interleave",     'i',  "<1|8-16>",           0,  "Frames each RS codeword is spread across, needs --ordered (default: 1)",        PRIMARY_GROUP },
 
     { 0, 0, 0, OPTION_DOC, "The following settings are only applicable when reading from a directory", DIRECTORY_MODE_GROUP },
     { "filter",         GET_KEY(FILE_FILTER,        DIRECTORY_MODE_GROUP),  "<glob>",       OPTION_NO_USAGE,  "Only transmit files whose filename matches the filter",      DIRECTORY_MODE_GROUP },
@@ -91,6 +95,9 @@ static struct argp_option opts[] = {
     { "verbose",    'v', 0, 0, "Verbosity level",           HELP_GROUP },
     { "syslog",     's', 0, 0, "Use SysLog for messages",   HELP_GROUP }, 
     { "quiet",      'q', 0, 0, "Silence any output",        HELP_GROUP },
+    { "async-log",  'A', 0, 0, "Format log messages on a background thread", HELP_GROUP },
+    { "metrics-socket", 'M', "<path>", 0, "Serve live metrics in Prometheus text format on a Unix socket", HELP_GROUP },
+    { "status-shm",     'S', "<name>", 0, "Publish live status in shared memory at /dev/shm/<name>", HELP_GROUP },
 
 #if defined(DXWIFI_TESTS)
     { 0, 0, 0, OPTION_DOC, "WARNING! You are running a development test build!", TEST_GROUP },
@@ -186,6 +193,18 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         args->use_syslog = true;
         break;
 
+    case 'A':
+        args->async_log = true;
+        break;
+
+    case 'M':
+        args->metrics_socket = arg;
+        break;
+
+    case 'S':
+        args->status_shm = arg;
+        break;
+
     case 'T':
         args->tx_mode = TX_TEST_MODE;
         break;
@@ -208,6 +227,14 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         //TODO: bounds check
         break; 
 
+    case 'z':
+        args->seed = atol(arg);
+        if(args->seed < 0) {
+            argp_error(state, "Seed must not be negative");
+            argp_usage(state);
+        }
+        break;
+
     case 'E':
         args->tx.enable_pa = true;
         break;
@@ -221,6 +248,30 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
         }
         break;
 
+    case 'k':
+        args->tx.buffer_size = atoi(arg);
+        if(args->tx.buffer_size < 0) {
+            argp_error(state, "Error: Kernel buffer size must be positive");
+            argp_usage(state);
+        }
+        break;
+
+    case 'b':
+        if(atoi(arg) < 1 || atoi(arg) > DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX) {
+            argp_error(state, "Error: Frame blocks must be between 1 and %d", DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX);
+            argp_usage(state);
+        }
+        args->frame_blocks = atoi(arg);
+        break;
+
+    case 'i':
+        if(atoi(arg) != 1 && (atoi(arg) < DXWIFI_FEC_INTERLEAVE_DEPTH_MIN || atoi(arg) > DXWIFI_FEC_INTERLEAVE_DEPTH_MAX)) {
+            argp_error(state, "Error: Interleave depth must be 1 or between %d and %d", DXWIFI_FEC_INTERLEAVE_DEPTH_MIN, DXWIFI_FEC_INTERLEAVE_DEPTH_MAX);
+            argp_usage(state);
+        }
+        args->interleave_depth = atoi(arg);
+        break;
+
     case GET_KEY(FILE_FILTER, DIRECTORY_MODE_GROUP):
         args->file_filter = arg;
         break;
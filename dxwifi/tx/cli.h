@@ -41,13 +41,19 @@ typedef struct {
     int                 verbosity;
     bool                quiet;
     bool                use_syslog;
+    bool                async_log;
+    const char*         metrics_socket;
+    const char*         status_shm;
     unsigned            tx_delay;
     unsigned            file_delay;
     const char*         device;
     float               packet_loss;
     float               error_rate;
+    long                seed;
     dxwifi_transmitter  tx;
     float               coderate;
+    uint8_t             frame_blocks;
+    uint8_t             interleave_depth;
 } cli_args;
 
 
@@ -58,6 +64,9 @@ typedef struct {
         .verbosity                  = DXWIFI_LOG_INFO,\
         .quiet                      = false,\
         .use_syslog                 = false,\
+        .async_log                  = false,\
+        .metrics_socket             = NULL,\
+        .status_shm                 = NULL,\
         .file_count                 = 0,\
         .file_filter                = "*",\
         .retransmit_count           = 0,\
@@ -69,8 +78,11 @@ typedef struct {
         .device                     = "mon0",\
         .error_rate                 = 0,\
         .packet_loss                = 0,\
+        .seed                       = -1,\
         .tx                         = DXWIFI_TRANSMITTER_DFLT_INITIALIZER,\
-        .coderate                   = 0.667\
+        .coderate                   = 0.667,\
+        .frame_blocks               = DXWIFI_RSCODE_BLOCKS_PER_FRAME,\
+        .interleave_depth           = 1\
     }\
 
 
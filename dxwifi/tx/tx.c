@@ -7,8 +7,13 @@
  *
  */
 
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_TX
+
 #include "tx.h"
 
+#include <libdxwifi/details/metrics.h>
+#include <libdxwifi/details/shm_status.h>
+
 typedef struct {
     float packet_loss_rate;
     unsigned count;
@@ -17,6 +22,9 @@ typedef struct {
 static dirwatch* dirwatch_handle = NULL;
 static dxwifi_transmitter* transmitter = NULL;
 
+// Set by terminate(), the main path tears down and exits with it
+static volatile sig_atomic_t terminate_signal = 0;
+
 
 int main(int argc, char** argv) {
     exit(main_worker(argc, argv));
@@ -37,12 +45,29 @@ int main_worker(int argc, char** argv) {
         daemon_run(args.pid_file, args.daemon);
         signal(SIGTERM, terminate);
     }
+    // After daemon_run, the background threads wouldn't survive the fork
+    if(args.metrics_socket && !start_metrics_server(args.metrics_socket, DXWIFI_METRICS_TX)) {
+        log_fatal("Failed to serve metrics on %s", args.metrics_socket);
+        if(args.daemon == DAEMON_START) {
+            remove(args.pid_file);
+        }
+        exit(EXIT_FAILURE);
+    }
+    if(args.async_log && start_async_logger((args.use_syslog || args.daemon) ? syslogger : default_logger, DXWIFI_ASYNC_LOG_DFLT_CAPACITY)) {
+        set_logger(DXWIFI_LOG_ALL_MODULES, async_logger);
+    }
+    if(args.status_shm) {
+        open_status_segment(args.status_shm, DXWIFI_STATUS_TX, args.device);
+    }
 
 #if defined(DXWIFI_TESTS)
     unsigned seed = 1621981756;
 #else
     unsigned seed = time(0);
 #endif
+    if(args.seed >= 0) {
+        seed = args.seed;
+    }
 
     srand(seed);
 
@@ -52,26 +77,33 @@ int main_worker(int argc, char** argv) {
 
     close_transmitter(transmitter);
 
-    if(args.daemon == DAEMON_START) { // This process is the daemon, tear it down
+    close_status_segment();
+    stop_metrics_server();
+    stop_async_logger(DXWIFI_ASYNC_LOG_DFLT_FLUSH_MS);
+
+    // The process stopping the daemon removes the PID file once we're gone
+    if(args.daemon == DAEMON_START && !terminate_signal) { // This process is the daemon, tear it down
         stop_daemon(args.pid_file);
     }
 
-    return 0;
+    return terminate_signal;
 }
 
 /**
- *  DESCRIPTION:    SIGTERM handler for daemonized process. Ensures transmitter
- *                  is closed.
+ *  DESCRIPTION:    SIGTERM handler for daemonized process. Stops transmission
+ *                  so main_worker() closes the transmitter and exits.
  *
  *  ARGUMENTS:
  *
  *      signum:     Received signal
  *
+ *  NOTES: Only sets flags, teardown isn't async-signal-safe.
+ *
  */
 void terminate(int signum) {
+    terminate_signal = signum;
     stop_transmission(transmitter);
-    close_transmitter(transmitter);
-    exit(signum);
+    dirwatch_stop(dirwatch_handle);
 }
 
 
@@ -134,7 +166,7 @@ void log_tx_stats(dxwifi_tx_stats stats) {
  *
  */
 bool log_frame_stats(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user) {
-    int frame_size = DXWIFI_TX_FRAME_SIZE;
+    int frame_size = DXWIFI_TX_HEADER_SIZE + stats.payload_size;
     if(stats.frame_type == DXWIFI_CONTROL_FRAME_NONE) {
         log_debug("Frame: %d - (Read: %ld, Sent: %ld)", stats.data_frame_count, stats.prev_bytes_read, stats.prev_bytes_sent);
     }
@@ -196,8 +228,8 @@ bool packet_loss_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user)
 bool bit_error_rate_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user) {
     float error_rate = *(float*) user;
 
-    int frame_size = DXWIFI_TX_FRAME_SIZE - DXWIFI_TX_RADIOTAP_HDR_SIZE;
-    int total_num_errors = DXWIFI_TX_FRAME_SIZE * 8 * error_rate; //Get total number of errors
+    int frame_size = DXWIFI_TX_HEADER_SIZE + stats.payload_size - DXWIFI_TX_RADIOTAP_HDR_SIZE;
+    int total_num_errors = (DXWIFI_TX_HEADER_SIZE + stats.payload_size) * 8 * error_rate; //Get total number of errors
     uint8_t bit_array[frame_size]; //Make an array of bits equal to the number in the frame
 
     // Initialize every bit to zero
@@ -242,6 +274,23 @@ bool attach_frame_number(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* us
 }
 
 
+/**
+ *  DESCRIPTION:    Collects the FEC encoding settings from the command line
+ *
+ *  ARGUMENTS:
+ *
+ *      args:       Parsed command line arguments
+ *
+ */
+static dxwifi_fec_params fec_params(const cli_args* args) {
+    dxwifi_fec_params fec = DXWIFI_FEC_PARAMS_DFLT_INITIALIZER;
+    fec.coderate            = args->coderate;
+    fec.frame_blocks        = args->frame_blocks;
+    fec.interleave_depth    = args->interleave_depth;
+    return fec;
+}
+
+
 /**
  *  DESCRIPTION:    Setups and tearsdown SIGINT handlers to control transmission
  *
@@ -286,14 +335,14 @@ dxwifi_tx_state_t setup_handlers_and_transmit(dxwifi_transmitter* tx, int fd) {
  *                  Number of times to retransmit the file. If the count is -1
  *                  then the file will be retransmitted forever or until the
  *                  transmitter reports a timeout or error
- *		coderate:
- *					Coderate for FEC encoding.
+ *      fec:        Coderate and frame geometry for FEC encoding
+ *
  *  RETURNS:
  *
  *      dxwifi_tx_state_t: The last reported state of the transmitter
  *
  */
-dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t num_files, unsigned delay, int retransmit_count, float coderate) {
+dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t num_files, unsigned delay, int retransmit_count, const dxwifi_fec_params* fec) {
     int fd = 0;
     dxwifi_tx_stats stats = { .tx_state = DXWIFI_TX_NORMAL };
 
@@ -309,7 +358,8 @@ dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t nu
             assert_M(file_data != MAP_FAILED, "Failed to map file to memory - %s", strerror(errno));
 
             void *encoded_message = NULL;
-            size_t msg_size = dxwifi_encode(file_data, file_size, coderate, &encoded_message);
+            status_set_state(DXWIFI_STATUS_ENCODING);
+            size_t msg_size = dxwifi_encode_with_params(file_data, file_size, fec, &encoded_message, NULL);
 
             if(msg_size > 0){
 
@@ -330,6 +380,7 @@ dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t nu
             }
             else {	
                 log_error("Unable to FEC Encode File [%s]", files[i]);	
+                status_set_state(DXWIFI_STATUS_IDLE);
             }
             close(fd);
             munmap(file_data, file_size);
@@ -352,10 +403,10 @@ dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t nu
  *
  *      delay:      Inter-file transmission delay in milliseconds
  *
- *		coderate:   Coderate for FEC Encoding
+ *      fec:        Coderate and frame geometry for FEC encoding
  *
  */
-void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, const char* dirname, unsigned delay, int retransmit_count, float coderate) {
+void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, const char* dirname, unsigned delay, int retransmit_count, const dxwifi_fec_params* fec) {
     DIR* dir;
     struct dirent* file;
     dxwifi_tx_state_t state = DXWIFI_TX_NORMAL;
@@ -369,7 +420,7 @@ void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, con
             if(fnmatch(filter, file->d_name, 0) == 0) {
                 combine_path(path_buffer, PATH_MAX, dirname, file->d_name);
                 if(is_regular_file(path_buffer)) {
-                    state = transmit_files(tx, &path_buffer, 1, delay, retransmit_count, coderate);
+                    state = transmit_files(tx, &path_buffer, 1, delay, retransmit_count, fec);
                 }
             }
         }
@@ -384,7 +435,7 @@ void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, con
  *
  *  ARGUMENTS:
  *
- *      event:      Creation and close event
+ *      event:      Creation and close or move in event
  *
  *      user:       Command line arguments
  *
@@ -396,7 +447,9 @@ static void transmit_new_file(const dirwatch_event* event, void* user) {
 
     combine_path(path_buffer, PATH_MAX, event->dirname, event->filename);
 
-    transmit_files(&args->tx, &path_buffer, 1, args->file_delay, args->retransmit_count, args-> coderate);
+    dxwifi_fec_params fec = fec_params(args);
+
+    transmit_files(&args->tx, &path_buffer, 1, args->file_delay, args->retransmit_count, &fec);
 
     free(path_buffer);
 }
@@ -418,13 +471,15 @@ void transmit_directory(cli_args* args, dxwifi_transmitter* tx) {
     const char* dirname = args->files[0];
 
     if(args->transmit_current_files) {
-        transmit_directory_contents(tx, args->file_filter, dirname, args->file_delay, args->retransmit_count, args->coderate);
+        dxwifi_fec_params fec = fec_params(args);
+
+        transmit_directory_contents(tx, args->file_filter, dirname, args->file_delay, args->retransmit_count, &fec);
     }
     if(args->listen_for_new_files) {
 
         dirwatch_handle = dirwatch_init();
 
-        dirwatch_add(dirwatch_handle, dirname, args->file_filter, DW_CREATE_AND_CLOSE, true);
+        dirwatch_add(dirwatch_handle, dirname, args->file_filter, DW_CREATE_AND_CLOSE | DW_MOVED_IN, true);
 
         // Setup handlers for exiting loop
         struct sigaction action = { 0 }, prev_action = { 0 };
@@ -438,7 +493,10 @@ void transmit_directory(cli_args* args, dxwifi_transmitter* tx) {
 
         sigaction(SIGINT, &prev_action, NULL);
 
-        dirwatch_close(dirwatch_handle);
+        // terminate() may run any time, don't leave it a freed handle
+        dirwatch* handle = dirwatch_handle;
+        dirwatch_handle = NULL;
+        dirwatch_close(handle);
     }
 }
 
@@ -467,7 +525,7 @@ void transmit_test_sequence(dxwifi_transmitter* tx, int retransmit) {
     uint32_t transmit_buffer[10240 / sizeof(uint32_t)];
 
     log_info("Transmitting test sequence...");
-    while (count <= retransmit || transmit_forever) {
+    while ((count <= retransmit || transmit_forever) && !terminate_signal) {
 
         for(size_t i = 0; i < NELEMS(transmit_buffer); ++i) {
             transmit_buffer[i] = count;
@@ -499,12 +557,20 @@ void transmit(cli_args* args, dxwifi_transmitter* tx) {
         .packet_loss_rate = args->packet_loss,
         .count = 0
     };
+    dxwifi_fec_params fec = fec_params(args);
+
+    // Every data frame carries one RS-LDPC frame, stream mode uses the same size
+    tx->payload_size = DXWIFI_RS_LDPC_FRAME_SIZE_FOR(args->frame_blocks);
+
     if(args->tx_delay > 0 ) {
         attach_preinject_handler(transmitter, delay_transmission, &args->tx_delay);
     }
     if(args->tx.rtap_tx_flags & IEEE80211_RADIOTAP_F_TX_ORDER) {
         attach_preinject_handler(transmitter, attach_frame_number, NULL);
     }
+    else if(args->interleave_depth > 1) {
+        log_warning("Interleaved frames can't be put back in place without --ordered");
+    }
     if(args->verbosity > DXWIFI_LOG_INFO ) {
         attach_postinject_handler(transmitter, log_frame_stats, NULL);
     }
@@ -521,7 +587,7 @@ void transmit(cli_args* args, dxwifi_transmitter* tx) {
         break;
 
     case TX_FILE_MODE:
-        transmit_files(tx, args->files, args->file_count, args->file_delay, args->retransmit_count, args->coderate);
+        transmit_files(tx, args->files, args->file_count, args->file_delay, args->retransmit_count, &fec);
         break;
 
     case TX_DIRECTORY_MODE:
@@ -28,6 +28,7 @@
 #include <libdxwifi/details/logging.h>
 #include <libdxwifi/details/dirwatch.h>
 #include <libdxwifi/details/syslogger.h>
+#include <libdxwifi/details/async_logger.h>
 
 //Syscalls for Memory Mapping
 #include <sys/mman.h>
@@ -44,8 +45,8 @@ bool packet_loss_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user);
 bool bit_error_rate_sim(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user);
 bool attach_frame_number(dxwifi_tx_frame* frame, dxwifi_tx_stats stats, void* user);
 dxwifi_tx_state_t setup_handlers_and_transmit(dxwifi_transmitter* tx, int fd);
-dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t num_files, unsigned delay, int retransmit_count, float coderate);
-void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, const char* dirname, unsigned delay, int retransmit_count, float coderate);
+dxwifi_tx_state_t transmit_files(dxwifi_transmitter* tx, char** files, size_t num_files, unsigned delay, int retransmit_count, const dxwifi_fec_params* fec);
+void transmit_directory_contents(dxwifi_transmitter* tx, const char* filter, const char* dirname, unsigned delay, int retransmit_count, const dxwifi_fec_params* fec);
 static void transmit_new_file(const dirwatch_event* event, void* user);
 void transmit_directory(cli_args* args, dxwifi_transmitter* tx);
 void transmit_test_sequence(dxwifi_transmitter* tx, int retransmit);
@@ -30,6 +30,9 @@ void dxwifi_transmitter_init_default(dxwifi_transmitter& tx) {
     tx.fctl.wep               = false;
     tx.fctl.order             = false;
 
+    tx.buffer_size            = 0;
+    tx.payload_size           = DXWIFI_TX_PAYLOAD_SIZE;
+
     tx.__activated = false;
     tx.__handle    = NULL;
 
@@ -46,6 +49,9 @@ void cli_init_default(cli_args& args) {
     args.verbosity = DXWIFI_LOG_INFO;
     args.quiet = false;
     args.use_syslog = false;
+    args.async_log = false;
+    args.metrics_socket = NULL;
+    args.status_shm = NULL;
     args.file_count = 0,
     args.file_filter = "*",
     args.retransmit_count = 0;
@@ -57,6 +63,8 @@ void cli_init_default(cli_args& args) {
     args.packet_loss = 0;
     dxwifi_transmitter_init_default(args.tx);
     args.coderate = 0.667;
+    args.frame_blocks = DXWIFI_RSCODE_BLOCKS_PER_FRAME;
+    args.interleave_depth = 1;
 }
 
 void init_transmitter_wrapper(dxwifi_transmitter* tx, const std::string& device_name) {
@@ -105,6 +113,24 @@ void set_file_filter(cli_args& args, const std::string& file_filter) {
     args.file_filter = strdup(file_filter.c_str());
 }
 
+const char* get_metrics_socket(const cli_args& args) {
+    return args.metrics_socket;
+}
+
+void set_metrics_socket(cli_args& args, const std::string& metrics_socket) {
+    free(const_cast<char*>(args.metrics_socket));
+    args.metrics_socket = strdup(metrics_socket.c_str());
+}
+
+const char* get_status_shm(const cli_args& args) {
+    return args.status_shm;
+}
+
+void set_status_shm(cli_args& args, const std::string& status_shm) {
+    free(const_cast<char*>(args.status_shm));
+    args.status_shm = strdup(status_shm.c_str());
+}
+
 std::vector<std::string> get_files(const cli_args& args) {
     std::vector<std::string> files;
     for (int i = 0; i < args.file_count; ++i) {
@@ -149,7 +175,8 @@ PYBIND11_MODULE(tx_module, m) {
         .def("set_address", &set_address)
         .def_readwrite("rtap_flags", &dxwifi_transmitter::rtap_flags)
         .def_readwrite("rtap_rate_mbps", &dxwifi_transmitter::rtap_rate_mbps)
-        .def_readwrite("rtap_tx_flags", &dxwifi_transmitter::rtap_tx_flags);
+        .def_readwrite("rtap_tx_flags", &dxwifi_transmitter::rtap_tx_flags)
+        .def_readwrite("payload_size", &dxwifi_transmitter::payload_size);
 
     pybind11::enum_<tx_mode_t>(m, "TxMode")
         .value("TX_TEST_MODE", TX_TEST_MODE)
@@ -181,6 +208,11 @@ PYBIND11_MODULE(tx_module, m) {
         .def_readwrite("verbosity", &cli_args::verbosity)
         .def_readwrite("quiet", &cli_args::quiet)
         .def_readwrite("use_syslog", &cli_args::use_syslog)
+        .def_readwrite("async_log", &cli_args::async_log)
+        .def("get_metrics_socket", &get_metrics_socket)
+        .def("set_metrics_socket", &set_metrics_socket)
+        .def("get_status_shm", &get_status_shm)
+        .def("set_status_shm", &set_status_shm)
         .def_readwrite("tx_delay", &cli_args::tx_delay)
         .def_readwrite("file_delay", &cli_args::file_delay)
         .def_readwrite("device", &cli_args::device)
@@ -189,5 +221,7 @@ PYBIND11_MODULE(tx_module, m) {
         .def_readwrite("packet_loss", &cli_args::packet_loss)
         .def_readwrite("error_rate", &cli_args::error_rate)
         .def_readwrite("tx", &cli_args::tx)
-        .def_readwrite("coderate", &cli_args::coderate);
+        .def_readwrite("coderate", &cli_args::coderate)
+        .def_readwrite("frame_blocks", &cli_args::frame_blocks)
+        .def_readwrite("interleave_depth", &cli_args::interleave_depth);
 }
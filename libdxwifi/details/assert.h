@@ -57,7 +57,8 @@
         if (expr)                                                               \
             ; /* empty */                                                       \
         else                                                                    \
-            __assert_M (true, #expr, __FILE__, __LINE__, msg, ##__VA_ARGS__);   \
+            __assert_M (true, #expr, DXWIFI_LOG_MODULE,                         \
+                __FILE__, __LINE__, msg, ##__VA_ARGS__);                        \
     }))
 
 
@@ -67,7 +68,8 @@
         if (expr)                                                               \
             ; /* empty */                                                       \
         else                                                                    \
-            __assert_M (false, #expr, __FILE__, __LINE__, msg, ##__VA_ARGS__);  \
+            __assert_M (false, #expr, DXWIFI_LOG_MODULE,                        \
+                __FILE__, __LINE__, msg, ##__VA_ARGS__);                        \
     }))
 
 
@@ -81,7 +83,7 @@
 
 
 // This function may or may not be used in production. Add unused attribute to notify GCC to not produce errors
-__attribute__((unused)) static void __assert_M(bool exit, const char* expr, const char* file, int line, const char* msg, ...) {
+__attribute__((unused)) static void __assert_M(bool exit, const char* expr, dxwifi_log_module_t module, const char* file, int line, const char* msg, ...) {
 
     char* path  = strdup(file);
     char* bname = basename(path);
@@ -96,7 +98,7 @@ __attribute__((unused)) static void __assert_M(bool exit, const char* expr, cons
     vsnprintf(fmt + chars, DXWIFI_ASSERT_MSG_MAX_LEN - chars, msg, args);
     va_end(args);
 
-    __dxwifi_log( exit ? DXWIFI_LOG_FATAL : DXWIFI_LOG_ERROR, file, "%s", fmt);
+    __dxwifi_log(module, exit ? DXWIFI_LOG_FATAL : DXWIFI_LOG_ERROR, "%s", fmt);
 
     free(path);
     if( exit ) {
@@ -0,0 +1,682 @@
+/**
+ *  async_logger.c
+ *
+ *  DESCRIPTION: See async_logger.h for details
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <sched.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/frame_ring.h>
+#include <libdxwifi/details/async_logger.h>
+
+
+/**
+ *  A log statement as it sits in a ring slot. Arguments are packed in the
+ *  order the format string consumes them, integers and pointers as 8 bytes,
+ *  doubles as 8 bytes and strings as a 2 byte length followed by the bytes.
+ */
+typedef struct {
+    uint64_t    timestamp_ns;   /* When the statement ran, CLOCK_MONOTONIC  */
+    const char* fmt;            /* Format string of the statement           */
+    uint8_t     module;         /* dxwifi_log_module_t                      */
+    uint8_t     level;          /* dxwifi_log_level_t                       */
+    bool        truncated;      /* Ran out of room for the arguments        */
+    uint16_t    length;         /* Bytes of packed arguments                */
+    uint8_t     args[];         /* Packed arguments                         */
+} log_record;
+
+
+#define LOG_RECORD_ARGS_MAX (DXWIFI_ASYNC_LOG_RECORD_SIZE - offsetof(log_record, args))
+
+
+typedef struct log_ring {
+    frame_ring              ring;       /* Records queued by one thread         */
+    atomic_uint_fast64_t    dropped;    /* Records lost to a full ring          */
+    atomic_uint_fast64_t    truncated;  /* Records cut short                    */
+    atomic_bool             queueing;   /* Owner is between checking running and
+                                           committing its record                */
+    struct log_ring*        next;       /* Next registered ring                 */
+} log_ring;
+
+
+typedef struct {
+    dxwifi_logger           sink;           /* Receives the formatted messages  */
+    size_t                  ring_capacity;  /* Records per new thread ring      */
+    pthread_t               thread;         /* Runs drain_rings()               */
+    atomic_bool             running;        /* Producers queue records when set */
+    atomic_bool             stopping;       /* Thread flushes and exits if set  */
+    uint64_t                deadline_ns;    /* End of the shutdown flush        */
+    _Atomic(log_ring*)      rings;          /* Every ring ever registered       */
+    atomic_size_t           threads;        /* Number of registered rings       */
+    atomic_uint_fast64_t    logged;         /* Records passed to the sink       */
+    atomic_uint_fast64_t    unflushed;      /* Records discarded on shutdown    */
+} async_log_state;
+
+
+static async_log_state state;
+
+// Rings live until the process exits so a thread never holds a freed one
+static _Thread_local log_ring* thread_ring = NULL;
+
+
+typedef enum {
+    LENGTH_NONE,
+    LENGTH_HH,
+    LENGTH_H,
+    LENGTH_L,
+    LENGTH_LL,
+    LENGTH_J,
+    LENGTH_Z,
+    LENGTH_T,
+    LENGTH_LONG_DOUBLE
+} length_modifier_t;
+
+
+typedef struct {
+    const char*         start;          /* The '%' of the conversion                */
+    size_t              prefix;         /* Length of '%', flags, width, precision   */
+    int                 stars;          /* Width and precision passed as arguments  */
+    length_modifier_t   length;         /* Length modifier                          */
+    char                conversion;     /* Conversion specifier, 0 if missing       */
+} conversion_spec;
+
+
+typedef struct {
+    uint8_t*    data;           /* Packed arguments                 */
+    size_t      length;         /* Bytes written or read            */
+    size_t      capacity;       /* Bytes available                  */
+    bool        truncated;      /* An argument didn't fit           */
+} arg_buffer;
+
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+// Parses the conversion starting at the '%' pointed to by p, returns the first
+// character after it
+static const char* parse_conversion(const char* p, conversion_spec* spec) {
+    spec->start = p++;
+    spec->stars = 0;
+
+    while(*p && strchr("-+ #0'", *p)) {
+        ++p;
+    }
+    for(int field = 0; field < 2; ++field) {
+        if(field == 1) {
+            if(*p != '.') {
+                break;
+            }
+            ++p;
+        }
+        if(*p == '*') {
+            ++spec->stars;
+            ++p;
+        }
+        while('0' <= *p && *p <= '9') {
+            ++p;
+        }
+    }
+    spec->prefix = p - spec->start;
+
+    switch (*p)
+    {
+    case 'h':
+        spec->length = (p[1] == 'h') ? LENGTH_HH : LENGTH_H;
+        p += (p[1] == 'h') ? 2 : 1;
+        break;
+    case 'l':
+        spec->length = (p[1] == 'l') ? LENGTH_LL : LENGTH_L;
+        p += (p[1] == 'l') ? 2 : 1;
+        break;
+    case 'q':
+        spec->length = LENGTH_LL;
+        ++p;
+        break;
+    case 'j':
+        spec->length = LENGTH_J;
+        ++p;
+        break;
+    case 'z':
+        spec->length = LENGTH_Z;
+        ++p;
+        break;
+    case 't':
+        spec->length = LENGTH_T;
+        ++p;
+        break;
+    case 'L':
+        spec->length = LENGTH_LONG_DOUBLE;
+        ++p;
+        break;
+    default:
+        spec->length = LENGTH_NONE;
+        break;
+    }
+    spec->conversion = *p;
+    return *p ? p + 1 : p;
+}
+
+
+static int64_t read_signed(va_list* args, length_modifier_t length) {
+    switch (length)
+    {
+    case LENGTH_HH: return (signed char) va_arg(*args, int);
+    case LENGTH_H:  return (short) va_arg(*args, int);
+    case LENGTH_L:  return va_arg(*args, long);
+    case LENGTH_LL: return va_arg(*args, long long);
+    case LENGTH_J:  return va_arg(*args, intmax_t);
+    case LENGTH_Z:  return va_arg(*args, ssize_t);
+    case LENGTH_T:  return va_arg(*args, ptrdiff_t);
+    default:        return va_arg(*args, int);
+    }
+}
+
+
+static uint64_t read_unsigned(va_list* args, length_modifier_t length) {
+    switch (length)
+    {
+    case LENGTH_HH: return (unsigned char) va_arg(*args, unsigned);
+    case LENGTH_H:  return (unsigned short) va_arg(*args, unsigned);
+    case LENGTH_L:  return va_arg(*args, unsigned long);
+    case LENGTH_LL: return va_arg(*args, unsigned long long);
+    case LENGTH_J:  return va_arg(*args, uintmax_t);
+    case LENGTH_Z:  return va_arg(*args, size_t);
+    case LENGTH_T:  return va_arg(*args, ptrdiff_t);
+    default:        return va_arg(*args, unsigned);
+    }
+}
+
+
+static bool pack(arg_buffer* buffer, const void* value, size_t size) {
+    if(buffer->truncated || buffer->length + size > buffer->capacity) {
+        buffer->truncated = true;
+        return false;
+    }
+    memcpy(buffer->data + buffer->length, value, size);
+    buffer->length += size;
+    return true;
+}
+
+
+// Copies as much of the string as fits
+static void pack_string(arg_buffer* buffer, const char* str) {
+    str = str ? str : "(null)";
+
+    size_t   space  = buffer->capacity - buffer->length;
+    size_t   room   = (space > sizeof(uint16_t)) ? space - sizeof(uint16_t) : 0;
+    size_t   len    = strnlen(str, room + 1);
+    uint16_t stored = (len < room) ? len : room;
+
+    if(pack(buffer, &stored, sizeof(stored))) {
+        pack(buffer, str, stored);
+        buffer->truncated |= stored < len;
+    }
+}
+
+
+// Walks the format string the way printf does and packs every argument
+static void pack_args(arg_buffer* buffer, const char* fmt, va_list* args) {
+    conversion_spec spec;
+
+    for(const char* p = strchr(fmt, '%'); p && !buffer->truncated; p = strchr(p, '%')) {
+        p = parse_conversion(p, &spec);
+
+        for(int i = 0; i < spec.stars; ++i) {
+            int64_t star = va_arg(*args, int);
+            pack(buffer, &star, sizeof(star));
+        }
+
+        switch (spec.conversion)
+        {
+        case 'd': case 'i': {
+                int64_t value = read_signed(args, spec.length);
+                pack(buffer, &value, sizeof(value));
+            }
+            break;
+
+        case 'o': case 'u': case 'x': case 'X': {
+                uint64_t value = read_unsigned(args, spec.length);
+                pack(buffer, &value, sizeof(value));
+            }
+            break;
+
+        case 'c': {
+                int64_t value = va_arg(*args, int);
+                pack(buffer, &value, sizeof(value));
+            }
+            break;
+
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A': {
+                double value = (spec.length == LENGTH_LONG_DOUBLE) ? va_arg(*args, long double) : va_arg(*args, double);
+                pack(buffer, &value, sizeof(value));
+            }
+            break;
+
+        case 's':
+            // Wide strings are logged as their address
+            if(spec.length != LENGTH_NONE) {
+                uint64_t value = (uintptr_t) va_arg(*args, void*);
+                pack(buffer, &value, sizeof(value));
+            }
+            else {
+                pack_string(buffer, va_arg(*args, const char*));
+            }
+            break;
+
+        case 'p': case 'n': {
+                uint64_t value = (uintptr_t) va_arg(*args, void*);
+                pack(buffer, &value, sizeof(value));
+            }
+            break;
+
+        case 'm':
+            pack_string(buffer, strerror(errno));
+            break;
+
+        default: // %% and malformed conversions take no argument
+            break;
+        }
+    }
+}
+
+
+static bool unpack(arg_buffer* buffer, void* value, size_t size) {
+    if(buffer->length + size > buffer->capacity) {
+        return false;
+    }
+    memcpy(value, buffer->data + buffer->length, size);
+    buffer->length += size;
+    return true;
+}
+
+
+// Appends snprintf output, keeping the line null terminated when it's cut off
+#define append_format(line, len, fmt, ...) do {                                 \
+        int __n = snprintf((line) + (len), DXWIFI_ASYNC_LOG_LINE_MAX - (len), fmt, ##__VA_ARGS__); \
+        (len) += (__n > 0) ? __n : 0;                                           \
+        (len)  = ((len) < DXWIFI_ASYNC_LOG_LINE_MAX) ? (len) : DXWIFI_ASYNC_LOG_LINE_MAX - 1; \
+    } while(0)
+
+
+// Formats one conversion after its width and precision arguments
+#define append_conversion(line, len, conv_fmt, nstars, stars, value) do {      \
+        switch (nstars) {                                                       \
+        case 0:  append_format(line, len, conv_fmt, value); break;              \
+        case 1:  append_format(line, len, conv_fmt, stars[0], value); break;    \
+        default: append_format(line, len, conv_fmt, stars[0], stars[1], value); \
+        }                                                                       \
+    } while(0)
+
+
+/**
+ *  DESCRIPTION:    Formats a record into a line of text
+ *
+ *  ARGUMENTS:
+ *
+ *      record:     Record taken from a ring
+ *
+ *      line:       Output of DXWIFI_ASYNC_LOG_LINE_MAX bytes
+ *
+ */
+static void format_record(const log_record* record, char* line) {
+    arg_buffer buffer = {
+        .data       = (uint8_t*) record->args,
+        .length     = 0,
+        .capacity   = record->length,
+        .truncated  = false
+    };
+
+    size_t len = 0;
+    line[0] = '\0';
+
+    conversion_spec spec;
+    const char* p = record->fmt;
+    while(*p && !buffer.truncated) {
+        const char* next = strchr(p, '%');
+        if(!next) {
+            append_format(line, len, "%s", p);
+            break;
+        }
+        append_format(line, len, "%.*s", (int)(next - p), p);
+        p = parse_conversion(next, &spec);
+
+        if(spec.conversion == '%' || spec.conversion == '\0') {
+            append_format(line, len, "%s", spec.conversion == '%' ? "%" : "");
+            continue;
+        }
+
+        int stars[2] = { 0, 0 };
+        for(int i = 0; i < spec.stars; ++i) {
+            int64_t star = 0;
+            buffer.truncated |= !unpack(&buffer, &star, sizeof(star));
+            stars[i] = star;
+        }
+
+        // Rebuild the conversion with a length modifier matching how the
+        // argument was packed
+        char conversion = spec.conversion;
+        if(conversion == 'n' || (conversion == 's' && spec.length != LENGTH_NONE)) {
+            conversion = 'p';
+        }
+        const char* length  = strchr("diouxX", conversion) ? "ll" : "";
+        int prefix          = (spec.prefix < 24) ? spec.prefix : 24;
+
+        char conv_fmt[32];
+        snprintf(conv_fmt, sizeof(conv_fmt), "%.*s%s%c", prefix, spec.start, length, (conversion == 'm') ? 's' : conversion);
+
+        switch (conversion)
+        {
+        case 'd': case 'i': case 'c': {
+                int64_t value = 0;
+                if(!(buffer.truncated |= !unpack(&buffer, &value, sizeof(value)))) {
+                    if(conversion == 'c') {
+                        append_conversion(line, len, conv_fmt, spec.stars, stars, (int) value);
+                    }
+                    else {
+                        append_conversion(line, len, conv_fmt, spec.stars, stars, (long long) value);
+                    }
+                }
+            }
+            break;
+
+        case 'o': case 'u': case 'x': case 'X': {
+                uint64_t value = 0;
+                if(!(buffer.truncated |= !unpack(&buffer, &value, sizeof(value)))) {
+                    append_conversion(line, len, conv_fmt, spec.stars, stars, (unsigned long long) value);
+                }
+            }
+            break;
+
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A': {
+                double value = 0;
+                if(!(buffer.truncated |= !unpack(&buffer, &value, sizeof(value)))) {
+                    append_conversion(line, len, conv_fmt, spec.stars, stars, value);
+                }
+            }
+            break;
+
+        case 's': case 'm': {
+                uint16_t size = 0;
+                char str[LOG_RECORD_ARGS_MAX + 1];
+                if(!(buffer.truncated |= !unpack(&buffer, &size, sizeof(size)) || !unpack(&buffer, str, size))) {
+                    str[size] = '\0';
+                    append_conversion(line, len, conv_fmt, spec.stars, stars, str);
+                }
+            }
+            break;
+
+        case 'p': {
+                uint64_t value = 0;
+                if(!(buffer.truncated |= !unpack(&buffer, &value, sizeof(value))) && spec.conversion != 'n') {
+                    append_conversion(line, len, conv_fmt, spec.stars, stars, (void*)(uintptr_t) value);
+                }
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+    if(record->truncated || buffer.truncated) {
+        append_format(line, len, "...");
+    }
+}
+
+
+// Passes a formatted message to the sink
+static void emit(dxwifi_log_module_t module, dxwifi_log_level_t log_level, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    state.sink(module, log_level, fmt, args);
+    va_end(args);
+}
+
+
+static log_ring* register_thread() {
+    log_ring* ring = calloc(1, sizeof(log_ring));
+    assert_M(ring, "Failed to allocate async log ring");
+
+    init_frame_ring(&ring->ring, state.ring_capacity, DXWIFI_ASYNC_LOG_RECORD_SIZE);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->truncated, 0);
+    atomic_init(&ring->queueing, false);
+
+    ring->next = atomic_load_explicit(&state.rings, memory_order_relaxed);
+    while(!atomic_compare_exchange_weak_explicit(&state.rings, &ring->next, ring, memory_order_release, memory_order_relaxed)) {
+        ;
+    }
+    atomic_fetch_add_explicit(&state.threads, 1, memory_order_relaxed);
+
+    thread_ring = ring;
+    return ring;
+}
+
+
+// Oldest queued record across every ring
+static log_ring* oldest_ring(log_record** oldest) {
+    log_ring* found = NULL;
+    *oldest = NULL;
+
+    for(log_ring* ring = atomic_load_explicit(&state.rings, memory_order_acquire); ring; ring = ring->next) {
+        log_record* record = (log_record*) frame_ring_peek(&ring->ring);
+        if(record && (!*oldest || record->timestamp_ns < (*oldest)->timestamp_ns)) {
+            *oldest = record;
+            found   = ring;
+        }
+    }
+    return found;
+}
+
+
+/**
+ *  DESCRIPTION:    Formats queued records in timestamp order until the rings
+ *                  are empty or the deadline passes
+ *
+ *  ARGUMENTS:
+ *
+ *      deadline_ns:    CLOCK_MONOTONIC time to stop at
+ *
+ *  RETURNS:
+ *
+ *      size_t:         Number of records passed to the sink
+ *
+ */
+static size_t flush_records(uint64_t deadline_ns) {
+    char line[DXWIFI_ASYNC_LOG_LINE_MAX];
+
+    size_t count = 0;
+    log_record* record = NULL;
+    for(log_ring* ring = oldest_ring(&record); ring && now_ns() < deadline_ns; ring = oldest_ring(&record)) {
+        format_record(record, line);
+        emit(record->module, record->level, "%s", line);
+        frame_ring_release(&ring->ring);
+        ++count;
+    }
+    atomic_fetch_add_explicit(&state.logged, count, memory_order_relaxed);
+    return count;
+}
+
+
+static uint64_t total_dropped() {
+    uint64_t dropped = 0;
+    for(log_ring* ring = atomic_load_explicit(&state.rings, memory_order_acquire); ring; ring = ring->next) {
+        dropped += atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    }
+    return dropped;
+}
+
+
+// Background thread, formats records until told to stop
+static void* drain_rings(void* arg) {
+    __DXWIFI_UTILS_UNUSED(arg);
+
+    uint64_t reported = total_dropped();
+    while(true) {
+        bool stopping = atomic_load_explicit(&state.stopping, memory_order_acquire);
+        size_t count  = flush_records(stopping ? state.deadline_ns : UINT64_MAX);
+
+        uint64_t dropped = total_dropped();
+        if(dropped != reported) {
+            emit(DXWIFI_LOG_GENERIC, DXWIFI_LOG_WARN, "Async logger dropped %lu records, rings were full", (unsigned long)(dropped - reported));
+            reported = dropped;
+        }
+        if(stopping) {
+            break;
+        }
+        if(count == 0) {
+            struct timespec idle = { 0, DXWIFI_ASYNC_LOG_POLL_MS * 1000000L };
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+
+bool start_async_logger(dxwifi_logger sink, size_t ring_capacity) {
+    debug_assert(sink && ring_capacity > 0);
+
+    if(atomic_load(&state.running)) {
+        return false;
+    }
+    state.sink          = sink;
+    state.ring_capacity = ring_capacity;
+    atomic_store(&state.stopping, false);
+
+    // Signals must interrupt the application threads, not ours
+    sigset_t all_signals, prev_mask;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &prev_mask);
+
+    int status = pthread_create(&state.thread, NULL, drain_rings, NULL);
+
+    pthread_sigmask(SIG_SETMASK, &prev_mask, NULL);
+
+    if(status != 0) {
+        return false;
+    }
+    atomic_store_explicit(&state.running, true, memory_order_release);
+    return true;
+}
+
+
+// Waits for threads that saw the logger running to commit their records
+static void wait_for_producers() {
+    for(log_ring* ring = atomic_load(&state.rings); ring; ring = ring->next) {
+        while(atomic_load(&ring->queueing)) {
+            sched_yield();
+        }
+    }
+}
+
+
+uint64_t stop_async_logger(unsigned timeout_ms) {
+    if(!atomic_exchange(&state.running, false)) {
+        return 0;
+    }
+    wait_for_producers();
+
+    state.deadline_ns = now_ns() + (uint64_t) timeout_ms * 1000000ull;
+    atomic_store_explicit(&state.stopping, true, memory_order_release);
+
+    pthread_join(state.thread, NULL);
+
+    uint64_t unflushed = 0;
+    for(log_ring* ring = atomic_load(&state.rings); ring; ring = ring->next) {
+        while(frame_ring_peek(&ring->ring)) {
+            frame_ring_release(&ring->ring);
+            ++unflushed;
+        }
+    }
+    atomic_fetch_add(&state.unflushed, unflushed);
+
+    if(unflushed > 0) {
+        emit(DXWIFI_LOG_GENERIC, DXWIFI_LOG_WARN, "Async logger discarded %lu records, the flush timed out", (unsigned long) unflushed);
+    }
+    return unflushed;
+}
+
+
+void async_logger(dxwifi_log_module_t module, dxwifi_log_level_t log_level, const char* fmt, va_list args) {
+    dxwifi_logger sink = state.sink ? state.sink : default_logger;
+
+    // Errors go out right away, an assert aborts before the thread gets to them
+    if(log_level <= DXWIFI_LOG_ERROR || !atomic_load_explicit(&state.running, memory_order_acquire)) {
+        sink(module, log_level, fmt, args);
+        return;
+    }
+
+    log_ring* ring = thread_ring ? thread_ring : register_thread();
+
+    // Pairs with stop_async_logger(), which clears running and then waits
+    // for queueing to clear. Either it waits for this record or we see it
+    // stopped and log synchronously.
+    atomic_store(&ring->queueing, true);
+    if(!atomic_load(&state.running)) {
+        atomic_store(&ring->queueing, false);
+        sink(module, log_level, fmt, args);
+        return;
+    }
+
+    log_record* record = (log_record*) frame_ring_reserve(&ring->ring);
+    if(!record) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        atomic_store_explicit(&ring->queueing, false, memory_order_release);
+        return;
+    }
+    record->timestamp_ns    = now_ns();
+    record->fmt             = fmt;
+    record->module          = module;
+    record->level           = log_level;
+
+    arg_buffer buffer = {
+        .data       = record->args,
+        .length     = 0,
+        .capacity   = LOG_RECORD_ARGS_MAX,
+        .truncated  = false
+    };
+
+    va_list copy;
+    va_copy(copy, args);
+    pack_args(&buffer, fmt, &copy);
+    va_end(copy);
+
+    record->length      = buffer.length;
+    record->truncated   = buffer.truncated;
+    if(buffer.truncated) {
+        atomic_fetch_add_explicit(&ring->truncated, 1, memory_order_relaxed);
+    }
+    frame_ring_commit(&ring->ring);
+    atomic_store_explicit(&ring->queueing, false, memory_order_release);
+}
+
+
+dxwifi_async_log_stats get_async_logger_stats() {
+    dxwifi_async_log_stats stats = {
+        .logged     = atomic_load(&state.logged),
+        .dropped    = total_dropped(),
+        .truncated  = 0,
+        .unflushed  = atomic_load(&state.unflushed),
+        .threads    = atomic_load(&state.threads)
+    };
+    for(log_ring* ring = atomic_load(&state.rings); ring; ring = ring->next) {
+        stats.truncated += atomic_load_explicit(&ring->truncated, memory_order_relaxed);
+    }
+    return stats;
+}
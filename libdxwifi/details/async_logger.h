@@ -0,0 +1,109 @@
+/**
+ *  async_logger.h
+ *
+ *  DESCRIPTION: Asynchronous logger for the DxWiFi logging facade. Log
+ *  statements don't format anything, they copy a compact binary record
+ *  (timestamp, module, level, format string pointer and the raw arguments)
+ *  into a lock-free ring owned by the calling thread. A background thread
+ *  merges the rings in timestamp order, formats the records and hands each
+ *  message to a sink logger such as default_logger or syslogger.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: Format strings must outlive the process' logging, which holds for the
+ *  string literals the log_* macros are used with. String arguments are copied
+ *  into the record. A record whose arguments don't fit is cut short and the
+ *  message ends with "...", long hexdumps are cut this way. Records logged
+ *  while a thread's ring is full are dropped and counted. Errors and fatal
+ *  messages skip the rings and go straight to the sink, so they aren't lost
+ *  when the process aborts right after logging them.
+ *
+ */
+
+#ifndef LIBDXWIFI_ASYNC_LOGGER_H
+#define LIBDXWIFI_ASYNC_LOGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <libdxwifi/details/logging.h>
+
+
+#define DXWIFI_ASYNC_LOG_RECORD_SIZE        512     /* Size of a ring slot            */
+#define DXWIFI_ASYNC_LOG_DFLT_CAPACITY      512     /* Records per thread ring        */
+#define DXWIFI_ASYNC_LOG_DFLT_FLUSH_MS      500     /* Shutdown flush bound           */
+#define DXWIFI_ASYNC_LOG_POLL_MS            10      /* Background thread idle sleep   */
+#define DXWIFI_ASYNC_LOG_LINE_MAX           1024    /* Longest formatted message      */
+
+
+typedef struct {
+    uint64_t    logged;         /* Records formatted and passed to the sink       */
+    uint64_t    dropped;        /* Records lost because a ring was full           */
+    uint64_t    truncated;      /* Records whose arguments didn't fit their slot  */
+    uint64_t    unflushed;      /* Records still queued when the flush timed out  */
+    size_t      threads;        /* Threads that have logged through the rings     */
+} dxwifi_async_log_stats;
+
+
+/**
+ *  DESCRIPTION:    Starts the background thread. Call set_logger with
+ *                  async_logger afterwards to route modules through it.
+ *
+ *  ARGUMENTS:
+ *
+ *      sink:           Logger the formatted messages are passed to
+ *
+ *      ring_capacity:  Number of records each thread can queue, rounded up to
+ *                      a power of two
+ *
+ *  RETURNS:
+ *
+ *      bool:           true if the logger started
+ *
+ *  NOTES: Start the logger after any fork, the background thread isn't
+ *  carried into the child.
+ *
+ */
+bool start_async_logger(dxwifi_logger sink, size_t ring_capacity);
+
+
+/**
+ *  DESCRIPTION:    Flushes the queued records and stops the background thread.
+ *                  Records other threads are still queueing are waited for
+ *                  and flushed too. Records logged afterwards go to the sink
+ *                  synchronously.
+ *
+ *  ARGUMENTS:
+ *
+ *      timeout_ms: Longest time spent flushing, whatever is still queued when
+ *                  it runs out is discarded and counted as unflushed
+ *
+ *  RETURNS:
+ *
+ *      uint64_t:   Number of records that weren't flushed
+ *
+ */
+uint64_t stop_async_logger(unsigned timeout_ms);
+
+
+/**
+ *  DESCRIPTION:    Logger that queues a record on the calling thread's ring.
+ *                  See logging.h for a description of the arguments
+ *
+ */
+void async_logger(dxwifi_log_module_t module, dxwifi_log_level_t log_level, const char* fmt, va_list args);
+
+
+/**
+ *  DESCRIPTION:    Reads the async logger's counters
+ *
+ *  RETURNS:
+ *
+ *      dxwifi_async_log_stats: Counters since the process started
+ *
+ */
+dxwifi_async_log_stats get_async_logger_stats();
+
+
+#endif // LIBDXWIFI_ASYNC_LOGGER_H
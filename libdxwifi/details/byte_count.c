@@ -0,0 +1,205 @@
+/**
+ *  byte_count.c
+ *  
+ *  DESCRIPTION: See byte_count.h for details
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <libdxwifi/details/byte_count.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define BYTE_COUNT_HAVE_AVX2 1
+#endif
+
+#if defined(BYTE_COUNT_HAVE_NEON) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+
+// Byte lanes are 8-bit counters so flush them before they can overflow
+#define LANE_COUNTER_MAX 255
+
+
+/**
+ *  DESCRIPTION:    Counts bytes equal to value in a single 64-bit word without
+ *                  branching. Each zero byte of word ^ pattern gets its high
+ *                  bit set, the masks are then popcounted.
+ * 
+ */
+static inline unsigned count_in_word(uint64_t word, uint8_t value) {
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7full;
+
+    uint64_t x = word ^ (0x0101010101010101ull * value);
+    uint64_t t = ((x & low7) + low7) | x | low7;
+
+    return __builtin_popcountll(~t);
+}
+
+
+static void count_byte_pair_swar(const uint8_t* data, size_t nbytes, uint8_t a, uint8_t b, size_t* count_a, size_t* count_b) {
+    size_t na = 0, nb = 0, i = 0;
+
+    for(; i + sizeof(uint64_t) <= nbytes; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        na += count_in_word(word, a);
+        nb += count_in_word(word, b);
+    }
+    for(; i < nbytes; ++i) {
+        na += data[i] == a;
+        nb += data[i] == b;
+    }
+    *count_a = na;
+    *count_b = nb;
+}
+
+
+#if defined(__SSE2__)
+static void count_byte_pair_sse2(const uint8_t* data, size_t nbytes, uint8_t a, uint8_t b, size_t* count_a, size_t* count_b) {
+    const __m128i va    = _mm_set1_epi8((char)a);
+    const __m128i vb    = _mm_set1_epi8((char)b);
+    const __m128i zero  = _mm_setzero_si128();
+
+    __m128i total_a = zero, total_b = zero;
+    size_t i = 0;
+
+    while(i + sizeof(__m128i) <= nbytes) {
+        __m128i acc_a = zero, acc_b = zero;
+
+        // Matches are 0xff (-1) so subtracting them increments each lane
+        for(unsigned n = 0; n < LANE_COUNTER_MAX && i + sizeof(__m128i) <= nbytes; ++n, i += sizeof(__m128i)) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+            acc_a = _mm_sub_epi8(acc_a, _mm_cmpeq_epi8(v, va));
+            acc_b = _mm_sub_epi8(acc_b, _mm_cmpeq_epi8(v, vb));
+        }
+        total_a = _mm_add_epi64(total_a, _mm_sad_epu8(acc_a, zero));
+        total_b = _mm_add_epi64(total_b, _mm_sad_epu8(acc_b, zero));
+    }
+
+    size_t tail_a = 0, tail_b = 0;
+    count_byte_pair_swar(data + i, nbytes - i, a, b, &tail_a, &tail_b);
+
+    uint64_t lanes_a[2], lanes_b[2];
+    _mm_storeu_si128((__m128i*)lanes_a, total_a);
+    _mm_storeu_si128((__m128i*)lanes_b, total_b);
+
+    *count_a = lanes_a[0] + lanes_a[1] + tail_a;
+    *count_b = lanes_b[0] + lanes_b[1] + tail_b;
+}
+#endif // __SSE2__
+
+
+#if defined(BYTE_COUNT_HAVE_AVX2)
+__attribute__((target("avx2")))
+static void count_byte_pair_avx2(const uint8_t* data, size_t nbytes, uint8_t a, uint8_t b, size_t* count_a, size_t* count_b) {
+    const __m256i va    = _mm256_set1_epi8((char)a);
+    const __m256i vb    = _mm256_set1_epi8((char)b);
+    const __m256i zero  = _mm256_setzero_si256();
+
+    __m256i total_a = zero, total_b = zero;
+    size_t i = 0;
+
+    while(i + sizeof(__m256i) <= nbytes) {
+        __m256i acc_a = zero, acc_b = zero;
+
+        for(unsigned n = 0; n < LANE_COUNTER_MAX && i + sizeof(__m256i) <= nbytes; ++n, i += sizeof(__m256i)) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+            acc_a = _mm256_sub_epi8(acc_a, _mm256_cmpeq_epi8(v, va));
+            acc_b = _mm256_sub_epi8(acc_b, _mm256_cmpeq_epi8(v, vb));
+        }
+        total_a = _mm256_add_epi64(total_a, _mm256_sad_epu8(acc_a, zero));
+        total_b = _mm256_add_epi64(total_b, _mm256_sad_epu8(acc_b, zero));
+    }
+
+    size_t tail_a = 0, tail_b = 0;
+    count_byte_pair_swar(data + i, nbytes - i, a, b, &tail_a, &tail_b);
+
+    uint64_t lanes_a[4], lanes_b[4];
+    _mm256_storeu_si256((__m256i*)lanes_a, total_a);
+    _mm256_storeu_si256((__m256i*)lanes_b, total_b);
+
+    *count_a = lanes_a[0] + lanes_a[1] + lanes_a[2] + lanes_a[3] + tail_a;
+    *count_b = lanes_b[0] + lanes_b[1] + lanes_b[2] + lanes_b[3] + tail_b;
+}
+#endif // BYTE_COUNT_HAVE_AVX2
+
+
+#if defined(BYTE_COUNT_HAVE_NEON)
+// Advanced SIMD is mandatory on AArch64, 32-bit ARM has to ask the kernel
+static bool neon_supported() {
+#if defined(__aarch64__)
+    return true;
+#else
+    return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+}
+
+
+static void count_byte_pair_neon_tail(const uint8_t* data, size_t nbytes, uint8_t a, uint8_t b, size_t* count_a, size_t* count_b) {
+    size_t na = 0, nb = 0;
+    size_t i = count_byte_pair_neon(data, nbytes, a, b, &na, &nb);
+
+    size_t tail_a = 0, tail_b = 0;
+    count_byte_pair_swar(data + i, nbytes - i, a, b, &tail_a, &tail_b);
+
+    *count_a = na + tail_a;
+    *count_b = nb + tail_b;
+}
+#endif // BYTE_COUNT_HAVE_NEON
+
+
+typedef void (*count_byte_pair_fn)(const uint8_t*, size_t, uint8_t, uint8_t, size_t*, size_t*);
+
+static count_byte_pair_fn count_impl = NULL;
+static const char* count_impl_name = NULL;
+
+static pthread_once_t count_impl_once = PTHREAD_ONCE_INIT;
+
+
+static void select_impl() {
+#if defined(__SSE2__)
+    count_impl = count_byte_pair_sse2;
+    count_impl_name = "sse2";
+#else
+    count_impl = count_byte_pair_swar;
+    count_impl_name = "swar";
+#endif
+
+#if defined(BYTE_COUNT_HAVE_AVX2)
+    if(__builtin_cpu_supports("avx2")) {
+        count_impl = count_byte_pair_avx2;
+        count_impl_name = "avx2";
+    }
+#endif
+
+#if defined(BYTE_COUNT_HAVE_NEON)
+    if(neon_supported()) {
+        count_impl = count_byte_pair_neon_tail;
+        count_impl_name = "neon";
+    }
+#endif
+}
+
+
+void count_byte_pair(const uint8_t* data, size_t nbytes, uint8_t a, uint8_t b, size_t* count_a, size_t* count_b) {
+    pthread_once(&count_impl_once, select_impl);
+    count_impl(data, nbytes, a, b, count_a, count_b);
+}
+
+
+const char* byte_count_impl() {
+    pthread_once(&count_impl_once, select_impl);
+    return count_impl_name;
+}
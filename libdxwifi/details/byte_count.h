@@ -0,0 +1,81 @@
+/**
+ *  byte_count.h
+ *  
+ *  DESCRIPTION: Vectorized byte population counters
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ *  NOTES: SSE2 is selected at compile time, AVX2 is selected at runtime on
+ *  x86 CPUs that support it. NEON is selected at runtime on ARM CPUs that
+ *  report it in AT_HWCAP, and is always present on AArch64. Every other
+ *  target uses a portable word-at-a-time popcount fallback.
+ * 
+ */
+
+
+#ifndef LIBDXWIFI_BYTE_COUNT_H
+#define LIBDXWIFI_BYTE_COUNT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__arm__) || defined(__aarch64__)
+#define BYTE_COUNT_HAVE_NEON 1
+#endif
+
+
+/**
+ *  DESCRIPTION:    Counts how many bytes in the buffer are equal to each of
+ *                  two values in a single pass
+ * 
+ *  ARGUMENTS: 
+ * 
+ *      data:       Buffer to scan
+ * 
+ *      nbytes:     Size of the buffer
+ * 
+ *      a:          First value to count
+ * 
+ *      b:          Second value to count
+ * 
+ *      count_a:    Set to the number of bytes equal to a
+ * 
+ *      count_b:    Set to the number of bytes equal to b
+ * 
+ */
+void count_byte_pair(const uint8_t* data, size_t nbytes, uint8_t a, uint8_t b, size_t* count_a, size_t* count_b);
+
+
+/**
+ *  DESCRIPTION:    Names the implementation count_byte_pair() dispatches to
+ * 
+ *  RETURNS:
+ *      
+ *      const char*: "avx2", "sse2", "neon" or "swar"
+ * 
+ */
+const char* byte_count_impl();
+
+
+#if defined(BYTE_COUNT_HAVE_NEON)
+/**
+ *  DESCRIPTION:    NEON kernel behind count_byte_pair(), counts whole 16-byte
+ *                  vectors only
+ * 
+ *  ARGUMENTS: 
+ * 
+ *      See count_byte_pair()
+ * 
+ *  RETURNS:
+ *      
+ *      size_t: Number of leading bytes counted, the caller counts the rest
+ * 
+ *  NOTES: Only call this after checking the CPU has NEON. It counts nothing
+ *  when byte_count_neon.c was built without NEON enabled.
+ * 
+ */
+size_t count_byte_pair_neon(const uint8_t* data, size_t nbytes, uint8_t a, uint8_t b, size_t* count_a, size_t* count_b);
+#endif // BYTE_COUNT_HAVE_NEON
+
+
+#endif // LIBDXWIFI_BYTE_COUNT_H
@@ -0,0 +1,66 @@
+/**
+ *  byte_count_neon.c
+ *
+ *  DESCRIPTION: NEON byte pair counter, see byte_count.h for details
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: On 32-bit ARM this file is the only one built with -mfpu=neon, so
+ *  NEON instructions never leak into code that runs before the HWCAP check.
+ *
+ */
+
+#include <libdxwifi/details/byte_count.h>
+
+#if defined(BYTE_COUNT_HAVE_NEON)
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+
+// Byte lanes are 8-bit counters so flush them before they can overflow
+#define LANE_COUNTER_MAX 255
+
+
+static inline uint64_t neon_sum_u8(uint8x16_t v) {
+    uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(v)));
+    return vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+}
+
+
+size_t count_byte_pair_neon(const uint8_t* data, size_t nbytes, uint8_t a, uint8_t b, size_t* count_a, size_t* count_b) {
+    const uint8x16_t va = vdupq_n_u8(a);
+    const uint8x16_t vb = vdupq_n_u8(b);
+
+    size_t na = 0, nb = 0, i = 0;
+
+    while(i + sizeof(uint8x16_t) <= nbytes) {
+        uint8x16_t acc_a = vdupq_n_u8(0), acc_b = vdupq_n_u8(0);
+
+        // Matches are 0xff (-1) so subtracting them increments each lane
+        for(unsigned n = 0; n < LANE_COUNTER_MAX && i + sizeof(uint8x16_t) <= nbytes; ++n, i += sizeof(uint8x16_t)) {
+            uint8x16_t v = vld1q_u8(data + i);
+            acc_a = vsubq_u8(acc_a, vceqq_u8(v, va));
+            acc_b = vsubq_u8(acc_b, vceqq_u8(v, vb));
+        }
+        na += neon_sum_u8(acc_a);
+        nb += neon_sum_u8(acc_b);
+    }
+    *count_a = na;
+    *count_b = nb;
+    return i;
+}
+
+#else
+
+// Built without NEON enabled, count nothing and leave it all to the caller
+size_t count_byte_pair_neon(const uint8_t* data, size_t nbytes, uint8_t a, uint8_t b, size_t* count_a, size_t* count_b) {
+    (void)data; (void)nbytes; (void)a; (void)b;
+    *count_a = 0;
+    *count_b = 0;
+    return 0;
+}
+
+#endif // __ARM_NEON
+
+#endif // BYTE_COUNT_HAVE_NEON
@@ -8,6 +8,8 @@
  */
 
 
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_DAEMON
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
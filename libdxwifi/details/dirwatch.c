@@ -8,25 +8,56 @@
  */
 
 
+#define _GNU_SOURCE // F_SETLEASE
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_DIRWATCH
+
 #include <poll.h>
+#include <time.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <fnmatch.h>
+#include <sys/stat.h>
 
 #include <linux/limits.h>
+#include <libdxwifi/details/utils.h>
 #include <libdxwifi/details/assert.h>
 #include <libdxwifi/details/logging.h>
 #include <libdxwifi/details/dirwatch.h>
 
 
-// TODO all the find operations just do a linear search, which is obviously suboptimal
-
-// Buffer can hold at a minimum, 32 events
+// Buffer can hold at a minimum, 32 events. It's read until inotify is empty
+// so bursts larger than this take several reads, not several handler calls.
 #define EVENT_BUFFSIZE ((sizeof(struct inotify_event) + NAME_MAX + 1) * 32)
 
-static const int EMPTY_NODE = 0;
+// Seconds of mtime granularity allowed for when rescanning after an overflow
+#define RESCAN_SLACK_S 1
+
+// Starting size of the watch list and of each hash table, always a power of two
+#define DIRWATCH_INITIAL_CAPACITY 16
+
+// Marks a hash table slot whose entry was removed, probing continues past it
+#define TOMBSTONE_SLOT (-1)
+
+static char TOMBSTONE_NAME[] = "";
+
+
+/**
+ *  Open addressed set of filenames within a directory. Grows so there's no 
+ *  limit on how many files can be pending or queued.
+ */
+typedef struct {
+    char** names;               /* Filename, NULL or TOMBSTONE_NAME per slot*/
+
+    size_t capacity;            /* Number of slots, a power of two          */
+
+    size_t count;               /* Number of filenames in the set           */
+
+    size_t used;                /* Filenames plus tombstones                */
+} filename_set;
 
 
 typedef struct {
@@ -36,123 +67,334 @@ typedef struct {
 
     char* file_filter;          /* Glob pattern to filter file events       */
 
-    char* watchfiles[DIRWATCH_MAX];
-                                /* Name of each file to watch within the dir*/
+    dirwatch_events_t events;   /* Events subscribed to                     */
+
+    filename_set pending;       /* Files created but not closed yet         */
+
+    filename_set queued;        /* Files waiting on the handler             */
 } watchdir;
 
 
+/**
+ *  Event waiting on the handler. The entry is stale, and skipped, when its 
+ *  file is no longer in the watchdir's queued set. That way an event is queued
+ *  once per file no matter how often the file is closed before it's handled.
+ */
+typedef struct {
+    int wd;                     /* Watch descriptor of the directory        */
+
+    dirwatch_events_t event;    /* Event to report                          */
+
+    char* filename;             /* Name of the file                         */
+} queued_event;
+
+
 struct __dirwatch {
     struct pollfd handle;       /* Pollable inotify handle                  */
 
-    watchdir watchdirs[DIRWATCH_MAX];
-                                /* Directory watchlist                      */
+    watchdir* watchdirs;        /* Directory watchlist, wd is 0 when unused */
+
+    size_t nwatchdirs;          /* Length of the watchlist                  */
+
+    int* wd_slots;              /* Watchlist index + 1 hashed by wd, 0 for 
+                                   empty and TOMBSTONE_SLOT for removed     */
+
+    size_t wd_capacity;         /* Number of wd slots, a power of two       */
+
+    size_t wd_used;             /* Occupied wd slots including tombstones   */
+
+    queued_event* queue;        /* Circular FIFO of events for the handler  */
+
+    size_t queue_capacity;      /* Number of queue entries, a power of two  */
+
+    size_t queue_head;          /* Index of the oldest event                */
+
+    size_t queue_count;         /* Number of events in the queue            */
+
+    time_t drained_at;          /* Last time inotify was read in full       */
 
     volatile bool listen;       /* Loop variable flag                       */
 };
 
 
-// Filtering expression for searching watch lists
-typedef bool (*filter)(const watchdir* node, const void* val);
+static size_t hash_wd(int wd) {
+    return (uint32_t) wd * 2654435761u;
+}
+
+
+// FNV-1a
+static size_t hash_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for(; *name; ++name) {
+        hash = (hash ^ (uint8_t) *name) * 16777619u;
+    }
+    return hash;
+}
 
 
 /**
- *  DESCRIPTION:    Finds the first watchdir that matches the filter
+ *  DESCRIPTION:    Finds the slot of a filename, or the slot it would be
+ *                  inserted at
  * 
  *  ARGUMENTS:
- *      dw:             Allocated dirwatch object
  * 
- *      target:         Value to compare against
+ *      files:      Filename set with at least one empty slot
  * 
- *      match:          Filter expression
+ *      name:       Filename to look for
+ * 
+ *      found:      Set to true if the file is in the set
  * 
  *  RETURNS:
  * 
- *      watch_node*:    Pointer to the matched watch node or NULL
+ *      size_t:     Slot holding the file or the first free slot on its probe
+ *                  sequence
  * 
  */
-static watchdir* find_watchdir(dirwatch* dw, const void* target, filter match) {
-    debug_assert(dw && target);
+static size_t find_name_slot(const filename_set* files, const char* name, bool* found) {
+    size_t mask = files->capacity - 1;
+    size_t slot = hash_name(name) & mask;
+    size_t free_slot = files->capacity;
+
+    for(; files->names[slot]; slot = (slot + 1) & mask) {
+        if(files->names[slot] == TOMBSTONE_NAME) {
+            free_slot = (free_slot == files->capacity) ? slot : free_slot;
+        }
+        else if(strcmp(files->names[slot], name) == 0) {
+            *found = true;
+            return slot;
+        }
+    }
+    *found = false;
+    return (free_slot == files->capacity) ? slot : free_slot;
+}
+
 
-    for(size_t i = 0; i < DIRWATCH_MAX; ++i) {
-        if(match(&dw->watchdirs[i], target)) {
-            return &dw->watchdirs[i];
+// Rehashes into a table sized for the filenames, dropping tombstones
+static void resize_set(filename_set* files, size_t capacity) {
+    filename_set resized = {
+        .names      = calloc(capacity, sizeof(char*)),
+        .capacity   = capacity,
+        .count      = files->count,
+        .used       = files->count
+    };
+    assert_M(resized.names, "Calloc failed: %s", strerror(errno));
+
+    for(size_t i = 0; i < files->capacity; ++i) {
+        if(files->names[i] && files->names[i] != TOMBSTONE_NAME) {
+            bool found = false;
+            resized.names[find_name_slot(&resized, files->names[i], &found)] = files->names[i];
         }
     }
-    return NULL;
+    free(files->names);
+    *files = resized;
 }
 
 
 /**
- *  DESCRIPTION:    Finds the integer index to the first watchdir that matches the filter
+ *  DESCRIPTION:    Adds a file to the set
  * 
  *  ARGUMENTS:
- *      dw:             Allocated dirwatch handle
  * 
- *      target:         Value to compare against
+ *      files:      Filename set
  * 
- *      match:          Filter expression
+ *      name:       Filename to copy into the set
  * 
  *  RETURNS:
  * 
- *      int:            Index to the matched watch node or -1
+ *      bool:       False if the file was already in the set
  * 
  */
-static int get_watchdir_idx(dirwatch* dw, const void* target, filter match) {
-    debug_assert(dw && target);
-
-    for(size_t i = 0; i < DIRWATCH_MAX; ++i) {
-        if(match(&dw->watchdirs[i], target)) {
-            return i;
+static bool set_add(filename_set* files, const char* name) {
+    // Keep the load under a half, counting tombstones
+    if(2 * (files->used + 1) > files->capacity) {
+        size_t capacity = DIRWATCH_INITIAL_CAPACITY;
+        while(capacity < 4 * (files->count + 1)) {
+            capacity <<= 1;
         }
+        resize_set(files, capacity);
     }
-    return -1;
+
+    bool found = false;
+    size_t slot = find_name_slot(files, name, &found);
+    if(found) {
+        return false;
+    }
+    files->used += (files->names[slot] == NULL);
+    files->names[slot] = strdup(name);
+    ++files->count;
+    return true;
 }
 
+
 /**
- *  DESCRIPTION:        Filters by watch descriptor
+ *  DESCRIPTION:    Removes a file from the set
  * 
  *  ARGUMENTS:
  * 
- *      watch:          Watchdir to be tested
+ *      files:      Filename set
  * 
- *      val:            Target watch descriptor value
+ *      name:       Filename to remove
  * 
  *  RETURNS:
  * 
- *      bool:           True if the watch descriptors match
+ *      char*:      The removed filename, owned by the caller, or NULL if the
+ *                  file wasn't in the set
  * 
  */
-static bool find_by_wd(const watchdir* watch, const void* val) {
-    debug_assert(watch && val);
+static char* set_take(filename_set* files, const char* name) {
+    if(files->count == 0) {
+        return NULL;
+    }
+    bool found = false;
+    size_t slot = find_name_slot(files, name, &found);
+    if(!found) {
+        return NULL;
+    }
+    char* taken = files->names[slot];
+    files->names[slot] = TOMBSTONE_NAME;
+    --files->count;
+    return taken;
+}
+
 
-    int wd = *(const int*)val;
-    return watch->wd == wd;
+static void set_clear(filename_set* files) {
+    for(size_t i = 0; i < files->capacity; ++i) {
+        if(files->names[i] != TOMBSTONE_NAME) {
+            free(files->names[i]);
+        }
+    }
+    free(files->names);
+    memset(files, 0x00, sizeof(filename_set));
+}
+
+
+// Slot holding the watchdir for wd, or the first free slot on its probe sequence
+static size_t find_wd_slot(const dirwatch* dw, int wd, bool* found) {
+    size_t mask = dw->wd_capacity - 1;
+    size_t slot = hash_wd(wd) & mask;
+    size_t free_slot = dw->wd_capacity;
+
+    for(; dw->wd_slots[slot] != 0; slot = (slot + 1) & mask) {
+        if(dw->wd_slots[slot] == TOMBSTONE_SLOT) {
+            free_slot = (free_slot == dw->wd_capacity) ? slot : free_slot;
+        }
+        else if(dw->watchdirs[dw->wd_slots[slot] - 1].wd == wd) {
+            *found = true;
+            return slot;
+        }
+    }
+    *found = false;
+    return (free_slot == dw->wd_capacity) ? slot : free_slot;
 }
 
 
 /**
- *  DESCRIPTION:        Filters by directory name
+ *  DESCRIPTION:    Finds the watchdir of a watch descriptor
  * 
  *  ARGUMENTS:
+ *      dw:             Allocated dirwatch object
+ * 
+ *      wd:             Watch descriptor of an inotify event
  * 
- *      watch:          Watchdir to be tested
+ *  RETURNS:
+ * 
+ *      watchdir*:      Pointer to the watchdir or NULL
+ * 
+ */
+static watchdir* find_watchdir(dirwatch* dw, int wd) {
+    debug_assert(dw);
+
+    bool found = false;
+    size_t slot = find_wd_slot(dw, wd, &found);
+    return found ? &dw->watchdirs[dw->wd_slots[slot] - 1] : NULL;
+}
+
+
+// Indexes the watchdir at idx by its current watch descriptor
+static void index_watchdir(dirwatch* dw, int idx) {
+    if(2 * (dw->wd_used + 1) > dw->wd_capacity) {
+        size_t capacity = dw->wd_capacity;
+        while(capacity < 4 * dw->nwatchdirs) {
+            capacity <<= 1;
+        }
+
+        // Rebuild from the watchlist, which also drops the tombstones
+        free(dw->wd_slots);
+        dw->wd_slots    = calloc(capacity, sizeof(int));
+        dw->wd_capacity = capacity;
+        dw->wd_used     = 0;
+        assert_M(dw->wd_slots, "Calloc failed: %s", strerror(errno));
+
+        for(size_t i = 0; i < dw->nwatchdirs; ++i) {
+            if(dw->watchdirs[i].wd > 0 && (int) i != idx) {
+                bool found = false;
+                dw->wd_slots[find_wd_slot(dw, dw->watchdirs[i].wd, &found)] = i + 1;
+                ++dw->wd_used;
+            }
+        }
+    }
+
+    bool found = false;
+    size_t slot = find_wd_slot(dw, dw->watchdirs[idx].wd, &found);
+    if(!found) {
+        dw->wd_used += (dw->wd_slots[slot] == 0);
+        dw->wd_slots[slot] = idx + 1;
+    }
+}
+
+
+// Removes a watch descriptor from the index
+static void unindex_wd(dirwatch* dw, int wd) {
+    bool found = false;
+    size_t slot = find_wd_slot(dw, wd, &found);
+    if(found) {
+        dw->wd_slots[slot] = TOMBSTONE_SLOT;
+    }
+}
+
+
+/**
+ *  DESCRIPTION:    Finds the index of a watched directory by name. Only used
+ *                  when directories are added, events look up by wd.
+ * 
+ *  ARGUMENTS:
+ *      dw:             Allocated dirwatch handle
  * 
- *      val:            Target directory name
+ *      dirname:        Directory name
  * 
  *  RETURNS:
- *      bool:           True if the directory names match
+ * 
+ *      int:            Index to the matched watchdir or -1
  * 
  */
-static bool find_by_dirname(const watchdir* watch, const void* val) {
-    debug_assert(watch && val);
+static int find_dirname_idx(dirwatch* dw, const char* dirname) {
+    debug_assert(dw && dirname);
 
-    if(watch->dirname) {
-        return strcmp(watch->dirname, (const char*)val) == 0;
+    for(size_t i = 0; i < dw->nwatchdirs; ++i) {
+        if(dw->watchdirs[i].wd > 0 && strcmp(dw->watchdirs[i].dirname, dirname) == 0) {
+            return i;
+        }
     }
-    return false;
+    return -1;
 }
 
 
+// Index of an unused watchdir, growing the watchlist when it's full
+static int free_watchdir_idx(dirwatch* dw) {
+    for(size_t i = 0; i < dw->nwatchdirs; ++i) {
+        if(dw->watchdirs[i].wd == 0 && dw->watchdirs[i].dirname == NULL) {
+            return i;
+        }
+    }
+    size_t idx = dw->nwatchdirs;
+
+    dw->nwatchdirs *= 2;
+    dw->watchdirs = realloc(dw->watchdirs, dw->nwatchdirs * sizeof(watchdir));
+    assert_M(dw->watchdirs, "Realloc failed: %s", strerror(errno));
+    memset(&dw->watchdirs[idx], 0x00, (dw->nwatchdirs - idx) * sizeof(watchdir));
+
+    return idx;
+}
 /**
  *  DESCRIPTION:    Converts a dirwatch event bitmask to the correct inotify bitmask
  * 
@@ -170,9 +412,269 @@ static int get_inotify_mask(dirwatch_events_t events) {
     if(events & DW_CREATE_AND_CLOSE) {
         mask |= IN_CREATE | IN_CLOSE_WRITE;
     }
+    if(events & DW_MOVED_IN) {
+        mask |= IN_MOVED_TO;
+    }
+    // Forget files that go away before they're handled
+    if(mask) {
+        mask |= IN_MOVED_FROM | IN_DELETE;
+    }
     return mask;
 }
 
+
+// Appends an event to the queue, growing it when it's full
+static void push_event(dirwatch* dw, int wd, dirwatch_events_t event, const char* filename) {
+    if(dw->queue_count == dw->queue_capacity) {
+        size_t capacity = 2 * dw->queue_capacity;
+        queued_event* queue = calloc(capacity, sizeof(queued_event));
+        assert_M(queue, "Calloc failed: %s", strerror(errno));
+
+        for(size_t i = 0; i < dw->queue_count; ++i) {
+            queue[i] = dw->queue[(dw->queue_head + i) & (dw->queue_capacity - 1)];
+        }
+        free(dw->queue);
+        dw->queue           = queue;
+        dw->queue_capacity  = capacity;
+        dw->queue_head      = 0;
+    }
+    queued_event* entry = &dw->queue[(dw->queue_head + dw->queue_count) & (dw->queue_capacity - 1)];
+    entry->wd       = wd;
+    entry->event    = event;
+    entry->filename = strdup(filename);
+    ++dw->queue_count;
+}
+
+
+// Removes the oldest event from the queue, its filename is owned by the caller
+static queued_event pop_event(dirwatch* dw) {
+    debug_assert(dw->queue_count > 0);
+
+    queued_event entry = dw->queue[dw->queue_head];
+    dw->queue_head = (dw->queue_head + 1) & (dw->queue_capacity - 1);
+    --dw->queue_count;
+    return entry;
+}
+
+
+/**
+ *  DESCRIPTION:    Queues an event for a file unless one is already waiting
+ *                  on the handler
+ * 
+ *  ARGUMENTS:
+ *      dw:         Allocated dirwatch handle
+ * 
+ *      dir:        Directory the file is in
+ * 
+ *      event:      Event to report
+ * 
+ *      filename:   Name of the file
+ * 
+ */
+static void queue_file(dirwatch* dw, watchdir* dir, dirwatch_events_t event, const char* filename) {
+    if(set_add(&dir->queued, filename)) {
+        push_event(dw, dir->wd, event, filename);
+    }
+    else {
+        log_debug("Coalesced event for: %s", filename);
+    }
+}
+
+
+// Drops a file that was moved away or deleted before it was handled
+static void forget_file(watchdir* dir, const char* filename) {
+    free(set_take(&dir->pending, filename));
+    free(set_take(&dir->queued, filename));
+}
+
+
+/**
+ *  DESCRIPTION:    Checks if a file is open for writing by any process
+ * 
+ *  ARGUMENTS:
+ *      path:       Path to the file
+ * 
+ *  RETURNS:
+ * 
+ *      bool:       True if a read lease was refused because of a writer
+ * 
+ *  NOTES: Leases need ownership of the file or CAP_LEASE. Files we can't take
+ *  a lease on for any other reason are assumed to be complete.
+ * 
+ */
+static bool is_open_for_writing(const char* path) {
+    bool writing = false;
+
+    int fd = open(path, O_RDONLY | O_NONBLOCK);
+    if(fd >= 0) {
+        if(fcntl(fd, F_SETLEASE, F_RDLCK) == 0) {
+            fcntl(fd, F_SETLEASE, F_UNLCK);
+        }
+        else {
+            writing = (errno == EAGAIN);
+        }
+        close(fd);
+    }
+    return writing;
+}
+
+
+/**
+ *  DESCRIPTION:    Recovers the files whose events were lost when the inotify
+ *                  queue overflowed. Every file changed or moved in since 
+ *                  inotify was last read in full is queued, unless it's still
+ *                  open for writing in which case its close event is awaited.
+ * 
+ *  ARGUMENTS:
+ *      dw:             Allocated dirwatch handle
+ * 
+ *      dir:            Directory to rescan
+ * 
+ *      path_buffer:    Buffer of PATH_MAX bytes
+ * 
+ *  NOTES: The ctime is compared since a rename updates it but not the mtime.
+ *  Files closed just before the overflow may be reported a second time.
+ * 
+ */
+static void rescan_watchdir(dirwatch* dw, watchdir* dir, char* path_buffer) {
+    DIR* handle;
+    struct dirent* file;
+    struct stat info;
+
+    dirwatch_events_t event = (dir->events & DW_CREATE_AND_CLOSE) ? DW_CREATE_AND_CLOSE : DW_MOVED_IN;
+
+    if((handle = opendir(dir->dirname)) == NULL) {
+        log_error("Failed to rescan directory: %s - %s", dir->dirname, strerror(errno));
+        return;
+    }
+    while((file = readdir(handle))) {
+        if(fnmatch(dir->file_filter, file->d_name, 0) == 0) {
+            combine_path(path_buffer, PATH_MAX, dir->dirname, file->d_name);
+
+            if(stat(path_buffer, &info) == 0 && S_ISREG(info.st_mode) && info.st_ctime >= dw->drained_at - RESCAN_SLACK_S) {
+                if((dir->events & DW_CREATE_AND_CLOSE) && is_open_for_writing(path_buffer)) {
+                    set_add(&dir->pending, file->d_name);
+                }
+                else {
+                    free(set_take(&dir->pending, file->d_name));
+                    queue_file(dw, dir, event, file->d_name);
+                }
+            }
+        }
+    }
+    closedir(handle);
+}
+
+
+/**
+ *  DESCRIPTION:    Reads inotify until it's empty, tracks pending files and 
+ *                  queues the completed ones for the handler
+ * 
+ *  ARGUMENTS:
+ *      dw:             Allocated dirwatch handle
+ * 
+ *      path_buffer:    Buffer of PATH_MAX bytes
+ * 
+ */
+static void drain_events(dirwatch* dw, char* path_buffer) {
+    bool overflowed = false;
+    ssize_t nbytes = 0;
+
+    //https://man7.org/linux/man-pages/man7/inotify.7.html - See example section
+    uint8_t event_buffer[EVENT_BUFFSIZE] 
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    while((nbytes = read(dw->handle.fd, event_buffer, EVENT_BUFFSIZE)) > 0) {
+        ssize_t next = 0;
+        while(next < nbytes) { // Process all events
+            struct inotify_event* event = (struct inotify_event*) &event_buffer[next];
+            next += sizeof(struct inotify_event) + event->len;
+
+            if(event->mask & IN_Q_OVERFLOW) {
+                overflowed = true;
+                continue;
+            }
+
+            watchdir* dir = find_watchdir(dw, event->wd);
+            if(!dir || event->len == 0 || (event->mask & IN_ISDIR) || fnmatch(dir->file_filter, event->name, 0) != 0) {
+                continue;
+            }
+
+            // New file was created, watch for file close
+            if(event->mask & IN_CREATE) {
+                if(set_add(&dir->pending, event->name)) {
+                    log_debug("File created: %s", event->name);
+                }
+            }
+            // File was closed, check if we were watching it
+            if(event->mask & IN_CLOSE_WRITE) {
+                char* filename = set_take(&dir->pending, event->name);
+                if(filename) {
+                    log_debug("File closed: %s", filename);
+                    queue_file(dw, dir, DW_CREATE_AND_CLOSE, filename);
+                    free(filename);
+                }
+            }
+            // Complete file was renamed into place
+            if(event->mask & IN_MOVED_TO) {
+                log_debug("File moved in: %s", event->name);
+                free(set_take(&dir->pending, event->name));
+                queue_file(dw, dir, DW_MOVED_IN, event->name);
+            }
+            if(event->mask & (IN_MOVED_FROM | IN_DELETE)) {
+                log_debug("File removed: %s", event->name);
+                forget_file(dir, event->name);
+            }
+        }
+    }
+    if(nbytes < 0 && errno != EAGAIN && errno != EINTR) {
+        log_error("Failed to read events: %s", strerror(errno));
+    }
+
+    if(overflowed) {
+        log_warning("Inotify queue overflowed, rescanning watched directories");
+        for(size_t i = 0; i < dw->nwatchdirs; ++i) {
+            if(dw->watchdirs[i].wd > 0) {
+                rescan_watchdir(dw, &dw->watchdirs[i], path_buffer);
+            }
+        }
+    }
+    dw->drained_at = time(NULL);
+}
+
+
+/**
+ *  DESCRIPTION:    Passes the oldest queued event to the handler, stale events
+ *                  are dropped
+ * 
+ *  ARGUMENTS:
+ *      dw:         Allocated dirwatch handle
+ * 
+ *      handler:    Callback to process the event
+ * 
+ *      user:       User arguments to forward to the handler
+ * 
+ */
+static void handle_next_event(dirwatch* dw, dirwatch_event_handler handler, void* user) {
+    queued_event entry = pop_event(dw);
+
+    // The handler may add directories and move the watchlist, so the file
+    // is taken out of the set before it's called
+    watchdir* dir = find_watchdir(dw, entry.wd);
+    char* queued = dir ? set_take(&dir->queued, entry.filename) : NULL;
+    if(queued) {
+        dirwatch_event dw_event = {
+            .event      = entry.event,
+            .dirname    = dir->dirname,
+            .filename   = entry.filename
+        };
+        handler(&dw_event, user);
+
+        free(queued);
+    }
+    free(entry.filename);
+}
+
 //
 // See dirwatch.h for non-static function descriptions
 //
@@ -186,6 +688,16 @@ dirwatch* dirwatch_init() {
 
     dw->handle.events = POLLIN;
 
+    dw->nwatchdirs      = DIRWATCH_INITIAL_CAPACITY;
+    dw->watchdirs       = calloc(dw->nwatchdirs, sizeof(watchdir));
+    dw->wd_capacity     = DIRWATCH_INITIAL_CAPACITY;
+    dw->wd_slots        = calloc(dw->wd_capacity, sizeof(int));
+    dw->queue_capacity  = DIRWATCH_INITIAL_CAPACITY;
+    dw->queue           = calloc(dw->queue_capacity, sizeof(queued_event));
+    assert_M(dw->watchdirs && dw->wd_slots && dw->queue, "Calloc failed: %s", strerror(errno));
+
+    dw->drained_at = time(NULL);
+
     return dw;
 }
 
@@ -193,12 +705,18 @@ dirwatch* dirwatch_init() {
 void dirwatch_close(dirwatch* dw) {
     debug_assert(dw);
     if(dw) {
-        for(int i = 0; i < DIRWATCH_MAX; ++i) {
+        for(size_t i = 0; i < dw->nwatchdirs; ++i) {
             dirwatch_remove(dw, i);
         }
 
         close(dw->handle.fd);
 
+        while(dw->queue_count > 0) {
+            free(pop_event(dw).filename);
+        }
+        free(dw->queue);
+        free(dw->watchdirs);
+        free(dw->wd_slots);
         free(dw);
     }
 }
@@ -209,26 +727,39 @@ int dirwatch_add(dirwatch* dw, const char* dirname, const char* file_filter, dir
 
     int mask = get_inotify_mask(events) | (clobber ? 0 : IN_MASK_ADD);
 
+    int wd = inotify_add_watch(dw->handle.fd, dirname, mask);
+    if(wd < 0) {
+        log_error("Failed to watch `%s`: %s", dirname, strerror(errno));
+        return -1;
+    }
+
     // Check if node already exists, update it if it does
-    int idx = get_watchdir_idx(dw, dirname, find_by_dirname);
+    int idx = find_dirname_idx(dw, dirname);
     if(idx >= 0) { 
-        dw->watchdirs[idx].wd = inotify_add_watch(dw->handle.fd, dirname, mask);
+        if(dw->watchdirs[idx].wd != wd) {
+            unindex_wd(dw, dw->watchdirs[idx].wd);
+            dw->watchdirs[idx].wd = wd;
+        }
 
         if(clobber) {
             free(dw->watchdirs[idx].file_filter); // Free old filter
             dw->watchdirs[idx].file_filter = strdup(file_filter);
+            dw->watchdirs[idx].events = events;
+        }
+        else {
+            dw->watchdirs[idx].events |= events;
         }
     }
     else 
     {
         // Add watch to empty node
-        idx = get_watchdir_idx(dw, &EMPTY_NODE, find_by_wd);
-        if(idx >= 0) {
-            dw->watchdirs[idx].wd = inotify_add_watch(dw->handle.fd, dirname, mask);
-            dw->watchdirs[idx].dirname = strdup(dirname);
-            dw->watchdirs[idx].file_filter = strdup(file_filter);
-        }
+        idx = free_watchdir_idx(dw);
+        dw->watchdirs[idx].wd = wd;
+        dw->watchdirs[idx].dirname = strdup(dirname);
+        dw->watchdirs[idx].file_filter = strdup(file_filter);
+        dw->watchdirs[idx].events = events;
     }
+    index_watchdir(dw, idx);
 
     return idx;
 }
@@ -238,20 +769,19 @@ int dirwatch_add(dirwatch* dw, const char* dirname, const char* file_filter, dir
 bool dirwatch_remove(dirwatch* dw, unsigned index) {
     debug_assert(dw);
 
-    if(dw && index < DIRWATCH_MAX) {
+    if(dw && index < dw->nwatchdirs) {
         if(dw->watchdirs[index].wd > 0) {
+            unindex_wd(dw, dw->watchdirs[index].wd);
+
             inotify_rm_watch(dw->handle.fd, dw->watchdirs[index].wd);
             free(dw->watchdirs[index].dirname);
             free(dw->watchdirs[index].file_filter);
 
-            // Free any associated watch files
-            for(size_t i = 0; i < DIRWATCH_MAX; ++i) {
-                if(dw->watchdirs[index].watchfiles[i]) {
-                    free(dw->watchdirs[index].watchfiles[i]);
-                }
-            }
+            // Free any associated watch files, their queued events go stale
+            set_clear(&dw->watchdirs[index].pending);
+            set_clear(&dw->watchdirs[index].queued);
 
-            dw->watchdirs[index].wd = 0;
+            memset(&dw->watchdirs[index], 0x00, sizeof(watchdir));
             return true;
         }
     }
@@ -262,82 +792,27 @@ bool dirwatch_remove(dirwatch* dw, unsigned index) {
 void dirwatch_listen(dirwatch* dw, int timeout_ms, dirwatch_event_handler handler, void* user) {
     debug_assert(dw && handler);
 
-    dirwatch_event dw_event;
     char* path_buffer = calloc(PATH_MAX, sizeof(char));
 
-    ssize_t next = 0;
-    ssize_t nbytes = 0;
-
-    //https://man7.org/linux/man-pages/man7/inotify.7.html - See example section
-    uint8_t event_buffer[EVENT_BUFFSIZE] 
-        __attribute__((aligned(__alignof__(struct inotify_event))));
-
     log_info("Dirwatch activated");
     dw->listen = true;
     while(dw->listen) {
-        int status = poll(&dw->handle, 1, timeout_ms);
-        if(status == 0) {
-            log_info("Dirwatch timeout occured");
-            dw->listen = false;
+        // Only block when nothing is waiting on the handler
+        int status = poll(&dw->handle, 1, dw->queue_count > 0 ? 0 : timeout_ms);
+        if(status > 0) {
+            drain_events(dw, path_buffer);
         }
-        else if(status < 0) {
-            if(dw->listen) {
-                log_error("Error occured: %s", strerror(errno));
-            }
+        else if(status < 0 && dw->listen) {
+            log_error("Error occured: %s", strerror(errno));
         }
-        else {// Events have occured, read them into the buffer
-            nbytes = read(dw->handle.fd, event_buffer, EVENT_BUFFSIZE);
-
-            next = 0;
-            while(next < nbytes) { // Process all events
-                struct inotify_event* event = (struct inotify_event*) &event_buffer[next];
-
-                // New file was created, watch for file close
-                if((event->mask & IN_CREATE) && !(event->mask & IN_ISDIR)) {
-                    watchdir* dir = find_watchdir(dw, &event->wd, find_by_wd);
-
-                    // Cache the filename if it matches the filter
-                    if(dir && fnmatch(dir->file_filter, event->name, 0) == 0) {
-                        bool added = false;
-                        for(int i = 0; i < DIRWATCH_MAX && !added; ++i) { // Find an empty watchfile
-                            if(dir->watchfiles[i] == NULL){
-                                log_debug("File created: %s", event->name);
-                                dir->watchfiles[i] = strdup(event->name);
-                                added = true;
-                            }
-                        }
-                        if(!added) {
-                            log_warning("Failed to add newly created file `%s` to watchlist", event->name);
-                        }
-                    }
-                }
-                // File was closed, check if we were watching it
-                if (event->mask & IN_CLOSE_WRITE) {
-
-                    watchdir* dir = find_watchdir(dw, &event->wd, find_by_wd);
-
-                    if(dir) {
-                        bool found = false;
-                        for(int i = 0; i < DIRWATCH_MAX && !found; ++i) {
-                            // TODO: strcmp in linear search is sub-optimal at best
-                            if(dir->watchfiles[i] && (strcmp(event->name, dir->watchfiles[i]) == 0)) {
-                                log_debug("File closed: %s", event->name);
-
-                                dw_event.event    = DW_CREATE_AND_CLOSE;
-                                dw_event.dirname  = dir->dirname;
-                                dw_event.filename = dir->watchfiles[i];
-
-                                handler(&dw_event, user);
-
-                                free(dir->watchfiles[i]);
-                                dir->watchfiles[i] = NULL;
-                                found = true;
-                            }
-                        }
-                    }
-                }
-                next += sizeof(struct inotify_event) + event->len;
-            }
+
+        // One event per pass so inotify is drained between handler calls
+        if(dw->listen && dw->queue_count > 0) {
+            handle_next_event(dw, handler, user);
+        }
+        else if(status == 0) {
+            log_info("Dirwatch timeout occured");
+            dw->listen = false;
         }
     }
 
@@ -352,4 +827,3 @@ void dirwatch_stop(dirwatch* dw) {
         dw->listen = false;
     }
 }
-
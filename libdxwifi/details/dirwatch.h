@@ -6,7 +6,15 @@
  *  https://github.com/oresat/oresat-dxwifi-software
  * 
  *  NOTES: Currently only supports tracking a directory for new files but can
- *  easily be modified to listen for a number of other events
+ *  easily be modified to listen for a number of other events. Watched 
+ *  directories and files waiting to be closed are kept in hash tables that
+ *  grow as needed, so there's no limit on either.
+ *
+ *  Inotify is read until it's empty before each handler call and the finished
+ *  files are queued, so a slow handler doesn't let the kernel's event queue 
+ *  overflow. A file is queued once however often it's closed before it's 
+ *  handled. If the kernel's queue overflows anyway the watched directories are
+ *  rescanned for the files whose events were lost.
  * 
  */
 
@@ -17,12 +25,9 @@
 #include <sys/inotify.h>
 
 
-// Maximum number of directories to watch concurrently
-#define DIRWATCH_MAX 256 
-
-
 typedef enum {
-    DW_CREATE_AND_CLOSE = 0x00000001,
+    DW_CREATE_AND_CLOSE = 0x00000001,   /* File was created and written out */
+    DW_MOVED_IN         = 0x00000002,   /* File was renamed into the dir    */
 } dirwatch_events_t;
 
 
@@ -93,7 +98,8 @@ void dirwatch_close(dirwatch* dw);
  * 
  *  RETURNS:
  *      
- *      int:            Index reference to watched directory
+ *      int:            Index reference to watched directory or -1 if the 
+ *                      directory couldn't be watched
  * 
  */
 int dirwatch_add(dirwatch* dw, const char* dirname, const char* file_filter, dirwatch_events_t events, bool clobber);
@@ -144,8 +150,8 @@ void dirwatch_listen(dirwatch* dw, int timeout_ms, dirwatch_event_handler handle
  *  ARGUMENTS:
  *      dw:         Allocated dirwatch handle, see dirwatch_init()
  * 
- *  NOTES: There are no guarantees that no more events will be process. At most, 
- *  one more buffer of events may be processed.
+ *  NOTES: At most, the event being handled when this is called completes. 
+ *  Events still queued are kept for the next call to dirwatch_listen().
  * 
  */
 void dirwatch_stop(dirwatch* dw);
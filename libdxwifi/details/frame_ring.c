@@ -0,0 +1,107 @@
+/**
+ *  frame_ring.c
+ * 
+ *  DESCRIPTION: See frame_ring.h for details
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ */
+
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/frame_ring.h>
+
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while(p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+
+void init_frame_ring(frame_ring* ring, size_t capacity, size_t slot_size) {
+    debug_assert(ring && capacity > 0 && slot_size > 0);
+
+    ring->capacity  = round_up_pow2(capacity);
+    ring->mask      = ring->capacity - 1;
+    ring->slot_size = slot_size;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->high_water, 0);
+
+    ring->slots = calloc(ring->capacity, slot_size);
+    assert_M(ring->slots, "Failed to allocate frame ring with capacity: %ld", ring->capacity);
+}
+
+
+void teardown_frame_ring(frame_ring* ring) {
+    debug_assert(ring);
+
+    free(ring->slots);
+    ring->slots     = NULL;
+    ring->capacity  = 0;
+    ring->mask      = 0;
+    ring->slot_size = 0;
+}
+
+
+uint8_t* frame_ring_reserve(frame_ring* ring) {
+    debug_assert(ring);
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if(head - tail >= ring->capacity) {
+        return NULL;
+    }
+    return offset(ring->slots, head & ring->mask, ring->slot_size);
+}
+
+
+void frame_ring_commit(frame_ring* ring) {
+    debug_assert(ring);
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+
+    // The consumer may reset the mark at any time so a plain store could lose it
+    size_t used = head - tail;
+    size_t mark = atomic_load_explicit(&ring->high_water, memory_order_relaxed);
+    while(used > mark && !atomic_compare_exchange_weak_explicit(
+                &ring->high_water, &mark, used, memory_order_relaxed, memory_order_relaxed)) {
+        ;
+    }
+}
+
+
+uint8_t* frame_ring_peek(frame_ring* ring) {
+    debug_assert(ring);
+
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if(head == tail) {
+        return NULL;
+    }
+    return offset(ring->slots, tail & ring->mask, ring->slot_size);
+}
+
+
+void frame_ring_release(frame_ring* ring) {
+    debug_assert(ring);
+
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+
+size_t frame_ring_reset_high_water(frame_ring* ring) {
+    debug_assert(ring);
+
+    return atomic_exchange_explicit(&ring->high_water, 0, memory_order_relaxed);
+}
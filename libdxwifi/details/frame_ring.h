@@ -0,0 +1,142 @@
+/**
+ *  frame_ring.h
+ * 
+ *  DESCRIPTION: Lock-free single-producer/single-consumer ring of fixed size
+ *  slots. All slots are allocated up front so that neither side allocates or
+ *  blocks while moving frames between threads.
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ *  NOTES: Exactly one thread may call the producer functions (reserve/commit)
+ *  and exactly one thread may call the consumer functions (peek/release).
+ * 
+ */
+
+
+#ifndef LIBDXWIFI_FRAME_RING_H
+#define LIBDXWIFI_FRAME_RING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+
+#define FRAME_RING_CACHELINE 64
+
+
+typedef struct {
+    uint8_t*        slots;          /* Contiguous slot storage                  */
+    size_t          slot_size;      /* Size of each slot in bytes               */
+    size_t          capacity;       /* Number of slots, always a power of two   */
+    size_t          mask;           /* capacity - 1                             */
+
+    _Alignas(FRAME_RING_CACHELINE)
+    atomic_size_t   head;           /* Next slot to write, owned by producer    */
+    atomic_size_t   high_water;     /* Max occupancy seen since last reset      */
+
+    _Alignas(FRAME_RING_CACHELINE)
+    atomic_size_t   tail;           /* Next slot to read, owned by consumer     */
+} frame_ring;
+
+
+/**
+ *  DESCRIPTION:    Initializes the ring and allocates all of its slots
+ * 
+ *  ARGUMENTS:
+ * 
+ *      ring:       pointer to the ring to be initialized
+ * 
+ *      capacity:   Desired number of slots, rounded up to a power of two
+ * 
+ *      slot_size:  Size of each slot in bytes
+ * 
+ */
+void init_frame_ring(frame_ring* ring, size_t capacity, size_t slot_size);
+
+
+/**
+ *  DESCRIPTION:    Tearsdown any resources associated with the ring
+ * 
+ *  ARGUMENTS:
+ * 
+ *      ring:       pointer to the ring to be torndown
+ * 
+ */
+void teardown_frame_ring(frame_ring* ring);
+
+
+/**
+ *  DESCRIPTION:    Producer side, get the next free slot
+ * 
+ *  ARGUMENTS:
+ * 
+ *      ring:       pointer to an initialized ring
+ * 
+ *  RETURNS:
+ * 
+ *      uint8_t*:   pointer to a slot of slot_size bytes or NULL if the ring is
+ *                  full. The slot is not visible to the consumer until
+ *                  frame_ring_commit() is called.
+ * 
+ */
+uint8_t* frame_ring_reserve(frame_ring* ring);
+
+
+/**
+ *  DESCRIPTION:    Producer side, publish the slot returned by the last call to
+ *                  frame_ring_reserve()
+ * 
+ *  ARGUMENTS:
+ * 
+ *      ring:       pointer to an initialized ring
+ * 
+ */
+void frame_ring_commit(frame_ring* ring);
+
+
+/**
+ *  DESCRIPTION:    Consumer side, get the oldest published slot
+ * 
+ *  ARGUMENTS:
+ * 
+ *      ring:       pointer to an initialized ring
+ * 
+ *  RETURNS:
+ * 
+ *      uint8_t*:   pointer to the slot or NULL if the ring is empty. The slot
+ *                  remains valid until frame_ring_release() is called.
+ * 
+ */
+uint8_t* frame_ring_peek(frame_ring* ring);
+
+
+/**
+ *  DESCRIPTION:    Consumer side, hand the slot returned by the last call to
+ *                  frame_ring_peek() back to the producer
+ * 
+ *  ARGUMENTS:
+ * 
+ *      ring:       pointer to an initialized ring
+ * 
+ */
+void frame_ring_release(frame_ring* ring);
+
+
+/**
+ *  DESCRIPTION:    Reads and resets the ring occupancy high-water mark. May be
+ *                  called from either side.
+ * 
+ *  ARGUMENTS:
+ * 
+ *      ring:       pointer to an initialized ring
+ * 
+ *  RETURNS:
+ * 
+ *      size_t:     Max number of occupied slots since the last reset
+ * 
+ */
+size_t frame_ring_reset_high_water(frame_ring* ring);
+
+
+#endif // LIBDXWIFI_FRAME_RING_H
@@ -16,28 +16,40 @@
 #include <libdxwifi/details/logging.h>
 
 
-typedef struct {
-    dxwifi_logger       logger;
-    dxwifi_log_level_t  log_level;
-} dxwifi_log_handler;
-
-
-static dxwifi_log_handler handlers[] = {
-    [DXWIFI_LOG_GENERIC]        = { default_logger, DXWIFI_LOG_FATAL },
-    [DXWIFI_LOG_TRANSMITTER]    = { default_logger, DXWIFI_LOG_FATAL },
-    [DXWIFI_LOG_TX]             = { default_logger, DXWIFI_LOG_FATAL },
-    [DXWIFI_LOG_RECEIVER]       = { default_logger, DXWIFI_LOG_FATAL },
-    [DXWIFI_LOG_RX]             = { default_logger, DXWIFI_LOG_FATAL },
-    [DXWIFI_LOG_DIRWATCH]       = { default_logger, DXWIFI_LOG_FATAL },
-    [DXWIFI_LOG_DAEMON]         = { default_logger, DXWIFI_LOG_FATAL },
-    [DXWIFI_LOG_FEC]            = { default_logger, DXWIFI_LOG_FATAL },
-    [DXWIFI_LOG_ENCODE]         = { default_logger, DXWIFI_LOG_FATAL },
-    [DXWIFI_LOG_DECODE]         = { default_logger, DXWIFI_LOG_FATAL },
+static dxwifi_logger loggers[] = {
+    [DXWIFI_LOG_GENERIC]        = default_logger,
+    [DXWIFI_LOG_TRANSMITTER]    = default_logger,
+    [DXWIFI_LOG_TX]             = default_logger,
+    [DXWIFI_LOG_RECEIVER]       = default_logger,
+    [DXWIFI_LOG_RX]             = default_logger,
+    [DXWIFI_LOG_DIRWATCH]       = default_logger,
+    [DXWIFI_LOG_DAEMON]         = default_logger,
+    [DXWIFI_LOG_FEC]            = default_logger,
+    [DXWIFI_LOG_ENCODE]         = default_logger,
+    [DXWIFI_LOG_DECODE]         = default_logger,
 
     // New modules should follow the same format
 
 };
-compiler_assert(NELEMS(handlers) == DXWIFI_LOG_MODULE_COUNT, "Handler count must match module count");
+compiler_assert(NELEMS(loggers) == DXWIFI_LOG_MODULE_COUNT, "Logger count must match module count");
+
+
+dxwifi_log_level_t __dxwifi_log_levels[] = {
+    [DXWIFI_LOG_GENERIC]        = DXWIFI_LOG_FATAL,
+    [DXWIFI_LOG_TRANSMITTER]    = DXWIFI_LOG_FATAL,
+    [DXWIFI_LOG_TX]             = DXWIFI_LOG_FATAL,
+    [DXWIFI_LOG_RECEIVER]       = DXWIFI_LOG_FATAL,
+    [DXWIFI_LOG_RX]             = DXWIFI_LOG_FATAL,
+    [DXWIFI_LOG_DIRWATCH]       = DXWIFI_LOG_FATAL,
+    [DXWIFI_LOG_DAEMON]         = DXWIFI_LOG_FATAL,
+    [DXWIFI_LOG_FEC]            = DXWIFI_LOG_FATAL,
+    [DXWIFI_LOG_ENCODE]         = DXWIFI_LOG_FATAL,
+    [DXWIFI_LOG_DECODE]         = DXWIFI_LOG_FATAL,
+
+    // New modules should follow the same format
+
+};
+compiler_assert(NELEMS(__dxwifi_log_levels) == DXWIFI_LOG_MODULE_COUNT, "Level count must match module count");
 
 
 // table entry must match the name of the file and index of the enumeration
@@ -49,8 +61,8 @@ static const char* file_lookup_tbl[DXWIFI_LOG_MODULE_COUNT] = {
     [DXWIFI_LOG_RX]             = "rx",
     [DXWIFI_LOG_DIRWATCH]       = "dirwatch",
     [DXWIFI_LOG_DAEMON]         = "daemon",
-    [DXWIFI_LOG_FEC]             = "fec",
-    [DXWIFI_LOG_ENCODE]       = "encode",
+    [DXWIFI_LOG_FEC]            = "fec",
+    [DXWIFI_LOG_ENCODE]         = "encode",
     [DXWIFI_LOG_DECODE]         = "decode",
 
     // Add new modules here
@@ -120,12 +132,12 @@ bool set_logger(dxwifi_log_module_t module, dxwifi_logger logger) {
     bool success = false;
     if(module == DXWIFI_LOG_ALL_MODULES) {
         for(size_t i = 0; i < DXWIFI_LOG_MODULE_COUNT; ++i) {
-            handlers[i].logger = logger;
+            loggers[i] = logger;
         }
         success = true;
     }
     else if(module < DXWIFI_LOG_MODULE_COUNT) {
-        handlers[module].logger = logger;
+        loggers[module] = logger;
         success = true;
     }
     return success;
@@ -136,62 +148,59 @@ bool set_log_level(dxwifi_log_module_t module, dxwifi_log_level_t level) {
     bool success = false;
     if(module == DXWIFI_LOG_ALL_MODULES) {
         for(size_t i = 0; i < DXWIFI_LOG_MODULE_COUNT; ++i) {
-            handlers[i].log_level = level;
+            __dxwifi_log_levels[i] = level;
         }
         success = true;
     }
     else if(module < DXWIFI_LOG_MODULE_COUNT) {
-        handlers[module].log_level = level;
+        __dxwifi_log_levels[module] = level;
         success = true;
     }
     return success;
 }
 
 
-void __dxwifi_log(dxwifi_log_level_t log_level, const char* file, const char* fmt, ...) {
+void __dxwifi_log(dxwifi_log_module_t module, dxwifi_log_level_t log_level, const char* fmt, ...) {
 
-    dxwifi_log_module_t module  = file_to_log_module(file);
-    dxwifi_log_handler  handler = handlers[module];
+    dxwifi_logger logger = loggers[module];
 
-    if( handler.logger && log_level <= handler.log_level) {
+    if( logger && log_level <= __dxwifi_log_levels[module]) {
         va_list args;
         va_start(args, fmt);
-        handler.logger(module, log_level, fmt, args);
+        logger(module, log_level, fmt, args);
         va_end(args);
     }
 }
 
 
-void __dxwifi_log_hexdump(const char* file, const uint8_t* data, int size) {
+void __dxwifi_log_hexdump(dxwifi_log_module_t module, const uint8_t* data, int size) {
+
+    static const char hex[] = "0123456789abcdef";
 
     int i           = 0;
-    int nbytes      = 0;
     int location    = 0;
     int num_rows    = (size / 16) + 1;
 
     // 8 for line header, 3 chars per byte of data, 16 bytes of data per row, and a newline
     int bytes_per_row = 57;
 
-    char temp[16];
     // Two more bytes for newline and null-terminator
     char formatted_str[(num_rows * bytes_per_row) + 2];
 
     formatted_str[location++] = '\n';
 
     while (i < size) {
-        nbytes = snprintf(temp, 16, "%08x", i);
-
-        memcpy(formatted_str + location, temp, nbytes);
-        location += nbytes;
-
+        for(int shift = 28; shift >= 0; shift -= 4) {
+            formatted_str[location++] = hex[(i >> shift) & 0xf];
+        }
         for(int j = 0; j < 16 && i < size; ++i, ++j) {
-            nbytes = snprintf(temp, 16, " %02x", *(data + i));
-            memcpy(formatted_str + location, temp, nbytes);
-            location += nbytes;
+            formatted_str[location++] = ' ';
+            formatted_str[location++] = hex[data[i] >> 4];
+            formatted_str[location++] = hex[data[i] & 0xf];
         }
         formatted_str[location++] = '\n';
     }
     formatted_str[location] = '\0';
 
-    __dxwifi_log(DXWIFI_LOG_TRACE, file, "%s", formatted_str);
+    __dxwifi_log(module, DXWIFI_LOG_TRACE, "%s", formatted_str);
 }
@@ -10,6 +10,10 @@
  *  different logging library simply create a function that fulfills the 
  *  dxwifi_logger interface and call the set_logger method
  * 
+ *  A source file picks its module by defining DXWIFI_LOG_MODULE before any 
+ *  include. Log statements check the module's level inline, so a filtered 
+ *  statement never evaluates its arguments or formats anything
+ * 
  *  https://github.com/oresat/oresat-dxwifi-software
  * 
  */
@@ -33,8 +37,9 @@ typedef enum {
     DXWIFI_LOG_TRACE    = 6
 } dxwifi_log_level_t;
 
-// If you want module specific logging add it here and update the file_lookup_tbl
-// Otherwise log statements  will get grouped into the generic sink. 
+// If you want module specific logging add it here, update the file_lookup_tbl 
+// and define DXWIFI_LOG_MODULE at the top of the source file. Otherwise log 
+// statements will get grouped into the generic sink. 
 typedef enum {
     DXWIFI_LOG_GENERIC      = 0,
     DXWIFI_LOG_TRANSMITTER  = 1,
@@ -154,7 +159,15 @@ bool set_logger(dxwifi_log_module_t module, dxwifi_logger logger);
 bool set_log_level(dxwifi_log_module_t module, dxwifi_log_level_t level);
 
 
-#if defined(LIBDXWIFI_DISABLE_LOGGING)
+// Module the log statements of this translation unit belong to
+#ifndef DXWIFI_LOG_MODULE
+    #define DXWIFI_LOG_MODULE DXWIFI_LOG_GENERIC
+#endif
+
+
+// Compiler log level, a translation unit may define its own before any include
+#if defined(DXWIFI_LOG_LEVEL)
+#elif defined(LIBDXWIFI_DISABLE_LOGGING)
     #define DXWIFI_LOG_LEVEL 0
 #elif defined(NDEBUG)
     #define DXWIFI_LOG_LEVEL 4
@@ -163,34 +176,57 @@ bool set_log_level(dxwifi_log_module_t module, dxwifi_log_level_t level);
 #endif
 
 
+// User log level of each module, only written through set_log_level
+extern dxwifi_log_level_t __dxwifi_log_levels[DXWIFI_LOG_MODULE_COUNT];
+
+
+static inline bool __dxwifi_log_enabled(dxwifi_log_module_t module, dxwifi_log_level_t log_level) {
+    return __builtin_expect(log_level <= __dxwifi_log_levels[module], 0);
+}
+
+
+// True if a statement at this level would be logged. Guards work that's only
+// done to build a log message
+#define log_enabled(log_level) \
+    (DXWIFI_LOG_LEVEL >= (log_level) && __dxwifi_log_enabled(DXWIFI_LOG_MODULE, log_level))
+
+
+#define __DXWIFI_LOG(log_level, fmt, ...)                                       \
+    do {                                                                        \
+        if(__dxwifi_log_enabled(DXWIFI_LOG_MODULE, log_level)) {                \
+            __dxwifi_log(DXWIFI_LOG_MODULE, log_level, fmt, ##__VA_ARGS__);     \
+        }                                                                       \
+    } while(0)
+
+
 #if DXWIFI_LOG_LEVEL < 1
   #define log_fatal(fmt, ...) __DXWIFI_UTILS_UNUSED(fmt, ##__VA_ARGS__)
 #else
-  #define log_fatal(fmt, ...) __dxwifi_log(DXWIFI_LOG_FATAL, __FILE__, fmt, ##__VA_ARGS__)
+  #define log_fatal(fmt, ...) __DXWIFI_LOG(DXWIFI_LOG_FATAL, fmt, ##__VA_ARGS__)
 #endif
 
 #if DXWIFI_LOG_LEVEL < 2
   #define log_error(fmt, ...) __DXWIFI_UTILS_UNUSED(fmt, ##__VA_ARGS__)
 #else
-  #define log_error(fmt, ...) __dxwifi_log(DXWIFI_LOG_ERROR, __FILE__, fmt, ##__VA_ARGS__)
+  #define log_error(fmt, ...) __DXWIFI_LOG(DXWIFI_LOG_ERROR, fmt, ##__VA_ARGS__)
 #endif
 
 #if DXWIFI_LOG_LEVEL < 3
   #define log_warning(fmt, ...) __DXWIFI_UTILS_UNUSED(fmt, ##__VA_ARGS__)
 #else
-  #define log_warning(fmt, ...) __dxwifi_log(DXWIFI_LOG_WARN, __FILE__, fmt, ##__VA_ARGS__)
+  #define log_warning(fmt, ...) __DXWIFI_LOG(DXWIFI_LOG_WARN, fmt, ##__VA_ARGS__)
 #endif
 
 #if DXWIFI_LOG_LEVEL < 4
   #define log_info(fmt, ...) __DXWIFI_UTILS_UNUSED(fmt, ##__VA_ARGS__)
 #else
-  #define log_info(fmt, ...) __dxwifi_log(DXWIFI_LOG_INFO, __FILE__, fmt, ##__VA_ARGS__)
+  #define log_info(fmt, ...) __DXWIFI_LOG(DXWIFI_LOG_INFO, fmt, ##__VA_ARGS__)
 #endif
 
 #if DXWIFI_LOG_LEVEL < 5
   #define log_debug(fmt, ...) __DXWIFI_UTILS_UNUSED(fmt, ##__VA_ARGS__)
 #else
-  #define log_debug(fmt, ...) __dxwifi_log(DXWIFI_LOG_DEBUG, __FILE__, fmt, ##__VA_ARGS__)
+  #define log_debug(fmt, ...) __DXWIFI_LOG(DXWIFI_LOG_DEBUG, fmt, ##__VA_ARGS__)
 #endif
 
 // Hexdump is expensive, so it's only enabled for trace logging
@@ -198,13 +234,18 @@ bool set_log_level(dxwifi_log_module_t module, dxwifi_log_level_t level);
   #define log_trace(fmt, ...) __DXWIFI_UTILS_UNUSED(fmt, ##__VA_ARGS__)
   #define log_hexdump(data, size) __DXWIFI_UTILS_UNUSED(data, size)
 #else
-  #define log_trace(fmt, ...) __dxwifi_log(DXWIFI_LOG_TRACE, __FILE__, fmt, ##__VA_ARGS__)
-  #define log_hexdump(data, size) __dxwifi_log_hexdump(__FILE__, (uint8_t*)data, size);
+  #define log_trace(fmt, ...) __DXWIFI_LOG(DXWIFI_LOG_TRACE, fmt, ##__VA_ARGS__)
+  #define log_hexdump(data, size)                                               \
+    do {                                                                        \
+        if(__dxwifi_log_enabled(DXWIFI_LOG_MODULE, DXWIFI_LOG_TRACE)) {         \
+            __dxwifi_log_hexdump(DXWIFI_LOG_MODULE, (uint8_t*)data, size);      \
+        }                                                                       \
+    } while(0)
 #endif
 
 
-void __dxwifi_log(dxwifi_log_level_t log_level, const char* file, const char* fmt, ...);
-void __dxwifi_log_hexdump(const char* file, const uint8_t* data, int size);
+void __dxwifi_log(dxwifi_log_module_t module, dxwifi_log_level_t log_level, const char* fmt, ...);
+void __dxwifi_log_hexdump(dxwifi_log_module_t module, const uint8_t* data, int size);
 
 
 #endif // LIBDXWIFI_LOGGING_H
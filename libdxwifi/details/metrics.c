@@ -0,0 +1,314 @@
+/**
+ *  metrics.c
+ *
+ *  DESCRIPTION: See metrics.h for details
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+#define _GNU_SOURCE // accept4
+
+#include <poll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/metrics.h>
+
+
+// How long a scrape may block the server on a client that isn't reading
+#define METRICS_SEND_TIMEOUT_S 1
+
+#define COUNTER(metric_name, metric_help) { .name = metric_name, .help = metric_help, .gauge = false }
+#define GAUGE(metric_name, metric_help)   { .name = metric_name, .help = metric_help, .gauge = true }
+
+
+dxwifi_tx_metrics __dxwifi_tx_metrics = {
+    .data_frames    = COUNTER("dxwifi_tx_data_frames_total",    "Data frames injected"),
+    .control_frames = COUNTER("dxwifi_tx_control_frames_total", "Control frames injected"),
+    .bytes          = COUNTER("dxwifi_tx_bytes_total",          "Bytes injected"),
+    .inject_errors  = COUNTER("dxwifi_tx_inject_errors_total",  "Frames that failed to inject"),
+    .transmissions  = COUNTER("dxwifi_tx_transmissions_total",  "Transmissions completed"),
+    .active         = GAUGE("dxwifi_tx_active",                 "1 while a transmission is in progress"),
+    .inject_latency = {
+        .name       = "dxwifi_tx_inject_latency_seconds",
+        .help       = "Time spent injecting each frame",
+        .scale      = 1e-9,
+        .nbounds    = 12,
+        .bounds     = { 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 25000000, 100000000 }
+    }
+};
+
+
+dxwifi_rx_metrics __dxwifi_rx_metrics = {
+    .data_frames    = COUNTER("dxwifi_rx_data_frames_total",    "Data frames accepted"),
+    .control_frames = COUNTER("dxwifi_rx_control_frames_total", "Control frames accepted"),
+    .unknown_frames = COUNTER("dxwifi_rx_unknown_frames_total", "Frames from the sender with an unexpected size"),
+    .dropped_frames = COUNTER("dxwifi_rx_dropped_frames_total", "Frames dropped because they came from another sender"),
+    .bytes          = COUNTER("dxwifi_rx_bytes_total",          "Bytes captured in data frames"),
+    .written_bytes  = COUNTER("dxwifi_rx_written_bytes_total",  "Bytes written to the output"),
+    .crc_failures   = COUNTER("dxwifi_rx_crc_failures_total",   "Data frames whose CRC didn't match"),
+    .blocks_lost    = COUNTER("dxwifi_rx_blocks_lost_total",    "Blocks missing from ordered captures"),
+    .noise_bytes    = COUNTER("dxwifi_rx_noise_bytes_total",    "Bytes of noise written in place of lost blocks"),
+    .ring_full      = COUNTER("dxwifi_rx_ring_full_total",      "Times the capture thread waited on a full frame ring"),
+    .active         = GAUGE("dxwifi_rx_active",                 "1 while a capture is in progress"),
+    .last_signal    = GAUGE("dxwifi_rx_last_antenna_signal_dbm","Antenna signal of the last data frame"),
+    .antenna_signal = {
+        .name       = "dxwifi_rx_antenna_signal_dbm",
+        .help       = "Antenna signal of each data frame",
+        .scale      = 1.0,
+        .nbounds    = 14,
+        .bounds     = { -95, -90, -85, -80, -75, -70, -65, -60, -55, -50, -45, -40, -30, -20 }
+    },
+    .frame_latency  = {
+        .name       = "dxwifi_rx_frame_latency_seconds",
+        .help       = "Time from the capture timestamp of each data frame to processing it",
+        .scale      = 1e-9,
+        .nbounds    = 16,
+        .bounds     = { 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 500000000, 1000000000 }
+    }
+};
+
+
+typedef struct {
+    pthread_t               thread;         /* Runs serve_metrics()                 */
+    int                     listen_fd;      /* Bound Unix domain socket             */
+    int                     shutdown_fd;    /* Wakes the server thread on stop      */
+    dxwifi_metrics_group_t  groups;         /* Metric groups to serve               */
+    struct sockaddr_un      addr;           /* Path the socket is bound to          */
+    bool                    running;        /* Server thread started?               */
+} metrics_server;
+
+
+static metrics_server server = { .listen_fd = -1, .shutdown_fd = -1 };
+
+
+static void write_metric(FILE* stream, const dxwifi_metric* metric) {
+    fprintf(stream, "# HELP %s %s\n", metric->name, metric->help);
+    fprintf(stream, "# TYPE %s %s\n", metric->name, metric->gauge ? "gauge" : "counter");
+    fprintf(stream, "%s %lld\n", metric->name, (long long) atomic_load_explicit(&metric->value, memory_order_relaxed));
+}
+
+
+// Buckets are exported cumulatively and _count is their total so they agree
+static void write_histogram(FILE* stream, const dxwifi_histogram* hist) {
+    uint64_t count = 0;
+
+    fprintf(stream, "# HELP %s %s\n", hist->name, hist->help);
+    fprintf(stream, "# TYPE %s histogram\n", hist->name);
+    for(size_t i = 0; i < hist->nbounds; ++i) {
+        count += atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+        fprintf(stream, "%s_bucket{le=\"%g\"} %llu\n", hist->name, hist->bounds[i] * hist->scale, (unsigned long long) count);
+    }
+    count += atomic_load_explicit(&hist->buckets[hist->nbounds], memory_order_relaxed);
+    fprintf(stream, "%s_bucket{le=\"+Inf\"} %llu\n", hist->name, (unsigned long long) count);
+    fprintf(stream, "%s_sum %g\n", hist->name, atomic_load_explicit(&hist->sum, memory_order_relaxed) * hist->scale);
+    fprintf(stream, "%s_count %llu\n", hist->name, (unsigned long long) count);
+}
+
+
+// Writes one snapshot to a connected client
+static void serve_client(int client_fd) {
+    char* snapshot = NULL;
+    size_t size = 0;
+
+    FILE* stream = open_memstream(&snapshot, &size);
+    if(!stream) {
+        log_error("Failed to format metrics: %s", strerror(errno));
+        return;
+    }
+    write_metrics(stream, server.groups);
+    fclose(stream);
+
+    struct timeval timeout = { .tv_sec = METRICS_SEND_TIMEOUT_S, .tv_usec = 0 };
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    size_t sent = 0;
+    while(sent < size) {
+        ssize_t nbytes = send(client_fd, snapshot + sent, size - sent, MSG_NOSIGNAL);
+        if(nbytes < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            log_debug("Metrics client went away: %s", strerror(errno));
+            break;
+        }
+        sent += nbytes;
+    }
+    free(snapshot);
+}
+
+
+/**
+ *  DESCRIPTION:    Server thread entry point. Answers every connection with a
+ *                  snapshot of the metrics until the server is stopped.
+ *
+ *  ARGUMENTS:
+ *
+ *      args:       Unused
+ *
+ */
+static void* serve_metrics(void* args) {
+    __DXWIFI_UTILS_UNUSED(args);
+
+    struct pollfd requests[2] = {
+        { .fd = server.listen_fd,   .events = POLLIN, .revents = 0 },
+        { .fd = server.shutdown_fd, .events = POLLIN, .revents = 0 }
+    };
+
+    while(true) {
+        int status = poll(requests, NELEMS(requests), -1);
+
+        if(status < 0) {
+            if(errno != EINTR) {
+                log_error("Metrics server failed: %s", strerror(errno));
+                break;
+            }
+        }
+        else if(requests[1].revents & POLLIN) {
+            break;
+        }
+        else if(requests[0].revents & POLLIN) {
+            int client_fd = accept4(server.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if(client_fd >= 0) {
+                serve_client(client_fd);
+                close(client_fd);
+            }
+        }
+    }
+    return NULL;
+}
+
+
+//
+// See metrics.h for non-static function descriptions
+//
+
+void write_metrics(FILE* stream, dxwifi_metrics_group_t groups) {
+    debug_assert(stream);
+
+    if(groups & DXWIFI_METRICS_TX) {
+        dxwifi_tx_metrics* tx = &__dxwifi_tx_metrics;
+        const dxwifi_metric* metrics[] = {
+            &tx->data_frames, &tx->control_frames, &tx->bytes, &tx->inject_errors, &tx->transmissions, &tx->active
+        };
+        for(size_t i = 0; i < NELEMS(metrics); ++i) {
+            write_metric(stream, metrics[i]);
+        }
+        write_histogram(stream, &tx->inject_latency);
+    }
+    if(groups & DXWIFI_METRICS_RX) {
+        dxwifi_rx_metrics* rx = &__dxwifi_rx_metrics;
+        const dxwifi_metric* metrics[] = {
+            &rx->data_frames, &rx->control_frames, &rx->unknown_frames, &rx->dropped_frames, &rx->bytes, &rx->written_bytes,
+            &rx->crc_failures, &rx->blocks_lost, &rx->noise_bytes, &rx->ring_full, &rx->active, &rx->last_signal
+        };
+        for(size_t i = 0; i < NELEMS(metrics); ++i) {
+            write_metric(stream, metrics[i]);
+        }
+        write_histogram(stream, &rx->antenna_signal);
+        write_histogram(stream, &rx->frame_latency);
+    }
+}
+
+
+bool start_metrics_server(const char* socket_path, dxwifi_metrics_group_t groups) {
+    debug_assert(socket_path);
+
+    if(server.running) {
+        return false;
+    }
+    if(strlen(socket_path) >= sizeof(server.addr.sun_path)) {
+        log_error("Metrics socket path is too long: %s", socket_path);
+        return false;
+    }
+    memset(&server.addr, 0x00, sizeof(server.addr));
+    server.addr.sun_family = AF_UNIX;
+    strcpy(server.addr.sun_path, socket_path);
+    server.groups = groups;
+
+    // Replace the socket a previous run left behind, but never anything else
+    struct stat path_stat;
+    if(lstat(socket_path, &path_stat) == 0) {
+        if(!S_ISSOCK(path_stat.st_mode)) {
+            log_error("Metrics socket path exists and is not a socket: %s", socket_path);
+            return false;
+        }
+        if(unlink(socket_path) < 0) {
+            log_error("Failed to remove stale metrics socket %s: %s", socket_path, strerror(errno));
+            return false;
+        }
+    }
+    else if(errno != ENOENT) {
+        log_error("Failed to stat metrics socket path %s: %s", socket_path, strerror(errno));
+        return false;
+    }
+
+    server.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if(server.listen_fd < 0) {
+        log_error("Failed to create metrics socket: %s", strerror(errno));
+        return false;
+    }
+
+    if(bind(server.listen_fd, (struct sockaddr*) &server.addr, sizeof(server.addr)) < 0 || listen(server.listen_fd, SOMAXCONN) < 0) {
+        log_error("Failed to serve metrics on %s: %s", socket_path, strerror(errno));
+        close(server.listen_fd);
+        return false;
+    }
+
+    server.shutdown_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert_M(server.shutdown_fd >= 0, "Failed to create eventfd: %s", strerror(errno));
+
+    // Signals like SIGINT must be handled by the application threads, not ours
+    sigset_t all_signals, prev_mask;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &prev_mask);
+
+    int status = pthread_create(&server.thread, NULL, serve_metrics, NULL);
+
+    pthread_sigmask(SIG_SETMASK, &prev_mask, NULL);
+
+    if(status != 0) {
+        log_error("Failed to start metrics server: %s", strerror(status));
+        close(server.shutdown_fd);
+        close(server.listen_fd);
+        unlink(socket_path);
+        return false;
+    }
+    server.running = true;
+
+    log_info("Serving metrics on %s", socket_path);
+    return true;
+}
+
+
+void stop_metrics_server() {
+    if(!server.running) {
+        return;
+    }
+    uint64_t signal = 1;
+    if(write(server.shutdown_fd, &signal, sizeof(signal)) < 0) {
+        log_warning("Failed to signal metrics server: %s", strerror(errno));
+    }
+    pthread_join(server.thread, NULL);
+
+    close(server.shutdown_fd);
+    close(server.listen_fd);
+    unlink(server.addr.sun_path);
+
+    server.running = false;
+}
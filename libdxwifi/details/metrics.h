@@ -0,0 +1,165 @@
+/**
+ *  metrics.h
+ *
+ *  DESCRIPTION: Live counters, gauges and histograms for the transmitter and
+ *  receiver. A background thread serves them in the Prometheus text format
+ *  over a Unix domain socket, every connection gets one snapshot:
+ *
+ *      socat - UNIX-CONNECT:/run/dxwifi/rx.sock
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: Updates are relaxed atomic adds and stores so the per-frame paths
+ *  never take a lock. Frame rates and throughput are left to the scraper to
+ *  derive from the counters, e.g. rate(dxwifi_rx_bytes_total[10s]).
+ *
+ */
+
+#ifndef LIBDXWIFI_METRICS_H
+#define LIBDXWIFI_METRICS_H
+
+#include <time.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+
+#define DXWIFI_METRICS_BOUNDS_MAX 16
+
+
+typedef enum {
+    DXWIFI_METRICS_TX   = 0x01,
+    DXWIFI_METRICS_RX   = 0x02,
+} dxwifi_metrics_group_t;
+
+
+typedef struct {
+    const char*             name;       /* Exported metric name                 */
+    const char*             help;       /* Exported description                 */
+    bool                    gauge;      /* Gauge or monotonic counter?          */
+    atomic_int_least64_t    value;      /* Current value                        */
+} dxwifi_metric;
+
+
+typedef struct {
+    const char*             name;       /* Exported metric name                 */
+    const char*             help;       /* Exported description                 */
+    double                  scale;      /* Exported units per recorded unit     */
+    size_t                  nbounds;    /* Number of bounds                     */
+    int64_t                 bounds[DXWIFI_METRICS_BOUNDS_MAX];
+                                        /* Inclusive upper bounds, ascending    */
+    atomic_uint_least64_t   buckets[DXWIFI_METRICS_BOUNDS_MAX + 1];
+                                        /* Per bucket counts, last one is +Inf  */
+    atomic_int_least64_t    sum;        /* Sum of the recorded values           */
+} dxwifi_histogram;
+
+
+typedef struct {
+    dxwifi_metric       data_frames;        /* Data frames injected             */
+    dxwifi_metric       control_frames;     /* Control frames injected          */
+    dxwifi_metric       bytes;              /* Bytes injected                   */
+    dxwifi_metric       inject_errors;      /* Failed injections                */
+    dxwifi_metric       transmissions;      /* Transmissions completed          */
+    dxwifi_metric       active;             /* Transmitting right now?          */
+    dxwifi_histogram    inject_latency;     /* Time spent in each injection, ns */
+} dxwifi_tx_metrics;
+
+
+typedef struct {
+    dxwifi_metric       data_frames;        /* Data frames accepted             */
+    dxwifi_metric       control_frames;     /* Control frames accepted          */
+    dxwifi_metric       unknown_frames;     /* Frames of an unknown size        */
+    dxwifi_metric       dropped_frames;     /* Frames from other senders        */
+    dxwifi_metric       bytes;              /* Bytes captured in data frames    */
+    dxwifi_metric       written_bytes;      /* Bytes written out                */
+    dxwifi_metric       crc_failures;       /* Data frames with a bad CRC       */
+    dxwifi_metric       blocks_lost;        /* Blocks found missing in order    */
+    dxwifi_metric       noise_bytes;        /* Bytes of noise written for gaps  */
+    dxwifi_metric       ring_full;          /* Times capture waited on the ring */
+    dxwifi_metric       active;             /* Capturing right now?             */
+    dxwifi_metric       last_signal;        /* Signal of the last data frame    */
+    dxwifi_histogram    antenna_signal;     /* Signal of each data frame, dBm   */
+    dxwifi_histogram    frame_latency;      /* Capture timestamp to processing
+                                               of each data frame, ns           */
+} dxwifi_rx_metrics;
+
+
+// Updated by the transmitter and receiver, see metrics.c
+extern dxwifi_tx_metrics __dxwifi_tx_metrics;
+extern dxwifi_rx_metrics __dxwifi_rx_metrics;
+
+
+// Monotonic timestamp for latency histograms
+static inline uint64_t metrics_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+static inline void metric_add(dxwifi_metric* metric, int64_t n) {
+    atomic_fetch_add_explicit(&metric->value, n, memory_order_relaxed);
+}
+
+
+static inline void metric_set(dxwifi_metric* metric, int64_t value) {
+    atomic_store_explicit(&metric->value, value, memory_order_relaxed);
+}
+
+
+static inline void histogram_observe(dxwifi_histogram* hist, int64_t value) {
+    size_t bucket = 0;
+    while(bucket < hist->nbounds && value > hist->bounds[bucket]) {
+        ++bucket;
+    }
+    atomic_fetch_add_explicit(&hist->buckets[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum, value, memory_order_relaxed);
+}
+
+
+/**
+ *  DESCRIPTION:    Writes the metrics in the Prometheus text exposition format
+ *
+ *  ARGUMENTS:
+ *
+ *      stream:     Where the metrics are written
+ *
+ *      groups:     Bitmask of the metric groups to write
+ *
+ */
+void write_metrics(FILE* stream, dxwifi_metrics_group_t groups);
+
+
+/**
+ *  DESCRIPTION:    Starts serving the metrics on a Unix domain socket
+ *
+ *  ARGUMENTS:
+ *
+ *      socket_path:    Path to bind the socket to, an existing socket there is
+ *                      replaced. Fails if anything other than a socket is
+ *                      there.
+ *
+ *      groups:         Bitmask of the metric groups to serve
+ *
+ *  RETURNS:
+ *
+ *      bool:           true if the server started
+ *
+ *  NOTES: Start the server after any fork, the background thread isn't
+ *  carried into the child.
+ *
+ */
+bool start_metrics_server(const char* socket_path, dxwifi_metrics_group_t groups);
+
+
+/**
+ *  DESCRIPTION:    Stops the metrics server and removes its socket. Does
+ *                  nothing if the server isn't running.
+ *
+ */
+void stop_metrics_server();
+
+
+#endif // LIBDXWIFI_METRICS_H
@@ -0,0 +1,86 @@
+/**
+ *  pcap_utils.c
+ *  
+ *  DESCRIPTION: See pcap_utils.h for details
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/pcap_utils.h>
+
+
+// Each frame in the kernel ring carries a tpacket header and link-layer address
+#define PCAP_KERNEL_FRAME_OVERHEAD 96
+
+
+static void set_tstamp_type(pcap_t* handle, const char* name) {
+    int type = pcap_tstamp_type_name_to_val(name);
+
+    if(type == PCAP_ERROR) {
+        log_warning("Unknown timestamp type: %s", name);
+    }
+    else {
+        int status = pcap_set_tstamp_type(handle, type);
+        if(status == PCAP_WARNING_TSTAMP_TYPE_NOTSUP) {
+            log_warning("Timestamp type %s is not supported by this device", name);
+        }
+        else if(status != 0) {
+            log_warning("Failed to set timestamp type %s: %s", name, pcap_statustostr(status));
+        }
+    }
+}
+
+
+pcap_t* open_live_handle(const char* device, const dxwifi_pcap_settings* settings, char* err_buff) {
+    debug_assert(settings && err_buff);
+
+    int status = 0;
+
+    pcap_t* handle = pcap_create(device, err_buff);
+    if(!handle) {
+        return NULL;
+    }
+
+    // These only fail if the handle is already activated
+    pcap_set_snaplen(handle, settings->snaplen);
+    pcap_set_promisc(handle, true);
+    pcap_set_timeout(handle, settings->pb_timeout);
+    pcap_set_immediate_mode(handle, settings->immediate);
+
+    if(settings->buffer_size > 0) {
+        pcap_set_buffer_size(handle, settings->buffer_size);
+    }
+    if(settings->tstamp_type) {
+        set_tstamp_type(handle, settings->tstamp_type);
+    }
+
+    status = pcap_activate(handle);
+    if(status < 0) {
+        snprintf(err_buff, PCAP_ERRBUF_SIZE, "%s: %s", pcap_statustostr(status), pcap_geterr(handle));
+        pcap_close(handle);
+        handle = NULL;
+    }
+    else if(status > 0) {
+        log_warning("%s: %s", pcap_statustostr(status), pcap_geterr(handle));
+    }
+    return handle;
+}
+
+
+int pcap_buffer_size_for_rate(unsigned frame_rate, size_t frame_size, unsigned stall_ms) {
+    uint64_t nbytes = (uint64_t)frame_rate * (frame_size + PCAP_KERNEL_FRAME_OVERHEAD) * stall_ms / 1000;
+
+    if(nbytes < DXWIFI_PCAP_BUFFER_SIZE_MIN) {
+        nbytes = DXWIFI_PCAP_BUFFER_SIZE_MIN;
+    }
+    else if(nbytes > DXWIFI_PCAP_BUFFER_SIZE_MAX) {
+        nbytes = DXWIFI_PCAP_BUFFER_SIZE_MAX;
+    }
+    return (int)nbytes;
+}
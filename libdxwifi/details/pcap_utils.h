@@ -0,0 +1,84 @@
+/**
+ *  pcap_utils.h
+ *  
+ *  DESCRIPTION: Helpers for opening and tuning live pcap handles
+ * 
+ *  https://github.com/oresat/oresat-dxwifi-software
+ * 
+ *  NOTES: See https://www.tcpdump.org/manpages/pcap.3pcap.html for a 
+ *  description of each setting
+ * 
+ */
+
+
+#ifndef LIBDXWIFI_PCAP_UTILS_H
+#define LIBDXWIFI_PCAP_UTILS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <pcap.h>
+
+
+#define DXWIFI_PCAP_BUFFER_SIZE_MIN (1024 * 256)            // 256kb
+#define DXWIFI_PCAP_BUFFER_SIZE_MAX (1024 * 1024 * 128)     // 128mb
+
+
+/**
+ *  Settings applied to a pcap handle before it is activated. Zero or NULL 
+ *  fields leave the pcap default in place.
+ */
+typedef struct {
+    int         snaplen;            /* Snapshot length in bytes               */
+    int         pb_timeout;         /* Packet buffer timeout in ms            */
+    int         buffer_size;        /* Kernel capture buffer size in bytes    */
+    bool        immediate;          /* Deliver packets as soon as they arrive */
+    const char* tstamp_type;        /* Timestamp source e.g. "host", "adapter"*/
+} dxwifi_pcap_settings;
+
+
+/**
+ *  DESCRIPTION:    Creates, configures and activates a live capture handle
+ * 
+ *  ARGUMENTS: 
+ * 
+ *      device:     Name of the network device to open
+ * 
+ *      settings:   Settings to apply before the handle is activated
+ * 
+ *      err_buff:   Buffer of at least PCAP_ERRBUF_SIZE bytes, filled in with 
+ *                  the reason on failure
+ * 
+ *  RETURNS:
+ *      
+ *      pcap_t*:    Activated handle or NULL on failure
+ * 
+ *  NOTES: Settings that are unsupported by the device are logged as warnings
+ *  and otherwise ignored
+ * 
+ */
+pcap_t* open_live_handle(const char* device, const dxwifi_pcap_settings* settings, char* err_buff);
+
+
+/**
+ *  DESCRIPTION:    Computes a kernel buffer size large enough to absorb a burst
+ *                  of traffic while the capture is stalled
+ * 
+ *  ARGUMENTS: 
+ * 
+ *      frame_rate: Expected number of frames per second
+ * 
+ *      frame_size: Size of each captured frame in bytes
+ * 
+ *      stall_ms:   Length of the stall to absorb in milliseconds
+ * 
+ *  RETURNS:
+ *      
+ *      int:        Buffer size in bytes clamped to DXWIFI_PCAP_BUFFER_SIZE_MIN
+ *                  and DXWIFI_PCAP_BUFFER_SIZE_MAX
+ * 
+ */
+int pcap_buffer_size_for_rate(unsigned frame_rate, size_t frame_size, unsigned stall_ms);
+
+
+#endif // LIBDXWIFI_PCAP_UTILS_H
@@ -0,0 +1,81 @@
+/**
+ *  probes.h
+ *
+ *  DESCRIPTION: Statically defined tracepoints (USDT probes) on the transmit,
+ *  receive and FEC hot paths under the `dxwifi` provider. They let per-frame
+ *  events be lined up against kernel scheduling and NIC activity in the field
+ *  without a TRACE logging build:
+ *
+ *      sudo bpftrace -e 'usdt:/usr/bin/rx:dxwifi:frame_accept { @signal = lhist(arg4, -100, 0, 5); }'
+ *      sudo perf probe -x /usr/bin/tx sdt_dxwifi:inject_return
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: An unattached probe is a single nop, its arguments are only read
+ *  from registers or the stack once a tracer attaches. Probes are compiled out
+ *  when <sys/sdt.h> (systemtap-sdt-dev) isn't installed or when building with
+ *  LIBDXWIFI_DISABLE_PROBES.
+ *
+ *  Probe                   Arguments
+ *
+ *  inject_entry            frame number, dxwifi_control_frame_t, frame size
+ *  inject_return           frame number, dxwifi_control_frame_t, pcap status,
+ *                          latency in ns
+ *  control_frame           dxwifi_control_frame_t, copies sent
+ *  frame_accept            frame number, payload size, capture size, CRC valid,
+ *                          antenna signal in dBm
+ *  frame_drop              dxwifi_probe_drop_t, capture size
+ *  frame_control           dxwifi_control_frame_t, capture size
+ *  buffer_flush_entry      frames buffered, bytes buffered
+ *  buffer_flush_return     blocks written, blocks lost
+ *  fec_encode_entry        message size, RS blocks per frame, interleave depth
+ *  fec_encode_return       encoded size or dxwifi_fec_error_t, n, k
+ *  fec_decode_entry        encoded size
+ *  fec_decode_return       decoded size or dxwifi_fec_error_t, n, k
+ *  fec_stage_entry         dxwifi_fec_stage_t
+ *  fec_stage_return        dxwifi_fec_stage_t
+ *
+ *  Frame numbers on the transmitter count data and control frames separately.
+ *
+ */
+
+#ifndef LIBDXWIFI_PROBES_H
+#define LIBDXWIFI_PROBES_H
+
+#include <libdxwifi/details/utils.h>
+
+
+#if !defined(LIBDXWIFI_DISABLE_PROBES) && defined(__has_include)
+    #if __has_include(<sys/sdt.h>)
+        #include <sys/sdt.h>
+        #define LIBDXWIFI_PROBES_ENABLED
+    #endif
+#endif
+
+
+/**
+ *  Why the receiver dropped a frame
+ */
+typedef enum {
+    DXWIFI_PROBE_DROP_SENDER        = 1,    /* Sent from another address        */
+    DXWIFI_PROBE_DROP_UNKNOWN       = 2,    /* Unexpected size for any frame    */
+    DXWIFI_PROBE_DROP_PAYLOAD_SIZE  = 3,    /* Not a whole number of RS blocks  */
+} dxwifi_probe_drop_t;
+
+
+#if defined(LIBDXWIFI_PROBES_ENABLED)
+    #define dxwifi_probe1(name, a)              DTRACE_PROBE1(dxwifi, name, a)
+    #define dxwifi_probe2(name, a, b)           DTRACE_PROBE2(dxwifi, name, a, b)
+    #define dxwifi_probe3(name, a, b, c)        DTRACE_PROBE3(dxwifi, name, a, b, c)
+    #define dxwifi_probe4(name, a, b, c, d)     DTRACE_PROBE4(dxwifi, name, a, b, c, d)
+    #define dxwifi_probe5(name, a, b, c, d, e)  DTRACE_PROBE5(dxwifi, name, a, b, c, d, e)
+#else
+    #define dxwifi_probe1(name, ...)            __DXWIFI_UTILS_UNUSED(__VA_ARGS__)
+    #define dxwifi_probe2(name, ...)            __DXWIFI_UTILS_UNUSED(__VA_ARGS__)
+    #define dxwifi_probe3(name, ...)            __DXWIFI_UTILS_UNUSED(__VA_ARGS__)
+    #define dxwifi_probe4(name, ...)            __DXWIFI_UTILS_UNUSED(__VA_ARGS__)
+    #define dxwifi_probe5(name, ...)            __DXWIFI_UTILS_UNUSED(__VA_ARGS__)
+#endif
+
+
+#endif // LIBDXWIFI_PROBES_H
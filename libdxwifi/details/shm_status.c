@@ -0,0 +1,302 @@
+/**
+ *  shm_status.c
+ *
+ *  DESCRIPTION: See shm_status.h for details
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include <libdxwifi/fec.h>
+#include <libdxwifi/details/utils.h>
+#include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/shm_status.h>
+
+
+typedef struct {
+    dxwifi_status*  segment;            /* Mapped segment, NULL if closed       */
+    char            name[NAME_MAX];     /* Name the segment was opened with     */
+    uint64_t        esi_seen[(UINT16_MAX + 1) / 64];
+                                        /* ESIs counted for the current object  */
+    bool            signal_seen[DXWIFI_STATUS_ANTENNAS_MAX];
+                                        /* Has min/max signal been set yet?     */
+} status_publisher;
+
+
+static status_publisher publisher = { .segment = NULL };
+
+
+// Makes the segment odd so readers back off until end_update()
+static void begin_update() {
+    uint32_t seq = atomic_load_explicit(&publisher.segment->seq, memory_order_relaxed);
+    atomic_store_explicit(&publisher.segment->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+
+static void end_update() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    publisher.segment->updated_ns = (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+
+    uint32_t seq = atomic_load_explicit(&publisher.segment->seq, memory_order_relaxed);
+    atomic_store_explicit(&publisher.segment->seq, seq + 1, memory_order_release);
+}
+
+
+// Must be called inside an update
+static void start_object() {
+    dxwifi_status_object* object = &publisher.segment->object;
+
+    object->objects     += 1;
+    object->n           = 0;
+    object->k           = 0;
+    object->esis        = 0;
+    object->source_esis = 0;
+    memset(publisher.esi_seen, 0x00, sizeof(publisher.esi_seen));
+}
+
+
+// Reads the OTI at the front of an RS-LDPC frame. The RS code is systematic so
+// the OTI sits in the clear at the start of the first block unless the frame
+// was interleaved. Anything implausible is ignored rather than trusted.
+static const dxwifi_oti* peek_oti(const uint8_t* payload, size_t size) {
+    const dxwifi_oti* oti = (const dxwifi_oti*) payload;
+
+    if(size < sizeof(dxwifi_oti)) {
+        return NULL;
+    }
+    if(oti->blocks < 1 || oti->blocks > DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX || size != DXWIFI_RS_LDPC_FRAME_SIZE_FOR(oti->blocks)) {
+        return NULL;
+    }
+    if(oti->depth != 1 || oti->codec >= DXWIFI_FEC_CODEC_COUNT) {
+        return NULL;
+    }
+    uint16_t n = ntohs(oti->n), k = ntohs(oti->k), esi = ntohs(oti->esi);
+    if(k == 0 || k > n || esi >= n) {
+        return NULL;
+    }
+    return oti;
+}
+
+
+// Must be called inside an update. Untrusted frames failed their CRC and may
+// only count toward the object already being tracked.
+static void track_object(const uint8_t* payload, size_t size, bool trusted) {
+    dxwifi_status_object* object = &publisher.segment->object;
+
+    const dxwifi_oti* oti = peek_oti(payload, size);
+    if(!oti) {
+        return;
+    }
+    uint16_t n = ntohs(oti->n), k = ntohs(oti->k), esi = ntohs(oti->esi);
+
+    // A different object started without a preamble in between
+    if(object->n && (object->n != n || object->k != k)) {
+        if(!trusted) {
+            return;
+        }
+        start_object();
+    }
+    object->n = n;
+    object->k = k;
+
+    uint64_t bit = 1ull << (esi % 64);
+    if(!(publisher.esi_seen[esi / 64] & bit)) {
+        publisher.esi_seen[esi / 64] |= bit;
+        object->esis        += 1;
+        object->source_esis += (esi < k);
+    }
+}
+
+
+//
+// See shm_status.h for non-static function descriptions
+//
+
+bool open_status_segment(const char* name, dxwifi_status_role_t role, const char* device) {
+    debug_assert(name);
+
+    if(publisher.segment) {
+        return false;
+    }
+    // shm_open() names are a single component with a leading slash
+    int len = snprintf(publisher.name, sizeof(publisher.name), "/%s", name[0] == '/' ? name + 1 : name);
+    if(len >= (int) sizeof(publisher.name) || strchr(publisher.name + 1, '/')) {
+        log_error("Invalid status segment name: %s", name);
+        return false;
+    }
+
+    int fd = shm_open(publisher.name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if(fd < 0) {
+        log_error("Failed to create status segment %s: %s", publisher.name, strerror(errno));
+        return false;
+    }
+    if(ftruncate(fd, sizeof(dxwifi_status)) < 0) {
+        log_error("Failed to size status segment %s: %s", publisher.name, strerror(errno));
+        close(fd);
+        shm_unlink(publisher.name);
+        return false;
+    }
+    void* segment = mmap(NULL, sizeof(dxwifi_status), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(segment == MAP_FAILED) {
+        log_error("Failed to map status segment %s: %s", publisher.name, strerror(errno));
+        shm_unlink(publisher.name);
+        return false;
+    }
+    publisher.segment = segment;
+    memset(publisher.esi_seen, 0x00, sizeof(publisher.esi_seen));
+    memset(publisher.signal_seen, 0x00, sizeof(publisher.signal_seen));
+
+    // Fresh from ftruncate() the segment is zeroed so seq is already even
+    begin_update();
+    publisher.segment->magic    = DXWIFI_STATUS_MAGIC;
+    publisher.segment->version  = DXWIFI_STATUS_VERSION;
+    publisher.segment->role     = role;
+    publisher.segment->size     = sizeof(dxwifi_status);
+    publisher.segment->pid      = getpid();
+    publisher.segment->state    = DXWIFI_STATUS_IDLE;
+    if(device) {
+        strncpy(publisher.segment->device, device, DXWIFI_STATUS_DEVICE_MAX - 1);
+    }
+    end_update();
+
+    log_info("Publishing status in /dev/shm%s", publisher.name);
+    return true;
+}
+
+
+void close_status_segment() {
+    if(!publisher.segment) {
+        return;
+    }
+    // Readers still holding a mapping can tell the publisher is gone
+    begin_update();
+    publisher.segment->state = DXWIFI_STATUS_IDLE;
+    publisher.segment->pid   = 0;
+    end_update();
+
+    munmap(publisher.segment, sizeof(dxwifi_status));
+    shm_unlink(publisher.name);
+    publisher.segment = NULL;
+}
+
+
+void status_set_state(dxwifi_status_state_t state) {
+    if(!publisher.segment) {
+        return;
+    }
+    begin_update();
+    if(state == DXWIFI_STATUS_CAPTURING || state == DXWIFI_STATUS_TRANSMITTING) {
+        start_object();
+    }
+    publisher.segment->state = state;
+    end_update();
+}
+
+
+void status_set_decoded(ssize_t result) {
+    if(!publisher.segment) {
+        return;
+    }
+    begin_update();
+    publisher.segment->state       = result > 0 ? DXWIFI_STATUS_DECODED : DXWIFI_STATUS_DECODE_FAILED;
+    publisher.segment->object.size = result;
+    end_update();
+}
+
+
+void status_control_frame(dxwifi_control_frame_t type) {
+    if(!publisher.segment) {
+        return;
+    }
+    begin_update();
+    publisher.segment->control_frames += 1;
+    if(type == DXWIFI_CONTROL_FRAME_PREAMBLE && publisher.segment->object.n) {
+        start_object();
+    }
+    end_update();
+}
+
+
+void status_tx_frame(const uint8_t* payload, size_t size, bool injected) {
+    if(!publisher.segment) {
+        return;
+    }
+    begin_update();
+    if(injected) {
+        publisher.segment->data_frames += 1;
+        publisher.segment->bytes       += size;
+        track_object(payload, size, true);
+    }
+    else {
+        publisher.segment->errors += 1;
+    }
+    end_update();
+}
+
+
+void status_rx_frame(const uint8_t* payload, size_t size, bool crc_valid, uint8_t antenna, int8_t signal, bool has_signal) {
+    if(!publisher.segment) {
+        return;
+    }
+    begin_update();
+    publisher.segment->data_frames += 1;
+    publisher.segment->bytes       += size;
+    publisher.segment->errors      += !crc_valid;
+
+    track_object(payload, size, crc_valid);
+
+    if(antenna < DXWIFI_STATUS_ANTENNAS_MAX) {
+        dxwifi_status_antenna* ant = &publisher.segment->antennas[antenna];
+
+        ant->frames       += 1;
+        ant->crc_failures += !crc_valid;
+        if(has_signal) {
+            if(!publisher.signal_seen[antenna]) {
+                publisher.signal_seen[antenna] = true;
+                ant->min_signal = signal;
+                ant->max_signal = signal;
+            }
+            ant->last_signal = signal;
+            ant->min_signal  = signal < ant->min_signal ? signal : ant->min_signal;
+            ant->max_signal  = signal > ant->max_signal ? signal : ant->max_signal;
+        }
+        if(antenna >= publisher.segment->nantennas) {
+            publisher.segment->nantennas = antenna + 1;
+        }
+    }
+    end_update();
+}
+
+
+void status_dropped_frame() {
+    if(!publisher.segment) {
+        return;
+    }
+    begin_update();
+    publisher.segment->dropped_frames += 1;
+    end_update();
+}
+
+
+void status_blocks_lost(uint32_t count) {
+    if(!publisher.segment) {
+        return;
+    }
+    begin_update();
+    publisher.segment->blocks_lost += count;
+    end_update();
+}
@@ -0,0 +1,257 @@
+/**
+ *  shm_status.h
+ *
+ *  DESCRIPTION: Live status of the transmitter or receiver published as a
+ *  fixed layout struct in POSIX shared memory (/dev/shm/<name>). Dashboards
+ *  and loggers map the segment read-only and poll it as often as they like
+ *  without a single syscall or any effect on the capture and inject loops.
+ *
+ *  https://github.com/oresat/oresat-dxwifi-software
+ *
+ *  NOTES: The segment has exactly one writer, the thread driving the
+ *  transmitter or receiver. Each update is bracketed by a sequence lock: `seq`
+ *  is odd while the struct is being written and is bumped again when it's
+ *  consistent. Readers copy the struct and retry if `seq` was odd or changed
+ *  during the copy, see status_snapshot().
+ *
+ *  The layout only ever grows at the end. Readers must check `magic`, accept
+ *  any `version` at least as new as the one they were built for and use `size`
+ *  rather than their own sizeof().
+ *
+ */
+
+#ifndef LIBDXWIFI_SHM_STATUS_H
+#define LIBDXWIFI_SHM_STATUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#include <libdxwifi/dxwifi.h>
+#include <libdxwifi/details/assert.h>
+
+
+#define DXWIFI_STATUS_MAGIC         0x54535844  /* "DXST" read little-endian */
+
+#define DXWIFI_STATUS_VERSION       1
+
+#define DXWIFI_STATUS_ANTENNAS_MAX  4
+
+#define DXWIFI_STATUS_DEVICE_MAX    16
+
+
+typedef enum {
+    DXWIFI_STATUS_TX    = 1,
+    DXWIFI_STATUS_RX    = 2,
+} dxwifi_status_role_t;
+
+
+typedef enum {
+    DXWIFI_STATUS_IDLE          = 0,    /* Waiting for work                 */
+    DXWIFI_STATUS_ENCODING      = 1,    /* Tx: FEC encoding a file          */
+    DXWIFI_STATUS_TRANSMITTING  = 2,    /* Tx: Injecting frames             */
+    DXWIFI_STATUS_CAPTURING     = 3,    /* Rx: Capturing frames             */
+    DXWIFI_STATUS_DECODING      = 4,    /* Rx: FEC decoding a capture       */
+    DXWIFI_STATUS_DECODED       = 5,    /* Rx: Last capture decoded         */
+    DXWIFI_STATUS_DECODE_FAILED = 6,    /* Rx: Last capture didn't decode   */
+} dxwifi_status_state_t;
+
+
+/**
+ *  Signal and frame counts for one antenna, as reported in the radiotap
+ *  header of received frames. Unused by the transmitter.
+ */
+typedef struct {
+    uint64_t    frames;             /* Data frames received                 */
+    uint64_t    crc_failures;       /* Data frames with a bad CRC           */
+    int8_t      last_signal;        /* Signal of the last frame, dBm        */
+    int8_t      min_signal;         /* Weakest signal seen, dBm             */
+    int8_t      max_signal;         /* Strongest signal seen, dBm           */
+    uint8_t     __reserved[5];
+} dxwifi_status_antenna;
+compiler_assert(sizeof(dxwifi_status_antenna) == 24, "Status antenna layout changed");
+
+
+/**
+ *  Progress on the FEC encoded object currently being sent or received, taken
+ *  from the OTI of frames as they go by. Interleaved objects don't carry a
+ *  readable OTI in every frame so only `objects` and `size` track them.
+ */
+typedef struct {
+    uint32_t    objects;            /* Objects started                      */
+    uint16_t    n;                  /* Encoding symbols in the object       */
+    uint16_t    k;                  /* Source symbols in the object         */
+    uint32_t    esis;               /* Distinct ESIs sent or received       */
+    uint32_t    source_esis;        /* Distinct ESIs below k                */
+    int64_t     size;               /* Decoded size of the last object or a
+                                       dxwifi_fec_error_t                   */
+} dxwifi_status_object;
+compiler_assert(sizeof(dxwifi_status_object) == 24, "Status object layout changed");
+
+
+typedef struct {
+    uint32_t                magic;          /* DXWIFI_STATUS_MAGIC              */
+    uint16_t                version;        /* DXWIFI_STATUS_VERSION            */
+    uint16_t                role;           /* dxwifi_status_role_t             */
+    uint32_t                size;           /* Size of the published struct     */
+    _Atomic uint32_t        seq;            /* Sequence lock, odd while writing */
+    int32_t                 pid;            /* Process publishing the segment   */
+    uint32_t                state;          /* dxwifi_status_state_t            */
+    uint64_t                updated_ns;     /* CLOCK_REALTIME of the last update*/
+    char                    device[DXWIFI_STATUS_DEVICE_MAX];
+                                            /* Network device, NUL terminated   */
+    uint64_t                data_frames;    /* Data frames sent or received     */
+    uint64_t                control_frames; /* Control frames sent or received  */
+    uint64_t                dropped_frames; /* Rx: Frames from other senders    */
+    uint64_t                bytes;          /* Payload bytes sent or received   */
+    uint64_t                errors;         /* Tx: Failed injections,
+                                               Rx: Data frames with a bad CRC   */
+    uint64_t                blocks_lost;    /* Rx: Blocks missing in order      */
+    dxwifi_status_object    object;         /* Current object progress          */
+    uint32_t                nantennas;      /* Antennas seen so far             */
+    uint32_t                __reserved;
+    dxwifi_status_antenna   antennas[DXWIFI_STATUS_ANTENNAS_MAX];
+                                            /* Indexed by radiotap antenna      */
+} dxwifi_status;
+compiler_assert(sizeof(dxwifi_status) == 224, "Status layout changed, bump DXWIFI_STATUS_VERSION");
+compiler_assert(ATOMIC_INT_LOCK_FREE == 2, "The sequence lock must be lock free to be shared between processes");
+
+
+/**
+ *  DESCRIPTION:    Copies a consistent snapshot of a mapped status segment
+ *
+ *  ARGUMENTS:
+ *
+ *      segment:    Status segment mapped by a reader
+ *
+ *      out:        Where the snapshot is copied
+ *
+ *  RETURNS:
+ *
+ *      bool:       false if the writer was mid-update, try again
+ *
+ */
+static inline bool status_snapshot(const dxwifi_status* segment, dxwifi_status* out) {
+    uint32_t seq = atomic_load_explicit(&segment->seq, memory_order_acquire);
+    if(seq & 1) {
+        return false;
+    }
+    memcpy(out, (const void*) segment, sizeof(dxwifi_status));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&segment->seq, memory_order_relaxed) == seq;
+}
+
+
+/**
+ *  DESCRIPTION:    Creates the status segment and starts publishing to it
+ *
+ *  ARGUMENTS:
+ *
+ *      name:       Segment name, published at /dev/shm/<name>. An existing
+ *                  segment of the same name is replaced.
+ *
+ *      role:       Whether the transmitter or receiver is publishing
+ *
+ *      device:     Network device to record in the segment, may be NULL
+ *
+ *  RETURNS:
+ *
+ *      bool:       true if the segment was created
+ *
+ */
+bool open_status_segment(const char* name, dxwifi_status_role_t role, const char* device);
+
+
+/**
+ *  DESCRIPTION:    Stops publishing and removes the segment. Does nothing if
+ *                  no segment is open.
+ *
+ */
+void close_status_segment();
+
+
+//
+// Updates below do nothing unless a segment is open. They must all be called
+// from the same thread.
+//
+
+/**
+ *  DESCRIPTION:    Records a change of state. Entering DXWIFI_STATUS_CAPTURING
+ *                  or DXWIFI_STATUS_TRANSMITTING starts a new object.
+ *
+ */
+void status_set_state(dxwifi_status_state_t state);
+
+
+/**
+ *  DESCRIPTION:    Records the result of decoding the last capture
+ *
+ *  ARGUMENTS:
+ *
+ *      result:     Decoded size or a dxwifi_fec_error_t
+ *
+ */
+void status_set_decoded(ssize_t result);
+
+
+/**
+ *  DESCRIPTION:    Records a control frame, a preamble starts a new object
+ *
+ */
+void status_control_frame(dxwifi_control_frame_t type);
+
+
+/**
+ *  DESCRIPTION:    Records an injected data frame
+ *
+ *  ARGUMENTS:
+ *
+ *      payload:    RS-LDPC frame that was sent
+ *
+ *      size:       Size of the payload
+ *
+ *      injected:   false if the injection failed
+ *
+ */
+void status_tx_frame(const uint8_t* payload, size_t size, bool injected);
+
+
+/**
+ *  DESCRIPTION:    Records a received data frame
+ *
+ *  ARGUMENTS:
+ *
+ *      payload:    RS-LDPC frame that was received
+ *
+ *      size:       Size of the payload
+ *
+ *      crc_valid:  Did the frame check sequence match?
+ *
+ *      antenna:    Radiotap antenna index, 0 if the driver didn't report it
+ *
+ *      signal:     Antenna signal in dBm, ignored if has_signal is false
+ *
+ *      has_signal: Did the driver report the antenna signal?
+ *
+ */
+void status_rx_frame(const uint8_t* payload, size_t size, bool crc_valid, uint8_t antenna, int8_t signal, bool has_signal);
+
+
+/**
+ *  DESCRIPTION:    Records frames from other senders dropped by the receiver
+ *
+ */
+void status_dropped_frame();
+
+
+/**
+ *  DESCRIPTION:    Records blocks found missing from an ordered capture
+ *
+ */
+void status_blocks_lost(uint32_t count);
+
+
+#endif // LIBDXWIFI_SHM_STATUS_H
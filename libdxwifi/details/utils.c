@@ -96,7 +96,8 @@ int msleep(unsigned msec, bool require_elapsed) {
 
 
 void combine_path(char* buffer, size_t n, const char* path, const char* filename) {
-    if(rindex(path, '/')) {
+    size_t len = strlen(path);
+    if(len > 0 && path[len - 1] == '/') {
         snprintf(buffer, n, "%s%s", path, filename);
     }
     else {
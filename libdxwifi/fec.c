@@ -4,8 +4,18 @@
  *  https://github.com/oresat/oresat-dxwifi-software
  */
 
+#define _GNU_SOURCE // fallocate
+
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_FEC
+
 #include <math.h>
+#include <time.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <arpa/inet.h>
 
 #include <rscode/ecc.h>
@@ -15,70 +25,338 @@
 #include <libdxwifi/details/utils.h>
 #include <libdxwifi/details/crc32.h>
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/probes.h>
 #include <libdxwifi/details/logging.h>
 
 #define FEC_PRNG 1804289383
 
+
+/**
+ *  An OpenFEC codec objects can be encoded with. The index into fec_codecs is
+ *  the codec ID carried in the OTI.
+ */
+typedef struct {
+    const char* name;                       /* Printable codec name             */
+    of_codec_id_t id;                       /* OpenFEC codec                    */
+    bool (*supports)(uint32_t n, uint32_t k);
+                                            /* Can the codec encode N, K?       */
+    of_status_t (*configure)(of_session_t* session, uint32_t n, uint32_t k, uint32_t symbol_size);
+                                            /* Sets the codec parameters        */
+} fec_codec;
+
+
+/**
+ *  Size of everything in an RS-LDPC frame, all derived from the number of RS
+ *  blocks per frame carried in the OTI
+ */
+typedef struct {
+    uint8_t blocks;                         /* RS blocks per frame              */
+    uint8_t depth;                          /* Frames each RS codeword spans    */
+    size_t symbol_size;                     /* FEC symbol size                  */
+    size_t ldpc_frame_size;                 /* LDPC frame size, OTI + symbol    */
+    size_t rs_frame_size;                   /* RS-LDPC frame size on the wire   */
+} frame_geometry;
+
+
+static const char* fec_stage_names[DXWIFI_FEC_STAGE_COUNT] = {
+    [DXWIFI_FEC_STAGE_SETUP]        = "Codec setup",
+    [DXWIFI_FEC_STAGE_SOURCE]       = "Source symbols",
+    [DXWIFI_FEC_STAGE_REPAIR]       = "Repair symbols",
+    [DXWIFI_FEC_STAGE_RS_ENCODE]    = "RS encode",
+    [DXWIFI_FEC_STAGE_INTERLEAVE]   = "Interleave",
+    [DXWIFI_FEC_STAGE_GEOMETRY]     = "Geometry probe",
+    [DXWIFI_FEC_STAGE_RS_DECODE]    = "RS decode",
+    [DXWIFI_FEC_STAGE_OTI_SEARCH]   = "OTI search",
+    [DXWIFI_FEC_STAGE_PLACE]        = "Place source symbols",
+    [DXWIFI_FEC_STAGE_IT_DECODE]    = "IT decode",
+    [DXWIFI_FEC_STAGE_ML_DECODE]    = "ML decode",
+    [DXWIFI_FEC_STAGE_COPY]         = "Copy ML symbols"
+};
+
+
+static uint64_t fec_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+// Start of a timed stage, the clock is only read when stats are kept
+static uint64_t stage_start(const dxwifi_fec_stats* stats, dxwifi_fec_stage_t stage) {
+    dxwifi_probe1(fec_stage_entry, stage);
+    return stats ? fec_now_ns() : 0;
+}
+
+
+static void stage_end(dxwifi_fec_stats* stats, dxwifi_fec_stage_t stage, uint64_t start) {
+    if(stats) {
+        stats->stage_ns[stage] += fec_now_ns() - start;
+    }
+    dxwifi_probe1(fec_stage_return, stage);
+}
+
+
+// Clears the stats for a new call and starts its total
+static uint64_t stats_start(dxwifi_fec_stats* stats) {
+    if(!stats) {
+        return 0;
+    }
+    memset(stats, 0x00, sizeof(*stats));
+    return fec_now_ns();
+}
+
+
+static void stats_total(dxwifi_fec_stats* stats, uint64_t start) {
+    if(stats) {
+        stats->total_ns = fec_now_ns() - start;
+    }
+}
+
+
+static frame_geometry make_geometry(uint8_t blocks, uint8_t depth) {
+    frame_geometry geometry = {
+        .blocks             = blocks,
+        .depth              = depth,
+        .symbol_size        = DXWIFI_FEC_SYMBOL_SIZE_FOR(blocks),
+        .ldpc_frame_size    = DXWIFI_LDPC_FRAME_SIZE_FOR(blocks),
+        .rs_frame_size      = DXWIFI_RS_LDPC_FRAME_SIZE_FOR(blocks)
+    };
+    return geometry;
+}
+
+
+static dxwifi_ldpc_frame* ldpc_frame_at(void* frames, size_t i, const frame_geometry* geometry) {
+    return offset(frames, i, geometry->ldpc_frame_size);
+}
+
+
+static dxwifi_rs_ldpc_frame* rs_ldpc_frame_at(void* frames, size_t i, const frame_geometry* geometry) {
+    return offset(frames, i, geometry->rs_frame_size);
+}
+
+
+// Byte q of a group of `depth` RS-LDPC frames goes to frame q % depth at
+// offset q / depth, so consecutive bytes of a codeword land in consecutive 
+// frames. Interleaves each group in place, N is a multiple of the depth.
+static void interleave_frames(void* frames, size_t nframes, const frame_geometry* geometry) {
+    size_t depth        = geometry->depth;
+    size_t frame_size   = geometry->rs_frame_size;
+
+    uint8_t* group = malloc(depth * frame_size);
+    assert_M(group, "Failed to allocate memory for interleaving");
+
+    for(size_t first = 0; first < nframes; first += depth) {
+        uint8_t* wire = (uint8_t*) rs_ldpc_frame_at(frames, first, geometry);
+        memcpy(group, wire, depth * frame_size);
+
+        for(size_t r = 0; r < frame_size; ++r) {
+            for(size_t j = 0; j < depth; ++j) {
+                wire[j * frame_size + r] = group[r * depth + j];
+            }
+        }
+    }
+    free(group);
+}
+
+
+// The receiver fills frames it never got with a single byte value, or leaves
+// a hole that reads back as zeros. No RS-LDPC frame looks like that.
+static bool frame_erased(const uint8_t* frame, size_t frame_size) {
+    return memcmp(frame, frame + 1, frame_size - 1) == 0;
+}
+
+
+// Positions of the bytes of group codeword c that were carried by lost 
+// frames, counted from the end of the codeword the way rscode expects them
+static int codeword_erasures(const bool* group_lost, size_t c, const frame_geometry* geometry, int* erasures) {
+    int nerasures = 0;
+    for(size_t t = 0; t < RSCODE_MAX_LEN; ++t) {
+        if(group_lost[(c * RSCODE_MAX_LEN + t) % geometry->depth]) {
+            erasures[nerasures++] = RSCODE_MAX_LEN - 1 - t;
+        }
+    }
+    return nerasures;
+}
+
+
+// Corrects a codeword in place, returns false if it's beyond repair. Counted
+// in stats unless it's NULL.
+static bool rs_correct(uint8_t* codeword, int nerasures, int* erasures, dxwifi_fec_stats* stats) {
+    bool corrected = false;
+    bool repaired  = true;
+
+    if(nerasures > RSCODE_NPAR) {
+        repaired = false;
+    }
+    else {
+        decode_data(codeword, RSCODE_MAX_LEN);
+
+        if(check_syndrome() != 0) {
+            corrected = true;
+            repaired  = correct_errors_erasures(codeword, RSCODE_MAX_LEN, nerasures, erasures) != 0;
+        }
+    }
+    if(stats) {
+        ++stats->rs_codewords;
+        stats->rs_corrections += corrected && repaired;
+        stats->rs_failures    += !repaired;
+    }
+    return repaired;
+}
+
+
+static bool ldpc_supports(uint32_t n, uint32_t k) {
+    return n <= OFEC_MAX_SYMBOLS && (n - k) >= DXWIFI_LDPC_N1_MIN;
+}
+
+
+static of_status_t ldpc_configure(of_session_t* session, uint32_t n, uint32_t k, uint32_t symbol_size) {
+    of_ldpc_parameters_t params = {
+        .nb_source_symbols      = k,
+        .nb_repair_symbols      = n - k,
+        .encoding_symbol_length = symbol_size,
+        .prng_seed              = FEC_PRNG, 
+        .N1                     = (n-k) > DXWIFI_LDPC_N1_MAX ? DXWIFI_LDPC_N1_MAX : (n-k) 
+    };
+    log_debug("LDPC N1: %d, PRNG Seed: %d", params.N1, params.prng_seed);
+    return of_set_fec_parameters(session, (of_parameters_t*) &params);
+}
+
+
+// RS is MDS, any K symbols decode the object, but GF(2^8) caps N at 255
+static bool rs_supports(uint32_t n, uint32_t k) {
+    return n <= OF_REED_SOLOMON_MAX_NB_ENCODING_SYMBOLS_DEFAULT && n > k;
+}
+
+
+static of_status_t rs_configure(of_session_t* session, uint32_t n, uint32_t k, uint32_t symbol_size) {
+    of_rs_parameters_t params = {
+        .nb_source_symbols      = k,
+        .nb_repair_symbols      = n - k,
+        .encoding_symbol_length = symbol_size
+    };
+    return of_set_fec_parameters(session, (of_parameters_t*) &params);
+}
+
+
+// The 2D parity matrix lays K out as a D x L grid, one repair symbol per row 
+// and column. Same search as OpenFEC's matrix builder.
+static bool parity_2d_supports(uint32_t n, uint32_t k) {
+    if(n > OF_2D_PARITY_MATRIX_MAX_NB_ENCODING_SYMBOLS_DEFAULT || k > OF_2D_PARITY_MATRIX_MAX_NB_SOURCE_SYMBOLS_DEFAULT) {
+        return false;
+    }
+    for(uint32_t d = 1; d * d <= k; ++d) {
+        if(k % d == 0 && d + (k / d) == n - k) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static of_status_t parity_2d_configure(of_session_t* session, uint32_t n, uint32_t k, uint32_t symbol_size) {
+    of_2d_parity_parameters_t params = {
+        .nb_source_symbols      = k,
+        .nb_repair_symbols      = n - k,
+        .encoding_symbol_length = symbol_size
+    };
+    return of_set_fec_parameters(session, (of_parameters_t*) &params);
+}
+
+
+static const fec_codec fec_codecs[DXWIFI_FEC_CODEC_COUNT] = {
+    [DXWIFI_FEC_CODEC_LDPC_STAIRCASE] = { "LDPC-Staircase", OF_CODEC_LDPC_STAIRCASE_STABLE, ldpc_supports, ldpc_configure },
+    [DXWIFI_FEC_CODEC_RS_GF_2_8]      = { "RS GF(2^8)", OF_CODEC_REED_SOLOMON_GF_2_8_STABLE, rs_supports, rs_configure },
+    [DXWIFI_FEC_CODEC_2D_PARITY]      = { "2D Parity", OF_CODEC_2D_PARITY_MATRIX_STABLE, parity_2d_supports, parity_2d_configure },
+};
+
+
+// Most robust codec that takes N, K. RS is MDS, any K of the N symbols rebuild
+// the object, and stays small for N <= 255. LDPC takes everything else. 2D 
+// parity is cheaper but loses objects RS would rebuild, so it's never chosen
+// here and has to be asked for.
+static dxwifi_fec_codec_t select_codec(uint32_t n, uint32_t k) {
+    if(rs_supports(n, k)) {
+        return DXWIFI_FEC_CODEC_RS_GF_2_8;
+    }
+    return DXWIFI_FEC_CODEC_LDPC_STAIRCASE;
+}
+
+
 // TODO Add function comments
-static void log_codec_params(const of_ldpc_parameters_t* params) {
+static void log_codec_params(const fec_codec* codec, uint32_t n, uint32_t k, const frame_geometry* geometry, uint64_t setup_ns, const char* setup_note) {
     log_info(
         "DxWiFi Codec\n"
+        "\tCodec:               %s\n"
         "\tK:                   %d\n"
         "\tN-K:                 %d\n"
-        "\tN1:                  %d\n"
-        "\tPRNG Seed:           %d\n"
         "\tRSCODE NPAR:         %d\n"
         "\tRSCODE Blocks/Frame: %d\n"
-        "\tFEC Symbol Size:     %d\n"
-        "\tLDPC Frame Size:     %d\n"
-        "\tRS-LDPC Frame Size:  %d\n",
-        params->nb_source_symbols,
-        params->nb_repair_symbols,
-        params->N1,
-        params->prng_seed,
+        "\tInterleave Depth:    %d\n"
+        "\tFEC Symbol Size:     %zu\n"
+        "\tLDPC Frame Size:     %zu\n"
+        "\tRS-LDPC Frame Size:  %zu\n"
+        "\tSetup Time:          %.3fms%s\n",
+        codec->name,
+        k,
+        n - k,
         RSCODE_NPAR,
-        DXWIFI_RSCODE_BLOCKS_PER_FRAME,
-        DXWIFI_FEC_SYMBOL_SIZE,
-        DXWIFI_LDPC_FRAME_SIZE,
-        DXWIFI_RS_LDPC_FRAME_SIZE
+        geometry->blocks,
+        geometry->depth,
+        geometry->symbol_size,
+        geometry->ldpc_frame_size,
+        geometry->rs_frame_size,
+        setup_ns / 1e6,
+        setup_note
     );
 }
 
 
-static void log_ldpc_data_frame(dxwifi_ldpc_frame* frame) {
+static void log_ldpc_data_frame(dxwifi_ldpc_frame* frame, const frame_geometry* geometry) {
     log_debug("(LDPC Frame) ESI: %u, CRC: 0x%x", ntohl(frame->oti.esi), ntohl(frame->oti.crc));
-    log_hexdump((uint8_t*)frame, sizeof(dxwifi_ldpc_frame));
+    log_hexdump((uint8_t*)frame, geometry->ldpc_frame_size);
 }
 
 
-static void log_rs_ldpc_data_frame(dxwifi_rs_ldpc_frame* frame) {
+static void log_rs_ldpc_data_frame(dxwifi_rs_ldpc_frame* frame, const frame_geometry* geometry) {
     log_debug("(RS-LDPC Frame)");
-    log_hexdump((uint8_t*)frame, sizeof(dxwifi_rs_ldpc_frame));
+    log_hexdump((uint8_t*)frame, geometry->rs_frame_size);
 }
 
 
-// Caculate N,K values, initialize openfec session
-static of_session_t* init_openfec(uint32_t n, uint32_t k, of_codec_type_t type) {
+// Initialize an OpenFEC session for the codec. OpenFEC keeps the last few
+// LDPC parity check matrices it built, so objects with the same N and K only
+// pay for a copy of the matrix. Returns NULL if the codec can't take N, K.
+static of_session_t* init_codec(dxwifi_fec_codec_t codec_id, uint32_t n, uint32_t k, const frame_geometry* geometry, of_codec_type_t type, dxwifi_fec_stats* stats) {
     of_status_t status = OF_STATUS_OK;
 
     of_session_t* openfec_session = NULL;
 
-    of_ldpc_parameters_t codec_params = {
-        .nb_source_symbols      = k,
-        .nb_repair_symbols      = n - k,
-        .encoding_symbol_length = DXWIFI_FEC_SYMBOL_SIZE,
-        .prng_seed              = FEC_PRNG, 
-        .N1                     = (n-k) > DXWIFI_LDPC_N1_MAX ? DXWIFI_LDPC_N1_MAX : (n-k) 
-    };
-    log_codec_params(&codec_params);
+    const fec_codec* codec = &fec_codecs[codec_id];
+    if(!codec->supports(n, k)) {
+        return NULL;
+    }
+
+    uint64_t start = fec_now_ns();
+
+    status = of_create_codec_instance(&openfec_session, codec->id, type, 2); // TODO magic number
+    assert_M(status == OF_STATUS_OK, "Failed to initialize OpenFEC session");
 
-    if(codec_params.N1 >= DXWIFI_LDPC_N1_MIN) {
-        status = of_create_codec_instance(&openfec_session, OF_CODEC_LDPC_STAIRCASE_STABLE, type, 2); // TODO magic number
-        assert_M(status == OF_STATUS_OK, "Failed to initialize OpenFEC session");
+    status = codec->configure(openfec_session, n, k, geometry->symbol_size);
+    assert_M(status == OF_STATUS_OK, "Failed to set codec parameters");
 
-        status = of_set_fec_parameters(openfec_session, (of_parameters_t*) &codec_params);
-        assert_M(status == OF_STATUS_OK, "Failed to set codec parameters");
+    const char* setup_note = "";
+    if(codec->id == OF_CODEC_LDPC_STAIRCASE_STABLE) {
+        uint32_t cached = 0;
+        of_get_control_parameter(openfec_session, OF_CRTL_LDPC_STAIRCASE_IS_PCHK_FROM_CACHE, &cached, sizeof(cached));
+        setup_note = cached ? " (matrix cached)" : " (matrix built)";
     }
+    uint64_t setup_ns = fec_now_ns() - start;
+    if(stats) {
+        stats->stage_ns[DXWIFI_FEC_STAGE_SETUP] += setup_ns;
+    }
+    log_codec_params(codec, n, k, geometry, setup_ns, setup_note);
+
     return openfec_session;
 }
 
@@ -101,98 +379,176 @@ const char* dxwifi_fec_error_to_str(dxwifi_fec_error_t err) {
 
     case FEC_ERROR_DECODE_NOT_POSSIBLE:
         return "Decode failed, not enough repair symbols";
+
+    case FEC_ERROR_OUTPUT_UNAVAILABLE:
+        return "Failed to allocate or map the decoded output";
+
+    case FEC_ERROR_UNSUPPORTED_CODEC:
+        return "Codec is unknown or can't take this N and K";
     
     default:
         return "Unknown error";
     }
 }
 
+const char* dxwifi_fec_codec_to_str(dxwifi_fec_codec_t codec) {
+    return codec < DXWIFI_FEC_CODEC_COUNT ? fec_codecs[codec].name : "Unknown";
+}
+
+
+ssize_t dxwifi_encode(void* message, size_t msglen, float coderate, void** out) {
+    return dxwifi_encode_with_codec(message, msglen, coderate, DXWIFI_FEC_CODEC_AUTO, out);
+}
+
+
+ssize_t dxwifi_encode_with_codec(void* message, size_t msglen, float coderate, dxwifi_fec_codec_t codec, void** out) {
+    dxwifi_fec_params params = DXWIFI_FEC_PARAMS_DFLT_INITIALIZER;
+    params.coderate = coderate;
+    params.codec    = codec;
+
+    return dxwifi_encode_with_params(message, msglen, &params, out, NULL);
+}
+
+
 // TODO refactor the individual algorithms of the encode routine into seperate 
 // functions
-ssize_t dxwifi_encode(void* message, size_t msglen, float coderate, void** out) {
-    debug_assert(message && out);
-    debug_assert(0.0 < coderate && coderate <= 1.0);
+ssize_t dxwifi_encode_with_params(void* message, size_t msglen, const dxwifi_fec_params* params, void** out, dxwifi_fec_stats* stats) {
+    debug_assert(message && out && params);
+    debug_assert(0.0 < params->coderate && params->coderate <= 1.0);
+    debug_assert(params->codec < DXWIFI_FEC_CODEC_COUNT || params->codec == DXWIFI_FEC_CODEC_AUTO);
+    debug_assert(0 < params->frame_blocks && params->frame_blocks <= DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX);
+    debug_assert(params->interleave_depth == 1 || (DXWIFI_FEC_INTERLEAVE_DEPTH_MIN <= params->interleave_depth && params->interleave_depth <= DXWIFI_FEC_INTERLEAVE_DEPTH_MAX));
+
+    uint64_t total_start = stats_start(stats);
 
-    uint16_t rem = msglen % DXWIFI_FEC_SYMBOL_SIZE;
-    uint16_t k   = ceil((float) msglen / DXWIFI_FEC_SYMBOL_SIZE);
-    uint16_t n   = k / coderate;  
+    dxwifi_probe3(fec_encode_entry, msglen, params->frame_blocks, params->interleave_depth);
+
+    dxwifi_fec_codec_t codec = params->codec;
+    frame_geometry geometry  = make_geometry(params->frame_blocks, params->interleave_depth);
+    size_t symbol_size       = geometry.symbol_size;
+
+    uint16_t rem = msglen % symbol_size;
+    uint16_t k   = ceil((float) msglen / symbol_size);
+    uint32_t n   = k / params->coderate;  
 
     if(rem) {
-        log_info("Encoded msg will be zero padded with %d bytes", DXWIFI_FEC_SYMBOL_SIZE - rem);
+        log_info("Encoded msg will be zero padded with %zu bytes", symbol_size - rem);
+    }
+
+    // Every interleaved group is full, the extra frames are repair symbols
+    if(n % geometry.depth) {
+        n += geometry.depth - n % geometry.depth;
+        log_info("N rounded up to %u, a multiple of the interleave depth", n);
     }
 
     //check if N > Max Symbols
     if(n > OFEC_MAX_SYMBOLS) {
+        dxwifi_probe3(fec_encode_return, FEC_ERROR_EXCEEDED_MAX_SYMBOLS, n, k);
         return FEC_ERROR_EXCEEDED_MAX_SYMBOLS;
     }
     
-    of_session_t* openfec_session = init_openfec(n, k, OF_ENCODER);
+    if(codec == DXWIFI_FEC_CODEC_AUTO) {
+        codec = select_codec(n, k);
+    }
+
+    of_session_t* openfec_session = init_codec(codec, n, k, &geometry, OF_ENCODER, stats);
     if(!openfec_session) {
-        return FEC_ERROR_BELOW_N1_MIN;
+        dxwifi_fec_error_t error = codec == DXWIFI_FEC_CODEC_LDPC_STAIRCASE ? FEC_ERROR_BELOW_N1_MIN : FEC_ERROR_UNSUPPORTED_CODEC;
+        dxwifi_probe3(fec_encode_return, error, n, k);
+        return error;
     }
 
-    dxwifi_ldpc_frame* ldpc_frames = calloc(n, sizeof(dxwifi_ldpc_frame));
+    void* ldpc_frames = calloc(n, geometry.ldpc_frame_size);
     assert_M(ldpc_frames, "Failed to allocate memory for LDPC Frames");
 
+    if(stats) {
+        stats->n = n;
+        stats->k = k;
+    }
+
     // Setup symbol table and CRCs
     uint32_t crcs[n];
     void* symbol_table[n];
 
+    uint64_t start = stage_start(stats, DXWIFI_FEC_STAGE_SOURCE);
+
     // Load source symbols into symbol table, and calculate CRCs
     for(uint16_t esi = 0; esi < k - 1; ++esi) { 
-        dxwifi_ldpc_frame* frame = &ldpc_frames[esi];
+        dxwifi_ldpc_frame* frame = ldpc_frame_at(ldpc_frames, esi, &geometry);
 
         // Copy symbol size bytes from the original message
-        memcpy(frame->symbol, offset(message, esi, DXWIFI_FEC_SYMBOL_SIZE), DXWIFI_FEC_SYMBOL_SIZE);
+        memcpy(frame->symbol, offset(message, esi, symbol_size), symbol_size);
 
         symbol_table[esi] = frame->symbol;
 
-        crcs[esi] = crc32(frame->symbol, DXWIFI_FEC_SYMBOL_SIZE);
+        crcs[esi] = crc32(frame->symbol, symbol_size);
     }
 
     // Special handling for Kth symbol since it may not be of length symbol size
-    dxwifi_ldpc_frame* frame = &ldpc_frames[k-1];
-    memcpy(frame->symbol, offset(message, k-1, DXWIFI_FEC_SYMBOL_SIZE), rem ? rem : DXWIFI_FEC_SYMBOL_SIZE);
+    dxwifi_ldpc_frame* frame = ldpc_frame_at(ldpc_frames, k-1, &geometry);
+    memcpy(frame->symbol, offset(message, k-1, symbol_size), rem ? rem : symbol_size);
 
     symbol_table[k-1] = frame->symbol;
 
-    crcs[k-1] = crc32(frame->symbol, DXWIFI_FEC_SYMBOL_SIZE);
+    crcs[k-1] = crc32(frame->symbol, symbol_size);
+
+    if(stats) {
+        stats->symbols_fed = k;
+    }
+    stage_end(stats, DXWIFI_FEC_STAGE_SOURCE, start);
+    start = stage_start(stats, DXWIFI_FEC_STAGE_REPAIR);
 
+    // Codecs that can build every repair symbol in one pass over the source 
+    // symbols do so when all the buffers are known up front
+    for(size_t esi = k; esi < n; ++esi) {
+        symbol_table[esi] = ldpc_frame_at(ldpc_frames, esi, &geometry)->symbol;
+    }
 
     // Build repair symbols and calculate CRCs
     of_status_t status = OF_STATUS_OK;
     for(size_t esi = k; esi < n; ++esi) {
-        dxwifi_ldpc_frame* frame = &ldpc_frames[esi];
-        symbol_table[esi] = frame->symbol;
-
         status = of_build_repair_symbol(openfec_session, symbol_table, esi);
         assert_continue(status == OF_STATUS_OK, "Failed to build repair symbol. esi=%d", esi);
 
-        crcs[esi] = crc32(symbol_table[esi], DXWIFI_FEC_SYMBOL_SIZE);
+        crcs[esi] = crc32(symbol_table[esi], symbol_size);
     }
+    stage_end(stats, DXWIFI_FEC_STAGE_REPAIR, start);
 
     initialize_ecc();
 
-    dxwifi_rs_ldpc_frame* rs_ldpc_frames = calloc(n, sizeof(dxwifi_rs_ldpc_frame));
+    start = stage_start(stats, DXWIFI_FEC_STAGE_RS_ENCODE);
+
+    void* rs_ldpc_frames = calloc(n, geometry.rs_frame_size);
+    assert_M(rs_ldpc_frames, "Failed to allocate memory for RS-LDPC Frames");
 
     // Fill out OTI headers and RS Encode each LDPC Frame
     for(uint16_t esi = 0; esi < n; ++esi) {
-        dxwifi_ldpc_frame* ldpc_frame = &ldpc_frames[esi];
+        dxwifi_ldpc_frame* ldpc_frame = ldpc_frame_at(ldpc_frames, esi, &geometry);
         ldpc_frame->oti.esi           = htons(esi);
         ldpc_frame->oti.n             = htons(n);
         ldpc_frame->oti.k             = htons(k);
         ldpc_frame->oti.rem           = htons(rem);
+        ldpc_frame->oti.codec         = codec;
+        ldpc_frame->oti.blocks        = geometry.blocks;
+        ldpc_frame->oti.depth         = geometry.depth;
         ldpc_frame->oti.crc           = htonl(crcs[esi]);
 
-        dxwifi_rs_ldpc_frame* rs_ldpc_frame = &rs_ldpc_frames[esi];
-        for(size_t i = 0; i < DXWIFI_RSCODE_BLOCKS_PER_FRAME; ++i) {
+        dxwifi_rs_ldpc_frame* rs_ldpc_frame = rs_ldpc_frame_at(rs_ldpc_frames, esi, &geometry);
+        for(size_t i = 0; i < geometry.blocks; ++i) {
             void* message  = offset(ldpc_frame, i, RSCODE_MAX_MSG_LEN);
             void* codeword = &rs_ldpc_frame->blocks[i];
 
             encode_data(message, RSCODE_MAX_MSG_LEN, codeword);
         }
-        log_ldpc_data_frame(ldpc_frame);
-        log_rs_ldpc_data_frame(rs_ldpc_frame);
+        log_ldpc_data_frame(ldpc_frame, &geometry);
+        log_rs_ldpc_data_frame(rs_ldpc_frame, &geometry);
+    }
+    stage_end(stats, DXWIFI_FEC_STAGE_RS_ENCODE, start);
+
+    if(geometry.depth > 1) {
+        start = stage_start(stats, DXWIFI_FEC_STAGE_INTERLEAVE);
+        interleave_frames(rs_ldpc_frames, n, &geometry);
+        stage_end(stats, DXWIFI_FEC_STAGE_INTERLEAVE, start);
     }
 
     *out = rs_ldpc_frames;
@@ -200,114 +556,612 @@ ssize_t dxwifi_encode(void* message, size_t msglen, float coderate, void** out)
     free(ldpc_frames);
 
     of_release_codec_instance(openfec_session);
-    return n * DXWIFI_RS_LDPC_FRAME_SIZE;
+
+    stats_total(stats, total_start);
+    dxwifi_probe3(fec_encode_return, n * geometry.rs_frame_size, n, k);
+    return n * geometry.rs_frame_size;
+}
+
+/**
+ *  Where decode_into() puts the decoded source symbols. The output buffer is
+ *  requested from `map` once K is known from the OTI, and every source symbol,
+ *  received or rebuilt, is written straight to its final offset in it.
+ */
+typedef struct {
+    void* (*map)(void* ctx, size_t size);   /* Returns a zeroed output buffer */
+    void* ctx;                              /* Passed to map                  */
+    uint8_t* out;                           /* Output buffer                  */
+    size_t symbol_size;                     /* Size of each source symbol     */
+    bool* placed;                           /* Source symbol already in out?  */
+    uint16_t n;                             /* Encoding symbols, from the OTI */
+    uint16_t k;                             /* Source symbols, from the OTI   */
+} decode_sink;
+
+
+// OpenFEC callback for source symbols rebuilt by IT decoding
+static void* place_decoded_symbol(void* context, UINT32 size, UINT32 esi) {
+    decode_sink* sink = context;
+    debug_assert(size == sink->symbol_size);
+
+    sink->placed[esi] = true;
+    return offset(sink->out, esi, sink->symbol_size);
 }
 
-// TODO Refactor the individual algorithms of the decode routine into seperate
-// functions. 
-ssize_t dxwifi_decode(void* encoded_msg, size_t msglen, void** out) {
-    debug_assert(encoded_msg && out);
 
-    if( msglen % DXWIFI_RS_LDPC_FRAME_SIZE != 0) {
-        log_warning("Misaligned, msglen (%u) is not divisible by RS-LDPC frame size");
+// Corrects RS blocks [first, last) of frame i in place and copies their 
+// messages into the LDPC frame. When the frames were interleaved, `lost` flags
+// the frames that never arrived and their bytes are erasures. An interleaved 
+// frame with a block beyond repair is partly fill, its ESI is invalidated so
+// the decoder skips it.
+static void rs_decode_blocks(void* rs_ldpc_frames, void* ldpc_frames, size_t i, size_t first, size_t last, const frame_geometry* geometry, const bool* lost, dxwifi_fec_stats* stats) {
+    uint64_t start = stage_start(stats, DXWIFI_FEC_STAGE_RS_DECODE);
+
+    dxwifi_rs_ldpc_frame* rs_ldpc_frame = rs_ldpc_frame_at(rs_ldpc_frames, i, geometry);
+    dxwifi_ldpc_frame* ldpc_frame = ldpc_frame_at(ldpc_frames, i, geometry);
+
+    size_t member = i % geometry->depth;
+
+    int erasures[RSCODE_MAX_LEN];
+    int nerasures = 0;
+
+    bool repaired = true;
+    for(size_t j = first; j < last; ++j) {
+        void* message  = offset(ldpc_frame, j, RSCODE_MAX_MSG_LEN);
+        void* codeword = &rs_ldpc_frame->blocks[j];
+
+        if(lost) {
+            nerasures = codeword_erasures(lost + (i - member), member * geometry->blocks + j, geometry, erasures);
+        }
+        repaired &= rs_correct(codeword, nerasures, erasures, stats);
+
+        memcpy(message, codeword, RSCODE_MAX_MSG_LEN);
+    }
+    if(lost && !repaired) {
+        ldpc_frame->oti.esi = htons(UINT16_MAX);
     }
+    stage_end(stats, DXWIFI_FEC_STAGE_RS_DECODE, start);
 
-    initialize_ecc();
+    if(last == geometry->blocks) {
+        log_ldpc_data_frame(ldpc_frame, geometry);
+        log_rs_ldpc_data_frame(rs_ldpc_frame, geometry);
+    }
+}
 
-    size_t nframes = msglen / DXWIFI_RS_LDPC_FRAME_SIZE;
 
-    dxwifi_ldpc_frame* ldpc_frames = calloc(nframes, sizeof(dxwifi_ldpc_frame));
+static bool frame_crc_valid(const dxwifi_ldpc_frame* frame, const frame_geometry* geometry) {
+    return crc32(frame->symbol, geometry->symbol_size) == ntohl(frame->oti.crc);
+}
 
-    dxwifi_rs_ldpc_frame* rs_ldpc_frames = encoded_msg;
 
-    // Decode outer RS shell and populate the LDPC Frames
-    for(size_t i = 0; i < nframes; ++i) {
+// Number of leading frames whose OTI is read for each candidate geometry
+#define FEC_GEOMETRY_PROBES 4
+
+// Leading frames checked for receiver fill while probing, and the furthest
+// frame a probe reaches
+#define FEC_GEOMETRY_PROBE_FRAMES ((FEC_GEOMETRY_PROBES + 1) * DXWIFI_FEC_INTERLEAVE_DEPTH_MAX)
+
 
-        dxwifi_rs_ldpc_frame* rs_ldpc_frame = &rs_ldpc_frames[i];
-        dxwifi_ldpc_frame* ldpc_frame = &ldpc_frames[i];
+// Reads the first RS block of the group of frames starting at `first`, 
+// deinterleaving it for depths above 1. Frames past the end of the message are
+// lost. Returns the number of erasures in the block, `oti` is only set if the
+// block could be corrected.
+static int probe_oti(void* encoded_msg, size_t nframes, const bool* lost, size_t first, const frame_geometry* geometry, uint8_t* codeword, const dxwifi_oti** oti) {
+    size_t depth = geometry->depth;
+
+    int erasures[RSCODE_MAX_LEN];
+    int nerasures = 0;
+
+    if(depth == 1) {
+        memcpy(codeword, rs_ldpc_frame_at(encoded_msg, first, geometry), RSCODE_MAX_LEN);
+    }
+    else {
+        for(size_t t = 0; t < RSCODE_MAX_LEN; ++t) {
+            size_t frame = first + t % depth;
+
+            if(frame >= nframes || lost[frame]) {
+                codeword[t] = 0;
+                erasures[nerasures++] = RSCODE_MAX_LEN - 1 - t;
+            }
+            else {
+                codeword[t] = ((uint8_t*) rs_ldpc_frame_at(encoded_msg, frame, geometry))[t / depth];
+            }
+        }
+    }
+    *oti = rs_correct(codeword, nerasures, erasures, NULL) ? (dxwifi_oti*) codeword : NULL;
+    return nerasures;
+}
 
-        for(size_t j = 0; j < DXWIFI_RSCODE_BLOCKS_PER_FRAME; ++j) {
-            void* message  = offset(ldpc_frame, j, RSCODE_MAX_MSG_LEN);
-            void* codeword = &rs_ldpc_frame->blocks[j];
 
-            decode_data(codeword, RSCODE_MAX_LEN);
+// The frame size isn't known until an OTI is read, but the OTI is in the 
+// first RS block of every frame. For each candidate number of blocks per frame
+// and interleave depth read the OTI at the start of the first few groups, a 
+// probe only counts when its OTI names the geometry it was read with. The RS 
+// blocks are corrected on a copy, the message may hold anything at offsets 
+// that aren't frame starts.
+//
+// Interleaved messages are also tried with their first group starting at 
+// every frame up to the depth, since the receiver can't fill in frames lost 
+// before the first one it got. `lead` is set to the number of frames missing 
+// from the front of the message. Groups that lost too many frames to be read
+// are passed over, and so are lost frames of messages that aren't interleaved.
+static bool detect_geometry(void* encoded_msg, size_t msglen, frame_geometry* geometry, size_t* lead) {
+    unsigned best_votes = 0;
+
+    // A wrong geometry all but never reads back an OTI naming itself, two
+    // votes settle it. Depths between 1 and the minimum are never encoded.
+    for(uint8_t depth = 1; depth <= DXWIFI_FEC_INTERLEAVE_DEPTH_MAX && best_votes < FEC_GEOMETRY_PROBES / 2; depth = (depth == 1 ? DXWIFI_FEC_INTERLEAVE_DEPTH_MIN : depth + 1)) {
+        for(uint8_t blocks = 1; blocks <= DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX; ++blocks) {
+            frame_geometry candidate = make_geometry(blocks, depth);
+            size_t nframes = msglen / candidate.rs_frame_size;
+
+            bool lost[FEC_GEOMETRY_PROBE_FRAMES];
+            for(size_t i = 0; i < nframes && i < FEC_GEOMETRY_PROBE_FRAMES; ++i) {
+                lost[i] = frame_erased((uint8_t*) rs_ldpc_frame_at(encoded_msg, i, &candidate), candidate.rs_frame_size);
+            }
 
-            if(check_syndrome() != 0) {
-                correct_errors_erasures(codeword, RSCODE_MAX_LEN, 0, NULL);
+            for(size_t first = 0; first < depth && first < nframes; ++first) {
+                unsigned votes = 0, probes = 0;
+                for(size_t i = first; i < nframes && i < FEC_GEOMETRY_PROBE_FRAMES && probes < FEC_GEOMETRY_PROBES; i += depth) {
+                    uint8_t codeword[RSCODE_MAX_LEN];
+                    const dxwifi_oti* oti = NULL;
+
+                    // A lost frame holds no OTI, without interleaving look past it
+                    if(depth == 1 && lost[i]) {
+                        continue;
+                    }
+                    ++probes;
+
+                    int nerasures = probe_oti(encoded_msg, nframes, lost, i, &candidate, codeword, &oti);
+                    if(oti && oti->blocks == blocks && oti->depth == depth && ntohs(oti->esi) % depth == 0) {
+                        ++votes;
+                    }
+                    else if(depth > 1 && votes == 0 && nerasures <= RSCODE_NPAR) {
+                        break; // Readable but wrong, not worth probing further
+                    }
+                }
+                if(votes > best_votes) {
+                    best_votes = votes;
+                    *geometry  = candidate;
+                    *lead      = (depth - first) % depth;
+                }
             }
-            memcpy(message, codeword, RSCODE_MAX_MSG_LEN);
         }
-        log_ldpc_data_frame(ldpc_frame);
-        log_rs_ldpc_data_frame(rs_ldpc_frame);
+    }
+    return best_votes > 0;
+}
+
+
+// Copies the interleaved message out in codeword order. `lead` lost frames go
+// in front and the last group is filled out with lost frames. Returns the 
+// number of frames in `out`, `lost` flags the ones that never arrived.
+static size_t deinterleave_frames(void* encoded_msg, size_t nframes, size_t lead, const frame_geometry* geometry, void** out, bool** lost) {
+    size_t depth        = geometry->depth;
+    size_t frame_size   = geometry->rs_frame_size;
+    size_t total        = lead + nframes;
+
+    total += (depth - total % depth) % depth;
+
+    uint8_t* frames = calloc(total, frame_size);
+    assert_M(frames, "Failed to allocate memory for deinterleaving");
+
+    *lost = calloc(total, sizeof(bool));
+    assert_M(*lost, "Failed to allocate memory for lost frames");
+
+    for(size_t v = 0; v < total; ++v) {
+        if(v < lead || v - lead >= nframes) {
+            (*lost)[v] = true;
+            continue;
+        }
+        uint8_t* wire  = (uint8_t*) rs_ldpc_frame_at(encoded_msg, v - lead, geometry);
+        uint8_t* group = (uint8_t*) rs_ldpc_frame_at(frames, v - v % depth, geometry);
+
+        if(frame_erased(wire, frame_size)) {
+            (*lost)[v] = true;
+            continue;
+        }
+        for(size_t r = 0; r < frame_size; ++r) {
+            group[r * depth + v % depth] = wire[r];
+        }
+    }
+    *out = frames;
+    return total;
+}
+
+
+// Decodes RS-LDPC frames laid out in codeword order
+static ssize_t decode_frames(void* rs_ldpc_frames, size_t nframes, const frame_geometry* geometry, const bool* lost, decode_sink* sink, dxwifi_fec_stats* stats) {
+    size_t symbol_size  = geometry->symbol_size;
+
+    void* ldpc_frames = calloc(nframes, geometry->ldpc_frame_size);
+    assert_M(ldpc_frames, "Failed to allocate memory for LDPC Frames");
+
+    bool* rs_decoded = calloc(nframes, sizeof(bool));
+    assert_M(rs_decoded, "Failed to allocate memory for RS decoded flags");
+
+    // The OTI fits in the first RS block. Decode that alone to sort source 
+    // frames from repair frames, repair frames are only fully decoded if the 
+    // LDPC decoder ends up needing them.
+    for(size_t i = 0; i < nframes; ++i) {
+        dxwifi_ldpc_frame* ldpc_frame = ldpc_frame_at(ldpc_frames, i, geometry);
+
+        rs_decode_blocks(rs_ldpc_frames, ldpc_frames, i, 0, 1, geometry, lost, stats);
+
+        if(ntohs(ldpc_frame->oti.esi) < ntohs(ldpc_frame->oti.k)) {
+            rs_decode_blocks(rs_ldpc_frames, ldpc_frames, i, 1, geometry->blocks, geometry, lost, stats);
+            rs_decoded[i] = true;
+        }
     }
 
-    // Search for first valid OTI header 
+    // Search for first valid OTI header, source frames first
     size_t idx = 0;
-    for(; idx < nframes; ++idx) {
-    	dxwifi_ldpc_frame* frame = &ldpc_frames[idx];
+    for(bool all_decoded = false; ; all_decoded = true) {
+        for(idx = 0; idx < nframes; ++idx) {
+            dxwifi_ldpc_frame* frame = ldpc_frame_at(ldpc_frames, idx, geometry);
 
-    	uint32_t crc = crc32(frame->symbol, DXWIFI_FEC_SYMBOL_SIZE); 
+            if(rs_decoded[idx] == all_decoded) {
+                continue;
+            }
+            if(all_decoded) {
+                rs_decode_blocks(rs_ldpc_frames, ldpc_frames, idx, 1, geometry->blocks, geometry, lost, stats);
+                rs_decoded[idx] = true;
+            }
+            uint64_t start = stage_start(stats, DXWIFI_FEC_STAGE_OTI_SEARCH);
+            bool crc_valid = frame_crc_valid(frame, geometry);
+            stage_end(stats, DXWIFI_FEC_STAGE_OTI_SEARCH, start);
 
-    	if(crc == ntohl(frame->oti.crc)){
+            if(crc_valid) {
+                break;
+            }
+            log_warning("Frame %d CRC mistmatch, actual: 0x%x expected: 0x%x", idx, crc32(frame->symbol, symbol_size), ntohl(frame->oti.crc)); 
+        }
+        if(idx < nframes || all_decoded) {
             break;
-    	}
-    	else { 
-            log_warning("Frame %d CRC mistmatch, actual: 0x%x expected: 0x%x", idx, crc, ntohl(frame->oti.crc)); 
         }
-	} 
+    }
     if(idx >= nframes){
+        free(rs_decoded);
         free(ldpc_frames);
         return FEC_ERROR_NO_OTI_FOUND;
-	}
+    }
 
-	dxwifi_oti* oti = &ldpc_frames[idx].oti;
+    dxwifi_oti* oti = &ldpc_frame_at(ldpc_frames, idx, geometry)->oti;
     uint16_t esi    = ntohs(oti->esi);
     uint16_t n      = ntohs(oti->n);
     uint16_t k      = ntohs(oti->k);
     uint16_t rem    = ntohs(oti->rem);
-    log_info("OTI Found: esi=%d, n=%d, k=%d, rem=%d", esi, n, k, rem);
+    dxwifi_fec_codec_t codec = oti->codec;
+    log_info("OTI Found: esi=%d, n=%d, k=%d, rem=%d, codec=%s", esi, n, k, rem, dxwifi_fec_codec_to_str(codec));
+
+    if(codec >= DXWIFI_FEC_CODEC_COUNT || !fec_codecs[codec].supports(n, k)) {
+        free(rs_decoded);
+        free(ldpc_frames);
+        return FEC_ERROR_UNSUPPORTED_CODEC;
+    }
+
+    // Kth symbol may not be of length symbol size, the caller drops the padding
+    uint16_t nbytes = rem ? rem : symbol_size;
+
+    sink->symbol_size = symbol_size;
+    sink->out = sink->map(sink->ctx, (size_t) k * symbol_size);
+    if(!sink->out) {
+        free(rs_decoded);
+        free(ldpc_frames);
+        return FEC_ERROR_OUTPUT_UNAVAILABLE;
+    }
+    sink->placed = calloc(k, sizeof(bool));
+    assert_M(sink->placed, "Failed to allocate memory for placed symbols");
+
+    sink->n = n;
+    sink->k = k;
+
+    if(stats) {
+        stats->n = n;
+        stats->k = k;
+    }
+
+    uint64_t start = stage_start(stats, DXWIFI_FEC_STAGE_PLACE);
+
+    // Place every intact source symbol. A duplicate that passes its CRC takes
+    // the slot over from an earlier corrupt copy.
+    uint16_t nplaced = 0;
+    for(size_t i = 0; i < nframes; ++i) {
+        dxwifi_ldpc_frame* frame = ldpc_frame_at(ldpc_frames, i, geometry);
+
+        uint16_t esi = ntohs(frame->oti.esi);
+        if(esi < k && rs_decoded[i] && !sink->placed[esi] && frame_crc_valid(frame, geometry)) {
+            memcpy(offset(sink->out, esi, symbol_size), frame->symbol, symbol_size);
+            sink->placed[esi] = true;
+            ++nplaced;
+        }
+    }
+    stage_end(stats, DXWIFI_FEC_STAGE_PLACE, start);
+
+    if(stats) {
+        stats->symbols_placed = nplaced;
+    }
+
+    // Systematic fast path, everything is already in place
+    if(nplaced == k) {
+        if(stats) {
+            stats->systematic = true;
+        }
+        log_info("All %d source symbols intact, skipping LDPC decoding", k);
+
+        free(rs_decoded);
+        free(ldpc_frames);
+        free(sink->placed);
+        return ((k-1) * symbol_size) + nbytes;
+    }
 
-    of_session_t* openfec_session = init_openfec(n, k, OF_DECODER);
+    for(size_t i = 0; i < nframes; ++i) {
+        if(!rs_decoded[i]) {
+            rs_decode_blocks(rs_ldpc_frames, ldpc_frames, i, 1, geometry->blocks, geometry, lost, stats);
+        }
+    }
+    free(rs_decoded);
+
+    of_session_t* openfec_session = init_codec(codec, n, k, geometry, OF_DECODER, stats);
+    of_set_callback_functions(openfec_session, place_decoded_symbol, NULL, sink);
 
     // Decode LDPC Frames
+    start = stage_start(stats, DXWIFI_FEC_STAGE_IT_DECODE);
     of_status_t status = OF_STATUS_OK;
+    uint32_t nfed = 0;
     for (size_t i = 0; i < nframes; ++i) {
-        dxwifi_ldpc_frame* frame = &ldpc_frames[i];
+        dxwifi_ldpc_frame* frame = ldpc_frame_at(ldpc_frames, i, geometry);
 
         uint16_t esi = ntohs(frame->oti.esi);
-        if(esi > n) {
+        bool have_copy = esi < k && sink->placed[esi];
+        if(esi >= n) {
             log_debug("Invalid ESI: %u, N: %u", esi, n);
-        } else {
+        } 
+        else if(!have_copy && !frame_crc_valid(frame, geometry)) {
+            // A corrupt symbol would spoil every symbol rebuilt from it
+            log_debug("Frame %zu CRC mismatch, ESI: %u not fed to the decoder", i, esi);
+        }
+        else if(esi < k) {
+            // Received source symbols go straight to their final offset. OpenFEC
+            // only keeps the pointer, and ignores duplicates.
+            void* symbol = offset(sink->out, esi, symbol_size);
+            if(!sink->placed[esi]) {
+                memcpy(symbol, frame->symbol, symbol_size);
+                sink->placed[esi] = true;
+            }
+            of_decode_with_new_symbol(openfec_session, symbol, esi);
+            ++nfed;
+        }
+        else {
             of_decode_with_new_symbol(openfec_session, frame->symbol, esi);
+            ++nfed;
         }
     }
+    stage_end(stats, DXWIFI_FEC_STAGE_IT_DECODE, start);
+    free(ldpc_frames);
+
+    if(stats) {
+        stats->symbols_fed = nfed;
+    }
+
     if(!of_is_decoding_complete(openfec_session)) {
+        if(stats) {
+            stats->ml_decoding = true;
+        }
+
+        start = stage_start(stats, DXWIFI_FEC_STAGE_ML_DECODE);
         status = of_finish_decoding(openfec_session);
+        stage_end(stats, DXWIFI_FEC_STAGE_ML_DECODE, start);
+
         if(status != OF_STATUS_OK) {
-            free(ldpc_frames);
+            free(sink->placed);
             of_release_codec_instance(openfec_session);
             return FEC_ERROR_DECODE_NOT_POSSIBLE;
         }
     }
 
+    // Symbols solved by ML decoding bypass the callback, move them in place
+    start = stage_start(stats, DXWIFI_FEC_STAGE_COPY);
     void* symbol_table[n];
     of_get_source_symbols_tab(openfec_session, symbol_table);
 
-    // Copy out the decoded message
-    void* decoded_msg = calloc(k, DXWIFI_FEC_SYMBOL_SIZE);
-    for(uint16_t esi = 0; esi < (k - 1); ++esi) {
-        void* symbol = offset(decoded_msg, esi, DXWIFI_FEC_SYMBOL_SIZE);
-        memcpy(symbol, symbol_table[esi], DXWIFI_FEC_SYMBOL_SIZE);
+    for(uint16_t esi = 0; esi < k; ++esi) {
+        void* symbol = offset(sink->out, esi, symbol_size);
+        if(symbol_table[esi] != symbol) {
+            memcpy(symbol, symbol_table[esi], symbol_size);
+            free(symbol_table[esi]);
+        }
     }
+    stage_end(stats, DXWIFI_FEC_STAGE_COPY, start);
 
-    // Special handling for Kth symbol since it may not be of length symbol size
-    uint16_t nbytes = rem ? rem : DXWIFI_FEC_SYMBOL_SIZE;
-    void* symbol = offset(decoded_msg, k-1, DXWIFI_FEC_SYMBOL_SIZE);
-    memcpy(symbol, symbol_table[k-1], nbytes);
+    free(sink->placed);
+    of_release_codec_instance(openfec_session);
 
-    *out = decoded_msg;
+    return ((k-1) * symbol_size) + nbytes;
+}
 
-    free(ldpc_frames);
-    of_release_codec_instance(openfec_session);
-    return ((k-1) * DXWIFI_FEC_SYMBOL_SIZE) + nbytes;
+
+static ssize_t decode_message(void* encoded_msg, size_t msglen, decode_sink* sink, dxwifi_fec_stats* stats) {
+    initialize_ecc();
+
+    frame_geometry geometry;
+    size_t lead = 0;
+
+    uint64_t start = stage_start(stats, DXWIFI_FEC_STAGE_GEOMETRY);
+    bool detected = detect_geometry(encoded_msg, msglen, &geometry, &lead);
+    stage_end(stats, DXWIFI_FEC_STAGE_GEOMETRY, start);
+
+    if(!detected) {
+        return FEC_ERROR_NO_OTI_FOUND;
+    }
+    log_info("Frame geometry: %d RS blocks per frame, interleave depth %d, %zu byte symbols", geometry.blocks, geometry.depth, geometry.symbol_size);
+
+    if( msglen % geometry.rs_frame_size != 0) {
+        log_warning("Misaligned, msglen (%zu) is not divisible by RS-LDPC frame size", msglen);
+    }
+
+    size_t nframes = msglen / geometry.rs_frame_size;
+
+    if(geometry.depth == 1) {
+        return decode_frames(encoded_msg, nframes, &geometry, NULL, sink, stats);
+    }
+
+    if(lead) {
+        log_info("First %zu frames of the message were lost", lead);
+    }
+    void* rs_ldpc_frames = NULL;
+    bool* lost = NULL;
+    start = stage_start(stats, DXWIFI_FEC_STAGE_INTERLEAVE);
+    nframes = deinterleave_frames(encoded_msg, nframes, lead, &geometry, &rs_ldpc_frames, &lost);
+    stage_end(stats, DXWIFI_FEC_STAGE_INTERLEAVE, start);
+
+    ssize_t nbytes = decode_frames(rs_ldpc_frames, nframes, &geometry, lost, sink, stats);
+
+    free(rs_ldpc_frames);
+    free(lost);
+    return nbytes;
+}
+
+
+// Every decode goes through here so the stats cover the whole call
+static ssize_t decode_into(void* encoded_msg, size_t msglen, decode_sink* sink, dxwifi_fec_stats* stats) {
+    uint64_t start = stats_start(stats);
+
+    dxwifi_probe1(fec_decode_entry, msglen);
+
+    ssize_t nbytes = decode_message(encoded_msg, msglen, sink, stats);
+
+    stats_total(stats, start);
+    dxwifi_probe3(fec_decode_return, nbytes, sink->n, sink->k);
+    return nbytes;
+}
+
+
+static void* map_heap_output(void* ctx, size_t size) {
+    return *(void**) ctx = calloc(1, size);
+}
+
+
+const char* dxwifi_fec_stage_to_str(dxwifi_fec_stage_t stage) {
+    return stage < DXWIFI_FEC_STAGE_COUNT ? fec_stage_names[stage] : "Unknown";
+}
+
+
+void dxwifi_write_fec_stats(FILE* stream, const dxwifi_fec_stats* stats) {
+    debug_assert(stream && stats);
+
+    fprintf(stream, "FEC stats: n=%u, k=%u, %.3f ms total\n", stats->n, stats->k, stats->total_ns / 1e6);
+    for(size_t stage = 0; stage < DXWIFI_FEC_STAGE_COUNT; ++stage) {
+        if(stats->stage_ns[stage]) {
+            fprintf(stream, "\t%-24s%10.3f ms %6.1f%%\n", 
+                fec_stage_names[stage], 
+                stats->stage_ns[stage] / 1e6, 
+                stats->total_ns ? 100.0 * stats->stage_ns[stage] / stats->total_ns : 0.0
+            );
+        }
+    }
+    fprintf(stream, 
+        "\tSymbols fed: %u, Source symbols placed: %u\n"
+        "\tRS codewords: %u, Corrected: %u, Beyond repair: %u\n"
+        "\tSystematic: %s, ML decoding: %s\n",
+        stats->symbols_fed, 
+        stats->symbols_placed,
+        stats->rs_codewords, 
+        stats->rs_corrections, 
+        stats->rs_failures,
+        stats->systematic ? "yes" : "no",
+        stats->ml_decoding ? "yes" : "no"
+    );
+}
+
+
+ssize_t dxwifi_decode(void* encoded_msg, size_t msglen, void** out) {
+    return dxwifi_decode_with_stats(encoded_msg, msglen, out, NULL);
+}
+
+
+ssize_t dxwifi_decode_with_stats(void* encoded_msg, size_t msglen, void** out, dxwifi_fec_stats* stats) {
+    debug_assert(encoded_msg && out);
+
+    *out = NULL;
+    decode_sink sink = { .map = map_heap_output, .ctx = out };
+
+    ssize_t nbytes = decode_into(encoded_msg, msglen, &sink, stats);
+    if(nbytes < 0) {
+        free(*out);
+        *out = NULL;
+    }
+    return nbytes;
+}
+
+
+/**
+ *  Output file region backing decode_into(). The region starts at the end of
+ *  the file and is mapped from the enclosing page boundary.
+ */
+typedef struct {
+    int fd;             /* Output file descriptor          */
+    off_t base;         /* File size before decoding       */
+    void* map;          /* Start of the mapping            */
+    size_t maplen;      /* Length of the mapping           */
+} file_output;
+
+
+static void* map_file_output(void* ctx, size_t size) {
+    file_output* file = ctx;
+
+    off_t page  = file->base & ~((off_t) sysconf(_SC_PAGESIZE) - 1);
+    size_t lead = file->base - page;
+
+    // Reserve the blocks up front so a full disk fails here rather than with a
+    // SIGBUS while writing through the mapping
+    int err = fallocate(file->fd, 0, file->base, size);
+    if(err < 0 && (errno == EOPNOTSUPP || errno == ENOSYS)) {
+        err = ftruncate(file->fd, file->base + size);
+    }
+    if(err < 0) {
+        log_error("Failed to reserve %zu bytes for the decoded file - %s", size, strerror(errno));
+        return NULL;
+    }
+
+    file->maplen = lead + size;
+    file->map = mmap(NULL, file->maplen, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, page);
+    if(file->map == MAP_FAILED) {
+        log_error("Failed to map the decoded file - %s", strerror(errno));
+        file->map = NULL;
+        return NULL;
+    }
+    return offset(file->map, lead, 1);
+}
+
+
+ssize_t dxwifi_decode_to_file(void* encoded_msg, size_t msglen, int fd, dxwifi_fec_stats* stats) {
+    debug_assert(encoded_msg);
+
+    struct stat st;
+    int flags = fcntl(fd, F_GETFL);
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || flags < 0 || (flags & O_ACCMODE) != O_RDWR) {
+        // Pipes and write-only descriptors can't be mapped, decode in memory instead
+        void* decoded_msg = NULL;
+        ssize_t nbytes = dxwifi_decode_with_stats(encoded_msg, msglen, &decoded_msg, stats);
+        if(nbytes > 0) {
+            ssize_t written = write(fd, decoded_msg, nbytes);
+            assert_M(written == nbytes, "Partial write occured: %d/%d - %s", written, nbytes, strerror(errno));
+        }
+        free(decoded_msg);
+        return nbytes;
+    }
+
+    file_output file = { .fd = fd, .base = st.st_size, .map = NULL, .maplen = 0 };
+    decode_sink sink = { .map = map_file_output, .ctx = &file };
+
+    ssize_t nbytes = decode_into(encoded_msg, msglen, &sink, stats);
+
+    if(file.map) {
+        munmap(file.map, file.maplen);
+    }
+    // Drop the padding of the last symbol, or everything if decoding failed
+    if(ftruncate(fd, file.base + (nbytes > 0 ? nbytes : 0)) < 0) {
+        log_error("Failed to truncate the decoded file - %s", strerror(errno));
+    }
+    lseek(fd, 0, SEEK_END);
+    return nbytes;
 }
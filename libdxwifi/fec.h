@@ -12,13 +12,16 @@
  *  Includes
  ***********************/
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <rscode/ecc.h>
 
 #include <ldpc_staircase/of_codec_profile.h>
 
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/ieee80211.h>
 
 /************************
  *  Constants
@@ -27,17 +30,40 @@
 // Max number of symbols that OpenFEC can handle, 50000
 #define OFEC_MAX_SYMBOLS OF_LDPC_STAIRCASE_MAX_NB_ENCODING_SYMBOLS_DEFAULT
 
-// Number of RS encoded chunks per LDPC frame
+// Default number of RS encoded chunks per LDPC frame
 #define DXWIFI_RSCODE_BLOCKS_PER_FRAME 5
 
+// Most RS encoded chunks that fit in a single 802.11 MSDU
+#define DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX (IEEE80211_MTU_MAX_LEN / RSCODE_MAX_LEN)
+
+// Size of the LDPC encoded symbol with OTI for a number of RS blocks per frame
+#define DXWIFI_LDPC_FRAME_SIZE_FOR(blocks) (RSCODE_MAX_MSG_LEN * (blocks))
+
+// Size in bytes of each symbol for a number of RS blocks per frame
+#define DXWIFI_FEC_SYMBOL_SIZE_FOR(blocks) (DXWIFI_LDPC_FRAME_SIZE_FOR(blocks) - sizeof(dxwifi_oti))
+
+// Size of the RS-LDPC frame on the wire for a number of RS blocks per frame
+#define DXWIFI_RS_LDPC_FRAME_SIZE_FOR(blocks) (RSCODE_MAX_LEN * (blocks))
+
 // Total size of the LDPC encoded symbol with OTI
-#define DXWIFI_LDPC_FRAME_SIZE (RSCODE_MAX_MSG_LEN * DXWIFI_RSCODE_BLOCKS_PER_FRAME)
+#define DXWIFI_LDPC_FRAME_SIZE DXWIFI_LDPC_FRAME_SIZE_FOR(DXWIFI_RSCODE_BLOCKS_PER_FRAME)
 
 // Size in bytes of each symbol
-#define DXWIFI_FEC_SYMBOL_SIZE (DXWIFI_LDPC_FRAME_SIZE - sizeof(dxwifi_oti))
+#define DXWIFI_FEC_SYMBOL_SIZE DXWIFI_FEC_SYMBOL_SIZE_FOR(DXWIFI_RSCODE_BLOCKS_PER_FRAME)
 
 // Total size of the LDPC encoded symbol with RS encoding and OTI
-#define DXWIFI_RS_LDPC_FRAME_SIZE ((DXWIFI_RSCODE_BLOCKS_PER_FRAME * RSCODE_NPAR) + DXWIFI_LDPC_FRAME_SIZE)
+#define DXWIFI_RS_LDPC_FRAME_SIZE DXWIFI_RS_LDPC_FRAME_SIZE_FOR(DXWIFI_RSCODE_BLOCKS_PER_FRAME)
+
+// Largest FEC symbol and RS-LDPC frame
+#define DXWIFI_FEC_SYMBOL_SIZE_MAX DXWIFI_FEC_SYMBOL_SIZE_FOR(DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX)
+#define DXWIFI_RS_LDPC_FRAME_SIZE_MAX DXWIFI_RS_LDPC_FRAME_SIZE_FOR(DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX)
+
+// Fewest frames an RS codeword can be interleaved across and still fill in a
+// whole lost frame with erasure decoding, fewer only spreads the damage
+#define DXWIFI_FEC_INTERLEAVE_DEPTH_MIN ((RSCODE_MAX_LEN + RSCODE_NPAR - 1) / RSCODE_NPAR)
+
+// Most consecutive frames an RS codeword can be interleaved across
+#define DXWIFI_FEC_INTERLEAVE_DEPTH_MAX 16
 
 // https://tools.ietf.org/html/rfc6816 - N1 definition
 #define DXWIFI_LDPC_N1_MAX 10
@@ -48,6 +74,19 @@
  *  Data structures
  ***********************/
 
+/**
+ *  OpenFEC codecs an object can be encoded with. The ID is carried in the OTI
+ *  so the decoder knows which one to use.
+ */
+typedef enum {
+    DXWIFI_FEC_CODEC_LDPC_STAIRCASE = 0,    /* LDPC-Staircase, any N and K      */
+    DXWIFI_FEC_CODEC_RS_GF_2_8      = 1,    /* Reed Solomon, N <= 255           */
+    DXWIFI_FEC_CODEC_2D_PARITY      = 2,    /* Row and column parity, K <= 16   */
+    DXWIFI_FEC_CODEC_COUNT,
+    DXWIFI_FEC_CODEC_AUTO           = 0xFF  /* Choose from N and K              */
+} dxwifi_fec_codec_t;
+
+
 /** 
  *  The OTI header (Object Transmission Info) stores important parameters 
  *  regarding how the message was encoded. Since these parameters are critical
@@ -59,24 +98,30 @@ typedef struct __attribute__((packed)) {
     uint16_t n;     /* Total number of symbols      */
     uint16_t k;     /* Number of source symbols     */
     uint16_t rem;   /* Length of Kth symbol         */
+    uint8_t codec;  /* dxwifi_fec_codec_t           */
+    uint8_t blocks; /* RS blocks per frame          */
+    uint8_t depth;  /* Interleave depth in frames   */
     uint32_t crc;   /* Computed CRC of the symbol   */
 } dxwifi_oti; 
-compiler_assert(sizeof(dxwifi_oti) == 12, "Mismatch in actual OTI size and calculated size");
+compiler_assert(sizeof(dxwifi_oti) == 15, "Mismatch in actual OTI size and calculated size");
 compiler_assert(65536 > OFEC_MAX_SYMBOLS, "Max number of symbols exceed storage capacity of uint16_t");
 
 
 /**
- *  The LDPC (Low Density Parity Check) frame is an LDPC encoded block of size 
- *  `DXWIFI_FEC_SYMBOL_SIZE` of the original raw message. LDPC Frame can be 
- *  either a source symbol or a repair symbol. If `oti.esi` is greater than 
- *  `oti.k` then it is a repair symbol. 
+ *  The LDPC (Low Density Parity Check) frame is an LDPC encoded block of the 
+ *  original raw message. LDPC Frame can be either a source symbol or a repair 
+ *  symbol. If `oti.esi` is greater than `oti.k` then it is a repair symbol. 
+ * 
+ *  The symbol is `DXWIFI_FEC_SYMBOL_SIZE_FOR(oti.blocks)` bytes long, only a
+ *  frame with the most blocks fills the array. Frames are laid out back to 
+ *  back with a stride of `DXWIFI_LDPC_FRAME_SIZE_FOR(oti.blocks)`.
  */
 typedef struct __attribute__((packed)) {
     dxwifi_oti oti;     /* Object Transmission Info */
-    uint8_t symbol[DXWIFI_FEC_SYMBOL_SIZE]; 
+    uint8_t symbol[DXWIFI_FEC_SYMBOL_SIZE_MAX]; 
                         /* Actual symbol data       */
 } dxwifi_ldpc_frame;
-compiler_assert(sizeof(dxwifi_ldpc_frame) == DXWIFI_LDPC_FRAME_SIZE, "Mismatch in actual LDPC Frame size and calculated size");
+compiler_assert(sizeof(dxwifi_ldpc_frame) == DXWIFI_LDPC_FRAME_SIZE_FOR(DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX), "Mismatch in actual LDPC Frame size and calculated size");
 
 
 /**
@@ -90,14 +135,41 @@ compiler_assert(sizeof(dxwifi_rs_block) == RSCODE_MAX_LEN, "Mismatch in actual R
 
 
 /**
- *  The RS_LDPC is the LDPC encoded symbol that has been fragmented into 5 
- *  chunks of size `RSCODE_MAX_MSG_LEN` and then Reed Solomon encoded with 
- *  `RSCODE_NPAR` parity bits.
+ *  The RS_LDPC is the LDPC encoded symbol that has been fragmented into 
+ *  `oti.blocks` chunks of size `RSCODE_MAX_MSG_LEN` and then Reed Solomon 
+ *  encoded with `RSCODE_NPAR` parity bits. Like the LDPC frame only the first
+ *  `oti.blocks` blocks are present.
  */
 typedef struct __attribute__((packed)) {
-    dxwifi_rs_block blocks[DXWIFI_RSCODE_BLOCKS_PER_FRAME];
+    dxwifi_rs_block blocks[DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX];
 } dxwifi_rs_ldpc_frame;
-compiler_assert(sizeof(dxwifi_rs_ldpc_frame) == DXWIFI_RS_LDPC_FRAME_SIZE, "Mismatch in actual RS-LDPC Frame size and calculated size");
+compiler_assert(sizeof(dxwifi_rs_ldpc_frame) == DXWIFI_RS_LDPC_FRAME_SIZE_MAX, "Mismatch in actual RS-LDPC Frame size and calculated size");
+compiler_assert(sizeof(dxwifi_oti) <= RSCODE_MAX_MSG_LEN, "The OTI must fit in the first RS block");
+
+
+/**
+ *  Parameters an object is encoded with. Everything the decoder needs is 
+ *  carried in the OTI.
+ */
+typedef struct {
+    float coderate;                 /* Source symbols per encoding symbol   */
+    dxwifi_fec_codec_t codec;       /* Codec or DXWIFI_FEC_CODEC_AUTO       */
+    uint8_t frame_blocks;           /* RS blocks per frame, 1 to 
+                                       DXWIFI_RSCODE_BLOCKS_PER_FRAME_MAX   */
+    uint8_t interleave_depth;       /* Frames each RS codeword is spread 
+                                       across, 1 or 
+                                       DXWIFI_FEC_INTERLEAVE_DEPTH_MIN to
+                                       DXWIFI_FEC_INTERLEAVE_DEPTH_MAX      */
+} dxwifi_fec_params;
+
+
+#define DXWIFI_FEC_PARAMS_DFLT_INITIALIZER {\
+    .coderate           = 0.667,\
+    .codec              = DXWIFI_FEC_CODEC_AUTO,\
+    .frame_blocks       = DXWIFI_RSCODE_BLOCKS_PER_FRAME,\
+    .interleave_depth   = 1\
+}\
+
 
 
 /**
@@ -108,8 +180,52 @@ typedef enum {
     FEC_ERROR_BELOW_N1_MIN          = -2,
     FEC_ERROR_NO_OTI_FOUND          = -3,
     FEC_ERROR_DECODE_NOT_POSSIBLE   = -4,
+    FEC_ERROR_OUTPUT_UNAVAILABLE    = -5,
+    FEC_ERROR_UNSUPPORTED_CODEC     = -6,
 } dxwifi_fec_error_t;
 
+
+/**
+ *  Stages of the encode and decode pipelines timed by dxwifi_fec_stats. Each
+ *  stage's time excludes the stages nested inside it.
+ */
+typedef enum {
+    DXWIFI_FEC_STAGE_SETUP = 0,     /* OpenFEC session creation and config  */
+    DXWIFI_FEC_STAGE_SOURCE,        /* Copying source symbols, their CRCs   */
+    DXWIFI_FEC_STAGE_REPAIR,        /* Building repair symbols, their CRCs  */
+    DXWIFI_FEC_STAGE_RS_ENCODE,     /* Reed Solomon encoding                */
+    DXWIFI_FEC_STAGE_INTERLEAVE,    /* Interleaving or deinterleaving       */
+    DXWIFI_FEC_STAGE_GEOMETRY,      /* Probing the frame geometry           */
+    DXWIFI_FEC_STAGE_RS_DECODE,     /* Reed Solomon correction              */
+    DXWIFI_FEC_STAGE_OTI_SEARCH,    /* CRC checks searching for an OTI      */
+    DXWIFI_FEC_STAGE_PLACE,         /* Placing intact source symbols        */
+    DXWIFI_FEC_STAGE_IT_DECODE,     /* OpenFEC iterative decoding           */
+    DXWIFI_FEC_STAGE_ML_DECODE,     /* OpenFEC maximum likelihood decoding  */
+    DXWIFI_FEC_STAGE_COPY,          /* Moving ML solved symbols in place    */
+    DXWIFI_FEC_STAGE_COUNT
+} dxwifi_fec_stage_t;
+
+
+/**
+ *  What an encode or decode did and where its time went
+ */
+typedef struct {
+    uint64_t stage_ns[DXWIFI_FEC_STAGE_COUNT];
+                                    /* Time spent in each stage                 */
+    uint64_t total_ns;              /* Time for the whole call                  */
+    uint16_t n;                     /* Encoding symbols in the object           */
+    uint16_t k;                     /* Source symbols in the object             */
+    uint32_t symbols_fed;           /* Encode: source symbols given to OpenFEC,
+                                       Decode: symbols given to OpenFEC         */
+    uint32_t symbols_placed;        /* Decode: intact source symbols placed 
+                                       before any LDPC decoding                 */
+    uint32_t rs_codewords;          /* Decode: RS codewords checked             */
+    uint32_t rs_corrections;        /* Decode: RS codewords that were corrected */
+    uint32_t rs_failures;           /* Decode: RS codewords beyond repair       */
+    bool systematic;                /* Decode: LDPC decoding was skipped        */
+    bool ml_decoding;               /* Decode: ML decoding ran                  */
+} dxwifi_fec_stats;
+
 /************************
  *  Functions
  ***********************/
@@ -144,12 +260,203 @@ ssize_t dxwifi_encode(void *message, size_t msglen, float coderate, void **out);
 
 
 /**
- *  DESCRIPTION:  TODO
+ *  DESCRIPTION:        FEC Encodes a message with a specific codec
+ * 
+ *  ARGUMENTS:
+ *      
+ *      message:        Message data to be encoded
+ * 
+ *      msglen:         Size of the message in bytes
+ *
+ *      coderate:       Rate at which to add repair symbols for each source symbol
+ * 
+ *      codec:          Codec to encode with, `DXWIFI_FEC_CODEC_AUTO` chooses 
+ *                      one from N and K
+ * 
+ *      out:            Pointer to a void pointer which will contain the encoded
+ *                      message on function return. 
+ * 
+ *  RETURNS:
+ * 
+ *      ssize_t:         Size of the encoded message in bytes or dxwifi_fec_error
+ * 
+ *  NOTES:
+ * 
+ *      dxwifi_encode() is this with `DXWIFI_FEC_CODEC_AUTO`. Automatic choice 
+ *      takes RS GF(2^8) when N <= 255 and LDPC-Staircase otherwise. The 2D 
+ *      parity matrix is pure XOR but not MDS, some losses RS survives cost it
+ *      the object, so it is only used when asked for here. A 2D parity 
+ *      geometry exists only when N-K is exactly a row plus a column of parity
+ *      over K, `FEC_ERROR_UNSUPPORTED_CODEC` is returned when the codec can't
+ *      take N and K.
+ * 
+ */
+ssize_t dxwifi_encode_with_codec(void *message, size_t msglen, float coderate, dxwifi_fec_codec_t codec, void **out);
+
+
+/**
+ *  DESCRIPTION:        FEC Encodes a message with a full set of parameters
+ * 
+ *  ARGUMENTS:
+ *      
+ *      message:        Message data to be encoded
+ * 
+ *      msglen:         Size of the message in bytes
+ *
+ *      params:         Coderate, codec and frame geometry
+ * 
+ *      out:            Pointer to a void pointer which will contain the encoded
+ *                      message on function return. 
+ * 
+ *      stats:          Filled with the stats of this encode, NULL skips them
+ *                      and the clock reads they need
+ * 
+ *  RETURNS:
+ * 
+ *      ssize_t:        Size of the encoded message in bytes or dxwifi_fec_error
+ * 
+ *  NOTES:
+ * 
+ *      The encoded message is a sequence of RS-LDPC frames of
+ *      `DXWIFI_RS_LDPC_FRAME_SIZE_FOR(params->frame_blocks)` bytes. Larger 
+ *      frames spend less airtime on per frame preambles and headers at OFDM 
+ *      rates, smaller frames lose less data to each corrupted frame. The 
+ *      decoder reads the geometry back from the OTI.
+ * 
+ *      With an interleave depth D above 1 the RS codewords of each group of D
+ *      frames are spread byte by byte across all D frames, so a lost frame 
+ *      costs every codeword of its group about 255/D erasures instead of 
+ *      taking whole codewords with it. RS(255,223) fills 32 erasures, D=8 
+ *      rebuilds one lost frame per group and D=16 two, before any LDPC repair
+ *      symbol is spent. A group that loses more is lost whole, so this pays 
+ *      off when frames are lost well under 1 in 8. N is rounded up to a 
+ *      multiple of D. The decoder needs lost frames kept in place, receive 
+ *      with `--ordered --add-noise`.
+ * 
+ */
+ssize_t dxwifi_encode_with_params(void *message, size_t msglen, const dxwifi_fec_params* params, void **out, dxwifi_fec_stats* stats);
+
+
+/**
+ *  DESCRIPTION:        Returns the printable name of a codec
+ * 
+ */
+const char* dxwifi_fec_codec_to_str(dxwifi_fec_codec_t codec);
+
+
+/**
+ *  DESCRIPTION:        FEC Decodes a message encoded by dxwifi_encode()
+ * 
+ *  ARGUMENTS:
+ *      
+ *      encoded_message: Encoded message data, the RS blocks are corrected in
+ *                       place unless the message is interleaved
+ * 
+ *      msglen:         Size of the encoded message in bytes
+ * 
+ *      out:            Pointer to a void pointer which will contain the decoded
+ *                      message on function return. The caller frees it, it is
+ *                      set to NULL when decoding fails.
+ * 
+ *  RETURNS:
+ * 
+ *      ssize_t:        Size of the decoded message in bytes or one of:
+ * 
+ *      FEC_ERROR_NO_OTI_FOUND:         No frame had an intact OTI
+ *      FEC_ERROR_UNSUPPORTED_CODEC:    The OTI names a codec or N and K this
+ *                                      build can't decode
+ *      FEC_ERROR_OUTPUT_UNAVAILABLE:   The output buffer couldn't be allocated
+ *      FEC_ERROR_DECODE_NOT_POSSIBLE:  Too few symbols arrived to rebuild
+ *                                      every source symbol
+ * 
+ *  NOTES:
+ * 
+ *      The frame geometry and codec are read back from the OTI, so the decoder
+ *      needs no parameters. Each frame is RS corrected, then its symbol is 
+ *      only used if its CRC matches the one in its OTI. Frames that fail the
+ *      check count as lost and are never handed to the codec, erasure 
+ *      decoding doesn't correct errors.
+ * 
+ *      This is dxwifi_decode_with_stats() without stats. Pass a 
+ *      dxwifi_fec_stats to that one to get the stage timings and what the 
+ *      decode did, they are filled in for each call.
+ * 
+ *      A decode takes the systematic fast path when every source ESI arrives 
+ *      in a frame whose CRC matches its OTI. The source symbols are written out
+ *      in order and no OpenFEC session is created, repair frames aren't even 
+ *      RS decoded. The systematic flag of dxwifi_fec_stats says whether a 
+ *      decode took it.
  * 
  */
 ssize_t dxwifi_decode(void* encoded_message, size_t msglen, void** out);
 
 
+/**
+ *  DESCRIPTION:        dxwifi_decode() that also reports what the decode did
+ * 
+ *  ARGUMENTS:
+ * 
+ *      stats:          Filled with the stats of this decode, NULL skips them
+ *                      and the clock reads they need
+ * 
+ */
+ssize_t dxwifi_decode_with_stats(void* encoded_message, size_t msglen, void** out, dxwifi_fec_stats* stats);
+
+
+/**
+ *  DESCRIPTION:        Returns the printable name of a stage
+ * 
+ */
+const char* dxwifi_fec_stage_to_str(dxwifi_fec_stage_t stage);
+
+
+/**
+ *  DESCRIPTION:        Writes FEC stats as a human readable table
+ * 
+ *  ARGUMENTS:
+ * 
+ *      stream:         Where the stats are written
+ * 
+ *      stats:          Stats of an encode or decode
+ * 
+ *  NOTES:
+ * 
+ *      Only stages that took time are listed
+ * 
+ */
+void dxwifi_write_fec_stats(FILE* stream, const dxwifi_fec_stats* stats);
+
+
+/**
+ *  DESCRIPTION:        FEC Decodes a message and appends it to a file
+ * 
+ *  ARGUMENTS:
+ *      
+ *      encoded_message: Encoded message data, the RS blocks are corrected in
+ *                       place unless the message is interleaved
+ * 
+ *      msglen:         Size of the encoded message in bytes
+ *
+ *      fd:             Output file descriptor
+ *
+ *      stats:          Filled with the stats of this decode, may be NULL
+ * 
+ *  RETURNS:
+ * 
+ *      ssize_t:        Size of the decoded message in bytes or dxwifi_fec_error
+ * 
+ *  NOTES:
+ * 
+ *      When fd is a regular file opened O_RDWR the decoded message is written 
+ *      in place: the file is extended with fallocate, mapped, and OpenFEC puts
+ *      received and rebuilt source symbols at their final offsets. Otherwise
+ *      the message is decoded in memory and written out. Nothing is appended 
+ *      if decoding fails.
+ * 
+ */
+ssize_t dxwifi_decode_to_file(void* encoded_message, size_t msglen, int fd, dxwifi_fec_stats* stats);
+
+
 /**
  *  DESCRIPTION:  TODO
  * 
@@ -7,14 +7,24 @@
  * 
  */
 
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_RECEIVER
+
 #include <string.h>
 
 #include <time.h>
 #include <poll.h>
 #include <errno.h>
+#include <signal.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
 
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
 #include <arpa/inet.h>
+#include <sys/eventfd.h>
 
 #include <libdxwifi/dxwifi.h>
 #include <libdxwifi/receiver.h>
@@ -22,18 +32,75 @@
 #include <libdxwifi/details/heap.h>
 #include <libdxwifi/details/crc32.h>
 #include <libdxwifi/details/assert.h>
+#include <libdxwifi/details/probes.h>
 #include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/metrics.h>
+#include <libdxwifi/details/byte_count.h>
+#include <libdxwifi/details/shm_status.h>
+#include <libdxwifi/details/frame_ring.h>
+#include <libdxwifi/details/pcap_utils.h>
+
+
+// Enough nodes for a packet buffer full of the smallest data frames
+#define DXWIFI_RX_PACKET_HEAP_CAPACITY ((DXWIFI_RX_PACKET_BUFFER_SIZE_MAX / DXWIFI_TX_PAYLOAD_SIZE_MIN) + 1)
+
+// Largest frame the capture ring will store. Fits the 802.11 MTU with room for
+// the radiotap and MAC headers, anything larger is truncated.
+#define DXWIFI_RX_RING_SLOT_DATA_MAX 4096
+
+// Captured data frame with room for the radiotap header, MAC header and FCS
+#define DXWIFI_RX_EXPECTED_FRAME_SIZE (DXWIFI_TX_BLOCKSIZE + 128)
+
+// How long the kernel buffer should absorb traffic when sized from frame_rate
+#define DXWIFI_RX_BUFFER_STALL_MS 1000
 
+// Percentage of a control frame's payload that must match a control value
+#define DXWIFI_RX_CONTROL_FRAME_THRESHOLD 66
 
-#define DXWIFI_RX_PACKET_HEAP_CAPACITY ((DXWIFI_RX_PACKET_BUFFER_SIZE_MAX / DXWIFI_TX_BLOCKSIZE) + 1)
+// Max iovecs per writev() call, matches the Linux UIO_MAXIOV limit
+#define DXWIFI_RX_IOV_BATCH 1024
 
 typedef struct {
     int32_t     frame_number;   /* Number of the frame was sent with          */
     uint8_t*    data;           /* pointer to data inside the packet buffer   */
+    uint32_t    size;           /* Size of the payload data                   */
     bool        crc_valid;      /* Was the attached crc correct?              */
 } packet_heap_node;
 
 
+/**
+ *  Each slot in the capture ring holds the pcap header followed by the frame
+ */
+typedef struct {
+    struct pcap_pkthdr  pkt_stats;      /* Capture info, caplen is the copied size*/
+    uint8_t             data[];         /* Copy of the captured frame             */
+} ring_frame;
+
+
+/**
+ *  Capture thread state. The capture thread is the only producer and the thread
+ *  in receiver_activate_capture() is the only consumer of the frame ring. The
+ *  semaphores are only touched when one side has to sleep, see wait_for_frame()
+ *  and wait_for_slot().
+ */
+struct __dxwifi_rx_capture {
+    frame_ring          ring;           /* Frames waiting to be processed         */
+    size_t              max_caplen;     /* Max frame size that fits in a slot     */
+    dxwifi_receiver*    rx;             /* Owning receiver                        */
+    pthread_t           thread;         /* Runs capture_frames()                  */
+    pthread_mutex_t     handle_lock;    /* Serializes access to the pcap handle   */
+    int                 shutdown_fd;    /* Wakes the capture thread on close      */
+    atomic_bool         shutdown;       /* Capture thread should exit?            */
+    atomic_bool         finished;       /* Capture thread has exited?             */
+    atomic_int          end_state;      /* Why the capture thread exited          */
+    atomic_uint         full_count;     /* Times the capture thread found ring full*/
+    atomic_bool         worker_waiting; /* Consumer sleeping on frame_ready?      */
+    atomic_bool         capture_waiting;/* Producer sleeping on slot_ready?       */
+    sem_t               frame_ready;    /* Posted when a sleeping consumer can go */
+    sem_t               slot_ready;     /* Posted when a sleeping producer can go */
+};
+
+
 /**
  *  Frame controller handles intra-capture state and contains flags that the 
  *  receiver uses to determine when to stop processing packets
@@ -48,7 +115,9 @@ typedef struct {
     bool                    end_capture;    /* eot && preamble?               */
     const dxwifi_receiver*  rx;             /* Reference to owning receiver   */
     dxwifi_rx_stats         rx_stats;       /* Capture statistics             */
+    dxwifi_rx_radiotap_layout rtap_layout;  /* Learned radiotap layout        */
     int                     fd;             /* Sink to write out data         */
+    bool                    sparse_noise;   /* Seek over zero noise blocks?   */
 } frame_controller;
 
 /**
@@ -87,6 +156,52 @@ static uint32_t extract_frame_number(const ieee80211_hdr* mac_hdr) {
 }
 
 
+/**
+ *  DESCRIPTION:    Checks if a payload is a whole number of RS blocks that fits
+ *                  in a data frame
+ * 
+ *  ARGUMENTS:
+ * 
+ *      payload_size: Size of the frame payload
+ * 
+ *  NOTES: The number of RS blocks per frame is chosen per object by the
+ *  transmitter. Control frames are never a multiple of the RS block size.
+ * 
+ */
+static bool is_data_payload_size(size_t payload_size) {
+    return DXWIFI_TX_PAYLOAD_SIZE_MIN <= payload_size 
+        && payload_size <= DXWIFI_TX_PAYLOAD_SIZE_MAX
+        && payload_size % RSCODE_MAX_LEN == 0;
+}
+compiler_assert(DXWIFI_FRAME_CONTROL_SIZE % RSCODE_MAX_LEN != 0, "Control frames must not look like data frames");
+
+
+/**
+ *  DESCRIPTION:    Checks if skipping ahead in the sink leaves a zero filled
+ *                  hole instead of failing or being ignored
+ * 
+ *  ARGUMENTS:
+ * 
+ *      fd:         Sink to write out data to
+ * 
+ *  RETURNS:
+ * 
+ *      bool:       true if fd is a regular file, positioned at its end and not
+ *                  opened for appending
+ * 
+ */
+static bool sink_supports_holes(int fd) {
+    struct stat info;
+    int flags = fcntl(fd, F_GETFL);
+
+    // Appends ignore the file offset and seeking over old data won't zero it
+    return fstat(fd, &info) == 0 
+        && S_ISREG(info.st_mode) 
+        && flags >= 0 && !(flags & O_APPEND) 
+        && lseek(fd, 0, SEEK_CUR) == info.st_size;
+}
+
+
 /**
  *  DESCRIPTION:    Initializes and allocates any frame controller resources
  * 
@@ -105,12 +220,14 @@ static void init_frame_controller(frame_controller* fc, const dxwifi_receiver* r
     fc->index           = 0;
     fc->rx              = rx;
     fc->fd              = fd;
+    fc->sparse_noise    = rx->add_noise && rx->noise_value == 0x00 && sink_supports_holes(fd);
     fc->end_capture     = 0;
     fc->eot_reached     = false;
     fc->preamble_recv   = false;
     fc->pb_size         = rx->packet_buffer_size;
 
     memset(&fc->rx_stats, 0x00, sizeof(dxwifi_rx_stats));
+    memset(&fc->rtap_layout, 0x00, sizeof(dxwifi_rx_radiotap_layout));
     fc->rx_stats.capture_state = DXWIFI_RX_NORMAL;
     
     fc->packet_buffer = calloc(fc->pb_size, sizeof(uint8_t));
@@ -187,6 +304,10 @@ static dxwifi_rx_frame parse_rx_frame_fields(const struct pcap_pkthdr* pkt_stats
 static void log_frame_stats(dxwifi_rx_frame* frame, int32_t frame_no, dxwifi_rx_stats* rx_stats) {
     debug_assert(frame && rx_stats);
 
+    if(!log_enabled(DXWIFI_LOG_DEBUG)) {
+        return;
+    }
+
     char timestamp[256];
     struct tm *time;
 
@@ -214,56 +335,44 @@ static void log_frame_stats(dxwifi_rx_frame* frame, int32_t frame_no, dxwifi_rx_
  * 
  *      pkt_stats:  Information about the current capture
  * 
- *      check_threshold: Percentage of data that must match with a control data
- *                       value for us to consider this frame as a "control frame"
+ *      check_threshold: Percentage (0-100) of data that must match with a control
+ *                       data value for us to consider this frame as a "control frame"
  * 
  *  RETURNS:
  *      dxwifi_control_frame_t: The type of the control frame
  *  
  */
-static dxwifi_control_frame_t check_frame_control(const uint8_t* frame, const struct pcap_pkthdr* pkt_stats, float check_threshold) {
+static dxwifi_control_frame_t check_frame_control(const uint8_t* frame, const struct pcap_pkthdr* pkt_stats, unsigned check_threshold) {
     // Get info we need from the raw data frame
     const ieee80211_radiotap_hdr* rtap = (const ieee80211_radiotap_hdr*)frame;
-    const uint8_t* payload = frame + rtap->it_len + sizeof(ieee80211_hdr);
 #if defined(DXWIFI_TESTS)
-    size_t payload_size = pkt_stats->caplen - rtap->it_len - sizeof(ieee80211_hdr);
+    size_t overhead = rtap->it_len + sizeof(ieee80211_hdr);
 #else
-    size_t payload_size = pkt_stats->caplen - rtap->it_len - sizeof(ieee80211_hdr) - IEEE80211_FCS_SIZE;
+    size_t overhead = rtap->it_len + sizeof(ieee80211_hdr) + IEEE80211_FCS_SIZE;
 #endif
 
-    unsigned eot                = 0;
-    unsigned preamble           = 0;
-    dxwifi_control_frame_t type = DXWIFI_CONTROL_FRAME_NONE;
-
-    if(payload_size == DXWIFI_FRAME_CONTROL_SIZE) {
-        type = DXWIFI_CONTROL_FRAME_UNKNOWN;
-        for(size_t i = 0; i < DXWIFI_TX_PAYLOAD_SIZE; ++i) {
-            switch (payload[i])
-            {
-            case DXWIFI_CONTROL_FRAME_PREAMBLE:
-                ++preamble;
-                break;
-            
-            case DXWIFI_CONTROL_FRAME_EOT:
-                ++eot;
-                break;
-
-            default:
-                break;
-            }
-        } 
-        if(((float)eot / payload_size) > check_threshold) {
-            type = DXWIFI_CONTROL_FRAME_EOT;
-        }
-        else if (((float)preamble / payload_size) > check_threshold) {
-            type = DXWIFI_CONTROL_FRAME_PREAMBLE;
-        }
+    // Data frames are the common case, classify them by length alone
+    if(pkt_stats->caplen > overhead && is_data_payload_size(pkt_stats->caplen - overhead)) {
+        return DXWIFI_CONTROL_FRAME_NONE;
     }
     // Payload size is incorrect, do not process frame
-    else if(payload_size != DXWIFI_TX_PAYLOAD_SIZE) {
-        type = DXWIFI_CONTROL_FRAME_UNKNOWN;
+    if(pkt_stats->caplen != overhead + DXWIFI_FRAME_CONTROL_SIZE) {
+        return DXWIFI_CONTROL_FRAME_UNKNOWN;
+    }
+
+    const uint8_t* payload = frame + rtap->it_len + sizeof(ieee80211_hdr);
+
+    size_t eot      = 0;
+    size_t preamble = 0;
+    count_byte_pair(payload, DXWIFI_FRAME_CONTROL_SIZE, DXWIFI_CONTROL_FRAME_EOT, DXWIFI_CONTROL_FRAME_PREAMBLE, &eot, &preamble);
+
+    if(eot * 100 > check_threshold * DXWIFI_FRAME_CONTROL_SIZE) {
+        return DXWIFI_CONTROL_FRAME_EOT;
     }
-    return type;
+    else if(preamble * 100 > check_threshold * DXWIFI_FRAME_CONTROL_SIZE) {
+        return DXWIFI_CONTROL_FRAME_PREAMBLE;
+    }
+    return DXWIFI_CONTROL_FRAME_UNKNOWN;
 }
 
 
@@ -319,18 +428,91 @@ static void handle_frame_control(frame_controller* fc, dxwifi_control_frame_t ty
 }
 
 
+/**
+ *  DESCRIPTION:    Writes out a batch of queued blocks, retrying on partial 
+ *                  writes
+ * 
+ *  ARGUMENTS:
+ * 
+ *      fc:         Frame controller with an open sink
+ * 
+ *      iov:        Queued blocks, consumed by the write
+ * 
+ *      iovcnt:     Number of queued blocks
+ * 
+ *      noise:      Noise block, used to tell noise apart from payload data
+ * 
+ */
+static void flush_blocks(frame_controller* fc, struct iovec* iov, int iovcnt, const uint8_t* noise) {
+    debug_assert(fc && iov);
+
+    while(iovcnt > 0) {
+        ssize_t nbytes = writev(fc->fd, iov, iovcnt);
+        if(nbytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if(nbytes <= 0) {
+            log_error("Failed to write %d blocks: %s", iovcnt, strerror(errno));
+            return;
+        }
+
+        // Credit whole and partially written blocks to the right counter
+        while(iovcnt > 0 && nbytes > 0) {
+            size_t written = (size_t)nbytes < iov->iov_len ? (size_t)nbytes : iov->iov_len;
+
+            if(iov->iov_base == noise) {
+                fc->rx_stats.total_noise_added += written;
+                metric_add(&__dxwifi_rx_metrics.noise_bytes, written);
+            }
+            else {
+                fc->rx_stats.total_writelen += written;
+                metric_add(&__dxwifi_rx_metrics.written_bytes, written);
+            }
+
+            nbytes -= written;
+            if(written == iov->iov_len) {
+                ++iov;
+                --iovcnt;
+            }
+            else {
+                iov->iov_base = (uint8_t*)iov->iov_base + written;
+                iov->iov_len -= written;
+            }
+        }
+    }
+}
+
+
 /**
  *  DESCRIPTION:    Write all the payload data received into a sink
  * 
  *  ARGUMENTS:
  * 
  *      fc:         Frame controller with allocated packet buffer
+ * 
+ *  NOTES: Blocks are queued up and written out with as few writev() calls as
+ *  possible. When noise is zero and the sink is a regular file, missing blocks
+ *  are seeked over so the file system leaves them as sparse holes.
  *  
  */
 static void dump_packet_buffer(frame_controller* fc) {
     debug_assert(fc);
 
-    int nbytes = 0;
+    struct iovec iov[DXWIFI_RX_IOV_BATCH];
+    int iovcnt = 0;
+
+    // Every missing block points at the same noise buffer. Frames of one 
+    // object share a size, so missing blocks take the size of the next block.
+    uint8_t noise[DXWIFI_TX_PAYLOAD_SIZE_MAX];
+    if(fc->rx->add_noise && !fc->sparse_noise) {
+        memset(noise, fc->rx->noise_value, sizeof(noise));
+    }
+
+    dxwifi_probe2(buffer_flush_entry, fc->packet_heap.count, fc->index);
+
+    uint32_t blocks_written = 0;
+    uint32_t blocks_lost    = 0;
+
     packet_heap_node node;
     int32_t expected_frame = ((packet_heap_node*)fc->packet_heap.tree)->frame_number;
 
@@ -341,29 +523,62 @@ static void dump_packet_buffer(frame_controller* fc) {
 
             int missing_blocks = (node.frame_number - expected_frame);
 
-            if(fc->rx->add_noise) {
-                uint8_t noise[DXWIFI_TX_PAYLOAD_SIZE];
-
-                memset(noise, fc->rx->noise_value, sizeof(noise));
+            if(fc->sparse_noise) {
+                flush_blocks(fc, iov, iovcnt, noise);
+                iovcnt = 0;
 
+                off_t hole = (off_t)missing_blocks * node.size;
+                if(lseek(fc->fd, hole, SEEK_CUR) < 0) {
+                    log_error("Failed to skip %d missing blocks: %s", missing_blocks, strerror(errno));
+                }
+                else {
+                    fc->rx_stats.total_noise_added += hole;
+                    metric_add(&__dxwifi_rx_metrics.noise_bytes, hole);
+                }
+            }
+            else if(fc->rx->add_noise) {
                 for(int i = 0; i < missing_blocks; ++i) {
-                    fc->rx_stats.total_noise_added += write(fc->fd, noise, sizeof(noise));
+                    if(iovcnt == DXWIFI_RX_IOV_BATCH) {
+                        flush_blocks(fc, iov, iovcnt, noise);
+                        iovcnt = 0;
+                    }
+                    iov[iovcnt++] = (struct iovec){ .iov_base = noise, .iov_len = node.size };
                 }
             }
 
+            blocks_lost                    += missing_blocks;
             fc->rx_stats.total_blocks_lost += missing_blocks;
+            metric_add(&__dxwifi_rx_metrics.blocks_lost, missing_blocks);
+            status_blocks_lost(missing_blocks);
         }
 
-        nbytes = write(fc->fd, node.data, DXWIFI_TX_PAYLOAD_SIZE);
-        debug_assert_continue(nbytes == DXWIFI_TX_PAYLOAD_SIZE, "Partial write: %d - %s", nbytes, strerror(errno));
+        if(iovcnt == DXWIFI_RX_IOV_BATCH) {
+            flush_blocks(fc, iov, iovcnt, noise);
+            iovcnt = 0;
+        }
+        iov[iovcnt++] = (struct iovec){ .iov_base = node.data, .iov_len = node.size };
+        blocks_written += 1;
 
-        fc->rx_stats.total_writelen += nbytes;
         expected_frame = node.frame_number + 1;
     }
+    flush_blocks(fc, iov, iovcnt, noise);
+
+    dxwifi_probe2(buffer_flush_return, blocks_written, blocks_lost);
+
     fc->index = 0; // Reset the write position and reuse the buffer
 }
 
 
+// Time since pcap stamped the frame, pcap stamps frames with the wall clock
+static int64_t capture_age_ns(const struct pcap_pkthdr* pkt_stats) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    int64_t age = (int64_t)(now.tv_sec - pkt_stats->ts.tv_sec) * 1000000000ll + (now.tv_nsec - (int64_t) pkt_stats->ts.tv_usec * 1000);
+    return age > 0 ? age : 0;
+}
+
+
 /**
  *  DESCRIPTION:    Checks the IEEE header address fields to verify that the 
  *                  packet orignated from OreSat
@@ -411,59 +626,185 @@ static bool verify_sender(const uint8_t* frame, const uint8_t* expected_address,
 }
 
 
-dxwifi_rx_radiotap_hdr parse_radiotap_header(const uint8_t* frame, uint32_t caplen) {
+/**
+ *  DESCRIPTION:    Walks the radiotap header with the radiotap iterator
+ * 
+ *  ARGUMENTS:
+ * 
+ *      frame:      Captured frame beginning with the radiotap header
+ * 
+ *      caplen:     Number of bytes captured
+ * 
+ *      layout:     If not NULL, the field offsets and signature are recorded
+ *                  here and the layout is marked valid if it can be reused
+ * 
+ *  RETURNS:
+ *      
+ *      dxwifi_rx_radiotap_hdr: Parsed fields, missing fields are zeroed
+ *  
+ */
+static dxwifi_rx_radiotap_hdr iterate_radiotap_header(const uint8_t* frame, uint32_t caplen, dxwifi_rx_radiotap_layout* layout) {
     dxwifi_rx_radiotap_hdr rtap;
     memset(&rtap, 0x00, sizeof(dxwifi_rx_radiotap_hdr));
 
+    if(layout) {
+        memset(layout, 0x00, sizeof(dxwifi_rx_radiotap_layout));
+        layout->tsft = layout->flags = layout->channel = layout->rx_flags = -1;
+        layout->mcs = layout->antenna = layout->ant_signal = -1;
+    }
+
     struct ieee80211_radiotap_iterator iter;
     int err = ieee80211_radiotap_iterator_init(&iter, (ieee80211_radiotap_hdr*)frame, caplen, NULL);
     if(err) {
         log_warning("Malformed radiotap header");
-    } else {
-        while(!(err = ieee80211_radiotap_iterator_next(&iter))) {
-            switch (iter.this_arg_index) 
-            {
-            case IEEE80211_RADIOTAP_FLAGS:
-                rtap.flags = *iter.this_arg;
-                break;
+        return rtap;
+    }
 
-            case IEEE80211_RADIOTAP_RX_FLAGS:
-                rtap.rx_flags = get_unaligned_le16((uint16_t*)iter.this_arg);
-                break;
+    while(!(err = ieee80211_radiotap_iterator_next(&iter))) {
+        int16_t* field_offset = NULL;
+
+        switch (iter.this_arg_index) 
+        {
+        case IEEE80211_RADIOTAP_FLAGS:
+            rtap.flags = *iter.this_arg;
+            field_offset = layout ? &layout->flags : NULL;
+            break;
+
+        case IEEE80211_RADIOTAP_RX_FLAGS:
+            rtap.rx_flags = get_unaligned_le16((uint16_t*)iter.this_arg);
+            field_offset = layout ? &layout->rx_flags : NULL;
+            break;
+
+        case IEEE80211_RADIOTAP_CHANNEL:
+            rtap.channel.frequency = get_unaligned_le16((uint16_t*)iter.this_arg);
+            rtap.channel.flags = get_unaligned_le16((uint16_t*)(iter.this_arg + 2));
+            field_offset = layout ? &layout->channel : NULL;
+            break;
+
+        case IEEE80211_RADIOTAP_TSFT:
+            rtap.tsft[0] = get_unaligned_le32((uint32_t*)iter.this_arg);
+            rtap.tsft[1] = get_unaligned_le32((uint32_t*)(iter.this_arg + 4));
+            field_offset = layout ? &layout->tsft : NULL;
+            break;
+
+        case IEEE80211_RADIOTAP_ANTENNA:
+            rtap.antenna = *iter.this_arg;
+            field_offset = layout ? &layout->antenna : NULL;
+            break;
+
+        case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
+            // Convert in decibels difference form 1mW
+            rtap.ant_signal = (*iter.this_arg - 255);
+            field_offset = layout ? &layout->ant_signal : NULL;
+            break;
+
+        case IEEE80211_RADIOTAP_MCS:
+            rtap.mcs.known = *iter.this_arg;
+            rtap.mcs.flags = *(iter.this_arg + 1);
+            rtap.mcs.mcs   = *(iter.this_arg + 2);
+            field_offset = layout ? &layout->mcs : NULL;
+            break;
+
+        default:
+            break;
+        }
 
-            case IEEE80211_RADIOTAP_CHANNEL:
-                rtap.channel.frequency = get_unaligned_le16((uint16_t*)iter.this_arg);
-                rtap.channel.flags = get_unaligned_le16((uint16_t*)(iter.this_arg + 2));
-                break;
+        // Later occurences overwrite earlier ones, same as the parsed fields
+        if(field_offset) {
+            *field_offset = iter.this_arg - frame;
+        }
+    }
 
-            case IEEE80211_RADIOTAP_TSFT:
-                rtap.tsft[0] = get_unaligned_le32((uint32_t*)iter.this_arg);
-                rtap.tsft[1] = get_unaligned_le32((uint32_t*)(iter.this_arg + 4));
+    if(err != -ENOENT) {
+        log_warning("An error occured while parsing the radiotap header");
+    }
+    else if(layout) {
+        // Record the present words, only layouts without vendor data are reusable
+        const uint8_t* word = frame + offsetof(ieee80211_radiotap_hdr, it_present);
+        uint32_t present = 0;
+        bool reusable = true;
+
+        do {
+            present = get_unaligned_le32((uint32_t*)word);
+            if(layout->npresent == DXWIFI_RX_RTAP_PRESENT_WORDS_MAX || (present & (1 << IEEE80211_RADIOTAP_VENDOR_NAMESPACE))) {
+                reusable = false;
                 break;
+            }
+            memcpy(&layout->present[layout->npresent++], word, sizeof(uint32_t));
+            word += sizeof(uint32_t);
+        } while(present & (1 << IEEE80211_RADIOTAP_EXT));
 
-            case IEEE80211_RADIOTAP_ANTENNA:
-                rtap.antenna = *iter.this_arg;
-                break;
+        layout->it_len = get_unaligned_le16((uint16_t*)(frame + offsetof(ieee80211_radiotap_hdr, it_len)));
+        layout->valid  = reusable;
+    }
+    return rtap;
+}
 
-            case IEEE80211_RADIOTAP_DBM_ANTSIGNAL:
-                // Convert in decibels difference form 1mW
-                rtap.ant_signal = (*iter.this_arg - 255);
-                break;
 
-            case IEEE80211_RADIOTAP_MCS:
-                rtap.mcs.known = *iter.this_arg;
-                rtap.mcs.flags = *(iter.this_arg + 1);
-                rtap.mcs.mcs   = *(iter.this_arg + 2);
-                break;
+/**
+ *  DESCRIPTION:    Checks if the frame's radiotap header has the same length 
+ *                  and present words as the learned layout
+ * 
+ *  ARGUMENTS:
+ * 
+ *      layout:     Learned layout
+ * 
+ *      frame:      Captured frame beginning with the radiotap header
+ * 
+ *      caplen:     Number of bytes captured
+ *  
+ */
+static bool radiotap_layout_matches(const dxwifi_rx_radiotap_layout* layout, const uint8_t* frame, uint32_t caplen) {
+    const ieee80211_radiotap_hdr* hdr = (const ieee80211_radiotap_hdr*) frame;
+    size_t present_size = layout->npresent * sizeof(uint32_t);
+
+    return layout->valid
+        && caplen >= layout->it_len
+        && hdr->it_version == IEEE80211_RADIOTAP_MAJOR_VERSION
+        && get_unaligned_le16((uint16_t*)(frame + offsetof(ieee80211_radiotap_hdr, it_len))) == layout->it_len
+        && memcmp(frame + offsetof(ieee80211_radiotap_hdr, it_present), layout->present, present_size) == 0;
+}
 
-            default:
-                break;
-            }
-        }
 
-        if(err != -ENOENT) {
-            log_warning("An error occured while parsing the radiotap header");
-        }
+dxwifi_rx_radiotap_hdr parse_radiotap_header(const uint8_t* frame, uint32_t caplen) {
+    return iterate_radiotap_header(frame, caplen, NULL);
+}
+
+
+dxwifi_rx_radiotap_hdr parse_radiotap_header_cached(dxwifi_rx_radiotap_layout* layout, const uint8_t* frame, uint32_t caplen) {
+    debug_assert(layout && frame);
+
+    if(!radiotap_layout_matches(layout, frame, caplen)) {
+        return iterate_radiotap_header(frame, caplen, layout);
+    }
+
+    dxwifi_rx_radiotap_hdr rtap;
+    memset(&rtap, 0x00, sizeof(dxwifi_rx_radiotap_hdr));
+
+    if(layout->flags >= 0) {
+        rtap.flags = frame[layout->flags];
+    }
+    if(layout->rx_flags >= 0) {
+        rtap.rx_flags = get_unaligned_le16((uint16_t*)(frame + layout->rx_flags));
+    }
+    if(layout->channel >= 0) {
+        rtap.channel.frequency = get_unaligned_le16((uint16_t*)(frame + layout->channel));
+        rtap.channel.flags = get_unaligned_le16((uint16_t*)(frame + layout->channel + 2));
+    }
+    if(layout->tsft >= 0) {
+        rtap.tsft[0] = get_unaligned_le32((uint32_t*)(frame + layout->tsft));
+        rtap.tsft[1] = get_unaligned_le32((uint32_t*)(frame + layout->tsft + 4));
+    }
+    if(layout->antenna >= 0) {
+        rtap.antenna = frame[layout->antenna];
+    }
+    if(layout->ant_signal >= 0) {
+        rtap.ant_signal = (frame[layout->ant_signal] - 255);
+    }
+    if(layout->mcs >= 0) {
+        rtap.mcs.known = frame[layout->mcs];
+        rtap.mcs.flags = frame[layout->mcs + 1];
+        rtap.mcs.mcs   = frame[layout->mcs + 2];
     }
     return rtap;
 }
@@ -486,30 +827,36 @@ static void process_frame(uint8_t* args, const struct pcap_pkthdr* pkt_stats, co
     frame_controller* fc = (frame_controller*) args;
 
     if(verify_sender(frame, fc->rx->sender_addr, fc->rx->max_hamming_dist)) {
-        dxwifi_control_frame_t ctrl_frame = check_frame_control(frame, pkt_stats, 0.66);
+        dxwifi_control_frame_t ctrl_frame = check_frame_control(frame, pkt_stats, DXWIFI_RX_CONTROL_FRAME_THRESHOLD);
 
         if(ctrl_frame == DXWIFI_CONTROL_FRAME_UNKNOWN) {
             // Payload size is incorrect, log the frame but don't process it
             log_warning("Warning, unknown frame encountered. caplen: %d, len: %d", pkt_stats->caplen, pkt_stats->len);
             log_hexdump(frame, pkt_stats->caplen);
+            metric_add(&__dxwifi_rx_metrics.unknown_frames, 1);
+            dxwifi_probe2(frame_drop, DXWIFI_PROBE_DROP_UNKNOWN, pkt_stats->caplen);
         }
         else if(ctrl_frame != DXWIFI_CONTROL_FRAME_NONE) {
             handle_frame_control(fc, ctrl_frame);
+            metric_add(&__dxwifi_rx_metrics.control_frames, 1);
+            status_control_frame(ctrl_frame);
+            dxwifi_probe2(frame_control, ctrl_frame, pkt_stats->caplen);
         }
         else {
 
             dxwifi_rx_frame rx_frame = parse_rx_frame_fields(pkt_stats, frame);
 
-            fc->rx_stats.rtap = parse_radiotap_header(frame, pkt_stats->caplen);
+            fc->rx_stats.rtap = parse_radiotap_header_cached(&fc->rtap_layout, frame, pkt_stats->caplen);
 
             ssize_t payload_size = rx_frame.fcs - rx_frame.payload;
 
-            if(payload_size != DXWIFI_TX_PAYLOAD_SIZE) {
-                log_warning("Payload size does not match expected: %d / %d", payload_size, DXWIFI_TX_PAYLOAD_SIZE);
+            if(!is_data_payload_size(payload_size)) {
+                log_warning("Payload size is not a whole number of RS blocks: %zd", payload_size);
+                dxwifi_probe2(frame_drop, DXWIFI_PROBE_DROP_PAYLOAD_SIZE, pkt_stats->caplen);
             } else {
 
                 // Buffer is full, write it out first
-                if( fc->index + DXWIFI_TX_PAYLOAD_SIZE >= fc->pb_size ) {
+                if( fc->index + payload_size >= fc->pb_size ) {
                     dump_packet_buffer(fc);
                 }
 
@@ -517,19 +864,20 @@ static void process_frame(uint8_t* args, const struct pcap_pkthdr* pkt_stats, co
                 uint8_t* write_idx = fc->packet_buffer + fc->index;
 
                 // Copy the entire frame into the packet buffer
-                memcpy(write_idx, rx_frame.payload, DXWIFI_TX_PAYLOAD_SIZE);
+                memcpy(write_idx, rx_frame.payload, payload_size);
 
                 int32_t frame_number = (fc->rx->ordered 
                     ? extract_frame_number(rx_frame.mac_hdr) 
                     : fc->rx_stats.num_packets_processed);
 
-                uint32_t crc = crc32((uint8_t*)rx_frame.mac_hdr, DXWIFI_TX_PAYLOAD_SIZE + sizeof(ieee80211_hdr));
+                uint32_t crc = crc32((uint8_t*)rx_frame.mac_hdr, payload_size + sizeof(ieee80211_hdr));
                 bool crc_valid = (crc == *rx_frame.fcs);
 
                 // Heap node only points to the payload data
                 packet_heap_node node = {
                     .frame_number   = frame_number,
                     .data           = write_idx,
+                    .size           = payload_size,
                     .crc_valid      = crc_valid
                 };
                 heap_push(&fc->packet_heap, &node);
@@ -542,15 +890,309 @@ static void process_frame(uint8_t* args, const struct pcap_pkthdr* pkt_stats, co
                 fc->rx_stats.bad_crcs               += !crc_valid ? 0 : 1;
                 memcpy(&fc->rx_stats.pkt_stats, pkt_stats, sizeof(struct pcap_pkthdr));
 
+                metric_add(&__dxwifi_rx_metrics.data_frames, 1);
+                metric_add(&__dxwifi_rx_metrics.bytes, pkt_stats->caplen);
+                metric_add(&__dxwifi_rx_metrics.crc_failures, !crc_valid);
+                if(fc->rtap_layout.ant_signal >= 0) {
+                    metric_set(&__dxwifi_rx_metrics.last_signal, fc->rx_stats.rtap.ant_signal);
+                    histogram_observe(&__dxwifi_rx_metrics.antenna_signal, fc->rx_stats.rtap.ant_signal);
+                }
+                histogram_observe(&__dxwifi_rx_metrics.frame_latency, capture_age_ns(pkt_stats));
+                status_rx_frame(rx_frame.payload, payload_size, crc_valid, fc->rx_stats.rtap.antenna, fc->rx_stats.rtap.ant_signal, fc->rtap_layout.ant_signal >= 0);
+
+                dxwifi_probe5(frame_accept, frame_number, payload_size, pkt_stats->caplen, crc_valid, fc->rx_stats.rtap.ant_signal);
+
                 log_frame_stats(&rx_frame, frame_number, &fc->rx_stats);
             }
         }
     }
     else {
         ++fc->rx_stats.packets_dropped;
+        metric_add(&__dxwifi_rx_metrics.dropped_frames, 1);
+        status_dropped_frame();
+        dxwifi_probe2(frame_drop, DXWIFI_PROBE_DROP_SENDER, pkt_stats->caplen);
     }
 }
 
+/**
+ *  DESCRIPTION:    Wakes the other side of the frame ring if it went to sleep
+ * 
+ *  ARGUMENTS:
+ * 
+ *      waiting:    Sleep flag set by the other side before it waits
+ * 
+ *      sem:        Semaphore the other side is waiting on
+ * 
+ *  NOTES: The fence pairs with the one in wait_for_frame()/wait_for_slot() so
+ *  that either the sleeper sees our ring update or we see its flag.
+ *  
+ */
+static void wake_waiter(atomic_bool* waiting, sem_t* sem) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_exchange(waiting, false)) {
+        sem_post(sem);
+    }
+}
+
+
+/**
+ *  DESCRIPTION:    Blocks the capture thread until the worker frees a slot
+ * 
+ *  ARGUMENTS:
+ * 
+ *      cap:        Capture thread state
+ * 
+ *  RETURNS:
+ *      
+ *      ring_frame*: Free slot or NULL if the receiver is shutting down
+ *  
+ */
+static ring_frame* wait_for_slot(dxwifi_rx_capture* cap) {
+    ring_frame* slot = NULL;
+
+    atomic_fetch_add_explicit(&cap->full_count, 1, memory_order_relaxed);
+    metric_add(&__dxwifi_rx_metrics.ring_full, 1);
+
+    while(!slot && !atomic_load(&cap->shutdown)) {
+        atomic_store(&cap->capture_waiting, true);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        slot = (ring_frame*) frame_ring_reserve(&cap->ring);
+        if(slot || atomic_load(&cap->shutdown)) {
+            atomic_store(&cap->capture_waiting, false);
+        }
+        else {
+            // Called from pcap_dispatch(), let the worker at the handle while we sleep
+            pthread_mutex_unlock(&cap->handle_lock);
+            while(sem_wait(&cap->slot_ready) < 0 && errno == EINTR) {
+                ;
+            }
+            pthread_mutex_lock(&cap->handle_lock);
+        }
+    }
+    return slot;
+}
+
+
+/**
+ *  DESCRIPTION:    Blocks the worker until a frame is available, the capture
+ *                  thread exits, the capture is stopped or timeout elapses
+ * 
+ *  ARGUMENTS:
+ * 
+ *      cap:        Capture thread state
+ * 
+ *      timeout:    Seconds to wait, a negative value waits forever
+ * 
+ *  RETURNS:
+ *      
+ *      bool:       false if the timeout elapsed
+ *  
+ */
+static bool wait_for_frame(dxwifi_rx_capture* cap, int timeout) {
+    int status = 0;
+
+    atomic_store(&cap->worker_waiting, true);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if(frame_ring_peek(&cap->ring) || atomic_load(&cap->finished) || !cap->rx->__activated) {
+        atomic_store(&cap->worker_waiting, false);
+        return true;
+    }
+
+    if(timeout < 0) {
+        status = sem_wait(&cap->frame_ready);
+    }
+    else {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout;
+        status = sem_timedwait(&cap->frame_ready, &deadline);
+    }
+    atomic_store(&cap->worker_waiting, false);
+
+    return !(status < 0 && errno == ETIMEDOUT);
+}
+
+
+/**
+ *  DESCRIPTION:    Callback for PCAP dispatch on the capture thread. Copies the
+ *                  frame into the ring and does nothing else.
+ * 
+ *  ARGUMENTS:
+ * 
+ *      args:       Capture thread state
+ * 
+ *      pkt_stats:  Information about the current capture
+ * 
+ *      frame:      Actual data that was captured. Memory is owned by pcap.
+ *  
+ */
+static void enqueue_frame(uint8_t* args, const struct pcap_pkthdr* pkt_stats, const uint8_t* frame) {
+    dxwifi_rx_capture* cap = (dxwifi_rx_capture*) args;
+
+    ring_frame* slot = (ring_frame*) frame_ring_reserve(&cap->ring);
+    if(!slot && !(slot = wait_for_slot(cap))) {
+        return; // Shutting down, frame is discarded
+    }
+
+    slot->pkt_stats = *pkt_stats;
+    if(slot->pkt_stats.caplen > cap->max_caplen) {
+        slot->pkt_stats.caplen = cap->max_caplen;
+    }
+    memcpy(slot->data, frame, slot->pkt_stats.caplen);
+
+    frame_ring_commit(&cap->ring);
+    wake_waiter(&cap->worker_waiting, &cap->frame_ready);
+}
+
+
+/**
+ *  DESCRIPTION:    Capture thread entry point. Polls the pcap handle and moves
+ *                  every captured frame into the ring until the receiver is 
+ *                  closed or the capture source fails.
+ * 
+ *  ARGUMENTS:
+ * 
+ *      args:       Capture thread state
+ *  
+ */
+static void* capture_frames(void* args) {
+    dxwifi_rx_capture* cap = (dxwifi_rx_capture*) args;
+    dxwifi_receiver* rx = cap->rx;
+
+    int status = 0;
+    dxwifi_rx_state_t end_state = DXWIFI_RX_DEACTIVATED;
+
+    struct pollfd requests[2] = {
+        { .fd = pcap_get_selectable_fd(rx->__handle), .events = POLLIN, .revents = 0 },
+        { .fd = cap->shutdown_fd,                     .events = POLLIN, .revents = 0 }
+    };
+
+    while(!atomic_load(&cap->shutdown)) {
+
+        status = poll(requests, NELEMS(requests), -1);
+
+        if(status < 0) {
+            if(errno != EINTR) {
+                log_error("Error occured: %s", strerror(errno));
+                end_state = DXWIFI_RX_ERROR;
+                break;
+            }
+        }
+        else if(requests[1].revents & POLLIN) {
+            break;
+        }
+        else {
+            pthread_mutex_lock(&cap->handle_lock);
+            status = pcap_dispatch(rx->__handle, rx->dispatch_count, enqueue_frame, (uint8_t*)cap);
+            pthread_mutex_unlock(&cap->handle_lock);
+
+#if defined(DXWIFI_TESTS)
+            // When reading from a savefile, 0 denotes that there are no more packets
+            if(status == 0) {
+                break;
+            }
+#endif // DXWIFI_TESTS
+
+            assert_continue(status != PCAP_ERROR, "Capture failure: %s", pcap_statustostr(status));
+        }
+    }
+
+    atomic_store(&cap->end_state, end_state);
+    atomic_store(&cap->finished, true);
+    sem_post(&cap->frame_ready);
+
+    return NULL;
+}
+
+
+/**
+ *  DESCRIPTION:    Allocates the frame ring and starts the capture thread
+ * 
+ *  ARGUMENTS:
+ * 
+ *      rx:         Receiver with an opened pcap handle
+ *  
+ */
+static void start_capture_thread(dxwifi_receiver* rx) {
+    debug_assert(rx && rx->__handle);
+
+    dxwifi_rx_capture* cap = calloc(1, sizeof(dxwifi_rx_capture));
+    assert_M(cap, "Failed to allocate capture thread state");
+
+    cap->rx         = rx;
+    cap->max_caplen = rx->snaplen < DXWIFI_RX_RING_SLOT_DATA_MAX ? rx->snaplen : DXWIFI_RX_RING_SLOT_DATA_MAX;
+
+    // Round the slots up so that each ring_frame header stays aligned
+    size_t slot_size = sizeof(ring_frame) + cap->max_caplen;
+    slot_size = (slot_size + FRAME_RING_CACHELINE - 1) & ~((size_t)FRAME_RING_CACHELINE - 1);
+    init_frame_ring(&cap->ring, rx->ring_capacity, slot_size);
+
+    atomic_init(&cap->shutdown, false);
+    atomic_init(&cap->finished, false);
+    atomic_init(&cap->end_state, DXWIFI_RX_NORMAL);
+    atomic_init(&cap->full_count, 0);
+    atomic_init(&cap->worker_waiting, false);
+    atomic_init(&cap->capture_waiting, false);
+
+    assert_M(sem_init(&cap->frame_ready, 0, 0) == 0, "Failed to create semaphore: %s", strerror(errno));
+    assert_M(sem_init(&cap->slot_ready, 0, 0) == 0, "Failed to create semaphore: %s", strerror(errno));
+
+    cap->shutdown_fd = eventfd(0, EFD_NONBLOCK);
+    assert_M(cap->shutdown_fd >= 0, "Failed to create eventfd: %s", strerror(errno));
+
+    pthread_mutex_init(&cap->handle_lock, NULL);
+
+    // Signals like SIGINT must be handled by the application threads, not ours
+    sigset_t all_signals, prev_mask;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &prev_mask);
+
+    int status = pthread_create(&cap->thread, NULL, capture_frames, cap);
+    assert_M(status == 0, "Failed to start capture thread: %s", strerror(status));
+
+    pthread_sigmask(SIG_SETMASK, &prev_mask, NULL);
+
+    rx->__capture = cap;
+}
+
+
+/**
+ *  DESCRIPTION:    Stops the capture thread and frees the frame ring. Frames
+ *                  left in the ring are discarded.
+ * 
+ *  ARGUMENTS:
+ * 
+ *      rx:         Receiver with a running capture thread
+ *  
+ */
+static void stop_capture_thread(dxwifi_receiver* rx) {
+    debug_assert(rx && rx->__capture);
+
+    dxwifi_rx_capture* cap = rx->__capture;
+    uint64_t signal = 1;
+
+    atomic_store(&cap->shutdown, true);
+    pcap_breakloop(rx->__handle);
+    if(write(cap->shutdown_fd, &signal, sizeof(signal)) < 0) {
+        log_warning("Failed to signal capture thread: %s", strerror(errno));
+    }
+    sem_post(&cap->slot_ready);
+
+    pthread_join(cap->thread, NULL);
+
+    close(cap->shutdown_fd);
+    sem_destroy(&cap->frame_ready);
+    sem_destroy(&cap->slot_ready);
+    pthread_mutex_destroy(&cap->handle_lock);
+    teardown_frame_ring(&cap->ring);
+    free(cap);
+
+    rx->__capture = NULL;
+}
+
+
 //
 // See receiver.h for description of non-static functions
 //
@@ -562,6 +1204,7 @@ static void log_rx_configuration(const dxwifi_receiver* rx, const char* dev_name
             "\tDevice:                   %s\n"
             "\tCapture Timeout:          %ds\n"
             "\tPacket Buffer Size:       %ld\n"
+            "\tCapture Ring Capacity:    %d\n"
             "\tMax Hamming Distance:     %d\n"
             "\tOrdered:                  %d\n"
             "\tAdd-noise:                %d\n"
@@ -569,11 +1212,15 @@ static void log_rx_configuration(const dxwifi_receiver* rx, const char* dev_name
             "\tOptimize:                 %d\n"
             "\tSnapshot Length:          %d\n"
             "\tPCAP Buffer Timeout:      %dms\n"
+            "\tKernel Buffer Size:       %d\n"
+            "\tImmediate Mode:           %d\n"
+            "\tTimestamp Type:           %s\n"
             "\tDispatch Count:           %d\n"
             "\tDatalink Type:            %s\n",
             dev_name,
             rx->capture_timeout,
             rx->packet_buffer_size,
+            rx->ring_capacity,
             rx->max_hamming_dist,
             rx->ordered,
             rx->add_noise,
@@ -581,6 +1228,9 @@ static void log_rx_configuration(const dxwifi_receiver* rx, const char* dev_name
             rx->optimize,
             rx->snaplen,
             rx->pb_timeout,
+            rx->buffer_size,
+            rx->immediate,
+            rx->tstamp_type ? rx->tstamp_type : "default",
             rx->dispatch_count,
             pcap_datalink_val_to_description(datalink)
     );
@@ -603,13 +1253,18 @@ void init_receiver(dxwifi_receiver* rx, const char* device_name) {
     }
     assert_M(rx->__handle != NULL, err_buff);
 #else
-    rx->__handle = pcap_open_live(
-                        device_name,
-                        rx->snaplen,
-                        true, 
-                        rx->pb_timeout,
-                        err_buff
-                    );
+    if(rx->buffer_size == 0 && rx->frame_rate > 0) {
+        rx->buffer_size = pcap_buffer_size_for_rate(rx->frame_rate, DXWIFI_RX_EXPECTED_FRAME_SIZE, DXWIFI_RX_BUFFER_STALL_MS);
+    }
+
+    dxwifi_pcap_settings settings = {
+        .snaplen        = rx->snaplen,
+        .pb_timeout     = rx->pb_timeout,
+        .buffer_size    = rx->buffer_size,
+        .immediate      = rx->immediate,
+        .tstamp_type    = rx->tstamp_type
+    };
+    rx->__handle = open_live_handle(device_name, &settings, err_buff);
     assert_M(rx->__handle != NULL, err_buff);
 
     status = pcap_setnonblock(rx->__handle, true, err_buff);
@@ -630,6 +1285,8 @@ void init_receiver(dxwifi_receiver* rx, const char* device_name) {
         pcap_freecode(&filter);
     }
 
+    start_capture_thread(rx);
+
     log_rx_configuration(rx, device_name);
 }
 
@@ -637,6 +1294,8 @@ void init_receiver(dxwifi_receiver* rx, const char* device_name) {
 void close_receiver(dxwifi_receiver* receiver) {
     debug_assert(receiver && receiver->__handle);
 
+    stop_capture_thread(receiver);
+
     pcap_close(receiver->__handle);
 
     log_info("DxWiFi receiver closed");
@@ -644,62 +1303,64 @@ void close_receiver(dxwifi_receiver* receiver) {
 
 
 void receiver_activate_capture(dxwifi_receiver* rx, int fd, dxwifi_rx_stats* out) {
-    debug_assert(rx && rx->__handle);
+    debug_assert(rx && rx->__handle && rx->__capture);
 
-    int status = 0;
     frame_controller fc;
-
-    struct pollfd request = {
-        .fd         = pcap_get_selectable_fd(rx->__handle),
-        .events     = POLLIN,
-        .revents    = 0
-    };
-    assert_M(request.fd >= 0, "Receiver handle cannot be polled");
+    ring_frame* slot = NULL;
+    dxwifi_rx_capture* cap = rx->__capture;
 
     init_frame_controller(&fc, rx, fd);
 
+    // Only track ring usage for this capture
+    frame_ring_reset_high_water(&cap->ring);
+    atomic_store(&cap->full_count, 0);
+
     log_info("Starting packet capture...");
     rx->__activated = true;
+    metric_set(&__dxwifi_rx_metrics.active, 1);
+    status_set_state(DXWIFI_STATUS_CAPTURING);
 
     while(rx->__activated && !fc.end_capture) {
 
-        status = poll(&request, 1, rx->capture_timeout * 1000);
+        // Must be read before checking the ring so that no frame is left behind
+        bool finished = atomic_load(&cap->finished);
+
+        if((slot = (ring_frame*) frame_ring_peek(&cap->ring))) {
+            process_frame((uint8_t*)&fc, &slot->pkt_stats, slot->data);
 
-        if(status == 0) {
+            frame_ring_release(&cap->ring);
+            wake_waiter(&cap->capture_waiting, &cap->slot_ready);
+        }
+        else if(finished) {
+            fc.rx_stats.capture_state = atomic_load(&cap->end_state);
+            rx->__activated = false;
+        }
+        else if(!wait_for_frame(cap, (int)rx->capture_timeout)) {
             log_info("Receiver timeout occured");
             fc.rx_stats.capture_state = DXWIFI_RX_TIMED_OUT;
             rx->__activated = false;
         }
-        else if(status < 0) {
-            if(rx->__activated) { 
-                log_error("Error occured: %s", strerror(errno));
-                fc.rx_stats.capture_state = DXWIFI_RX_ERROR;
-            }
-            else {
-                fc.rx_stats.capture_state = DXWIFI_RX_DEACTIVATED;
-            }
-        }
-        else {
-            status = pcap_dispatch(rx->__handle, rx->dispatch_count, process_frame, (uint8_t*)&fc);
-
-#if defined(DXWIFI_TESTS)
-            // When reading from a savefile, 0 denotes that there are no more packets
-            if(status == 0) {
-                rx->__activated = false;
-                fc.rx_stats.capture_state = DXWIFI_RX_DEACTIVATED;
-            }
-#endif // DXWIFI_TESTS
+    }
 
-            assert_continue(status != PCAP_ERROR, "Capture failure: %s", pcap_statustostr(status));
-        }
+    // Stopped through receiver_stop_capture()
+    if(!rx->__activated && fc.rx_stats.capture_state == DXWIFI_RX_NORMAL) {
+        fc.rx_stats.capture_state = DXWIFI_RX_DEACTIVATED;
     }
     log_info("DxWiFi Reciever capture ended");
+    metric_set(&__dxwifi_rx_metrics.active, 0);
+    status_set_state(DXWIFI_STATUS_IDLE);
 
     dump_packet_buffer(&fc); // Flush out whatever's leftover in the buffer
 
+    pthread_mutex_lock(&cap->handle_lock);
     if( pcap_stats(rx->__handle, &fc.rx_stats.pcap_stats) == PCAP_ERROR) {
         log_warning("Failed to gather capture stats from PCAP");
     }
+    pthread_mutex_unlock(&cap->handle_lock);
+
+    fc.rx_stats.ring_capacity   = cap->ring.capacity;
+    fc.rx_stats.ring_high_water = frame_ring_reset_high_water(&cap->ring);
+    fc.rx_stats.ring_full_count = atomic_load(&cap->full_count);
 
     if(out) {
         *out = fc.rx_stats;
@@ -710,7 +1371,9 @@ void receiver_activate_capture(dxwifi_receiver* rx, int fd, dxwifi_rx_stats* out
 
 void receiver_stop_capture(dxwifi_receiver* rx) {
     if(rx) {
-        pcap_breakloop(rx->__handle);
         rx->__activated = false;
+        if(rx->__capture) {
+            sem_post(&rx->__capture->frame_ready);
+        }
     }
 }
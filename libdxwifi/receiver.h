@@ -31,6 +31,12 @@
 #define DXWIFI_RX_PACKET_BUFFER_SIZE_MIN IEEE80211_MTU_MAX_LEN
 #define DXWIFI_RX_PACKET_BUFFER_SIZE_MAX (1024 * 1024 * 5)  // 5mb
 
+#define DXWIFI_RX_RING_CAPACITY_MIN 2
+#define DXWIFI_RX_RING_CAPACITY_MAX 65536
+#define DXWIFI_RX_RING_CAPACITY_DFLT 512
+
+#define DXWIFI_RX_RTAP_PRESENT_WORDS_MAX 8
+
 
 /************************
  *  Data structures
@@ -75,6 +81,32 @@ typedef struct {
     int8_t  ant_signal;     /* Antenna signal in dBm                    */
 } dxwifi_rx_radiotap_hdr;
 
+
+/**
+ *  Drivers emit the same radiotap layout for every frame, so once a layout has
+ *  been walked with the radiotap iterator the offset of each field is known. 
+ *  Frames whose it_len and it_present words match the learned signature are
+ *  parsed with direct loads from these offsets. Offsets are relative to the 
+ *  start of the radiotap header and are -1 for fields that are not present.
+ * 
+ *  NOTES: Layouts with vendor namespaces are never learned since their length
+ *  is stored in the namespace data rather than in the present words.
+ */
+typedef struct {
+    bool        valid;          /* Has a layout been learned?               */
+    uint16_t    it_len;         /* Radiotap header length                   */
+    uint8_t     npresent;       /* Number of it_present words               */
+    uint32_t    present[DXWIFI_RX_RTAP_PRESENT_WORDS_MAX];
+                                /* it_present words, as captured            */
+    int16_t     tsft;           /* Offset of the TSFT field                 */
+    int16_t     flags;          /* Offset of the flags field                */
+    int16_t     channel;        /* Offset of the channel field              */
+    int16_t     rx_flags;       /* Offset of the Rx flags field             */
+    int16_t     mcs;            /* Offset of the MCS field                  */
+    int16_t     antenna;        /* Offset of the antenna field              */
+    int16_t     ant_signal;     /* Offset of the antenna signal field       */
+} dxwifi_rx_radiotap_layout;
+
 /**
  *  The DxWifi RX frame structure comes in like this:
  * 
@@ -112,6 +144,9 @@ typedef struct {
     uint32_t                num_packets_processed;  /* Number of packets processed      */
     uint32_t                packets_dropped;        /* Packets dropped because by rx    */
     uint32_t                bad_crcs;               /* Number of packets with a bad CRC */
+    uint32_t                ring_capacity;          /* Slots in the capture frame ring  */
+    uint32_t                ring_high_water;        /* Max ring slots used this capture */
+    uint32_t                ring_full_count;        /* Times capture waited on the ring */
     dxwifi_rx_state_t       capture_state;          /* State of last capture            */
     struct pcap_pkthdr      pkt_stats;              /* Stats for the current capture    */
     struct pcap_stat        pcap_stats;             /* Pcap statistics                  */
@@ -119,6 +154,10 @@ typedef struct {
 } dxwifi_rx_stats;
 
 
+// Implementation in receiver.c
+typedef struct __dxwifi_rx_capture dxwifi_rx_capture;
+
+
 /**
  *  Receiver is responsible for handling packet capture. The receiver must be
  *  initialized before use and torn down after. It is the user's responsibility 
@@ -129,11 +168,21 @@ typedef struct {
  *  the last four bytes of the MAC header's addr1 field. If the frame number 
  *  is not present then the receiver will not be able to sort the packet data.
  * 
+ *  Packets are captured on a dedicated thread that copies each frame into a
+ *  preallocated ring of ring_capacity slots. The thread that activates the
+ *  capture drains the ring and does all of the frame validation and reordering.
+ *  Frames captured after an EOT stay in the ring for the next capture.
+ * 
+ *  If buffer_size is 0 and frame_rate is set then the kernel capture buffer is
+ *  sized to hold about a second of frames at that rate. If neither is set the
+ *  pcap default is used.
+ * 
  */
 typedef struct {
     unsigned    dispatch_count;     /* Number of packets to process at a time */
     unsigned    capture_timeout;    /* Number of seconds to wait for a packet */
     size_t      packet_buffer_size; /* Size of the intermediate packet buffer */
+    unsigned    ring_capacity;      /* Number of frames the capture ring holds*/
     bool        ordered;            /* Packets have packed sequence data      */
     bool        add_noise;          /* Add noise for missing packets          */
     uint8_t     noise_value;        /* Value to use for noise                 */
@@ -146,9 +195,14 @@ typedef struct {
     bool        optimize;           /* Optimize compiled filter?              */
     int         snaplen;            /* Snapshot length in bytes               */
     int         pb_timeout;         /* PCAP Packet buffer timeout             */
+    int         buffer_size;        /* Kernel capture buffer size in bytes    */
+    unsigned    frame_rate;         /* Expected frames/s, sizes buffer if 0   */
+    bool        immediate;          /* Deliver packets as soon as they arrive */
+    const char *tstamp_type;        /* Timestamp source, NULL for default     */
 
     volatile bool   __activated;    /* Currently capturing packets?           */
     pcap_t*         __handle;       /* Pcap session handle                    */
+    dxwifi_rx_capture* __capture;   /* Capture thread and frame ring          */
 
 #if defined(DXWIFI_TESTS)
     const char*     savefile;       /* Name of file to read packets from      */
@@ -161,6 +215,7 @@ typedef struct {
     .dispatch_count     = 1,\
     .capture_timeout    = -1,\
     .packet_buffer_size = DXWIFI_RX_PACKET_BUFFER_SIZE_MAX,\
+    .ring_capacity      = DXWIFI_RX_RING_CAPACITY_DFLT,\
     .ordered            = false,\
     .add_noise          = false,\
     .noise_value        = 0xff,\
@@ -169,7 +224,11 @@ typedef struct {
     .filter             = NULL,\
     .optimize           = true,\
     .snaplen            = DXWIFI_SNAPLEN_MAX,\
-    .pb_timeout         = DXWIFI_DFLT_PACKET_BUFFER_TIMEOUT\
+    .pb_timeout         = DXWIFI_DFLT_PACKET_BUFFER_TIMEOUT,\
+    .buffer_size        = 0,\
+    .frame_rate         = 0,\
+    .immediate          = false,\
+    .tstamp_type        = NULL\
 }\
 
 
@@ -227,6 +286,45 @@ void close_receiver(dxwifi_receiver* receiver);
 void receiver_activate_capture(dxwifi_receiver* receiver, int fd, dxwifi_rx_stats* out);
 
 
+/**
+ *  DESCRIPTION:    Parses the radiotap fields DxWiFi cares about with the 
+ *                  generic radiotap iterator
+ * 
+ *  ARGUMENTS:
+ * 
+ *      frame:      Captured frame beginning with the radiotap header
+ * 
+ *      caplen:     Number of bytes captured
+ * 
+ *  RETURNS:
+ *      
+ *      dxwifi_rx_radiotap_hdr: Parsed fields, missing fields are zeroed
+ * 
+ */
+dxwifi_rx_radiotap_hdr parse_radiotap_header(const uint8_t* frame, uint32_t caplen);
+
+
+/**
+ *  DESCRIPTION:    Parses the radiotap fields using a learned layout when the
+ *                  frame's signature matches it. Otherwise falls back to 
+ *                  parse_radiotap_header() and learns the new layout.
+ * 
+ *  ARGUMENTS:
+ * 
+ *      layout:     Layout cache, zero initialize it before the first call
+ * 
+ *      frame:      Captured frame beginning with the radiotap header
+ * 
+ *      caplen:     Number of bytes captured
+ * 
+ *  RETURNS:
+ *      
+ *      dxwifi_rx_radiotap_hdr: Same result parse_radiotap_header() gives
+ * 
+ */
+dxwifi_rx_radiotap_hdr parse_radiotap_header_cached(dxwifi_rx_radiotap_layout* layout, const uint8_t* frame, uint32_t caplen);
+
+
 /**
  *  DESCRIPTION:    Signals to the receiver to stop capturing packets
  * 
@@ -235,7 +333,8 @@ void receiver_activate_capture(dxwifi_receiver* receiver, int fd, dxwifi_rx_stat
  *      receiver:   pointer to an allocated receiver object
  * 
  *  NOTES: There are no guartantees that no more packets will be processed. At
- *  most at least one more packet may be processed.
+ *  most at least one more packet may be processed. Safe to call from a signal 
+ *  handler.
  * 
  */
 void receiver_stop_capture(dxwifi_receiver* receiver);
@@ -8,6 +8,8 @@
  */
 
 
+#define DXWIFI_LOG_MODULE DXWIFI_LOG_TRANSMITTER
+
 #include <string.h>
 #include <stdbool.h>
 
@@ -25,6 +27,10 @@
 #include <libdxwifi/details/utils.h>
 #include <libdxwifi/details/assert.h>
 #include <libdxwifi/details/logging.h>
+#include <libdxwifi/details/probes.h>
+#include <libdxwifi/details/metrics.h>
+#include <libdxwifi/details/shm_status.h>
+#include <libdxwifi/details/pcap_utils.h>
 
 
 /**
@@ -222,12 +228,19 @@ static int inject_packet(dxwifi_transmitter* tx, dxwifi_tx_frame* frame, dxwifi_
     int status = 0;
     bool transmit = invoke_handlers(tx->__preinjection, frame, stats);
 
-    size_t frame_size = DXWIFI_TX_FRAME_SIZE;
+    size_t frame_size = DXWIFI_TX_HEADER_SIZE + tx->payload_size;
     if(stats->frame_type != DXWIFI_CONTROL_FRAME_NONE) {
         frame_size = DXWIFI_TX_HEADER_SIZE + DXWIFI_FRAME_CONTROL_SIZE;
     }
 
+    // Data and control frames are numbered separately
+    bool control = stats->frame_type != DXWIFI_CONTROL_FRAME_NONE;
+    uint32_t frame_number = control ? stats->ctrl_frame_count : stats->data_frame_count;
+
     if(transmit) {
+        dxwifi_probe3(inject_entry, frame_number, stats->frame_type, frame_size);
+
+        uint64_t start = metrics_now_ns();
 #if defined(DXWIFI_TESTS)
         struct pcap_pkthdr pcap_hdr;
         gettimeofday(&pcap_hdr.ts, NULL);
@@ -238,6 +251,24 @@ static int inject_packet(dxwifi_transmitter* tx, dxwifi_tx_frame* frame, dxwifi_
 #else
         status = pcap_inject(tx->__handle, frame, frame_size);
 #endif
+        uint64_t latency = metrics_now_ns() - start;
+        histogram_observe(&__dxwifi_tx_metrics.inject_latency, latency);
+
+        dxwifi_probe4(inject_return, frame_number, stats->frame_type, status, latency);
+
+        if(status == PCAP_ERROR) {
+            metric_add(&__dxwifi_tx_metrics.inject_errors, 1);
+        }
+        else {
+            metric_add(control ? &__dxwifi_tx_metrics.control_frames : &__dxwifi_tx_metrics.data_frames, 1);
+            metric_add(&__dxwifi_tx_metrics.bytes, status);
+        }
+        if(control && status != PCAP_ERROR) {
+            status_control_frame(stats->frame_type);
+        }
+        else {
+            status_tx_frame(frame->payload, tx->payload_size, status != PCAP_ERROR);
+        }
     }
     assert_continue(status != PCAP_ERROR, "Injection failure: %s", pcap_statustostr(status));
 
@@ -276,6 +307,8 @@ static void send_control_frame(dxwifi_transmitter* tx, dxwifi_tx_frame* frame, d
 
     memcpy(frame->payload, control_data, DXWIFI_FRAME_CONTROL_SIZE);
 
+    dxwifi_probe2(control_frame, type, tx->redundant_ctrl_frames + 1);
+
     for (int i = 0; i < tx->redundant_ctrl_frames + 1; ++i) {
 
         stats->prev_bytes_sent = inject_packet(tx, frame, stats);
@@ -308,14 +341,18 @@ static void log_tx_configuration(const dxwifi_transmitter* tx, const char* devic
             "\tRedundant Ctrl:      %d\n"
             "\tData Rate:           %dMbps\n"
             "\tRTAP flags:          0x%x\n"
-            "\tRTAP Tx flags:       0x%x\n",
+            "\tRTAP Tx flags:       0x%x\n"
+            "\tKernel Buffer Size:  %d\n"
+            "\tPayload Size:        %zu\n",
             device_name,
             tx->enable_pa,
             tx->transmit_timeout,
             tx->redundant_ctrl_frames,
             tx->rtap_rate_mbps,
             tx->rtap_flags,
-            tx->rtap_tx_flags
+            tx->rtap_tx_flags,
+            tx->buffer_size,
+            tx->payload_size
     );
 }
 
@@ -329,6 +366,8 @@ void init_transmitter(dxwifi_transmitter* tx, const char* device_name) {
 
     char err_buff[PCAP_ERRBUF_SIZE];
 
+    debug_assert(DXWIFI_TX_PAYLOAD_SIZE_MIN <= tx->payload_size && tx->payload_size <= DXWIFI_TX_PAYLOAD_SIZE_MAX);
+
     tx->__activated = false;
 
     memset(tx->__preinjection,  0x00, sizeof(dxwifi_tx_frame_handler) * DXWIFI_TX_FRAME_HANDLER_MAX);
@@ -344,13 +383,14 @@ void init_transmitter(dxwifi_transmitter* tx, const char* device_name) {
     }
     assert_M(tx->dumper, "Failed to open savefile: %s", pcap_geterr(tx->__handle));
 #else 
-    tx->__handle = pcap_open_live(
-                        device_name,
-                        DXWIFI_SNAPLEN_MAX, 
-                        true,
-                        DXWIFI_DFLT_PACKET_BUFFER_TIMEOUT, 
-                        err_buff
-                    );
+    dxwifi_pcap_settings settings = {
+        .snaplen        = DXWIFI_SNAPLEN_MAX,
+        .pb_timeout     = DXWIFI_DFLT_PACKET_BUFFER_TIMEOUT,
+        .buffer_size    = tx->buffer_size,
+        .immediate      = false,
+        .tstamp_type    = NULL
+    };
+    tx->__handle = open_live_handle(device_name, &settings, err_buff);
 
     // WARNING: Only Enable PA if PCAP successfully initiailzed the WiFi device
     if(tx->enable_pa && tx->__handle != NULL)  { 
@@ -437,6 +477,7 @@ void start_transmission(dxwifi_transmitter* tx, int fd, dxwifi_tx_stats* out) {
         .total_bytes_sent   = 0,
         .prev_bytes_read    = 0,
         .prev_bytes_sent    = 0,
+        .payload_size       = tx->payload_size,
         .tx_state           = DXWIFI_TX_NORMAL,
         .frame_type         = DXWIFI_CONTROL_FRAME_NONE
     };
@@ -451,6 +492,8 @@ void start_transmission(dxwifi_transmitter* tx, int fd, dxwifi_tx_stats* out) {
     log_info("Starting DxWiFi Transmission...");
 
     tx->__activated = true;
+    metric_set(&__dxwifi_tx_metrics.active, 1);
+    status_set_state(DXWIFI_STATUS_TRANSMITTING);
 
     send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_PREAMBLE, &stats);
 
@@ -472,14 +515,14 @@ void start_transmission(dxwifi_transmitter* tx, int fd, dxwifi_tx_stats* out) {
             }
         }
         else {
-            stats.prev_bytes_read = read(fd, data_frame.payload, DXWIFI_TX_BLOCKSIZE);
+            stats.prev_bytes_read = read(fd, data_frame.payload, tx->payload_size);
             if(stats.prev_bytes_read > 0) {
 
-                if(stats.prev_bytes_read != DXWIFI_TX_BLOCKSIZE) { // Zero fill remaining bytes
+                if(stats.prev_bytes_read != tx->payload_size) { // Zero fill remaining bytes
                     memset(
                         data_frame.payload + stats.prev_bytes_read, 
                         0x00, 
-                        DXWIFI_TX_BLOCKSIZE - stats.prev_bytes_read
+                        tx->payload_size - stats.prev_bytes_read
                         );
                 }
 
@@ -498,6 +541,10 @@ void start_transmission(dxwifi_transmitter* tx, int fd, dxwifi_tx_stats* out) {
 
     log_info("DxWiFI Transmission stopped");
 
+    metric_set(&__dxwifi_tx_metrics.active, 0);
+    status_set_state(DXWIFI_STATUS_IDLE);
+    metric_add(&__dxwifi_tx_metrics.transmissions, 1);
+
 #if defined(DXWIFI_TESTS)
     pcap_dump_flush(tx->dumper);
 #endif 
@@ -522,6 +569,7 @@ void transmit_bytes(dxwifi_transmitter* tx, const void* data, size_t nbytes, dxw
         .total_bytes_sent   = 0,
         .prev_bytes_read    = 0,
         .prev_bytes_sent    = 0,
+        .payload_size       = tx->payload_size,
         .tx_state           = DXWIFI_TX_NORMAL
     };
 
@@ -534,20 +582,23 @@ void transmit_bytes(dxwifi_transmitter* tx, const void* data, size_t nbytes, dxw
 
     log_debug("Starting DxWiFi Transmission...");
 
+    metric_set(&__dxwifi_tx_metrics.active, 1);
+    status_set_state(DXWIFI_STATUS_TRANSMITTING);
+
     send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_PREAMBLE, &stats);
 
     while (nbytes > 0)
     {
         // Copy blocksize bytes or remainder into the payload
-        stats.prev_bytes_read = (DXWIFI_TX_BLOCKSIZE < nbytes ? DXWIFI_TX_BLOCKSIZE : nbytes);
+        stats.prev_bytes_read = (tx->payload_size < nbytes ? tx->payload_size : nbytes);
 
         memcpy(data_frame.payload, data + stats.total_bytes_read, stats.prev_bytes_read);
 
-        if(stats.prev_bytes_read != DXWIFI_TX_BLOCKSIZE) { // Zero fill remaining bytes
+        if(stats.prev_bytes_read != tx->payload_size) { // Zero fill remaining bytes
             memset(
                 data_frame.payload + stats.prev_bytes_read, 
                 0x00, 
-                DXWIFI_TX_BLOCKSIZE - stats.prev_bytes_read
+                tx->payload_size - stats.prev_bytes_read
                 );
         }
 
@@ -563,6 +614,10 @@ void transmit_bytes(dxwifi_transmitter* tx, const void* data, size_t nbytes, dxw
 
     send_control_frame(tx, &data_frame, DXWIFI_CONTROL_FRAME_EOT, &stats);
 
+    metric_set(&__dxwifi_tx_metrics.active, 0);
+    status_set_state(DXWIFI_STATUS_IDLE);
+    metric_add(&__dxwifi_tx_metrics.transmissions, 1);
+
 #if defined(DXWIFI_TESTS)
     pcap_dump_flush(tx->dumper);
 #endif
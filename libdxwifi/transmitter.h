@@ -32,13 +32,21 @@
 #define DXWIFI_TX_HEADER_SIZE \
     (sizeof(dxwifi_tx_radiotap_hdr) + sizeof(ieee80211_hdr))
 
+// Default payload size, one RS-LDPC frame with the default geometry
 #define DXWIFI_TX_PAYLOAD_SIZE DXWIFI_RS_LDPC_FRAME_SIZE
 
+// Payload sizes a data frame can have, one to the most RS blocks per frame
+#define DXWIFI_TX_PAYLOAD_SIZE_MIN DXWIFI_RS_LDPC_FRAME_SIZE_FOR(1)
+#define DXWIFI_TX_PAYLOAD_SIZE_MAX DXWIFI_RS_LDPC_FRAME_SIZE_MAX
+
 #define DXWIFI_TX_BLOCKSIZE DXWIFI_TX_PAYLOAD_SIZE
 
 #define DXWIFI_TX_FRAME_SIZE \
     (DXWIFI_TX_HEADER_SIZE + DXWIFI_TX_PAYLOAD_SIZE)
 
+#define DXWIFI_TX_FRAME_SIZE_MAX \
+    (DXWIFI_TX_HEADER_SIZE + DXWIFI_TX_PAYLOAD_SIZE_MAX)
+
 #define DXWIFI_TX_RADIOTAP_PRESENCE_BIT_FIELD \
     ( 0x1 << IEEE80211_RADIOTAP_FLAGS    \
     | 0x1 << IEEE80211_RADIOTAP_RATE     \
@@ -88,15 +96,18 @@ compiler_assert(sizeof(dxwifi_tx_radiotap_hdr) == DXWIFI_TX_RADIOTAP_HDR_SIZE,
  *  always be the last four bytes of the frame and should always start at the 
  *  address `frame.payload[frame.payload_size]`.
  * 
+ *  The payload array fits the largest payload, only the transmitter's 
+ *  `payload_size` bytes of it are injected.
+ * 
  */
 typedef struct __attribute__((packed)) { 
     // Actual Data Frame
     dxwifi_tx_radiotap_hdr  radiotap_hdr;  /* frame metadata               */
     ieee80211_hdr           mac_hdr;       /* link-layer header            */
-    uint8_t                 payload[DXWIFI_TX_PAYLOAD_SIZE];       
+    uint8_t                 payload[DXWIFI_TX_PAYLOAD_SIZE_MAX];       
                                            /* packet data, driver attaches FCS */
 } dxwifi_tx_frame;
-compiler_assert(sizeof(dxwifi_tx_frame) == DXWIFI_TX_FRAME_SIZE, 
+compiler_assert(sizeof(dxwifi_tx_frame) == DXWIFI_TX_FRAME_SIZE_MAX, 
     "Mismatch in actual tx frame size and calculated size");
 
 
@@ -119,6 +130,7 @@ typedef struct {
     uint32_t                total_bytes_sent;   /* total of bytes sent via pcap */
     uint32_t                prev_bytes_read;    /* Size of last read            */
     uint32_t                prev_bytes_sent;    /* Size of last transmission    */
+    uint32_t                payload_size;       /* Data frame payload size      */
     dxwifi_tx_state_t       tx_state;           /* State of last transmission   */
     dxwifi_control_frame_t  frame_type;         /* Type of the last frame       */
 } dxwifi_tx_stats;
@@ -174,6 +186,9 @@ typedef struct {
     uint8_t     rtap_rate_mbps;     /* Radiotap data rate                   */
     uint16_t    rtap_tx_flags;      /* Radiotap Tx flags                    */
     ieee80211_frame_control fctl;   /* Frame control settings               */
+    int         buffer_size;        /* Kernel buffer size, 0 for default    */
+    size_t      payload_size;       /* Data frame payload size, the RS-LDPC 
+                                       frame size of the encoded data       */
 
 
     dxwifi_tx_frame_handler __preinjection[DXWIFI_TX_FRAME_HANDLER_MAX];
@@ -211,6 +226,8 @@ typedef struct {
         .order              = false\
     },\
     .address = DXWIFI_DFLT_SENDER_ADDR,\
+    .buffer_size = 0,\
+    .payload_size = DXWIFI_TX_PAYLOAD_SIZE,\
 }\
 
 
@@ -161,6 +161,11 @@ of_status_t	of_ldpc_ff_set_fec_parameters (of_ldpc_ff_cb_t*	cb,
 				ofcb->tab_nb_equ_for_repair[seq - ofcb->nb_source_symbols]++;
 			}
 		}
+		// and the compressed copy of the matrix walked by the IT decoder
+		if ((ofcb->pchk_csr = of_mod2csr_from_sparse (ofcb->pchk_matrix)) == NULL)
+		{
+			goto error;
+		}
 	}	
 #endif //OF_USE_DECODER
 	ofcb->nb_source_symbol_ready = 0; // Number of source symbols ready
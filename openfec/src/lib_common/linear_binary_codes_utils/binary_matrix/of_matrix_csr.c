@@ -0,0 +1,161 @@
+/*
+ * OpenFEC.org AL-FEC Library.
+ * (c) Copyright 2009 - 2012 INRIA - All rights reserved
+ * Contact: vincent.roca@inria.fr
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+#include "../of_linear_binary_code.h"
+
+
+#ifdef OF_USE_LINEAR_BINARY_CODES_UTILS
+
+
+of_mod2csr* of_mod2csr_from_sparse (of_mod2sparse	*m)
+{
+	OF_ENTER_FUNCTION
+	of_mod2csr	*csr;
+	of_mod2entry	*e;
+	UINT32		*col_fill;	/* next free slot of each column during the copy */
+	UINT32		n_entries = 0;
+	UINT32		pos;
+	UINT32		slot;
+	UINT32		n_rows = of_mod2sparse_rows (m);
+	UINT32		n_cols = of_mod2sparse_cols (m);
+	UINT32		i, j;
+	size_t		size;
+
+	if (n_rows >= OF_MOD2CSR_DELETED || n_cols >= OF_MOD2CSR_DELETED)
+	{
+		OF_PRINT_ERROR(("%s: matrix too large (%d rows, %d columns) for %u-bit indexes, define OF_MOD2CSR_WIDE_INDEX\n",
+				__FUNCTION__, n_rows, n_cols, (UINT32)(8 * sizeof(of_mod2csr_index_t))))
+		OF_EXIT_FUNCTION
+		return NULL;
+	}
+	for (i = 0; i < n_rows; i++)
+	{
+		for (e = of_mod2sparse_first_in_row (m, i); !of_mod2sparse_at_end (e); e = of_mod2sparse_next_in_row (e))
+		{
+			n_entries++;
+		}
+	}
+	/* one block for everything: the UINT32 arrays first, then the index arrays */
+	size = sizeof(of_mod2csr)
+		+ (n_rows + 1 + n_cols + 1 + n_entries) * sizeof(UINT32)
+		+ 2 * n_entries * sizeof(of_mod2csr_index_t);
+	if ((csr = (of_mod2csr*) of_calloc (1, size)) == NULL)
+	{
+		goto no_mem;
+	}
+	if ((col_fill = (UINT32*) of_calloc (n_cols, sizeof(UINT32))) == NULL)
+	{
+		of_free (csr);
+		goto no_mem;
+	}
+	csr->n_rows = n_rows;
+	csr->n_cols = n_cols;
+	csr->n_entries = n_entries;
+	csr->row_start = (UINT32*) (csr + 1);
+	csr->col_start = csr->row_start + n_rows + 1;
+	csr->col_pos = csr->col_start + n_cols + 1;
+	csr->row_col = (of_mod2csr_index_t*) (csr->col_pos + n_entries);
+	csr->col_row = csr->row_col + n_entries;
+
+	/* column offsets first, so that columns can be filled while walking the rows */
+	for (j = 0; j < n_cols; j++)
+	{
+		for (e = of_mod2sparse_first_in_col (m, j); !of_mod2sparse_at_end_col (e); e = of_mod2sparse_next_in_col (e))
+		{
+			col_fill[j]++;
+		}
+		csr->col_start[j + 1] = csr->col_start[j] + col_fill[j];
+		col_fill[j] = csr->col_start[j];
+	}
+	pos = 0;
+	for (i = 0; i < n_rows; i++)
+	{
+		csr->row_start[i] = pos;
+		for (e = of_mod2sparse_first_in_row (m, i); !of_mod2sparse_at_end (e); e = of_mod2sparse_next_in_row (e))
+		{
+			/* rows are walked in increasing order, so each column ends up sorted too */
+			slot = col_fill[of_mod2sparse_col (e)]++;
+			csr->col_row[slot] = i;
+			csr->col_pos[slot] = pos;
+			csr->row_col[pos++] = of_mod2sparse_col (e);
+		}
+	}
+	csr->row_start[n_rows] = pos;
+	of_free (col_fill);
+	OF_EXIT_FUNCTION
+	return csr;
+
+no_mem:
+	OF_PRINT_ERROR(("out of memory\n"))
+	OF_EXIT_FUNCTION
+	return NULL;
+}
+
+
+void of_mod2csr_free (of_mod2csr	*m)
+{
+	if (m != NULL)
+	{
+		of_free (m);
+	}
+}
+
+
+void of_mod2csr_sync_sparse (const of_mod2csr	*csr,
+			     of_mod2sparse	*m)
+{
+	OF_ENTER_FUNCTION
+	of_mod2entry	*e;
+	of_mod2entry	*next;
+	UINT32		pos;
+	UINT32		i;
+
+	ASSERT(csr->n_rows == (UINT32)of_mod2sparse_rows (m) && csr->n_cols == (UINT32)of_mod2sparse_cols (m));
+	for (i = 0; i < csr->n_rows; i++)
+	{
+		/* both representations store a row in increasing column order */
+		pos = of_mod2csr_row_begin (csr, i);
+		for (e = of_mod2sparse_first_in_row (m, i); !of_mod2sparse_at_end (e); e = next, pos++)
+		{
+			ASSERT(of_mod2csr_is_deleted (csr, pos) || of_mod2csr_col (csr, pos) == of_mod2sparse_col (e));
+			next = of_mod2sparse_next_in_row (e);
+			if (of_mod2csr_is_deleted (csr, pos))
+			{
+				of_mod2sparse_delete (m, e);
+			}
+		}
+		ASSERT(pos == of_mod2csr_row_end (csr, i));
+	}
+	OF_EXIT_FUNCTION
+}
+
+#endif //OF_USE_LINEAR_BINARY_CODES_UTILS
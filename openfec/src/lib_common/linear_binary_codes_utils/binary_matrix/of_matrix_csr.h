@@ -0,0 +1,132 @@
+/*
+ * OpenFEC.org AL-FEC Library.
+ * (c) Copyright 2009 - 2012 INRIA - All rights reserved
+ * Contact: vincent.roca@inria.fr
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/*
+ * This module implements a compressed, read-mostly copy of a sparse mod2
+ * matrix, stored both row-wise (CSR) and column-wise (CSC) in a single
+ * contiguous block.
+ *
+ * It is meant for the iterative decoder, whose inner loops walk the column of
+ * each new symbol and then the rows it touches. With the linked of_mod2sparse
+ * representation each step dereferences a 32 byte node that may live anywhere
+ * in memory. Here a row is a run of 16-bit column indexes and a column is a
+ * run of row indexes, so a whole equation usually fits in a single cache line.
+ *
+ * Entries can only be deleted, never inserted. A deleted entry keeps its slot
+ * and is flagged in the row array, so that the column view (which points into
+ * the row array) stays valid without any bookkeeping.
+ */
+
+#ifndef OF_LDPC_MATRIX_CSR__
+#define OF_LDPC_MATRIX_CSR__
+
+
+#ifdef OF_USE_LINEAR_BINARY_CODES_UTILS
+
+/**
+ * Type used to store row and column indexes.
+ * 16-bit indexes cover every profile that keeps ML decoding enabled (at most
+ * 50000 encoding symbols, see of_codec_profile.h). IT only profiles accept up
+ * to 100000 symbols and need 32-bit indexes.
+ */
+#if defined(ML_DECODING) && !defined(OF_MOD2CSR_WIDE_INDEX)
+typedef UINT16	of_mod2csr_index_t;
+#define OF_MOD2CSR_DELETED	0xFFFF
+#else
+typedef UINT32	of_mod2csr_index_t;
+#define OF_MOD2CSR_DELETED	0xFFFFFFFF
+#endif
+
+
+/**
+ * Representation of a compressed sparse matrix.
+ */
+typedef struct of_mod2csr
+{
+	UINT32			n_rows;		/* Number of rows in the matrix */
+	UINT32			n_cols;		/* Number of columns in the matrix */
+	UINT32			n_entries;	/* Number of entries at creation time */
+
+	UINT32			*row_start;	/* n_rows + 1 offsets into row_col */
+	UINT32			*col_start;	/* n_cols + 1 offsets into col_row and col_pos */
+	UINT32			*col_pos;	/* Position in row_col of each column entry */
+	of_mod2csr_index_t	*row_col;	/* Column of each row entry, or OF_MOD2CSR_DELETED */
+	of_mod2csr_index_t	*col_row;	/* Row of each column entry */
+} of_mod2csr;
+
+
+/* MACROS TO GET AT ELEMENTS OF A COMPRESSED MATRIX. Entries are addressed by
+   their position in the row array. Rows are scanned from row_begin up to
+   row_end, columns from col_begin up to col_end, and col_pos maps the
+   latter back to a position. */
+
+#define of_mod2csr_row_begin(m,i) ((m)->row_start[i])
+#define of_mod2csr_row_end(m,i) ((m)->row_start[(i) + 1])
+#define of_mod2csr_col_begin(m,j) ((m)->col_start[j])
+#define of_mod2csr_col_end(m,j) ((m)->col_start[(j) + 1])
+
+#define of_mod2csr_col(m,pos) ((m)->row_col[pos])	  /* Column of an entry */
+#define of_mod2csr_is_deleted(m,pos) ((m)->row_col[pos] == OF_MOD2CSR_DELETED)
+#define of_mod2csr_delete(m,pos) ((m)->row_col[pos] = OF_MOD2CSR_DELETED)
+
+
+/**
+ * Create the compressed copy of a sparse matrix.
+ *
+ * @param m		(IN) Sparse matrix to copy. Rows are stored in increasing column order
+ *			and columns in increasing row order, as in the sparse matrix.
+ * @return		The compressed matrix, or NULL if out of memory or if the matrix
+ *			dimensions do not fit in of_mod2csr_index_t.
+ */
+of_mod2csr*	of_mod2csr_from_sparse (of_mod2sparse *m);
+
+
+/**
+ * Free a compressed matrix.
+ *
+ * @param m		(IN) Compressed matrix to free, may be NULL.
+ */
+void		of_mod2csr_free (of_mod2csr *m);
+
+
+/**
+ * Propagate the deletions made in a compressed matrix to the sparse matrix it
+ * was created from, e.g. before handing the system over to ML decoding.
+ *
+ * @param csr		(IN) Compressed matrix.
+ * @param m		(IN/OUT) Sparse matrix used to create csr, unmodified since.
+ */
+void		of_mod2csr_sync_sparse (const of_mod2csr *csr, of_mod2sparse *m);
+
+#endif //OF_USE_LINEAR_BINARY_CODES_UTILS
+
+#endif //OF_LDPC_MATRIX_CSR__
@@ -41,8 +41,11 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 							  void*				new_symbol,
 							  UINT32			new_symbol_esi)
 {
-	of_mod2entry	*e = NULL;			// entry ("1") in parity check matrix
-	of_mod2entry	*mod_entry_to_delete;		// temp: entry to delete in row/column
+	of_mod2csr	*csr = ofcb->pchk_csr;		// compressed parity check matrix
+	UINT32		col;				// temp: column of the new symbol
+	UINT32		col_slot;			// temp: current entry in this column
+	UINT32		col_end;			// temp: end of this column
+	UINT32		pos;				// temp: current entry ("1") in parity check matrix
 	void		*const_term;			// temp: pointer to constant term, containing the sum of
 							// all the known symbols of this equation
 	UINT32		row;				// temp: current row value
@@ -75,6 +78,16 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 	}
 	
 	//of_mod2sparse_print_bitmap(ofcb->pchk_matrix);
+	if (csr == NULL)
+	{
+		// ML decoding took the system back, continue from what it left in the sparse matrix
+		if (ofcb->pchk_matrix == NULL || (csr = ofcb->pchk_csr = of_mod2csr_from_sparse (ofcb->pchk_matrix)) == NULL)
+		{
+			OF_PRINT_ERROR(("%s: no parity check matrix to decode with\n", __FUNCTION__))
+			OF_EXIT_FUNCTION
+			return OF_STATUS_FATAL_ERROR;
+		}
+	}
 	
 	/*
 	 * Step 1: Store the symbol in a permanent array.
@@ -117,11 +130,21 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 	 * Step 2: Inject the symbol value in each equation it is involved
 	 */
 	// (if partial sum already exists or if partial sum should be created)
-	for (e = of_mod2sparse_first_in_col (ofcb->pchk_matrix, of_get_symbol_col ((of_cb_t*)ofcb, new_symbol_esi)); !of_mod2sparse_at_end_col (e); )
+	// The walk uses the compressed copy of the matrix: the column of the new symbol
+	// and each row it touches are contiguous runs of indexes.
+	col = of_get_symbol_col ((of_cb_t*)ofcb, new_symbol_esi);
+	col_end = of_mod2csr_col_end (csr, col);
+	for (col_slot = of_mod2csr_col_begin (csr, col); col_slot < col_end; col_slot++)
 	{
+		pos = csr->col_pos[col_slot];
+		if (of_mod2csr_is_deleted (csr, pos))
+		{
+			// entry already removed, e.g. by step 3 just before this recursive call
+			continue;
+		}
 		// for a given row, ie for a given equation where this symbol
 		// is implicated, do the following:
-		row = e->row;
+		row = csr->col_row[col_slot];
 		ofcb->tab_nb_unknown_symbols[row]--;		// symbol is known
 		const_term = ofcb->tab_const_term_of_equ[row];	// associated partial sum buffer (if any)
 		if ((const_term == NULL) && ((ofcb->tab_nb_unknown_symbols[row] == 1)))
@@ -137,8 +160,8 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 		}
 		if (const_term != NULL)
 		{
-			mod_entry_to_delete = e;
-			of_mod2entry	*tmp_e;		// current symbol in this equation
+			UINT32		tmp_pos;	// current entry in this equation
+			UINT32		tmp_end;	// end of this equation
 			UINT32		tmp_esi;	// corresponding esi
 			void		*tmp_symbol;	// corresponding symbol pointer
 
@@ -157,8 +180,7 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 			// symbol of this equation, and its value is necessarilly
 			// equal to the constant term. Their sum must be 0 (we don't check it).
 			// Remove the symbol from the equation since this entry is now useless.
-			e = of_mod2sparse_next_in_col (e);
-			of_mod2sparse_delete (ofcb->pchk_matrix, mod_entry_to_delete);
+			of_mod2csr_delete (csr, pos);
 			ofcb->tab_nb_enc_symbols_per_equ[row]--;
 			if (of_is_repair_symbol ((of_cb_t*)ofcb, new_symbol_esi))
 			{
@@ -167,9 +189,14 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 			// Inject all permanently stored symbols
 			// (source and repair) into this partial sum.
 			// Requires to scan the equation (i.e. row).
-			for (tmp_e = of_mod2sparse_first_in_row (ofcb->pchk_matrix, row); !of_mod2sparse_at_end_row (tmp_e); )
+			tmp_end = of_mod2csr_row_end (csr, row);
+			for (tmp_pos = of_mod2csr_row_begin (csr, row); tmp_pos < tmp_end; tmp_pos++)
 			{
-				tmp_esi = of_get_symbol_esi ((of_cb_t*)ofcb, tmp_e->col);
+				if (of_mod2csr_is_deleted (csr, tmp_pos))
+				{
+					continue;
+				}
+				tmp_esi = of_get_symbol_esi ((of_cb_t*)ofcb, of_mod2csr_col (csr, tmp_pos));
 				tmp_symbol = ofcb->encoding_symbols_tab[tmp_esi];
 				if (tmp_symbol != NULL)
 				{
@@ -180,9 +207,7 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 #endif
 							);
 					// delete the entry
-					mod_entry_to_delete = tmp_e;
-					tmp_e =  of_mod2sparse_next_in_row (tmp_e);
-					of_mod2sparse_delete (ofcb->pchk_matrix, mod_entry_to_delete);
+					of_mod2csr_delete (csr, tmp_pos);
 					ofcb->tab_nb_enc_symbols_per_equ[row]--;
 					if (of_is_repair_symbol ((of_cb_t*)ofcb, tmp_esi))
 					{
@@ -198,19 +223,8 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 #endif
 					}
 				}
-				else
-				{
-					// this symbol is not yet known, switch to next one in equation
-					tmp_e =  of_mod2sparse_next_in_row (tmp_e);
-				}
 			}
 		}
-		else
-		{
-			// here m_checkValues[row] is NULL, ie. the partial
-			// sum has not been allocated
-			e = of_mod2sparse_next_in_col (e);
-		}
 		if (ofcb->tab_nb_enc_symbols_per_equ[row] == 1)
 		{
 			// register this entry for step 3 since the symbol
@@ -256,9 +270,10 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 			// NB: because of the recursion below, we need to
 			// check that all equations mentioned in the
 			// table_of_check_deg_1 list are __still__ of degree 1.
-			e = of_mod2sparse_first_in_row (ofcb->pchk_matrix, row);
-			ASSERT (!of_mod2sparse_at_end_row (e) && of_mod2sparse_at_end_row (e->right))
-			decoded_symbol_esi = of_get_symbol_esi ((of_cb_t*)ofcb, e->col);
+			for (pos = of_mod2csr_row_begin (csr, row); of_mod2csr_is_deleted (csr, pos); pos++)
+				;
+			ASSERT (pos < of_mod2csr_row_end (csr, row))
+			decoded_symbol_esi = of_get_symbol_esi ((of_cb_t*)ofcb, of_mod2csr_col (csr, pos));
 			// remove the entry from the matrix
 			const_term = ofcb->tab_const_term_of_equ[row];	// remember it
 			ofcb->tab_const_term_of_equ[row] = NULL;
@@ -267,7 +282,7 @@ of_status_t of_linear_binary_code_decode_with_new_symbol (of_linear_binary_code_
 			{
 				ofcb->tab_nb_equ_for_repair[decoded_symbol_esi - ofcb->nb_source_symbols]--;
 			}
-			of_mod2sparse_delete (ofcb->pchk_matrix, e);
+			of_mod2csr_delete (csr, pos);
 			OF_TRACE_LVL (1, ("%s: REBUILT %s symbol %d\n", __FUNCTION__,
 					  (of_is_repair_symbol ((of_cb_t*)ofcb, decoded_symbol_esi)) ? "Parity" : "Source",
 					  decoded_symbol_esi));
@@ -112,6 +112,14 @@ of_linear_binary_code_finish_decoding_with_ml (of_linear_binary_code_cb_t	*ofcb)
 	 * last symbol of this equation. Here we need to do that explicitely in order to simplify the system
 	 * as much as possible.
 	 */
+	if (ofcb->pchk_csr != NULL)
+	{
+		/* IT decoding works on the compressed copy of the matrix, bring the sparse
+		 * matrix up to date before simplifying it. */
+		of_mod2csr_sync_sparse (ofcb->pchk_csr, ofcb->pchk_matrix);
+		of_mod2csr_free (ofcb->pchk_csr);
+		ofcb->pchk_csr = NULL;
+	}
 	ofcb->remain_rows = ofcb->nb_repair_symbols;
 	ofcb->remain_cols = ofcb->nb_source_symbols + ofcb->nb_repair_symbols;
 	if (of_linear_binary_code_prepar_linear_system (ofcb) != OF_STATUS_OK)
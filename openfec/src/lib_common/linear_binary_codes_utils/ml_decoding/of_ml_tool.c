@@ -30,7 +30,6 @@
  * The fact that you are presently reading this means that you have had
  * knowledge of the CeCILL-C license and that you accept its terms.
  */
-
 #include "../of_linear_binary_code.h"
 
 #ifdef OF_USE_DECODER
@@ -38,41 +37,65 @@
 #ifdef ML_DECODING
 
 
+/**
+ * Maximum number of columns eliminated at once with a "Method of Four Russians"
+ * table. Each block of columns builds a table of 2^k combinations of its pivot
+ * rows, so every row below the block is cleared with a single row XOR.
+ */
+#define OF_M4RI_MAX_K		8
+
+
+/**
+ * Elimination state shared by the M4RI helpers.
+ */
+typedef struct of_m4ri
+{
+	of_mod2dense	*m;		/* system being triangularized */
+	of_mod2dense	*ops;		/* bit u of row i set: pivot row u was added to row i */
+	void		**constant_tab;	/* constant terms, permuted along with the rows */
+	of_mod2word	*table;		/* 2^k combinations of the pivot rows of a block */
+	of_mod2word	*basis;		/* k basis combinations the table is built from */
+	UINT8		table_ops[1 << OF_M4RI_MAX_K];	/* pivots combined in each table entry */
+	of_xor_kernel_t	xor_kernel;	/* kernel used for packed row XORs */
+} of_m4ri_t;
+
+
 /******  Static Functions  ****************************************************/
 
 
 /**
- * This function transforms the matrix into a triangular matrix. It goes through each column and calls of_linear_binary_code_col_forward_elimination()
- * to find the pivot and eliminate '1's below the pivot.
+ * This function transforms the matrix into an upper triangular matrix with a unit diagonal,
+ * k columns at a time (see OF_M4RI_MAX_K). Only the bits are processed: the row operations
+ * are recorded in m4ri->ops and applied to the constant terms afterwards, once the pivot
+ * schedule is known.
  *
  * @brief			triangularize the dense system
- * @param m			(IN/OUT) address of the dense matrix.
- * @param constant_tab		(IN/OUT)
  * @param ofcb			(IN) Linear-Binary-Code control-block.
- * @return			1 if it's OK, or 0 if an error took place.
+ * @param m4ri			(IN/OUT) elimination state, with the dense matrix and the
+ *				(permuted) constant terms.
+ * @return			1 if it's OK, or 0 if a column has no pivot (the system is not
+ *				of full column rank).
  */
 static INT32
 of_linear_binary_code_triangularize_dense_system (of_linear_binary_code_cb_t	*ofcb,
-						  of_mod2dense			*m,
-						  void				**constant_tab);
+						  of_m4ri_t			*m4ri);
 
 
 /**
- * This function finds the pivot for this column and eliminates '1's below this pivot.
+ * This function applies the row operations recorded during the triangularization to the
+ * constant terms. Pivot rows are never modified once chosen, so the constant term of each
+ * pivot row is built in a single pass from the final constant terms of the pivots that
+ * were added to it, in pivot order. Rows that are not pivots are never used again and are
+ * skipped.
  *
- * @brief			eliminates "1" entries in parity check matrix
- * @param m 			(IN/OUT) address of the dense matrix.
- * @param constant_tab		(IN/OUT) pointer to all constant members
- * @param ofcb			(IN/OUT) Linear-Binary-Code control-block.
- * @param col_idx		(IN) column index
- * @param stats			(IN)
+ * @brief			deferred forward elimination of the constant terms
+ * @param ofcb			(IN) Linear-Binary-Code control-block.
+ * @param m4ri			(IN/OUT) elimination state after triangularization.
  * @return			1 if it's OK, or 0 if an error took place.
  */
 static INT32
-of_linear_binary_code_col_forward_elimination  (of_linear_binary_code_cb_t	*ofcb,
-						of_mod2dense			*m,
-						void				**constant_tab,
-						INT32				col_idx);
+of_linear_binary_code_apply_forward_elimination (of_linear_binary_code_cb_t	*ofcb,
+						 of_m4ri_t			*m4ri);
 
 
 /**
@@ -80,7 +103,7 @@ of_linear_binary_code_col_forward_elimination  (of_linear_binary_code_cb_t	*ofcb
  * already been transformed into a triangular matrix.
  *
  * @brief			solve system with backward substitution
- * @param variable_tab		(IN/OUT) address of the dense matrix.
+ * @param variable_tab		(IN/OUT) address of the dense matrix.
  * @param constant_tab
  * @param m 			(IN/OUT) address of the dense matrix.
  * @param ofcb			(IN/OUT) Linear-Binary-Code control-block.
@@ -98,8 +121,8 @@ of_linear_binary_code_backward_substitution (of_linear_binary_code_cb_t	*ofcb,
 
 
 /**
- * This function solves the system: first triangularize the system, then for each column,
- * do a forward elimination, then do the backward elimination.
+ * This function solves the system: first triangularize the system, then apply
+ * the forward elimination to the constant terms, then do the backward elimination.
  */
 of_status_t
 of_linear_binary_code_solve_dense_system (of_linear_binary_code_cb_t	*ofcb,
@@ -107,161 +130,321 @@ of_linear_binary_code_solve_dense_system (of_linear_binary_code_cb_t	*ofcb,
 					  void				**constant_tab,
 					  void				**variable_tab)
 {
+	of_m4ri_t	m4ri;
+	of_status_t	status = OF_STATUS_OK;
+
 	OF_ENTER_FUNCTION
-	if (!of_linear_binary_code_triangularize_dense_system (ofcb, m, constant_tab))
+	memset(&m4ri, 0, sizeof(m4ri));
+	m4ri.m			= m;
+	m4ri.constant_tab	= constant_tab;
+	m4ri.xor_kernel		= of_symbol_get_current_xor_kernel();
+	m4ri.ops		= of_mod2dense_allocate (of_mod2dense_rows(m), of_mod2dense_cols(m));
+	m4ri.table		= (of_mod2word*) of_malloc ((1 << OF_M4RI_MAX_K) * m->n_words * sizeof(of_mod2word));
+	m4ri.basis		= (of_mod2word*) of_malloc (OF_M4RI_MAX_K * m->n_words * sizeof(of_mod2word));
+	if ((m4ri.ops == NULL) || (m4ri.table == NULL) || (m4ri.basis == NULL))
+	{
+		OF_PRINT_ERROR(("out of memory"))
+		status = OF_STATUS_FATAL_ERROR;
+		goto end;
+	}
+	if (!of_linear_binary_code_triangularize_dense_system (ofcb, &m4ri))
 	{
 		OF_TRACE_LVL(0,("%s: triangularize_dense_system failed for system with %d rows, %d cols\n",
 				__FUNCTION__, of_mod2dense_rows(m), of_mod2dense_cols(m)))
-		OF_EXIT_FUNCTION
-		return OF_STATUS_FAILURE;
+		status = OF_STATUS_FAILURE;
+		goto end;
 	}
 	//of_mod2dense_print_bitmap(m);
+	if (!of_linear_binary_code_apply_forward_elimination (ofcb, &m4ri))
+	{
+		OF_TRACE_LVL(0,("%s: apply_forward_elimination failed\n", __FUNCTION__))
+		status = OF_STATUS_FAILURE;
+		goto end;
+	}
 	if (!of_linear_binary_code_backward_substitution (ofcb, m, variable_tab, constant_tab))
 	{
 		OF_TRACE_LVL(0,("%s: backward_substitution failed\n", __FUNCTION__))
-		OF_EXIT_FUNCTION
-		return OF_STATUS_FAILURE;
+		status = OF_STATUS_FAILURE;
+		goto end;
+	}
+end:
+	if (m4ri.ops != NULL)
+	{
+		of_mod2dense_free (m4ri.ops);
 	}
+	of_free (m4ri.table);
+	of_free (m4ri.basis);
 	OF_EXIT_FUNCTION
-	return OF_STATUS_OK;
+	return status;
 }
 
 
 /******  Static Functions  ****************************************************/
 
 
-static
-INT32	of_linear_binary_code_triangularize_dense_system (of_linear_binary_code_cb_t	*ofcb,
-							  of_mod2dense			*m,
-							  void				**constant_tab)
+/**
+ * Read the k (<= OF_M4RI_MAX_K) bits of a packed row starting at column col.
+ */
+static inline UINT32
+of_m4ri_read_bits (const of_mod2word	*row,
+		   UINT32		n_words,
+		   UINT32		col,
+		   UINT32		k)
 {
-	INT32 i, n;
+	UINT32	w	= col >> of_mod2_wordsize_shift;
+	UINT32	b	= col & of_mod2_wordsize_mask;
+	UINT64	bits	= row[w];
 
-	OF_ENTER_FUNCTION
-	n = of_mod2dense_cols (m);
-	/* for each row */
-	for (i = 0; i < n; i++)
+	if (w + 1 < n_words)
 	{
-		if (!of_linear_binary_code_col_forward_elimination(ofcb, m, constant_tab, i))
-		{
-			OF_EXIT_FUNCTION
-			return 0;
-		}
+		bits |= (UINT64) row[w + 1] << of_mod2_wordsize;
 	}
-	OF_EXIT_FUNCTION
-	return 1;
+	return (UINT32) (bits >> b) & ((1u << k) - 1);
 }
 
 
-static
-INT32	of_linear_binary_code_col_forward_elimination  (of_linear_binary_code_cb_t	*ofcb,
-								of_mod2dense			*m,
-								void				**constant_tab,
-								INT32				col_idx)
+/**
+ * Flip the k (<= OF_M4RI_MAX_K) bits of a packed row starting at column col.
+ */
+static inline void
+of_m4ri_flip_bits (of_mod2word	*row,
+		   UINT32	col,
+		   UINT32	k,
+		   UINT32	bits)
+{
+	UINT32	w	= col >> of_mod2_wordsize_shift;
+	UINT32	b	= col & of_mod2_wordsize_mask;
+
+	row[w] ^= (of_mod2word) (bits << b);
+	if (b + k > of_mod2_wordsize)
+	{
+		row[w + 1] ^= (of_mod2word) (bits >> (of_mod2_wordsize - b));
+	}
+}
+
+
+/**
+ * XOR nb_words packed words of src into dst.
+ */
+static inline void
+of_m4ri_xor_words (of_m4ri_t		*m4ri,
+		   of_mod2word		*dst,
+		   const of_mod2word	*src,
+		   UINT32		nb_words)
+{
+	const UINT8	*from = (const UINT8*) src;
+
+	m4ri->xor_kernel((UINT8*) dst, &from, 1, nb_words * sizeof(of_mod2word));
+}
+
+
+static inline void
+of_m4ri_swap_rows (of_m4ri_t	*m4ri,
+		   UINT32	i,
+		   UINT32	j)
 {
-	of_mod2word	*s;
 	of_mod2word	*t;
-	INT32		i, j, k;
-	INT32		n, p;
-	INT32		w;
-	INT32		w0;
-	INT32		b0;
-	INT32		symbol_size;
 	void		*tmp_buffer;
 
+	t = m4ri->m->row[i];
+	m4ri->m->row[i] = m4ri->m->row[j];
+	m4ri->m->row[j] = t;
+	t = m4ri->ops->row[i];
+	m4ri->ops->row[i] = m4ri->ops->row[j];
+	m4ri->ops->row[j] = t;
+	tmp_buffer = m4ri->constant_tab[i];
+	m4ri->constant_tab[i] = m4ri->constant_tab[j];
+	m4ri->constant_tab[j] = tmp_buffer;
+}
+
+
+/**
+ * Add pivot row "pivot" (which is also the pivot column) to row "row".
+ */
+static inline void
+of_m4ri_add_pivot (of_m4ri_t	*m4ri,
+		   UINT32	row,
+		   UINT32	pivot,
+		   UINT32	w0)
+{
+	of_m4ri_xor_words(m4ri, m4ri->m->row[row] + w0, m4ri->m->row[pivot] + w0, m4ri->m->n_words - w0);
+	m4ri->ops->row[row][pivot >> of_mod2_wordsize_shift] ^= 1u << (pivot & of_mod2_wordsize_mask);
+}
+
+
+static
+INT32	of_linear_binary_code_triangularize_dense_system (of_linear_binary_code_cb_t	*ofcb,
+							  of_m4ri_t			*m4ri)
+{
+	of_mod2dense	*m = m4ri->m;
+	of_mod2word	*entry;
+	of_mod2word	*prev_entry;
+	INT32		n, p, w;
+	INT32		c0;		/* first column of the current block */
+	INT32		k;		/* number of columns in the current block */
+	INT32		w0;		/* first word that can be non null in rows >= c0 */
+	INT32		tw;		/* number of words in a table entry */
+	INT32		i, j, s, t;
+	UINT32		bits, mask, g, prev_g;
+
 	OF_ENTER_FUNCTION
-	symbol_size = ofcb->encoding_symbol_length;
 	n = of_mod2dense_cols (m);
 	p = of_mod2dense_rows (m);
 	w = m->n_words;
-	i = col_idx;
-	//printf("of_col_forward_elimination of col %d\n",i);
-	w0 = i >> of_mod2_wordsize_shift;	// word index of the ith bit
-	b0 = i & of_mod2_wordsize_mask;		// bit index of the ith bit in the w0-th word
-	/* search for the first non-null element of that column (pivot) */
-	for (j = i; j < p; j++)
-	{
-		if (of_mod2_getbit(m->row[j][w0], b0))
-			break;
-	}
-	/* now j is the index of the first non null element in column i */
-	if (j == p)
-	{
-		/* it's a failure, it's not possible to choose a pivot for this empty column */
-		OF_EXIT_FUNCTION
-		return 0;
-	}
-	if (j != i)
-	{
-		// swap columns i and j in the two matrices
-		//printf("swap rows %i and %i\n",j,i);
-		t = m->row[i];
-		m->row[i] = m->row[j];
-		m->row[j] = t;
-		// swap the partial sum
-		tmp_buffer = constant_tab[i];
-		constant_tab[i] = constant_tab[j];
-		constant_tab[j] = tmp_buffer;
-		//of_mod2dense_print(stdout,m);
-	}
-	/* we have found the pivot and made sure that it is at row i (potentially after swapping two rows).
-	 * Now eliminate the other '1's below this pivot... */
-	ofcb->nb_tmp_symbols = 0;
-	for (j = i + 1; j < p; j++)
+	for (c0 = 0; c0 < n; c0 += k)
 	{
-		if (of_mod2_getbit(m->row[j][w0], b0))
+		/* a table only pays off if there are enough rows below the block to clear */
+		k = (n - c0 < OF_M4RI_MAX_K) ? n - c0 : OF_M4RI_MAX_K;
+		while (k > 1 && (1 << k) > p - c0 - k)
 		{
-			/* there's a '1' below the pivot, so XOR the two rows (word by word to go faster). */
-			//printf("\n\nxor in %i, %i\n",j,i);
-			s = m->row[j];
-			t = m->row[i];
-			s += w0;
-			t += w0;
-			for (k = w0; k < w; k++)
-			{
-				*s ^= *t;
-				s++;
-				t++;
-			}
-			//of_mod2dense_print(stdout,m);
-			if (constant_tab[i] != NULL)
+			k--;
+		}
+		w0 = c0 >> of_mod2_wordsize_shift;
+		tw = w - w0;
+		/*
+		 * Step 1: find the pivots of the k columns. Each candidate row is first reduced by
+		 * the pivots already found in this block, which leaves the pivot rows of the block
+		 * in upper triangular form.
+		 */
+		for (t = 0; t < k; t++)
+		{
+			for (j = c0 + t; j < p; j++)
 			{
-				/* if the buffer of line i is NULL there is nothing to add.
-				 * add the constant term of the i to the constant term of line j */
-				if (constant_tab[j] == NULL)
+				for (s = 0; s < t; s++)
 				{
-					constant_tab[j] = of_malloc (symbol_size);
-					/* copy data directly, there's no XOR to perform */
-					memcpy (constant_tab[j], constant_tab[i], symbol_size);
+					if (of_mod2_getbit(m->row[j][(c0 + s) >> of_mod2_wordsize_shift], (c0 + s) & of_mod2_wordsize_mask))
+					{
+						of_m4ri_add_pivot(m4ri, j, c0 + s, w0);
+					}
 				}
-				else
+				if (of_mod2_getbit(m->row[j][(c0 + t) >> of_mod2_wordsize_shift], (c0 + t) & of_mod2_wordsize_mask))
 				{
-					/* add constant term i to constant term j */
-					ofcb->tmp_tab_symbols[ofcb->nb_tmp_symbols++] = constant_tab[j];
+					break;
 				}
 			}
-			else
+			if (j == p)
 			{
-				constant_tab[i] = of_calloc (1, symbol_size);
+				/* it's a failure, it's not possible to choose a pivot for this empty column */
+				OF_EXIT_FUNCTION
+				return 0;
+			}
+			if (j != c0 + t)
+			{
+				of_m4ri_swap_rows(m4ri, c0 + t, j);
+			}
+		}
+		/*
+		 * Step 2: for each column t of the block, find the combination of pivot rows that
+		 * clears a lone '1' in column t (the pivots are triangular, so walk them in order),
+		 * then build the 2^k combinations in Gray code order, one row XOR per entry.
+		 */
+		for (t = 0; t < k; t++)
+		{
+			bits = 1u << t;
+			mask = 0;
+			entry = m4ri->basis + t * tw;
+			memset(entry, 0, tw * sizeof(of_mod2word));
+			for (s = t; s < k; s++)
+			{
+				if ((bits >> s) & 1)
+				{
+					mask ^= 1u << s;
+					bits ^= of_m4ri_read_bits(m->row[c0 + s], w, c0, k);
+					of_m4ri_xor_words(m4ri, entry, m->row[c0 + s] + w0, tw);
+				}
+			}
+			m4ri->table_ops[1u << t] = (UINT8) mask;
+		}
+		memset(m4ri->table, 0, tw * sizeof(of_mod2word));
+		m4ri->table_ops[0] = 0;
+		for (i = 1; i < (1 << k); i++)
+		{
+			g = i ^ (i >> 1);
+			prev_g = (i - 1) ^ ((i - 1) >> 1);
+			t = __builtin_ctz(g ^ prev_g);
+			entry = m4ri->table + g * tw;
+			prev_entry = m4ri->table + prev_g * tw;
+			memcpy(entry, prev_entry, tw * sizeof(of_mod2word));
+			of_m4ri_xor_words(m4ri, entry, m4ri->basis + t * tw, tw);
+			m4ri->table_ops[g] = m4ri->table_ops[prev_g] ^ m4ri->table_ops[1u << t];
+		}
+		/*
+		 * Step 3: clear the block columns of all the rows below with a single lookup each.
+		 */
+		for (j = c0 + k; j < p; j++)
+		{
+			bits = of_m4ri_read_bits(m->row[j], w, c0, k);
+			if (bits != 0)
+			{
+				of_m4ri_xor_words(m4ri, m->row[j] + w0, m4ri->table + bits * tw, tw);
+				of_m4ri_flip_bits(m4ri->ops->row[j], c0, k, m4ri->table_ops[bits]);
 			}
 		}
 	}
-	if (ofcb->nb_tmp_symbols != 0)
+	OF_EXIT_FUNCTION
+	return 1;
+}
+
+
+static
+INT32	of_linear_binary_code_apply_forward_elimination (of_linear_binary_code_cb_t	*ofcb,
+							 of_m4ri_t			*m4ri)
+{
+	of_mod2word	*row;
+	of_mod2word	word;
+	void		**constant_tab = m4ri->constant_tab;
+	INT32		n, w;
+	INT32		i, j;
+	INT32		symbol_size;
+	INT32		first;
+	void		*from;
+
+	OF_ENTER_FUNCTION
+	symbol_size = ofcb->encoding_symbol_length;
+	n = of_mod2dense_cols (m4ri->m);
+	w = m4ri->ops->n_words;
+	for (i = 0; i < n; i++)
 	{
-		if (ofcb->nb_tmp_symbols == 1)
+		/* gather the (already final) constant terms of the pivots added to this row */
+		row = m4ri->ops->row[i];
+		ofcb->nb_tmp_symbols = 0;
+		for (j = 0; j < w; j++)
+		{
+			for (word = row[j]; word != 0; word &= word - 1)
+			{
+				from = constant_tab[(j << of_mod2_wordsize_shift) + __builtin_ctz(word)];
+				/* a NULL constant term is a null symbol, there is nothing to add */
+				if (from != NULL)
+				{
+					ofcb->tmp_tab_symbols[ofcb->nb_tmp_symbols++] = from;
+				}
+			}
+		}
+		if (ofcb->nb_tmp_symbols == 0)
+		{
+			continue;
+		}
+		first = 0;
+		if (constant_tab[i] == NULL)
 		{
-			of_add_to_symbol (ofcb->tmp_tab_symbols[0], constant_tab[i], symbol_size OP_ARG_VAL);
+			if ((constant_tab[i] = of_malloc (symbol_size)) == NULL)
+			{
+				OF_PRINT_ERROR(("out of memory"))
+				OF_EXIT_FUNCTION
+				return 0;
+			}
+			/* copy data directly, there's no XOR to perform */
+			memcpy (constant_tab[i], ofcb->tmp_tab_symbols[0], symbol_size);
+			first = 1;
 		}
-		else
+		if (ofcb->nb_tmp_symbols > first)
 		{
-			of_add_to_multiple_symbols (ofcb->tmp_tab_symbols,
-						    constant_tab[i],
-						    ofcb->nb_tmp_symbols,
-						    ofcb->encoding_symbol_length
+			of_add_from_multiple_symbols(constant_tab[i], (const void**) ofcb->tmp_tab_symbols + first,
+						     ofcb->nb_tmp_symbols - first, symbol_size
 #ifdef OF_DEBUG
-						    , &(ofcb->stats_xor->nb_xor_for_ML)
+						     , &(ofcb->stats_xor->nb_xor_for_ML)
 #endif
-						   );
+							);
 		}
 	}
 	OF_EXIT_FUNCTION
@@ -269,7 +452,6 @@ INT32	of_linear_binary_code_col_forward_elimination  (of_linear_binary_code_cb_t
 }
 
 
-/* old trivial backward substitution algorithm. */
 static
 INT32	of_linear_binary_code_backward_substitution    (of_linear_binary_code_cb_t	*ofcb,
 							of_mod2dense			*m,
@@ -277,55 +459,63 @@ INT32	of_linear_binary_code_backward_substitution    (of_linear_binary_code_cb_t
 							void				*constant_tab[])
 {
 	INT32	i;		/* current variable index for which we apply backward substition. It's also the row index. */
-	INT32	j;		/*  */
+	INT32	j;		/* word index in row i */
 	INT32	n;
-	INT32	w0;		/* dense matrix word index for variable j */
+	INT32	w0;		/* dense matrix word index for variable i */
 	INT32	b0;		/* dense matrix bit index in word of index w0 */
+	of_mod2word	word;
 
 	OF_ENTER_FUNCTION
 	n = of_mod2dense_cols (m);
 	/* go through all the rows, starting from the last one... */
 	for (i = n - 1; i >= 0; i--)
 	{
+		of_mod2word	*row = m->row[i];		// row corresponding to variable i
+
+		w0 = i >> of_mod2_wordsize_shift;	// word index of the ith bit
+		b0 = i & of_mod2_wordsize_mask;		// bit index of the ith bit in the w0-th word
 		ASSERT(variable_tab[i] == NULL);
-		//if (variable_tab[i] == NULL)
+		ASSERT(of_mod2_getbit(row[w0], b0))
+		/*
+		 * the missing source symbol in col i is equal to the sum of the constant term of this
+		 * equation (i.e. row i) plus all the variables of this equation.
+		 */
+		if (constant_tab[i] == NULL)
 		{
-			of_mod2word	*row = m->row[i];		// row corresponding to variable i
-#ifdef OF_DEBUG
-			w0 = i >> of_mod2_wordsize_shift;	// word index of the ith bit
-			b0 = i & of_mod2_wordsize_mask;		// bit index of the ith bit in the w0-th word
-			ASSERT(of_mod2_getbit(row[w0], b0))
-#endif
-			/*
-			 * the missing source symbol in col i is equal to the sum of the constant term of this
-			 * equation (i.e. row i) plus all the variables of this equation.
-			 */
-			//OF_TRACE_LVL(1, ("%s: rebuilding source symbol %d with col %d\n", __FUNCTION__, col_index[i], i))
-			ASSERT(variable_tab[i] == NULL);
-			variable_tab[i] = constant_tab[i];
-			constant_tab[i] = NULL;
-			/* determine the list of symbols to add to compute the decoded source symbol */
-			ofcb->nb_tmp_symbols = 0;
-			for (j = i + 1; j < n; j++)
+			/* a NULL constant term is a null symbol */
+			if ((constant_tab[i] = of_calloc (1, ofcb->encoding_symbol_length)) == NULL)
 			{
-				w0 = j >> of_mod2_wordsize_shift;	// word index of the ith bit
-				b0 = j & of_mod2_wordsize_mask;		// bit index of the ith bit in the w0-th word
-				/* search for the non-null element in row i */
-				if (of_mod2_getbit(row[w0], b0))
-				{
-					/* since the bit is set, add the variable_tab[j] symbol */
-					ofcb->tmp_tab_symbols[ofcb->nb_tmp_symbols++] = variable_tab[j];
-				}
+				OF_PRINT_ERROR(("out of memory"))
+				OF_EXIT_FUNCTION
+				return 0;
 			}
-			if (ofcb->nb_tmp_symbols != 0)
+		}
+		variable_tab[i] = constant_tab[i];
+		constant_tab[i] = NULL;
+		/* determine the list of symbols to add to compute the decoded source symbol,
+		 * i.e. the variables of the non-null elements of row i after column i */
+		ofcb->nb_tmp_symbols = 0;
+		for (j = w0; j < m->n_words; j++)
+		{
+			word = row[j];
+			if (j == w0)
+			{
+				/* ignore the pivot and the (null) elements before it */
+				word &= (b0 == of_mod2_wordsize_mask) ? 0 : ~(of_mod2word) 0 << (b0 + 1);
+			}
+			for (; word != 0; word &= word - 1)
 			{
-				of_add_from_multiple_symbols(variable_tab[i], (const void**)ofcb->tmp_tab_symbols,
-							     ofcb->nb_tmp_symbols, ofcb->encoding_symbol_length
+				ofcb->tmp_tab_symbols[ofcb->nb_tmp_symbols++] = variable_tab[(j << of_mod2_wordsize_shift) + __builtin_ctz(word)];
+			}
+		}
+		if (ofcb->nb_tmp_symbols != 0)
+		{
+			of_add_from_multiple_symbols(variable_tab[i], (const void**)ofcb->tmp_tab_symbols,
+						     ofcb->nb_tmp_symbols, ofcb->encoding_symbol_length
 #ifdef OF_DEBUG
-							     , &(ofcb->stats_xor->nb_xor_for_ML)
+						     , &(ofcb->stats_xor->nb_xor_for_ML)
 #endif
-								);
-			}
+							);
 		}
 	}
 	OF_EXIT_FUNCTION
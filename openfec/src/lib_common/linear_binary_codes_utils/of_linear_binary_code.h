@@ -48,10 +48,6 @@
 #include <IL/il.h>
 #endif
 
-#ifdef ASSEMBLY_SSE_OPT
-#include <xmmintrin.h>
-#endif
-
 #include "../of_rand.h"
 #include "../of_cb.h"
 #include "../of_mem.h"
@@ -60,6 +56,7 @@
 
 #include "binary_matrix/of_matrix_sparse.h"
 #include "binary_matrix/of_matrix_dense.h"
+#include "binary_matrix/of_matrix_csr.h"
 #include "of_create_pchk.h"
 
 #include "binary_matrix/of_matrix_convert.h"
@@ -85,6 +82,8 @@ typedef struct of_linear_binary_code_cb
 	UINT32		nb_total_symbols;	/** n parameter (AKA code length). */
 	/* parity check matrix */
 	of_mod2sparse*	pchk_matrix;
+	/* compressed copy of pchk_matrix walked by the IT decoder, NULL for encoders */
+	of_mod2csr	*pchk_csr;
 
 	/** statistics for this codec instance. */
 	of_symbol_stats_op_t	*stats_xor;
@@ -31,245 +31,322 @@
  * knowledge of the CeCILL-C license and that you accept its terms.
  */
 
+#include <pthread.h>
+
 #include "of_linear_binary_code.h"
 
 
 #ifdef OF_USE_LINEAR_BINARY_CODES_UTILS
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OF_XOR_X86
+#endif
 
-#ifndef OF_DEBUG
-void	of_add_from_multiple_symbols	(void		*to,
-					 const void	**from,
-					 UINT32		from_size,
-					 UINT32		symbol_size)
-#else
-void	of_add_from_multiple_symbols	(void		*to,
-					 const void	**from,
-					 UINT32		from_size,
-					 UINT32		symbol_size,
-					 UINT32		*op)
+#if defined(OF_XOR_NEON) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
 #endif
+
+
+/**
+ * Maximum number of "from" symbols handed to a kernel at once. Sources are
+ * accumulated in registers, so more than this only adds loop overhead.
+ */
+#define OF_XOR_MAX_SOURCES	8
+
+
+/**
+ * XOR the bytes [offset, symbol_size[ of all the "from" symbols into "to",
+ * using 64-bit words. This is both the portable kernel and the tail handler
+ * of the SIMD kernels. memcpy() keeps unaligned symbols safe and compiles to
+ * plain loads/stores.
+ */
+static void	of_xor_words (UINT8		*to,
+			      const UINT8	* const *from,
+			      UINT32		from_size,
+			      UINT32		offset,
+			      UINT32		symbol_size)
 {
-	OF_ENTER_FUNCTION
-#ifdef OF_DEBUG
-	if (op != NULL)
-		(*op)+=from_size;
-#endif
-	UINT32	i;
-//#ifndef ASSEMBLY_SSE_OPT /* { */
-	UINT32		symbolSize32;
-	UINT32		symbolSize32rem;
-	//printf("%i\n",from_size);
-	
-	symbolSize32	= symbol_size >> 2;
-	symbolSize32rem = symbol_size % 4;	// Remaining bytes when the symbol
-	// size is not multiple of 32 bits.
-	
-#if defined (__LP64__) || (__WORDSIZE == 64) // {
-	/*
-	 * 64-bit machines
-	 */
-	
-	UINT32		symbolSize64;		// Size of symbols in 64-bit unit
-	// symbol_size is not necessarily a multiple of 8, but >> 3 will divide
-	// it by 8 and keep the integral part automatically.
-	symbolSize64	= symbol_size >> 3;
-	while (from_size >=8)
+	UINT32	i = offset;
+	UINT32	j;
+	UINT64	acc, v;
+
+	for (; i + sizeof(UINT64) <= symbol_size; i += sizeof(UINT64))
 	{
-		 UINT64* t = (UINT64*) to;	// to pointer to 64-bit integers
-		 UINT64* ps1 = (UINT64*)from[0];
-		 UINT64* ps2 = (UINT64*)from[1];
-		 UINT64* ps3 = (UINT64*)from[2];
-		 UINT64* ps4 = (UINT64*)from[3];
-		 UINT64* ps5 = (UINT64*)from[4];
-		 UINT64* ps6 = (UINT64*)from[5];
-		 UINT64* ps7 = (UINT64*)from[6];
-		 UINT64* ps8 = (UINT64*)from[7];
-		from_size-=8;
-		from+=8;
-		for (i = symbolSize64; i > 0; i--)
-		{
-			*t ^= (*ps1 ^ *ps2 ^ *ps3 ^ *ps4 ^ *ps5 ^ *ps6 ^ *ps7 ^ *ps8);
-			t++;
-			ps1++;	
-			ps2++;
-			ps3++;
-			ps4++;
-			ps5++;
-			ps6++;
-			ps7++;
-			ps8++;		
-		}
-		UINT32* t32 = (UINT32*) t;	// to pointer to 32-bit integers
-		UINT32* ps1_32 = (UINT32*) ps1;	// from pointer to 32-bit integers
-		UINT32* ps2_32 = (UINT32*) ps2;	// from pointer to 32-bit integers
-		UINT32* ps3_32 = (UINT32*) ps3;	// from pointer to 32-bit integers
-		UINT32* ps4_32 = (UINT32*) ps4;	// from pointer to 32-bit integers
-		UINT32* ps5_32 = (UINT32*) ps5;	// from pointer to 32-bit integers
-		UINT32* ps6_32 = (UINT32*) ps6;	// from pointer to 32-bit integers
-		UINT32* ps7_32 = (UINT32*) ps7;	// from pointer to 32-bit integers
-		UINT32* ps8_32 = (UINT32*) ps8;	// from pointer to 32-bit integers
-		
-		/* then perform a 32-bit XOR if needed... */
-		if ( (symbolSize64 << 1) < symbolSize32)
+		memcpy(&acc, to + i, sizeof(UINT64));
+		for (j = 0; j < from_size; j++)
 		{
-			* (UINT32*) t32 ^= (* (UINT32*) ps1_32 ^ * (UINT32*) ps2_32 ^ * (UINT32*) ps3_32 ^ * (UINT32*) ps4_32 ^ 
-								* (UINT32*) ps5_32 ^ * (UINT32*) ps6_32 ^ * (UINT32*) ps7_32 ^ * (UINT32*) ps8_32);
-			ps1_32++;
-			ps2_32++;
-			ps3_32++;
-			ps4_32++;
-			ps5_32++;
-			ps6_32++;
-			ps7_32++;
-			ps8_32++;
-			t32++;
-		}
-		if (symbolSize32rem > 0)
-		{
-			for (i = 0; i < symbolSize32rem; i++)
-			{
-				* (UINT8*) ( (UINT8*) t32 + i) ^= ((* (UINT8*) ( (UINT8*) ps1_32 + i)) ^ (* (UINT8*) ( (UINT8*) ps2_32 + i) ) ^ 
-								   (* (UINT8*) ( (UINT8*) ps3_32 + i) ) ^ (* (UINT8*) ( (UINT8*) ps4_32 + i) ) ^ 
-								   (* (UINT8*) ( (UINT8*) ps5_32 + i) ) ^ (* (UINT8*) ( (UINT8*) ps6_32 + i) ) ^ 
-								   (* (UINT8*) ( (UINT8*) ps7_32 + i) ) ^ (* (UINT8*) ( (UINT8*) ps8_32 + i) ) );
-			}
+			memcpy(&v, from[j] + i, sizeof(UINT64));
+			acc ^= v;
 		}
+		memcpy(to + i, &acc, sizeof(UINT64));
 	}
-	while (from_size >=4)
+	for (; i < symbol_size; i++)
 	{
-		UINT64* t = (UINT64*) to;	// to pointer to 64-bit integers
-		UINT64* ps1 = (UINT64*)from[0];
-		UINT64* ps2 = (UINT64*)from[1];
-		UINT64* ps3 = (UINT64*)from[2];
-		UINT64* ps4 = (UINT64*)from[3];
-		from_size-=4;
-		from+=4;
-		for (i = symbolSize64; i > 0; i--)
-		{
-			*t ^= (*ps1 ^ *ps2 ^ *ps3 ^ *ps4);
-			t++;
-			ps1++;	
-			ps2++;
-			ps3++;
-			ps4++;		
-		}
-		UINT32* t32 = (UINT32*) t;	// to pointer to 32-bit integers
-		UINT32* ps1_32 = (UINT32*) ps1;	// from pointer to 32-bit integers
-		UINT32* ps2_32 = (UINT32*) ps2;	// from pointer to 32-bit integers
-		UINT32* ps3_32 = (UINT32*) ps3;	// from pointer to 32-bit integers
-		UINT32* ps4_32 = (UINT32*) ps4;	// from pointer to 32-bit integers
-		
-		/* then perform a 32-bit XOR if needed... */
-		if ( (symbolSize64 << 1) < symbolSize32)
+		UINT8	b = to[i];
+		for (j = 0; j < from_size; j++)
 		{
-			* (UINT32*) t32 ^= (* (UINT32*) ps1_32 ^ * (UINT32*) ps2_32 ^ * (UINT32*) ps3_32 ^ * (UINT32*) ps4_32 );
-			ps1_32++;
-			ps2_32++;
-			ps3_32++;
-			ps4_32++;
-			t32++;
-		}
-		if (symbolSize32rem > 0)
-		{
-			for (i = 0; i < symbolSize32rem; i++)
-			{
-				* (UINT8*) ( (UINT8*) t32 + i) ^= ((* (UINT8*) ( (UINT8*) ps1_32 + i)) ^ (* (UINT8*) ( (UINT8*) ps2_32 + i) ) ^ 
-								   (* (UINT8*) ( (UINT8*) ps3_32 + i) ) ^ (* (UINT8*) ( (UINT8*) ps4_32 + i) ) );
-			}
+			b ^= from[j][i];
 		}
+		to[i] = b;
 	}
-	while (from_size >=2)
+}
+
+
+static void	of_xor_generic (UINT8		*to,
+				const UINT8	* const *from,
+				UINT32		from_size,
+				UINT32		symbol_size)
+{
+	of_xor_words(to, from, from_size, 0, symbol_size);
+}
+
+
+static bool	of_xor_generic_supported (void)
+{
+	return true;
+}
+
+
+#ifdef OF_XOR_X86
+
+/*
+ * Unaligned loads cost the same as aligned ones on aligned data on every
+ * SSE2/AVX2 CPU still in use, so a single path handles both cases.
+ */
+__attribute__((target("sse2")))
+static void	of_xor_sse2 (UINT8		*to,
+			     const UINT8	* const *from,
+			     UINT32		from_size,
+			     UINT32		symbol_size)
+{
+	UINT32	i, j;
+	__m128i	acc;
+
+	for (i = 0; i + sizeof(__m128i) <= symbol_size; i += sizeof(__m128i))
 	{
-		UINT64* t = (UINT64*) to;	// to pointer to 64-bit integers
-		UINT64* ps1 = (UINT64*)from[0];
-		UINT64* ps2 = (UINT64*)from[1];
-		from+=2;
-		from_size-=2;
-		for (i = symbolSize64; i > 0; i--)
-		{
-			*t ^= (*ps1 ^ *ps2);
-			t++;
-			ps1++;	
-			ps2++;
-		}
-		UINT32* t32 = (UINT32*) t;	// to pointer to 32-bit integers
-		UINT32* ps1_32 = (UINT32*) ps1;	// from pointer to 32-bit integers
-		UINT32* ps2_32 = (UINT32*) ps2;	// from pointer to 32-bit integers
-		/* then perform a 32-bit XOR if needed... */
-		if ( (symbolSize64 << 1) < symbolSize32)
+		acc = _mm_loadu_si128((const __m128i*) (to + i));
+		for (j = 0; j < from_size; j++)
 		{
-			* (UINT32*) t32 ^= (* (UINT32*) ps1_32 ^ * (UINT32*) ps2_32);
-			ps1_32++;
-			ps2_32++;
-			t32++;
-		}
-		if (symbolSize32rem > 0)
-		{
-			for (i = 0; i < symbolSize32rem; i++)
-			{
-				* (UINT8*) ( (UINT8*) t32 + i) ^= ((* (UINT8*) ( (UINT8*) ps1_32 + i)) ^ (* (UINT8*) ( (UINT8*) ps2_32 + i) ));
-			}
+			acc = _mm_xor_si128(acc, _mm_loadu_si128((const __m128i*) (from[j] + i)));
 		}
+		_mm_storeu_si128((__m128i*) (to + i), acc);
 	}
-	
-	if (from_size == 0) return;
-	
-   	UINT64	*t = (UINT64*) to;	// to pointer to 64-bit integers
-	UINT64	*f = (UINT64*) from[0];	// from pointer to 64-bit integers
-	for (i = symbolSize64; i > 0; i--)
+	of_xor_words(to, from, from_size, i, symbol_size);
+}
+
+
+static bool	of_xor_sse2_supported (void)
+{
+	return __builtin_cpu_supports("sse2");
+}
+
+
+__attribute__((target("avx2")))
+static void	of_xor_avx2 (UINT8		*to,
+			     const UINT8	* const *from,
+			     UINT32		from_size,
+			     UINT32		symbol_size)
+{
+	UINT32	i, j;
+	__m256i	acc;
+	__m128i	acc128;
+
+	for (i = 0; i + sizeof(__m256i) <= symbol_size; i += sizeof(__m256i))
 	{
-		*t ^= *f;
-		t++;
-		f++;
+		acc = _mm256_loadu_si256((const __m256i*) (to + i));
+		for (j = 0; j < from_size; j++)
+		{
+			acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i*) (from[j] + i)));
+		}
+		_mm256_storeu_si256((__m256i*) (to + i), acc);
 	}
-	UINT32	*t32 = (UINT32*) t;	// to pointer to 32-bit integers
-	UINT32	*f32 = (UINT32*) f;	// from pointer to 32-bit integers
-	/* then perform a 32-bit XOR if needed... */
-	if ( (symbolSize64 << 1) < symbolSize32)
+	if (i + sizeof(__m128i) <= symbol_size)
 	{
-		* (UINT32*) t32 ^= * (UINT32*) f32;
-		t32++;
-		f32++;
+		acc128 = _mm_loadu_si128((const __m128i*) (to + i));
+		for (j = 0; j < from_size; j++)
+		{
+			acc128 = _mm_xor_si128(acc128, _mm_loadu_si128((const __m128i*) (from[j] + i)));
+		}
+		_mm_storeu_si128((__m128i*) (to + i), acc128);
+		i += sizeof(__m128i);
 	}
-	/* finally perform as many 8-bit XORs as needed if symbol size is not
-	* multiple of 32 bits... */
-	if (symbolSize32rem > 0)
+	of_xor_words(to, from, from_size, i, symbol_size);
+}
+
+
+static bool	of_xor_avx2_supported (void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif /* OF_XOR_X86 */
+
+
+#ifdef OF_XOR_NEON
+
+static void	of_xor_neon (UINT8		*to,
+			     const UINT8	* const *from,
+			     UINT32		from_size,
+			     UINT32		symbol_size)
+{
+	of_xor_words(to, from, from_size, of_xor_neon_blocks(to, from, from_size, symbol_size), symbol_size);
+}
+
+
+/*
+ * Advanced SIMD is mandatory on AArch64. On 32-bit ARM the kernel tells
+ * whether the CPU has NEON, the compiler flags don't.
+ */
+static bool	of_xor_neon_supported (void)
+{
+#ifdef __aarch64__
+	return true;
+#else
+	return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+}
+
+#endif /* OF_XOR_NEON */
+
+
+typedef struct of_xor_kernel_desc
+{
+	const char	*name;
+	of_xor_kernel_t	kernel;
+	bool		(*is_supported) (void);
+} of_xor_kernel_desc_t;
+
+
+/**
+ * Known kernels, from the most to the least preferred one.
+ */
+static const of_xor_kernel_desc_t	of_xor_kernels[] =
+{
+#ifdef OF_XOR_X86
+	{ "avx2",	of_xor_avx2,	of_xor_avx2_supported },
+	{ "sse2",	of_xor_sse2,	of_xor_sse2_supported },
+#endif
+#ifdef OF_XOR_NEON
+	{ "neon",	of_xor_neon,	of_xor_neon_supported },
+#endif
+	{ "generic",	of_xor_generic,	of_xor_generic_supported },
+};
+
+#define OF_NB_XOR_KERNELS	(sizeof(of_xor_kernels) / sizeof(of_xor_kernels[0]))
+
+
+/* Kernel used by all the symbol XOR functions. Correct before any selection. */
+static const of_xor_kernel_desc_t	*of_xor_current = &of_xor_kernels[OF_NB_XOR_KERNELS - 1];
+
+
+/* Sessions may be created from several threads, the kernel is chosen once. */
+static pthread_once_t	of_xor_kernel_once = PTHREAD_ONCE_INIT;
+
+
+static void	of_select_xor_kernel (void)
+{
+	UINT32	i;
+
+	for (i = 0; i < OF_NB_XOR_KERNELS; i++)
 	{
-		for (i = 0; i < symbolSize32rem; i++)
+		if (of_xor_kernels[i].is_supported())
 		{
-			* (UINT8*) ( (UINT8*) t32 + i) ^= * (UINT8*) ( (UINT8*) f32 + i);
+			of_xor_current = &of_xor_kernels[i];
+			break;
 		}
 	}
-												   
-#else //defined (__LP64__) || (__WORDSIZE == 64) } {
-	
-	/*
-	 * 32-bit machines
-	 */
-	UINT32		*t32 = (UINT32*) to;	// to pointer to 32-bit integers
-	UINT32		*f32 = (UINT32*)  from;	// from pointer	to 32-bit integers
-	/* First perform as many 32-bit XORs as needed... */
-	for (i = symbolSize32; i > 0; i--)
+	OF_TRACE_LVL(1, ("of_symbol_init_xor_kernel: using %s\n", of_xor_current->name))
+}
+
+
+void	of_symbol_init_xor_kernel (void)
+{
+	pthread_once(&of_xor_kernel_once, of_select_xor_kernel);
+}
+
+
+const char*	of_symbol_get_xor_kernel_name (UINT32	index)
+{
+	return (index < OF_NB_XOR_KERNELS) ? of_xor_kernels[index].name : NULL;
+}
+
+
+const char*	of_symbol_get_current_xor_kernel_name (void)
+{
+	return of_xor_current->name;
+}
+
+
+of_xor_kernel_t	of_symbol_get_current_xor_kernel (void)
+{
+	return of_xor_current->kernel;
+}
+
+
+of_xor_kernel_t	of_symbol_find_xor_kernel (const char	*name)
+{
+	UINT32	i;
+
+	for (i = 0; i < OF_NB_XOR_KERNELS; i++)
 	{
-		*t32 ^= *f32;
-		t32++;
-		f32++;
+		if (strcmp(of_xor_kernels[i].name, name) == 0)
+		{
+			return of_xor_kernels[i].is_supported() ? of_xor_kernels[i].kernel : NULL;
+		}
 	}
-	/* finally perform as many 8-bit XORs as needed if symbol size is not
-	 * multiple of 32 bits... */
-	if (symbolSize32rem > 0)
+	return NULL;
+}
+
+
+of_status_t	of_symbol_set_xor_kernel (const char	*name)
+{
+	UINT32	i;
+
+	/* so that a later codec instance doesn't override the choice */
+	of_symbol_init_xor_kernel();
+	for (i = 0; i < OF_NB_XOR_KERNELS; i++)
 	{
-		for (i = 0; i < symbolSize32rem; i++)
+		if (strcmp(of_xor_kernels[i].name, name) == 0 && of_xor_kernels[i].is_supported())
 		{
-			* (UINT8*) ( (UINT8*) t32 + i) ^= * (UINT8*) ( (UINT8*) f32 + i);
+			of_xor_current = &of_xor_kernels[i];
+			return OF_STATUS_OK;
 		}
 	}
-#endif //defined (__LP64__) || (__WORDSIZE == 64) }
-	
-//#else  /* } ASSEMBLY_SSE_OPT { */
+	OF_PRINT_ERROR(("of_symbol_set_xor_kernel: %s is unknown or not supported by this CPU\n", name))
+	return OF_STATUS_ERROR;
+}
+
 
-//#endif
+#ifndef OF_DEBUG
+void	of_add_from_multiple_symbols	(void		*to,
+					 const void	**from,
+					 UINT32		from_size,
+					 UINT32		symbol_size)
+#else
+void	of_add_from_multiple_symbols	(void		*to,
+					 const void	**from,
+					 UINT32		from_size,
+					 UINT32		symbol_size,
+					 UINT32		*op)
+#endif
+{
+	OF_ENTER_FUNCTION
+#ifdef OF_DEBUG
+	if (op != NULL)
+		(*op)+=from_size;
+#endif
+	UINT32	n;
+
+	while (from_size > 0)
+	{
+		n = (from_size < OF_XOR_MAX_SOURCES) ? from_size : OF_XOR_MAX_SOURCES;
+		of_xor_current->kernel((UINT8*) to, (const UINT8 * const *) from, n, symbol_size);
+		from += n;
+		from_size -= n;
+	}
+	OF_EXIT_FUNCTION
 }
 
 
@@ -291,235 +368,16 @@ void	of_add_to_multiple_symbols	(void		**to,
 	if (op != NULL)
 		(*op) += to_size;
 #endif
-	UINT32	i;
-	//#ifndef ASSEMBLY_SSE_OPT /* { */
-	UINT32		symbolSize32;
-	UINT32		symbolSize32rem;
-	
-	symbolSize32	= symbol_size >> 2;
-	symbolSize32rem = symbol_size % 4;	// Remaining bytes when the symbol
-	// size is not multiple of 32 bits.
-#if defined (__LP64__) || (__WORDSIZE == 64) // {
-	/*
-	 * 64-bit machines
-	 */
-	UINT32		symbolSize64;		// Size of symbols in 64-bit unit
-	// symbol_size is not necessarily a multiple of 8, but >> 3 will divide
-	// it by 8 and keep the integral part automatically.
-	symbolSize64	= symbol_size >> 3;
-	UINT64		*pt1, *pt2, *pt3, *pt4, *pt5, *pt6, *pt7, *pt8, *from_s, from_value;
-
-	while (to_size >= 8)
-	{
-		from_s = (UINT64*) from;	// to pointer to 64-bit integers
-		pt1 = (UINT64*)to[0];
-		pt2 = (UINT64*)to[1];
-		pt3 = (UINT64*)to[2];
-		pt4 = (UINT64*)to[3];
-		pt5 = (UINT64*)to[4];
-		pt6 = (UINT64*)to[5];
-		pt7 = (UINT64*)to[6];
-		pt8 = (UINT64*)to[7];
-		to += 8;
-		to_size -= 8;
-		for (i = symbolSize64; i > 0; i--)
-		{
-			from_value = *from_s;
-			*pt1 ^= from_value;
-			*pt2 ^= from_value ;
-			*pt3 ^= from_value ;
-			*pt4 ^= from_value ;
-			*pt5 ^= from_value ;
-			*pt6 ^= from_value ;
-			*pt7 ^= from_value ;
-			*pt8 ^= from_value ;
-			from_s++;
-			pt1++;	
-			pt2++;
-			pt3++;
-			pt4++;
-			pt5++;	
-			pt6++;
-			pt7++;
-			pt8++;			
-		}
-		UINT32* from_s32 = (UINT32*) from_s;	// to pointer to 32-bit integers
-                /* then perform a 32-bit XOR if needed... */
-		from_s32 = (UINT32*) from_s;    // pointer to 32-bit integers
-		if ( (symbolSize64 << 1) < symbolSize32)
-		{               
-			(* (UINT32*) pt1++) ^= *from_s32;
-			(* (UINT32*) pt2++) ^= *from_s32;
-			(* (UINT32*) pt3++) ^= *from_s32;
-			(* (UINT32*) pt4++) ^= *from_s32;
-			(* (UINT32*) pt5++) ^= *from_s32;
-			(* (UINT32*) pt6++) ^= *from_s32;
-			(* (UINT32*) pt7++) ^= *from_s32;
-			(* (UINT32*) pt8++) ^= *from_s32;
-			from_s32++;
-		}
-		if (symbolSize32rem > 0)
-		{
-			UINT8* s8;
-			for (i = 0; i < symbolSize32rem; i++)
-			{
-				s8  = ( (UINT8*) from_s32 + i);
-				(* (UINT8*) ( (UINT8*) pt1 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt2 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt3 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt4 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt5 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt6 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt7 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt8 + i)) ^= * (UINT8*) s8;	 
-			}
-		}
-	}
-	while (to_size >= 4)
-	{
-		UINT32	*from_s32;		// to pointer to 32-bit integers
-
-		from_s = (UINT64*) from;	// to pointer to 64-bit integers
-		pt1 = (UINT64*)to[0];
-		pt2 = (UINT64*)to[1];
-		pt3 = (UINT64*)to[2];
-		pt4 = (UINT64*)to[3];
-		to += 4;
-		to_size -= 4;
-		for (i = symbolSize64; i > 0; i--)
-		{
-			from_value = *from_s;
-			*pt1 ^= from_value;
-			*pt2 ^= from_value;
-			*pt3 ^= from_value;
-			*pt4 ^= from_value;
-			from_s++;
-			pt1++;	
-			pt2++;
-			pt3++;
-			pt4++;		
-		}
-		/* then perform a 32-bit XOR if needed... */ 
-		from_s32 = (UINT32*) from_s;
-		if ( (symbolSize64 << 1) < symbolSize32) 
-		{ 
-			(* (UINT32*) pt1++) ^= *from_s32; 
-			(* (UINT32*) pt2++) ^= *from_s32; 
-			(* (UINT32*) pt3++) ^= *from_s32; 
-			(* (UINT32*) pt4++) ^= *from_s32;                        
-			from_s32++; 
-		} 
-		if (symbolSize32rem > 0)
-		{
-			UINT8	*s8;
-			for (i = 0; i < symbolSize32rem; i++)
-			{
-				s8  = ( (UINT8*) from_s32 + i);
-				(* (UINT8*) ( (UINT8*) pt1 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt2 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt3 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt4 + i)) ^= * (UINT8*) s8;
-			}
-		}
-	}
-	while (to_size >= 2)
-	{
-		UINT32	*from_s32;			// to pointer to 32-bit integers
-
-		from_s = (UINT64*) from;	// to pointer to 64-bit integers
-		pt1 = (UINT64*)to[0];
-		pt2 = (UINT64*)to[1];
-
-		to += 2;
-		to_size -= 2;
-		for (i = symbolSize64; i > 0; i--)
-		{
-			*pt1 ^= *from_s ;
-			*pt2 ^= *from_s ;
-			from_s++;
-			pt1++;	
-			pt2++;
-		}
-                /* then perform a 32-bit XOR if needed... */
-                from_s32 = (UINT32*) from_s;    // pointer to 32-bit integers
-                if ( (symbolSize64 << 1) < symbolSize32) 
-                { 
-                        (* (UINT32*) pt1++) ^= *from_s32; 
-                        (* (UINT32*) pt2++) ^= *from_s32; 
-                        from_s32++; 
-                }
-		if (symbolSize32rem > 0)
-		{
-			UINT8	*s8;
-			for (i = 0; i < symbolSize32rem; i++)
-			{
-				s8  = ( (UINT8*) from_s32 + i);
-				(* (UINT8*) ( (UINT8*) pt1 + i)) ^= * (UINT8*) s8;
-				(* (UINT8*) ( (UINT8*) pt2 + i)) ^= * (UINT8*) s8;
-			}
-		}
-	}
-	
-	if (to_size == 0) return;
-	
-   	UINT64	*t = (UINT64*) to[0];	// to pointer to 64-bit integers
-	UINT64	*f = (UINT64*) from;	// from pointer to 64-bit integers
-	for (i = symbolSize64; i > 0; i--)
-	{
-		*t ^= *f;
-		t++;
-		f++;
-	}
-	UINT32* t32 = (UINT32*) t;	// to pointer to 32-bit integers
-	UINT32		*f32 = (UINT32*) f;	// from pointer to 32-bit integers
-	/* then perform a 32-bit XOR if needed... */
-	if ( (symbolSize64 << 1) < symbolSize32)
-	{
-		* (UINT32*) t32 ^= * (UINT32*) f32;
-		t32++;
-		f32++;
-	}
-	/* finally perform as many 8-bit XORs as needed if symbol size is not
-	 * multiple of 32 bits... */
-	if (symbolSize32rem > 0)
-	{
-		for (i = 0; i < symbolSize32rem; i++)
-		{
-			* (UINT8*) ( (UINT8*) t32 + i) ^= * (UINT8*) ( (UINT8*) f32 + i);
-		}
-	}
+	const UINT8	*src = (const UINT8*) from;
+	UINT32		i;
 
-#else //defined (__LP64__) || (__WORDSIZE == 64) } {
-	
-	/*
-	 * 32-bit machines
-	 */
-	UINT32		*t32 = (UINT32*) to;	// to pointer to 32-bit integers
-	UINT32		*f32 = (UINT32*)  from;	// from pointer	to 32-bit integers
-	/* First perform as many 32-bit XORs as needed... */
-	for (i = symbolSize32; i > 0; i--)
-	{
-		*t32 ^= *f32;
-		t32++;
-		f32++;
-	}
-	/* finally perform as many 8-bit XORs as needed if symbol size is not
-	 * multiple of 32 bits... */
-	if (symbolSize32rem > 0)
+	for (i = 0; i < to_size; i++)
 	{
-		for (i = 0; i < symbolSize32rem; i++)
-		{
-			* (UINT8*) ( (UINT8*) t32 + i) ^= * (UINT8*) ( (UINT8*) f32 + i);
-		}
+		of_xor_current->kernel((UINT8*) to[i], &src, 1, symbol_size);
 	}
-#endif //defined (__LP64__) || (__WORDSIZE == 64) }
-	
-	//#else  /* } ASSEMBLY_SSE_OPT { */
-	
-	//#endif /* } ASSEMBLY_SSE_OPT */
+	OF_EXIT_FUNCTION
 }
-	
-	
+
 
 #ifdef OF_DEBUG
 void	of_add_to_symbol (void		*to,
@@ -533,114 +391,13 @@ void	of_add_to_symbol (void		*to,
 #endif
 {
 	//OF_ENTER_FUNCTION
-	UINT32		i;
 #ifdef OF_DEBUG
 	if (op != NULL)
 		(*op)++;
 #endif
-#ifndef ASSEMBLY_SSE_OPT /* { */
-	UINT32		symbolSize32;
-	UINT32		symbolSize32rem;
-
-	symbolSize32	= symbol_size >> 2;
-	symbolSize32rem = symbol_size % 4;	// Remaining bytes when the symbol
-						// size is not multiple of 32 bits.
-
-#if defined (__LP64__) || (__WORDSIZE == 64) // {
-	/*
-	 * 64-bit machines
-	 */
-
-	UINT32		symbolSize64;		// Size of symbols in 64-bit unit
-	// symbol_size is not necessarily a multiple of 8, but >> 3 will divide
-	// it by 8 and keep the integral part automatically.
-	symbolSize64	= symbol_size >> 3;
-	/* First perform as many 64-bit XORs as needed... */
-	UINT64		*t = (UINT64*) to;	// to pointer to 64-bit integers
-	UINT64		*f = (UINT64*) from;	// from pointer to 64-bit integers
-	for (i = symbolSize64; i > 0; i--)
-	{
-		*t ^= *f;
-		t++;
-		f++;
-	}
-	UINT32		*t32 = (UINT32*) t;	// to pointer to 32-bit integers
-	UINT32		*f32 = (UINT32*) f;	// from pointer to 32-bit integers
-	/* then perform a 32-bit XOR if needed... */
-	if ( (symbolSize64 << 1) < symbolSize32)
-	{
-		* (UINT32*) t32 ^= * (UINT32*) f32;
-		t32++;
-		f32++;
-	}
-	/* finally perform as many 8-bit XORs as needed if symbol size is not
-	 * multiple of 32 bits... */
-	if (symbolSize32rem > 0)
-	{
-		for (i = 0; i < symbolSize32rem; i++)
-		{
-			* (UINT8*) ( (UINT8*) t32 + i) ^= * (UINT8*) ( (UINT8*) f32 + i);
-		}
-	}
+	const UINT8	*src = (const UINT8*) from;
 
-#else //defined (__LP64__) || (__WORDSIZE == 64) } {
-
-	/*
-	 * 32-bit machines
-	 */
-	UINT32		*t32 = (UINT32*) to;	// to pointer to 32-bit integers
-	UINT32		*f32 = (UINT32*) from;	// from pointer	to 32-bit integers
-	/* First perform as many 32-bit XORs as needed... */
-	for (i = symbolSize32; i > 0; i--)
-	{
-		*t32 ^= *f32;
-		t32++;
-		f32++;
-	}
-	/* finally perform as many 8-bit XORs as needed if symbol size is not
-	* multiple of 32 bits... */
-	if (symbolSize32rem > 0)
-	{
-		for (i = 0; i < symbolSize32rem; i++)
-		{
-			* (UINT8*) ( (UINT8*) t32 + i) ^= * (UINT8*) ( (UINT8*) f32 + i);
-		}
-	}
-#endif //defined (__LP64__) || (__WORDSIZE == 64) }
-
-#else  /* } ASSEMBLY_SSE_OPT { */
-
-	/*
-	 * machine with SSE capable CPU
-	 * Use assembly language to XOR two 128 bit registers at a time.
-	 */
-	UINT32 symbolSize32rem = symbol_size % 16;	// Remaining bytes when the symbol
-						// size is not multiple of 32 bits.
-	UINT32 symbolSize128;
-	symbolSize128	= symbol_size >> 4;
-	float *dst128;
-	float *src128;
-	dst128 = (float *) to;
-	src128 = (float *) from;
-	__m128 a, b;
-
-	for (i = symbolSize128  ; i--  ;)
-	{
-		a = _mm_load_ps (dst128);
-		b = _mm_load_ps (src128);
-		a = _mm_xor_ps (a, b);
-		_mm_store_ps (dst128, a);
-		dst128 += 4;
-		src128 += 4;
-	}
-	if (symbolSize32rem > 0)
-	{
-		for (i = 0; i < symbolSize32rem; i++)
-		{
-			* (UINT8*) ( (UINT8*) dst128 + i) ^= * (UINT8*) ( (UINT8*) src128 + i);
-		}
-	}
-#endif /* } ASSEMBLY_SSE_OPT */
+	of_xor_current->kernel((UINT8*) to, &src, 1, symbol_size);
 	OF_EXIT_FUNCTION
 }
 
@@ -77,6 +77,87 @@ typedef struct of_symbol_stats_op
  */
 #define of_get_symbol_col(ofcb,esi)		(((esi) < (ofcb)->nb_source_symbols) ? (INT32)((esi) + (ofcb)->nb_repair_symbols) : (INT32)((esi) - (ofcb)->nb_source_symbols))
 
+/**
+ * XOR kernel: to = to + from[0] + ... + from[from_size - 1].
+ * All the symbol XOR functions below end up in the kernel chosen by
+ * of_symbol_init_xor_kernel(). Symbols do not need any particular alignment.
+ *
+ * @param to		(IN/OUT) source symbol.
+ * @param from		(IN) symbols added to the source symbol.
+ * @param from_size	(IN) number of "from" symbols
+ * @param symbol_size	(IN) size in byte
+ */
+typedef void (*of_xor_kernel_t) (UINT8			*to,
+				 const UINT8 * const	*from,
+				 UINT32			from_size,
+				 UINT32			symbol_size);
+
+#if defined(__arm__) || defined(__aarch64__)
+#define OF_XOR_NEON
+
+/**
+ * NEON part of the NEON XOR kernel, built on its own with NEON enabled.
+ * Only XORs whole 16-byte blocks, and nothing at all when of_symbol_neon.c
+ * was built without NEON. Only call it once the CPU is known to have NEON.
+ *
+ * @param to		(IN/OUT) source symbol.
+ * @param from		(IN) symbols added to the source symbol.
+ * @param from_size	(IN) number of "from" symbols
+ * @param symbol_size	(IN) size in byte
+ * @return		offset of the first byte left for the caller to XOR
+ */
+UINT32	of_xor_neon_blocks	(UINT8			*to,
+				 const UINT8 * const	*from,
+				 UINT32			from_size,
+				 UINT32			symbol_size);
+#endif
+
+/**
+ * Select the fastest XOR kernel supported by the CPU: AVX2 or SSE2 on x86,
+ * NEON on ARM when AT_HWCAP reports it (always on AArch64), and a portable
+ * 64-bit one otherwise. Only the first call does anything,
+ * concurrent calls wait for it. Called when a codec instance is created, the
+ * portable kernel is used until then.
+ */
+void	of_symbol_init_xor_kernel	(void);
+
+/**
+ * Get the name of a known XOR kernel, whether or not this CPU supports it.
+ *
+ * @param index		(IN) kernel index, starting at 0
+ * @return		kernel name or NULL if index is past the last kernel
+ */
+const char*	of_symbol_get_xor_kernel_name	(UINT32		index);
+
+/**
+ * @return		name of the XOR kernel currently in use
+ */
+const char*	of_symbol_get_current_xor_kernel_name	(void);
+
+/**
+ * @return		the XOR kernel currently in use, for callers XORing
+ *			buffers that are not symbols (e.g. packed matrix rows)
+ */
+of_xor_kernel_t	of_symbol_get_current_xor_kernel	(void);
+
+/**
+ * Get a XOR kernel by name, e.g. to benchmark it.
+ *
+ * @param name		(IN) kernel name
+ * @return		the kernel or NULL if it is unknown or not supported
+ *			by this CPU
+ */
+of_xor_kernel_t	of_symbol_find_xor_kernel	(const char	*name);
+
+/**
+ * Force the XOR kernel used by the symbol XOR functions.
+ *
+ * @param name		(IN) kernel name
+ * @return		Error status. Fails if the kernel is unknown or not
+ *			supported by this CPU.
+ */
+of_status_t	of_symbol_set_xor_kernel	(const char	*name);
+
 /**
  * Compute the XOR sum of two symbols: to = to + from.
  * This function must be highly optimized, since it is one of the most computationally
@@ -0,0 +1,84 @@
+/* $Id: of_symbol_neon.c $ */
+/*
+ * OpenFEC.org AL-FEC Library.
+ * (c) Copyright 2009 - 2012 INRIA - All rights reserved
+ * Contact: vincent.roca@inria.fr
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+
+/*
+ * NEON XOR kernel. On 32-bit ARM this is the only OpenFEC file built with
+ * -mfpu=neon, so that no NEON instruction runs before of_symbol.c has
+ * checked the CPU has it.
+ */
+
+#include "of_linear_binary_code.h"
+
+
+#ifdef OF_USE_LINEAR_BINARY_CODES_UTILS
+#ifdef OF_XOR_NEON
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+UINT32	of_xor_neon_blocks (UINT8		*to,
+			    const UINT8	* const *from,
+			    UINT32		from_size,
+			    UINT32		symbol_size)
+{
+	UINT32		i, j;
+	uint8x16_t	acc;
+
+	for (i = 0; i + sizeof(uint8x16_t) <= symbol_size; i += sizeof(uint8x16_t))
+	{
+		acc = vld1q_u8(to + i);
+		for (j = 0; j < from_size; j++)
+		{
+			acc = veorq_u8(acc, vld1q_u8(from[j] + i));
+		}
+		vst1q_u8(to + i, acc);
+	}
+	return i;
+}
+
+#else
+
+/* Built without NEON enabled: leave the whole symbol to the caller. */
+UINT32	of_xor_neon_blocks (UINT8		*to,
+			    const UINT8	* const *from,
+			    UINT32		from_size,
+			    UINT32		symbol_size)
+{
+	return 0;
+}
+
+#endif /* __ARM_NEON */
+
+#endif /* OF_XOR_NEON */
+#endif /* OF_USE_LINEAR_BINARY_CODES_UTILS */
@@ -60,6 +60,9 @@ of_status_t	of_create_codec_instance (of_session_t**	ses,
 	
 	OF_ENTER_FUNCTION
 	of_verbosity = verbosity;
+#ifdef OF_USE_LINEAR_BINARY_CODES_UTILS
+	of_symbol_init_xor_kernel();
+#endif
 	/**
 	 * each codec must realloc control block.
 	 */
@@ -69,17 +69,10 @@
 #define OF_USE_LINEAR_BINARY_CODES_UTILS
 #define OF_USE_GALOIS_FIELD_CODES_UTILS
 
-/**
- * Define if you need SSE optimizations for XOR operations.
- * This is useful for PC usage, with processors that support this
- * extension (i.e. all the processors except the very old ones).
- */
-//#define ASSEMBLY_SSE_OPT
- 
 /*
- * NB: if SSE is not defined, then we'll use regular XOR operations,
- * either on 32 bit or 64 bit integers depending on the operating
- * system.
+ * NB: XOR operations on symbols use SSE2/AVX2 (x86) or NEON (ARM) when the
+ * CPU supports it, and 64-bit integer XORs otherwise. The kernel is
+ * chosen at run time, see of_symbol_init_xor_kernel().
  */
 
 #endif // OF_OPENFEC_PROFILE_H
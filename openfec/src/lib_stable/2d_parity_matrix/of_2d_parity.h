@@ -65,6 +65,8 @@ typedef struct of_2d_parity_cb
 
 	/* parity check matrix */
 	of_mod2sparse*	pchk_matrix;
+	/* compressed copy of pchk_matrix walked by the IT decoder, NULL for encoders */
+	of_mod2csr	*pchk_csr;
 
 	/** usage statistics, for this codec instance. */
 	of_symbol_stats_op_t		*stats_xor;
@@ -101,6 +103,9 @@ typedef struct of_2d_parity_cb
 	UINT16*		tab_nb_equ_for_repair;
 	
 		void** repair_symbols_values;
+	/* unused, keeps the layout in line with of_linear_binary_code_cb_t */
+	void		** tmp_tab_symbols;
+	UINT16		nb_tmp_symbols;
 #endif /* } OF_USE_DECODER */
 
 	void 		**encoding_symbols_tab;
@@ -69,6 +69,11 @@ of_status_t	of_2d_parity_release_codec_instance (of_2d_parity_cb_t*	ofcb)
 		of_free (ofcb->pchk_matrix);
 		ofcb->pchk_matrix  = NULL;
 	}
+	if (ofcb->pchk_csr != NULL)
+	{
+		of_mod2csr_free (ofcb->pchk_csr);
+		ofcb->pchk_csr = NULL;
+	}
 	if (ofcb->encoding_symbols_tab != NULL)
 	{
 		/* do not try to free source buffers, it's the responsibility of the application
@@ -242,6 +247,11 @@ of_status_t	of_2d_parity_set_fec_parameters (of_2d_parity_cb_t*	ofcb,
 				ofcb->tab_nb_equ_for_repair[seq - ofcb->nb_source_symbols]++;
 			}
 		}
+		// and the compressed copy of the matrix walked by the IT decoder
+		if ((ofcb->pchk_csr = of_mod2csr_from_sparse (ofcb->pchk_matrix)) == NULL)
+		{
+			goto error;
+		}
 	}
 #endif //OF_USE_DECODER
 	ofcb->nb_source_symbol_ready = 0; // Number of source symbols ready
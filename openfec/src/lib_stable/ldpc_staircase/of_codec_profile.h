@@ -97,3 +97,14 @@
 #define OF_LDPC_STAIRCASE_MAX_NB_ENCODING_SYMBOLS_DEFAULT	100000
 #endif
 #endif
+
+
+/**
+ * Number of parity check matrices kept in the matrix cache, indexed by (n-k, n, N1,
+ * PRNG seed). A session whose parameters hit the cache copies the matrix instead of
+ * building it again, which avoids the PRNG and the duplicate entry checks of the
+ * RFC 5170 construction. Set it to 0 to disable the cache.
+ */
+#ifndef OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE
+#define OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE	4
+#endif
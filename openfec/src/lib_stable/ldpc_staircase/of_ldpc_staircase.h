@@ -54,6 +54,8 @@ typedef struct of_ldpc_staircase_cb
 
 	/* parity check matrix */
 	of_mod2sparse	*pchk_matrix;
+	/* compressed copy of pchk_matrix walked by the IT decoder, NULL for encoders */
+	of_mod2csr	*pchk_csr;
 
 	/** usage statistics for this codec instance. */
 	of_symbol_stats_op_t	*stats_xor;
@@ -116,6 +118,8 @@ typedef struct of_ldpc_staircase_cb
 	UINT8		N1;
 	/** During H1 creation, have extra entries been added per row to make the row hamming weight at least two? */
 	bool		extra_entries_added_in_pchk;
+	/** Has the parity check matrix been copied from the matrix cache rather than built? */
+	bool		pchk_from_cache;
 	/** ESI of first non decoded source symbol. Used by is_decoding_complete function. */
 	UINT32		first_non_decoded;
 } of_ldpc_staircase_cb_t;
@@ -321,6 +325,23 @@ of_mod2sparse* of_create_pchck_matrix_rfc5170_compliant (UINT32			nb_rows,
 							 UINT32			seed,
 							 of_ldpc_staircase_cb_t	*ofcb);
 
+/**
+ * @brief		Get a private copy of the RFC 5170 matrix for these parameters, from the
+ *			matrix cache if it was built recently, otherwise by building (and caching) it.
+ *			The cache is not thread safe, like the PRNG used to build the matrix.
+ * @param nb_rows	(IN) number of rows, also equal to n-k.
+ * @param nb_cols	(IN) number of columns, also equal to n.
+ * @param left_degree	(IN) another name of the N1 parameter.
+ * @param seed		(IN) seed to use for the PRNG.
+ * @param ofcb		(IN/OUT) extra_entries_added_in_pchk and pchk_from_cache are updated.
+ * @return		pointer to the parity check matrix, owned by the caller.
+ */
+of_mod2sparse* of_ldpc_staircase_get_pchk_matrix (UINT32			nb_rows,
+						  UINT32			nb_cols,
+						  UINT32			left_degree,
+						  UINT32			seed,
+						  of_ldpc_staircase_cb_t	*ofcb);
+
 #endif  //OF_USE_DECODER
 
 #endif //OF_LDPC_STAIRCASE_H
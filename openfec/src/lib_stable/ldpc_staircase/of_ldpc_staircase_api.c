@@ -66,6 +66,11 @@ of_status_t	of_ldpc_staircase_release_codec_instance (of_ldpc_staircase_cb_t*	of
 		of_free (ofcb->pchk_matrix);
 		ofcb->pchk_matrix  = NULL;
 	}
+	if (ofcb->pchk_csr != NULL)
+	{
+		of_mod2csr_free (ofcb->pchk_csr);
+		ofcb->pchk_csr = NULL;
+	}
 	if (ofcb->encoding_symbols_tab != NULL)
 	{
 		/* do not try to free source buffers, it's the responsibility of the application
@@ -212,7 +217,7 @@ of_status_t	of_ldpc_staircase_set_fec_parameters (of_ldpc_staircase_cb_t*	ofcb,
 			ofcb->nb_source_symbols, ofcb->nb_repair_symbols, ofcb->nb_total_symbols,
 			ofcb->encoding_symbol_length, ofcb->prng_seed, ofcb->N1))
 	/* it's now time to create the parity check matrix! */
-	ofcb->pchk_matrix = of_create_pchck_matrix_rfc5170_compliant
+	ofcb->pchk_matrix = of_ldpc_staircase_get_pchk_matrix
 						  (ofcb->nb_repair_symbols,
 						   ofcb->nb_total_symbols,
 						   ofcb->N1,
@@ -288,6 +293,11 @@ of_status_t	of_ldpc_staircase_set_fec_parameters (of_ldpc_staircase_cb_t*	ofcb,
 				ofcb->tab_nb_equ_for_repair[seq - ofcb->nb_source_symbols]++;
 			}
 		}
+		// and the compressed copy of the matrix walked by the IT decoder
+		if ((ofcb->pchk_csr = of_mod2csr_from_sparse (ofcb->pchk_matrix)) == NULL)
+		{
+			goto error;
+		}
 		ofcb->tmp_tab_symbols = (void**)of_malloc(sizeof(void*)*ofcb->nb_total_symbols);
 	}
 #endif //OF_USE_DECODER
@@ -556,6 +566,15 @@ of_status_t	of_ldpc_staircase_get_control_parameter (of_ldpc_staircase_cb_t*	ofc
 		}
 		break;
 
+	case OF_CRTL_LDPC_STAIRCASE_IS_PCHK_FROM_CACHE:
+		if (value == NULL || length != sizeof(UINT32)) {
+			OF_PRINT_ERROR(("%s: OF_CRTL_LDPC_STAIRCASE_IS_PCHK_FROM_CACHE ERROR: null value or bad length (got %d, expected %zd)\n",
+				__FUNCTION__, length, sizeof(UINT32)))
+			goto error;
+		}
+		*(UINT32*)value = ofcb->pchk_from_cache ? 1 : 0;
+		break;
+
 	default:
 		OF_PRINT_ERROR(("%s: unknown type (%d)\n", __FUNCTION__, type))
 		goto error;
@@ -76,6 +76,21 @@ typedef struct of_ldpc_parameters
  */
 #define	OF_CRTL_LDPC_STAIRCASE_IS_LAST_SYMBOL_NULL	1024
 
+/**
+ * Ask the OF library if the parity check matrix of this session was copied from the
+ * matrix cache (see OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE) rather than built from scratch.
+ * Argument: UINT32, since the size of bool depends on whether the application uses
+ * stdbool.h.
+ */
+#define	OF_CRTL_LDPC_STAIRCASE_IS_PCHK_FROM_CACHE	1025
+
+
+/**
+ * Free the parity check matrices kept by the LDPC-Staircase matrix cache. Sessions
+ * already created are not affected, they own a private copy of their matrix.
+ */
+void	of_ldpc_staircase_flush_pchk_cache (void);
+
 
 #endif  /* OF_CODEC_STABLE_LDPC_SCSTAIRCASE_API */
 
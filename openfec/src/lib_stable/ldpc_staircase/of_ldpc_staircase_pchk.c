@@ -178,4 +178,123 @@ of_mod2sparse* of_create_pchck_matrix_rfc5170_compliant (UINT32		nb_rows,
 	return pchkMatrix;
 }
 
+
+
+#if OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE > 0
+
+/**
+ * Matrices already built, so that objects sharing the same code parameters
+ * only pay for a copy of the matrix. Entries are evicted in LRU order.
+ */
+typedef struct
+{
+	UINT32		nb_rows;
+	UINT32		nb_cols;
+	UINT32		left_degree;
+	UINT32		seed;
+	bool		extra_entries_added_in_pchk;
+	UINT32		last_use;	/* value of of_pchk_cache_clock at last lookup, 0 if unused */
+	of_mod2sparse	*matrix;	/* pristine matrix, never handed out */
+} of_pchk_cache_entry_t;
+
+static of_pchk_cache_entry_t	of_pchk_cache[OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE];
+static UINT32			of_pchk_cache_clock = 0;
+
+
+/* Returns a private copy of a cached matrix, or NULL if out of memory. */
+static of_mod2sparse* of_pchk_cache_copy (of_pchk_cache_entry_t	*entry,
+					  of_ldpc_staircase_cb_t	*ofcb)
+{
+	of_mod2sparse	*copy;
+
+	if ((copy = of_mod2sparse_allocate (entry->nb_rows, entry->nb_cols)) == NULL)
+	{
+		return NULL;
+	}
+	of_mod2sparse_copy (entry->matrix, copy);
+	ofcb->extra_entries_added_in_pchk = entry->extra_entries_added_in_pchk;
+	entry->last_use = ++of_pchk_cache_clock;
+	return copy;
+}
+
+#endif /* OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE > 0 */
+
+
+of_mod2sparse* of_ldpc_staircase_get_pchk_matrix (UINT32			nb_rows,
+						  UINT32			nb_cols,
+						  UINT32			left_degree,
+						  UINT32			seed,
+						  of_ldpc_staircase_cb_t	*ofcb)
+{
+	OF_ENTER_FUNCTION
+	of_mod2sparse	*pchkMatrix;
+#if OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE > 0
+	of_pchk_cache_entry_t	*entry;
+	of_pchk_cache_entry_t	*victim = &of_pchk_cache[0];
+	UINT32		i;
+
+	for (i = 0; i < OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE; i++)
+	{
+		entry = &of_pchk_cache[i];
+		if (entry->matrix != NULL && entry->nb_rows == nb_rows && entry->nb_cols == nb_cols &&
+		    entry->left_degree == left_degree && entry->seed == seed)
+		{
+			OF_TRACE_LVL(1, ("%s: parity check matrix found in cache\n", __FUNCTION__))
+			ofcb->pchk_from_cache = true;
+			pchkMatrix = of_pchk_cache_copy (entry, ofcb);
+			OF_EXIT_FUNCTION
+			return pchkMatrix;
+		}
+		if (entry->last_use < victim->last_use)
+		{
+			victim = entry;
+		}
+	}
+#endif
+	ofcb->pchk_from_cache = false;
+	if ((pchkMatrix = of_create_pchck_matrix_rfc5170_compliant (nb_rows, nb_cols, left_degree, seed, ofcb)) == NULL)
+	{
+		OF_EXIT_FUNCTION
+		return NULL;
+	}
+#if OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE > 0
+	/* keep the freshly built matrix and hand out a copy of it */
+	if (victim->matrix != NULL)
+	{
+		of_mod2sparse_free (victim->matrix);
+		of_free (victim->matrix);
+	}
+	victim->nb_rows = nb_rows;
+	victim->nb_cols = nb_cols;
+	victim->left_degree = left_degree;
+	victim->seed = seed;
+	victim->extra_entries_added_in_pchk = ofcb->extra_entries_added_in_pchk;
+	victim->matrix = pchkMatrix;
+	pchkMatrix = of_pchk_cache_copy (victim, ofcb);
+#endif
+	OF_EXIT_FUNCTION
+	return pchkMatrix;
+}
+
+
+void of_ldpc_staircase_flush_pchk_cache (void)
+{
+	OF_ENTER_FUNCTION
+#if OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE > 0
+	UINT32		i;
+
+	for (i = 0; i < OF_LDPC_STAIRCASE_PCHK_CACHE_SIZE; i++)
+	{
+		if (of_pchk_cache[i].matrix != NULL)
+		{
+			of_mod2sparse_free (of_pchk_cache[i].matrix);
+			of_free (of_pchk_cache[i].matrix);
+		}
+	}
+	memset (of_pchk_cache, 0, sizeof(of_pchk_cache));
+	of_pchk_cache_clock = 0;
+#endif
+	OF_EXIT_FUNCTION
+}
+
 #endif /* #ifdef OF_USE_LDPC_STAIRCASE_CODEC */
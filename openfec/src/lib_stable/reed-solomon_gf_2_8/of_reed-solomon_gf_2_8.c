@@ -32,6 +32,8 @@
  * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
  * OF SUCH DAMAGE.
  */
+#include <pthread.h>
+
 #include "of_reed-solomon_gf_2_8_includes.h"
 
 #ifdef OF_USE_REED_SOLOMON_CODEC
@@ -441,6 +443,233 @@ of_addmul1 (gf *dst1, gf *src1, gf c, int sz)
 
 #endif //defined (__LP64__) || (__WORDSIZE == 64)
 
+
+/*
+ * Multi-row multiply-accumulate, used to build several symbols in a single
+ * pass over the source data:
+ *	dst[r] = dst[r] + sum over s of c[r * nb_src + s] * src[s]
+ * The SIMD kernels walk the symbols one vector at a time. For each vector,
+ * every destination row is loaded and stored once while the source vectors,
+ * (nb_src + nb_rows) * 32 bytes at most, stay in L1. Products come from two
+ * 16-entry tables per constant, one for each nibble of the source byte, that
+ * are looked up with a byte shuffle.
+ */
+#if (GF_BITS == 8)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OF_GF_X86
+#endif
+
+#if defined(OF_GF_NEON) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/* c * x for the low and the high nibble of x, 16 entries per constant */
+static gf of_gf_mul_lo[GF_SIZE + 1][16] __attribute__((aligned(16)));
+static gf of_gf_mul_hi[GF_SIZE + 1][16] __attribute__((aligned(16)));
+
+static void
+of_rs_init_split_tables (void)
+{
+	int c, x;
+	for (c = 0; c < GF_SIZE + 1; c++)
+	{
+		for (x = 0; x < 16; x++)
+		{
+			of_gf_mul_lo[c][x] = of_gf_mul (c, x);
+			of_gf_mul_hi[c][x] = of_gf_mul (c, x << 4);
+		}
+	}
+}
+
+
+/*
+ * Bytes [offset, sz[ of every row, the scalar tail of the SIMD kernels.
+ */
+static void
+of_addmul_rows_tail (gf **dst, int nb_rows, gf **src, int nb_src, const gf *c, int offset, int sz)
+{
+	int r, s, i;
+	for (r = 0; r < nb_rows; r++)
+	{
+		for (s = 0; s < nb_src; s++)
+		{
+			const gf *mulc = of_gf_mul_table[c[r * nb_src + s]];
+			for (i = offset; i < sz; i++)
+				dst[r][i] ^= mulc[src[s][i]];
+		}
+	}
+}
+
+
+static void
+of_addmul_rows_generic (gf **dst, int nb_rows, gf **src, int nb_src, const gf *c, int sz)
+{
+	int r, s;
+	for (r = 0; r < nb_rows; r++)
+	{
+		for (s = 0; s < nb_src; s++)
+			addmul (dst[r], src[s], c[r * nb_src + s], sz);
+	}
+}
+
+
+static bool
+of_addmul_rows_generic_supported (void)
+{
+	return true;
+}
+
+
+#ifdef OF_GF_X86
+
+__attribute__((target("ssse3")))
+static void
+of_addmul_rows_ssse3 (gf **dst, int nb_rows, gf **src, int nb_src, const gf *c, int sz)
+{
+	const __m128i	mask = _mm_set1_epi8(0x0F);
+	__m128i		acc, x, lo, hi;
+	int		r, s, i;
+	gf		cs;
+
+	for (i = 0; i + (int) sizeof(__m128i) <= sz; i += sizeof(__m128i))
+	{
+		for (r = 0; r < nb_rows; r++)
+		{
+			acc = _mm_loadu_si128((const __m128i*) (dst[r] + i));
+			for (s = 0; s < nb_src; s++)
+			{
+				if ((cs = c[r * nb_src + s]) == 0)
+					continue;
+				x  = _mm_loadu_si128((const __m128i*) (src[s] + i));
+				lo = _mm_shuffle_epi8(_mm_load_si128((const __m128i*) of_gf_mul_lo[cs]), _mm_and_si128(x, mask));
+				hi = _mm_shuffle_epi8(_mm_load_si128((const __m128i*) of_gf_mul_hi[cs]),
+						      _mm_and_si128(_mm_srli_epi64(x, 4), mask));
+				acc = _mm_xor_si128(acc, _mm_xor_si128(lo, hi));
+			}
+			_mm_storeu_si128((__m128i*) (dst[r] + i), acc);
+		}
+	}
+	of_addmul_rows_tail(dst, nb_rows, src, nb_src, c, i, sz);
+}
+
+
+static bool
+of_addmul_rows_ssse3_supported (void)
+{
+	return __builtin_cpu_supports("ssse3");
+}
+
+
+/* vpshufb looks up each 128-bit lane separately, so the tables are broadcast */
+__attribute__((target("avx2")))
+static void
+of_addmul_rows_avx2 (gf **dst, int nb_rows, gf **src, int nb_src, const gf *c, int sz)
+{
+	const __m256i	mask = _mm256_set1_epi8(0x0F);
+	__m256i		acc, x, lo, hi;
+	int		r, s, i;
+	gf		cs;
+
+	for (i = 0; i + (int) sizeof(__m256i) <= sz; i += sizeof(__m256i))
+	{
+		for (r = 0; r < nb_rows; r++)
+		{
+			acc = _mm256_loadu_si256((const __m256i*) (dst[r] + i));
+			for (s = 0; s < nb_src; s++)
+			{
+				if ((cs = c[r * nb_src + s]) == 0)
+					continue;
+				x  = _mm256_loadu_si256((const __m256i*) (src[s] + i));
+				lo = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*) of_gf_mul_lo[cs])),
+							 _mm256_and_si256(x, mask));
+				hi = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*) of_gf_mul_hi[cs])),
+							 _mm256_and_si256(_mm256_srli_epi64(x, 4), mask));
+				acc = _mm256_xor_si256(acc, _mm256_xor_si256(lo, hi));
+			}
+			_mm256_storeu_si256((__m256i*) (dst[r] + i), acc);
+		}
+	}
+	of_addmul_rows_tail(dst, nb_rows, src, nb_src, c, i, sz);
+}
+
+
+static bool
+of_addmul_rows_avx2_supported (void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif /* OF_GF_X86 */
+
+
+#ifdef OF_GF_NEON
+
+static void
+of_addmul_rows_neon (gf **dst, int nb_rows, gf **src, int nb_src, const gf *c, int sz)
+{
+	int i = of_addmul_rows_neon_blocks(dst, nb_rows, src, nb_src, c,
+					   (const gf (*)[16]) of_gf_mul_lo, (const gf (*)[16]) of_gf_mul_hi, sz);
+	of_addmul_rows_tail(dst, nb_rows, src, nb_src, c, i, sz);
+}
+
+
+/* Mandatory on AArch64, 32-bit ARM asks the kernel rather than the compiler */
+static bool
+of_addmul_rows_neon_supported (void)
+{
+#ifdef __aarch64__
+	return true;
+#else
+	return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+}
+
+#endif /* OF_GF_NEON */
+
+
+typedef struct of_addmul_kernel_desc
+{
+	const char		*name;
+	of_rs_addmul_kernel_t	kernel;
+	bool			(*is_supported) (void);
+} of_addmul_kernel_desc_t;
+
+
+/**
+ * Known kernels, from the most to the least preferred one.
+ */
+static const of_addmul_kernel_desc_t	of_addmul_kernels[] =
+{
+#ifdef OF_GF_X86
+	{ "avx2",	of_addmul_rows_avx2,	of_addmul_rows_avx2_supported },
+	{ "ssse3",	of_addmul_rows_ssse3,	of_addmul_rows_ssse3_supported },
+#endif
+#ifdef OF_GF_NEON
+	{ "neon",	of_addmul_rows_neon,	of_addmul_rows_neon_supported },
+#endif
+	{ "generic",	of_addmul_rows_generic,	of_addmul_rows_generic_supported },
+};
+
+#define OF_NB_ADDMUL_KERNELS	(sizeof(of_addmul_kernels) / sizeof(of_addmul_kernels[0]))
+
+
+/* Kernel used by encoding and decoding, chosen in of_rs_init() */
+static const of_addmul_kernel_desc_t	*of_addmul_current = &of_addmul_kernels[OF_NB_ADDMUL_KERNELS - 1];
+
+#define addmul_rows(dst, nb_rows, src, nb_src, c, sz) \
+	of_addmul_current->kernel((dst), (nb_rows), (src), (nb_src), (c), (sz))
+
+#else	/* GF_BITS != 8 */
+
+#define addmul_rows(dst, nb_rows, src, nb_src, c, sz) \
+	{ int _r, _s; for (_r = 0; _r < (nb_rows); _r++) for (_s = 0; _s < (nb_src); _s++) \
+		addmul ((dst)[_r], (src)[_s], (c)[_r * (nb_src) + _s], (sz)); }
+
+#endif	/* GF_BITS == 8 */
+
 /*
  * computes C = AB where A is n*k, B is k*m, C is n*m
  */
@@ -719,10 +948,11 @@ of_invert_vdm (gf *src, int k)
 	return 0 ;
 }
 
-static int of_rs_initialized = 0 ;
-/* static */
-void		/* VR: removed static */
-of_rs_init()
+/* Codecs may be created from several threads, the tables are built once */
+static pthread_once_t of_rs_init_control = PTHREAD_ONCE_INIT ;
+
+static void
+of_rs_init_once (void)
 {
 	OF_ENTER_FUNCTION
 	TICK (ticks[0]);
@@ -733,10 +963,63 @@ of_rs_init()
 	of_rs_init_mul_table();
 	TOCK (ticks[0]);
 	DDB (printf("init_mul_table took %ldus\n", ticks[0]);)
-	of_rs_initialized = 1 ;
+#if (GF_BITS == 8)
+	of_rs_init_split_tables();
+	for (UINT32 i = 0; i < OF_NB_ADDMUL_KERNELS; i++)
+	{
+		if (of_addmul_kernels[i].is_supported())
+		{
+			of_addmul_current = &of_addmul_kernels[i];
+			break;
+		}
+	}
+	OF_TRACE_LVL(1, ("of_rs_init: using %s addmul kernel\n", of_addmul_current->name))
+#endif
 	OF_EXIT_FUNCTION
 }
 
+/* static */
+void		/* VR: removed static */
+of_rs_init()
+{
+	pthread_once (&of_rs_init_control, of_rs_init_once) ;
+}
+
+
+#if (GF_BITS == 8)
+const char*
+of_rs_get_addmul_kernel_name (UINT32 index)
+{
+	return (index < OF_NB_ADDMUL_KERNELS) ? of_addmul_kernels[index].name : NULL;
+}
+
+
+const char*
+of_rs_get_current_addmul_kernel_name (void)
+{
+	of_rs_init();
+	return of_addmul_current->name;
+}
+
+
+of_rs_addmul_kernel_t
+of_rs_find_addmul_kernel (const char *name)
+{
+	UINT32	i;
+
+	/* kernels need the multiplication tables */
+	of_rs_init();
+	for (i = 0; i < OF_NB_ADDMUL_KERNELS; i++)
+	{
+		if (strcmp(of_addmul_kernels[i].name, name) == 0)
+		{
+			return of_addmul_kernels[i].is_supported() ? of_addmul_kernels[i].kernel : NULL;
+		}
+	}
+	return NULL;
+}
+#endif
+
 /*
  * This section contains the proper FEC encoding/decoding routines.
  * The encoding matrix is computed starting with a Vandermonde matrix,
@@ -793,8 +1076,7 @@ of_rs_new (UINT32 k, UINT32 n)
 
 	struct fec_parms *retval ;
 
-	if (of_rs_initialized == 0)
-		of_rs_init();
+	of_rs_init();
 
 	if (k > GF_SIZE + 1 || n > GF_SIZE + 1 || k > n)
 	{
@@ -877,7 +1159,7 @@ of_rs_encode (struct fec_parms *code, gf *src[], gf *fec, int index, int sz)
 	gf **src = (gf**) src_vp;				/* VR */
 	gf *fec = (gf*) fec_vp;				/* VR */
 #endif /* CPLUSPLUS_COMPATIBLE */
-	int i, k = code->k ;
+	int k = code->k ;
 	gf *p ;
 
 	if (GF_BITS > 8)
@@ -889,8 +1171,7 @@ of_rs_encode (struct fec_parms *code, gf *src[], gf *fec, int index, int sz)
 	{
 		p = & (code->enc_matrix[index*k]);
 		bzero (fec, sz*sizeof (gf));
-		for (i = 0; i < k ; i++)
-			addmul (fec, src[i], p[i], sz) ;
+		addmul_rows (&fec, 1, src, k, p, sz) ;
 		return OF_STATUS_OK;
 	}
 	else
@@ -901,6 +1182,36 @@ of_rs_encode (struct fec_parms *code, gf *src[], gf *fec, int index, int sz)
 	return OF_STATUS_ERROR;
 }
 
+/*
+ * of_rs_encode_rows builds the nb_rows repair symbols starting at index in a
+ * single pass over the source symbols. The rows of the encoding matrix are
+ * consecutive, so they are handed to the kernel as they are.
+ */
+of_status_t
+of_rs_encode_rows (void *code_vp, void **src_vp, void **fec_vp, int index, int nb_rows, int sz)
+{
+	OF_ENTER_FUNCTION
+	struct fec_parms *code = (struct fec_parms*) code_vp;
+	gf **src = (gf**) src_vp;
+	gf **fec = (gf**) fec_vp;
+	int r, k = code->k ;
+
+	if (GF_BITS > 8)
+		sz /= 2 ;
+
+	if (index < k || index + nb_rows > code->n)
+	{
+		OF_PRINT_ERROR (("Invalid repair rows [%d, %d[ (k %d, n %d)\n", index, index + nb_rows, k, code->n))
+		OF_EXIT_FUNCTION
+		return OF_STATUS_ERROR;
+	}
+	for (r = 0; r < nb_rows; r++)
+		bzero (fec[r], sz*sizeof (gf));
+	addmul_rows (fec, nb_rows, src, k, & (code->enc_matrix[index*k]), sz) ;
+	OF_EXIT_FUNCTION
+	return OF_STATUS_OK;
+}
+
 /*
  * shuffle move src packets in their position
  */
@@ -1026,7 +1337,7 @@ of_rs_decode (struct fec_parms *code, gf *pkt[], int index[], int sz)
 #endif /* CPLUSPLUS_COMPATIBLE */
 	gf *m_dec ;
 	gf **new_pkt ;
-	int row, col, k = code->k ;
+	int row, nb_missing, k = code->k ;
 
 	if (GF_BITS > 8)
 		sz /= 2 ;
@@ -1045,32 +1356,34 @@ of_rs_decode (struct fec_parms *code, gf *pkt[], int index[], int sz)
 		return OF_STATUS_ERROR ; /* error */
 	}
 	/*
-	 * do the actual decoding
+	 * do the actual decoding. The rows of m_dec for the missing packets are
+	 * packed at its start so all of them are rebuilt in one pass over pkt.
 	 */
 	new_pkt = (gf **) of_my_malloc (k * sizeof (gf *), "new pkt pointers");
-	for (row = 0 ; row < k ; row++)
+	for (row = 0, nb_missing = 0 ; row < k ; row++)
 	{
 		if (index[row] >= k)
 		{
-			new_pkt[row] = (gf *) of_my_malloc (sz * sizeof (gf), "new pkt buffer");
-			bzero (new_pkt[row], sz * sizeof (gf)) ;
-			for (col = 0 ; col < k ; col++)
-			{
-				addmul (new_pkt[row], pkt[col], m_dec[row*k + col], sz) ;
-			}
+			new_pkt[nb_missing] = (gf *) of_my_malloc (sz * sizeof (gf), "new pkt buffer");
+			bzero (new_pkt[nb_missing], sz * sizeof (gf)) ;
+			if (nb_missing != row)
+				bcopy (&m_dec[row*k], &m_dec[nb_missing*k], k * sizeof (gf));
+			nb_missing++;
 		}
 	}
+	addmul_rows (new_pkt, nb_missing, pkt, k, m_dec, sz) ;
 	/*
 	 * move pkts to their final destination
 	 * Warning: this function does not update the index[] table to contain
 	 * the actual reconstructed packet index.
 	 */
-	for (row = 0 ; row < k ; row++)
+	for (row = 0, nb_missing = 0 ; row < k ; row++)
 	{
 		if (index[row] >= k)
 		{
-			bcopy (new_pkt[row], pkt[row], sz*sizeof (gf));
-			free (new_pkt[row]);
+			bcopy (new_pkt[nb_missing], pkt[row], sz*sizeof (gf));
+			free (new_pkt[nb_missing]);
+			nb_missing++;
 		}
 	}
 	free (new_pkt);
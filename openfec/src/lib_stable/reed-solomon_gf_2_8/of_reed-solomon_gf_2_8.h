@@ -70,6 +70,14 @@ typedef struct of_rs_cb
 
 	void 		*rs_cb;			/** Reed-Solomon internal codec control block */
 
+#ifdef OF_USE_ENCODER
+	/**
+	 * Repair symbol buffers filled by the last batch encoding, in ESI order starting
+	 * at k. NULL until all the repair symbols have been built in one pass.
+	 */
+	void		** built_repair_tab;
+#endif /* OF_USE_ENCODER */
+
 #ifdef OF_USE_DECODER
 	/*
 	 * decoder specific variables.
@@ -300,9 +308,75 @@ void		of_rs_init (void) ;
 
 of_status_t	of_rs_encode (void *code, void **src, void *dst,  int index, int sz) ;
 
+/**
+ * Build the nb_rows repair symbols index, index + 1, ... in a single pass over
+ * the k source symbols.
+ */
+of_status_t	of_rs_encode_rows (void *code, void **src, void **dst, int index, int nb_rows, int sz) ;
+
 of_status_t 	of_rs_decode (void *code,  void **pkt, int index[], int sz) ;
 
 
+#if (GF_BITS == 8)
+/**
+ * GF(2^8) multiply-accumulate kernel, used for both encoding and decoding:
+ *	dst[r] = dst[r] + sum over s of c[r * nb_src + s] * src[s]
+ * for every row r < nb_rows. Symbols do not need any particular alignment.
+ */
+typedef void (*of_rs_addmul_kernel_t) (unsigned char	**dst,
+				       int		nb_rows,
+				       unsigned char	**src,
+				       int		nb_src,
+				       const unsigned char *c,
+				       int		sz);
+
+#if defined(__arm__) || defined(__aarch64__)
+#define OF_GF_NEON
+
+/**
+ * NEON part of the NEON addmul kernel, built on its own with NEON enabled.
+ * Only handles whole 16-byte blocks, and nothing at all when
+ * of_reed-solomon_gf_2_8_neon.c was built without NEON. Only call it once the
+ * CPU is known to have NEON.
+ *
+ * @param mul_lo	(IN) c * x for the low nibble x, 16 entries per constant c
+ * @param mul_hi	(IN) c * (x << 4) for the high nibble x
+ * @return		offset of the first byte left for the caller
+ */
+int	of_addmul_rows_neon_blocks (unsigned char	**dst,
+				    int			nb_rows,
+				    unsigned char	**src,
+				    int			nb_src,
+				    const unsigned char	*c,
+				    const unsigned char	(*mul_lo)[16],
+				    const unsigned char	(*mul_hi)[16],
+				    int			sz);
+#endif
+
+/**
+ * Get the name of a known addmul kernel, whether or not this CPU supports it.
+ *
+ * @param index		(IN) kernel index, starting at 0
+ * @return		kernel name or NULL if index is past the last kernel
+ */
+const char*	of_rs_get_addmul_kernel_name (UINT32 index) ;
+
+/**
+ * @return		name of the addmul kernel chosen for this CPU: AVX2 or SSSE3 on
+ *			x86, NEON on ARM when AT_HWCAP reports it (always on
+ *			AArch64), a table based one otherwise
+ */
+const char*	of_rs_get_current_addmul_kernel_name (void) ;
+
+/**
+ * Get an addmul kernel by name, e.g. to benchmark it.
+ *
+ * @param name		(IN) kernel name
+ * @return		the kernel or NULL if it is unknown or not supported
+ */
+of_rs_addmul_kernel_t	of_rs_find_addmul_kernel (const char *name) ;
+#endif
+
 #endif /* OF_REED_SOLOMON_GF_2_8_H */
 
 #endif //#ifdef OF_USE_REED_SOLOMON_CODEC
@@ -86,6 +86,13 @@ of_status_t	of_rs_release_codec_instance (of_rs_cb_t*	ofcb)
 		of_rs_free (ofcb->rs_cb);
 		ofcb->rs_cb = NULL;
 	}
+#ifdef OF_USE_ENCODER
+	if (ofcb->built_repair_tab != NULL)
+	{
+		of_free(ofcb->built_repair_tab);
+		ofcb->built_repair_tab = NULL;
+	}
+#endif  /* OF_USE_ENCODER */
 #ifdef OF_USE_DECODER
 	if (ofcb->available_symbols_tab != NULL)
 	{
@@ -111,6 +118,11 @@ of_status_t	of_rs_set_fec_parameters (of_rs_cb_t*		ofcb,
 	ofcb->nb_repair_symbols = params->nb_repair_symbols;
 	ofcb->encoding_symbol_length = params->encoding_symbol_length;
 	ofcb->nb_encoding_symbols = ofcb->nb_source_symbols + ofcb->nb_repair_symbols;
+#ifdef OF_USE_ENCODER
+	/* sized for the previous parameters, if any */
+	of_free(ofcb->built_repair_tab);
+	ofcb->built_repair_tab = NULL;
+#endif  /* OF_USE_ENCODER */
 #ifdef OF_USE_DECODER
 	ofcb->available_symbols_tab = (void**) of_calloc (ofcb->nb_encoding_symbols, sizeof (void*));
 	ofcb->nb_available_symbols = 0;
@@ -146,6 +158,25 @@ of_status_t	of_rs_set_callback_functions (of_rs_cb_t*		ofcb,
 
 
 #ifdef OF_USE_ENCODER
+/**
+ * @return		true if encoding_symbols_tab holds a buffer for every repair symbol
+ */
+static bool	of_rs_all_repair_buffers_set (of_rs_cb_t*	ofcb,
+					      void*		encoding_symbols_tab[])
+{
+	UINT32	esi;
+
+	for (esi = ofcb->nb_source_symbols; esi < ofcb->nb_encoding_symbols; esi++)
+	{
+		if (encoding_symbols_tab[esi] == NULL)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
 of_status_t	of_rs_build_repair_symbol (of_rs_cb_t*		ofcb,
 					   void*		encoding_symbols_tab[],
 					   UINT32		esi_of_symbol_to_build)
@@ -176,6 +207,41 @@ of_status_t	of_rs_build_repair_symbol (of_rs_cb_t*		ofcb,
 		  goto error;
 		}
 	}
+	/*
+	 * Asking for the first repair symbol while the application already provides a
+	 * buffer for every other one builds them all in a single pass over the source
+	 * symbols. Later requests for those buffers are then already satisfied.
+	 */
+	if (esi_of_symbol_to_build == ofcb->nb_source_symbols &&
+	    of_rs_all_repair_buffers_set(ofcb, encoding_symbols_tab))
+	{
+		if (ofcb->built_repair_tab == NULL &&
+		    (ofcb->built_repair_tab = (void**) of_calloc (ofcb->nb_repair_symbols, sizeof (void*))) == NULL)
+		{
+			OF_PRINT_ERROR(("of_rs_build_repair_symbol: Error, no memory\n"))
+			goto error;
+		}
+		if (of_rs_encode_rows(ofcb->rs_cb,
+				      encoding_symbols_tab,
+				      encoding_symbols_tab + ofcb->nb_source_symbols,
+				      ofcb->nb_source_symbols,
+				      ofcb->nb_repair_symbols,
+				      ofcb->encoding_symbol_length) != OF_STATUS_OK)
+		{
+			OF_PRINT_ERROR(("of_rs_build_repair_symbol: Error, of_rs_encode_rows failed"))
+			goto error;
+		}
+		memcpy(ofcb->built_repair_tab, encoding_symbols_tab + ofcb->nb_source_symbols,
+		       ofcb->nb_repair_symbols * sizeof (void*));
+		OF_EXIT_FUNCTION
+		return OF_STATUS_OK;
+	}
+	if (ofcb->built_repair_tab != NULL &&
+	    ofcb->built_repair_tab[esi_of_symbol_to_build - ofcb->nb_source_symbols] == encoding_symbols_tab[esi_of_symbol_to_build])
+	{
+		OF_EXIT_FUNCTION
+		return OF_STATUS_OK;
+	}
 	if (of_rs_encode(ofcb->rs_cb,
 			 encoding_symbols_tab,
 			 encoding_symbols_tab[esi_of_symbol_to_build],
@@ -0,0 +1,101 @@
+/* $Id: of_reed-solomon_gf_2_8_neon.c $ */
+/*
+ * OpenFEC.org AL-FEC Library.
+ * (c) Copyright 2009 - 2012 INRIA - All rights reserved
+ * Contact: vincent.roca@inria.fr
+ *
+ * This software is governed by the CeCILL-C license under French law and
+ * abiding by the rules of distribution of free software.  You can  use,
+ * modify and/ or redistribute the software under the terms of the CeCILL-C
+ * license as circulated by CEA, CNRS and INRIA at the following URL
+ * "http://www.cecill.info".
+ *
+ * As a counterpart to the access to the source code and  rights to copy,
+ * modify and redistribute granted by the license, users are provided only
+ * with a limited warranty  and the software's author,  the holder of the
+ * economic rights,  and the successive licensors  have only  limited
+ * liability.
+ *
+ * In this respect, the user's attention is drawn to the risks associated
+ * with loading,  using,  modifying and/or developing or reproducing the
+ * software by the user in light of its specific status of free software,
+ * that may mean  that it is complicated to manipulate,  and  that  also
+ * therefore means  that it is reserved for developers  and  experienced
+ * professionals having in-depth computer knowledge. Users are therefore
+ * encouraged to load and test the software's suitability as regards their
+ * requirements in conditions enabling the security of their systems and/or
+ * data to be ensured and,  more generally, to use and operate it in the
+ * same conditions as regards security.
+ *
+ * The fact that you are presently reading this means that you have had
+ * knowledge of the CeCILL-C license and that you accept its terms.
+ */
+
+/*
+ * NEON GF(2^8) multiply-accumulate. On 32-bit ARM this is the only file of
+ * the codec built with -mfpu=neon, so that no NEON instruction runs before
+ * of_rs_init() has checked the CPU has it.
+ */
+#include "of_reed-solomon_gf_2_8_includes.h"
+
+#ifdef OF_USE_REED_SOLOMON_CODEC
+#if (GF_BITS == 8) && defined(OF_GF_NEON)
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+/* 16-entry table lookup, vtbl only takes 8 entries per register on ARMv7 */
+static inline uint8x16_t
+of_gf_lookup (const gf *table, uint8x16_t idx)
+{
+#ifdef __aarch64__
+	return vqtbl1q_u8(vld1q_u8(table), idx);
+#else
+	uint8x8x2_t t = {{ vld1_u8(table), vld1_u8(table + 8) }};
+	return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)), vtbl2_u8(t, vget_high_u8(idx)));
+#endif
+}
+
+
+int
+of_addmul_rows_neon_blocks (gf **dst, int nb_rows, gf **src, int nb_src, const gf *c,
+			    const gf (*mul_lo)[16], const gf (*mul_hi)[16], int sz)
+{
+	const uint8x16_t	mask = vdupq_n_u8(0x0F);
+	uint8x16_t		acc, x;
+	int			r, s, i;
+	gf			cs;
+
+	for (i = 0; i + (int) sizeof(uint8x16_t) <= sz; i += sizeof(uint8x16_t))
+	{
+		for (r = 0; r < nb_rows; r++)
+		{
+			acc = vld1q_u8(dst[r] + i);
+			for (s = 0; s < nb_src; s++)
+			{
+				if ((cs = c[r * nb_src + s]) == 0)
+					continue;
+				x   = vld1q_u8(src[s] + i);
+				acc = veorq_u8(acc, of_gf_lookup(mul_lo[cs], vandq_u8(x, mask)));
+				acc = veorq_u8(acc, of_gf_lookup(mul_hi[cs], vshrq_n_u8(x, 4)));
+			}
+			vst1q_u8(dst[r] + i, acc);
+		}
+	}
+	return i;
+}
+
+#else
+
+/* Built without NEON enabled: leave every byte to the caller. */
+int
+of_addmul_rows_neon_blocks (gf **dst, int nb_rows, gf **src, int nb_src, const gf *c,
+			    const gf (*mul_lo)[16], const gf (*mul_hi)[16], int sz)
+{
+	return 0;
+}
+
+#endif /* __ARM_NEON */
+
+#endif /* GF_BITS == 8 && OF_GF_NEON */
+#endif /* OF_USE_REED_SOLOMON_CODEC */
@@ -0,0 +1,90 @@
+'''
+    FILE: buffer_sweep.py
+
+    DESCRIPTION: Compare receiver drop rates across kernel capture buffer sizes
+    by replaying a savefile over the air.
+
+    NOTES: This script needs a live build of rx (i.e. `Release` or `Debug`, not
+    the test configurations), two monitor mode interfaces that can hear each
+    other, root privileges and `tcpreplay`. Savefiles can be made with a test
+    build of tx, e.g. `tx --savefile capture.pcap <file>`. By default, it will
+    assume the binaries are installed in `bin/Release`. If they are installed
+    elsewhere please define the `DXWIFI_INSTALL_DIR` environment variable with
+    the correct install location.
+
+    Each run replays the savefile on `--tx-dev` at the given packet rate while
+    rx captures on `--rx-dev`. Packets received and dropped by the kernel are
+    parsed out of the rx capture summary and written out as CSV.
+'''
+
+# Imports
+import os
+import re
+import sys
+import time
+import shutil
+import argparse
+import subprocess
+
+# Get binary paths
+INSTALL_DIR = os.environ.get('DXWIFI_INSTALL_DIR', default='bin/Release')
+RX = f'./{INSTALL_DIR}/rx'
+
+# Verify binaries exist
+if not os.access(RX, os.X_OK):
+    print(f"Error! Please verify rx is available at {INSTALL_DIR}.")
+    sys.exit(1)
+
+if shutil.which("tcpreplay") is None:
+    print("Error! tcpreplay is required to replay the savefile.")
+    sys.exit(1)
+
+# Matches the summary line logged by rx when a capture ends
+SUMMARY = re.compile(r"received: (\d+), dropped \(kernel\): (\d+), ring high-water: (\d+)/(\d+)")
+
+# Parse arguments
+parser = argparse.ArgumentParser(description = "Compare drop rates across kernel buffer sizes.")
+parser.add_argument("--savefile", "-s", required = True, help = "savefile to replay")
+parser.add_argument("--tx-dev", required = True, help = "monitor mode interface to replay on")
+parser.add_argument("--rx-dev", required = True, help = "monitor mode interface to capture on")
+parser.add_argument("--sizes", "-b", type = int, nargs = "+", required = True,
+                    help = "kernel buffer sizes in bytes, 0 for the pcap default", metavar = "BYTES")
+parser.add_argument("--pps", "-p", type = int, default = 1000, help = "replay rate in packets per second")
+parser.add_argument("--immediate", action = "store_true", help = "capture in immediate mode")
+parser.add_argument("--repeat", "-r", type = int, default = 1, help = "number of runs per buffer size")
+parser.add_argument("--output", "-o", default = "buffer_sweep.csv", help = "output CSV path")
+args = parser.parse_args()
+
+with open(args.output, "w") as out:
+    out.write("buffer_size,run,received,dropped,drop_rate,ring_high_water,ring_capacity\n")
+
+    # Iterate over buffer sizes
+    for size in args.sizes:
+        for run in range(args.repeat):
+
+            # Start capture, rx exits after 2 idle seconds once the replay is done
+            rx_command = f"{RX} -d {args.rx_dev} -t 2 --kernel-buffer {size} /dev/null"
+            if args.immediate:
+                rx_command += " --immediate"
+            rx_proc = subprocess.Popen(rx_command.split(), stdout = subprocess.DEVNULL,
+                                       stderr = subprocess.PIPE, text = True)
+            time.sleep(1)
+
+            # Replay the savefile
+            replay_command = f"tcpreplay -q -i {args.tx_dev} --pps {args.pps} {args.savefile}"
+            subprocess.run(replay_command.split(), stdout = subprocess.DEVNULL).check_returncode()
+
+            _, rx_log = rx_proc.communicate()
+
+            match = SUMMARY.search(rx_log)
+            if match is None:
+                print(f"Error! No capture summary found for buffer size {size}:\n{rx_log}")
+                sys.exit(1)
+
+            received, dropped, high_water, capacity = (int(i) for i in match.groups())
+            # On Linux ps_recv already counts the packets the kernel dropped
+            drop_rate = dropped / received if received else 0.0
+            out.write(f"{size},{run},{received},{dropped},{drop_rate:.6f},{high_water},{capacity}\n")
+
+            # Notify user
+            print(f"Buffer size {size}, run {run}: received {received}, dropped {dropped} ({drop_rate:.2%})")
@@ -18,15 +18,19 @@
 '''
 
 import os
+import mmap
 import signal
+import socket
+import struct
 import shutil
 import filecmp
 import unittest
+import itertools
 import subprocess
 from time import sleep
 from test.genbytes import genbytes
 
-FEC_SYMBOL_SIZE = 1103
+FEC_SYMBOL_SIZE = 1100
 
 INSTALL_DIR = os.environ.get('DXWIFI_INSTALL_DIR', default='bin/TestDebug')
 TEMP_DIR    = '__temp'
@@ -37,9 +41,57 @@ RX_INSTALL = f'./{INSTALL_DIR}/tx'
 if 'DXWIFI_MEMORY_CHECK' in os.environ: 
     TX = f'valgrind --leak-check=full -s --track-origins=yes ./{INSTALL_DIR}/tx'
     RX = f'valgrind --leak-check=full -s --track-origins=yes ./{INSTALL_DIR}/rx'
+    ENCODE = f'valgrind --leak-check=full -s --track-origins=yes ./{INSTALL_DIR}/encode'
+    DECODE = f'valgrind --leak-check=full -s --track-origins=yes ./{INSTALL_DIR}/decode'
 else:
     TX = f'./{INSTALL_DIR}/tx'
     RX = f'./{INSTALL_DIR}/rx'
+    ENCODE = f'./{INSTALL_DIR}/encode'
+    DECODE = f'./{INSTALL_DIR}/decode'
+
+
+def scrape_metrics(socket_path, timeout=5):
+    '''Reads one snapshot from a metrics socket into a dict of sample name to value'''
+
+    for _ in range(timeout * 20):
+        if os.path.exists(socket_path):
+            break
+        sleep(0.05)
+
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as client:
+        client.connect(socket_path)
+        text = b''.join(iter(lambda: client.recv(4096), b'')).decode()
+
+    samples = {}
+    for line in text.splitlines():
+        if line and not line.startswith('#'):
+            name, value = line.rsplit(' ', 1)
+            samples[name] = float(value)
+    return samples
+
+
+# Leading fields of dxwifi_status in shm_status.h, up to the antenna array
+STATUS_LAYOUT = struct.Struct('<IHHIIiIQ16s6QIHHIIqII')
+STATUS_FIELDS = (
+    'magic', 'version', 'role', 'size', 'seq', 'pid', 'state', 'updated_ns', 'device',
+    'data_frames', 'control_frames', 'dropped_frames', 'bytes', 'errors', 'blocks_lost',
+    'objects', 'n', 'k', 'esis', 'source_esis', 'decoded_size', 'nantennas', 'reserved'
+)
+
+def read_status(name, timeout=5):
+    '''Takes a consistent snapshot of a status segment into a dict of field to value'''
+
+    path = f'/dev/shm/{name}'
+    for _ in range(timeout * 20):
+        if os.path.exists(path):
+            break
+        sleep(0.05)
+
+    with open(path, 'rb') as segment, mmap.mmap(segment.fileno(), 0, prot=mmap.PROT_READ) as status:
+        while True:
+            fields = dict(zip(STATUS_FIELDS, STATUS_LAYOUT.unpack_from(status)))
+            if fields['seq'] % 2 == 0 and struct.unpack_from('<I', status, 12)[0] == fields['seq']:
+                return fields
 
 
 class TestTxRx(unittest.TestCase):
@@ -211,6 +263,126 @@ class TestTxRx(unittest.TestCase):
 
         self.assertEqual(all(results), True)
 
+    def testWatchDirectoryManyPendingFiles(self):
+        '''Tx transmits every file when more files are open at once than the old watch list could hold'''
+
+        nfiles     = 300
+        tx_out     = f'{TEMP_DIR}/tx.raw'
+        rx_out     = [f'{TEMP_DIR}/rx_{x:05}.raw' for x in range(nfiles)]
+        tx_command = f'{TX_INSTALL} {TEMP_DIR} -q --watch-timeout 2 --filter=test_*.raw --savefile {tx_out}'
+        rx_command = f'{RX} {TEMP_DIR} -q -c 1 -t 2 --prefix rx --extension raw --savefile {tx_out}'
+
+        # Open tx to listen for new files in a directory
+        proc = subprocess.Popen(tx_command.split())
+
+        sleep(0.05) # Give tx time to get set up
+
+        # Create every file before closing any of them
+        test_files = [f'{TEMP_DIR}/test_{x}.raw' for x in range(nfiles)]
+        handles = [open(file, 'wb') for file in test_files]
+        for x, handle in enumerate(handles):
+            handle.write(str.encode(f'{x:04}') * (10 * FEC_SYMBOL_SIZE // 4))
+        for handle in handles:
+            handle.close()
+
+        # Wait for tx to timeout and close
+        proc.wait()
+
+        # Verify tx exited cleanly
+        self.assertEqual(proc.returncode, 0)
+
+        # Receive all the transmitted test files
+        subprocess.run(rx_command.split())
+
+        results = [os.path.exists(copy) and filecmp.cmp(src, copy) for src, copy in zip(test_files, rx_out)]
+
+        self.assertEqual(all(results), True)
+
+    def testWatchDirectoryRenameIntoPlace(self):
+        '''Tx transmits files written under a temporary name and renamed into place, once each'''
+
+        nfiles     = 3
+        tx_out     = f'{TEMP_DIR}/tx.raw'
+        rx_out     = [f'{TEMP_DIR}/rx_{x:05}.raw' for x in range(nfiles)]
+        tx_command = f'{TX_INSTALL} {TEMP_DIR} -q --watch-timeout 2 --filter=test_*.raw --savefile {tx_out}'
+        rx_command = f'{RX} {TEMP_DIR} -q -c 1 -t 2 --prefix rx --extension raw --savefile {tx_out}'
+
+        # Open tx to listen for new files in a directory
+        proc = subprocess.Popen(tx_command.split())
+
+        sleep(0.05) # Give tx time to get set up
+
+        # Write each file out of the filter then move it into place
+        test_files = [f'{TEMP_DIR}/test_{x}.raw' for x in range(nfiles)]
+        for x, file in enumerate(test_files):
+            genbytes(f'{TEMP_DIR}/camera_{x}.tmp', 10, FEC_SYMBOL_SIZE)
+            os.rename(f'{TEMP_DIR}/camera_{x}.tmp', file)
+
+        # Wait for tx to timeout and close
+        proc.wait()
+
+        # Verify tx exited cleanly
+        self.assertEqual(proc.returncode, 0)
+
+        # Receive all the transmitted test files
+        subprocess.run(rx_command.split())
+
+        results = [os.path.exists(copy) and filecmp.cmp(src, copy) for src, copy in zip(test_files, rx_out)]
+
+        self.assertEqual(all(results), True)
+        self.assertFalse(os.path.exists(f'{TEMP_DIR}/rx_{nfiles:05}.raw'))
+
+    def testWatchDirectoryQueueOverflow(self):
+        '''Tx rescans the directory when the inotify queue overflows and transmits the files it missed'''
+
+        with open('/proc/sys/fs/inotify/max_queued_events') as f:
+            max_queued_events = int(f.read())
+
+        nfiles     = 3
+        tx_out     = f'{TEMP_DIR}/tx.raw'
+        rx_out     = [f'{TEMP_DIR}/rx_{x:05}.raw' for x in range(2 * nfiles)]
+        tx_command = f'{TX_INSTALL} {TEMP_DIR} --watch-timeout 2 --filter=test_*.raw --savefile {tx_out}'
+        rx_command = f'{RX} {TEMP_DIR} -q -c 1 -t 2 --prefix rx --extension raw --savefile {tx_out}'
+
+        # Open tx to listen for new files in a directory
+        proc = subprocess.Popen(tx_command.split(), stderr=subprocess.PIPE, text=True)
+
+        sleep(0.05) # Give tx time to get set up
+
+        test_files = [f'{TEMP_DIR}/test_{x}.raw' for x in range(nfiles)]
+        contents   = [str.encode(f'{x:04}') * (10 * FEC_SYMBOL_SIZE // 4) for x in range(nfiles)]
+
+        # Nothing reads the queue while tx is stopped
+        proc.send_signal(signal.SIGSTOP)
+
+        # Each file is a create and a close event, more than the queue holds
+        for x in range(max_queued_events // 2 + 100):
+            open(f'{TEMP_DIR}/noise_{x}.tmp', 'wb').close()
+
+        # Only the rescan can find these, their events were never queued
+        for file, content in zip(test_files, contents):
+            with open(file, 'wb') as f:
+                f.write(content)
+
+        proc.send_signal(signal.SIGCONT)
+        _, tx_log = proc.communicate()
+
+        # Verify tx exited cleanly after the overflow
+        self.assertEqual(proc.returncode, 0)
+        self.assertIn('Inotify queue overflowed', tx_log)
+
+        # Receive all the transmitted test files
+        subprocess.run(rx_command.split())
+
+        # The rescan goes in directory order
+        received = set()
+        for copy in rx_out:
+            if os.path.exists(copy):
+                with open(copy, 'rb') as f:
+                    received.add(f.read())
+
+        self.assertEqual(received, set(contents))
+
     def testSmallImageTransmission(self):
         '''Small (~1mb), uncompressed images can be transmitted and received'''
 
@@ -329,5 +501,358 @@ class TestTxRx(unittest.TestCase):
         self.assertEqual(status, True)
 
 
+    def testFrameGeometry(self):
+        '''Rx decodes objects sent with the smallest and largest frames'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+
+        # Create a single test file
+        genbytes(test_file, 10, FEC_SYMBOL_SIZE) # Create test file
+
+        for blocks in [1, 9]:
+            tx_out      = f'{TEMP_DIR}/tx_{blocks}.raw'
+            rx_out      = f'{TEMP_DIR}/rx_{blocks}.raw'
+
+            tx_command = f'{TX} {test_file} -q --frame-blocks {blocks} --packet-loss 0.1 --seed 1621981756 --savefile {tx_out}'
+            rx_command = f'{RX} {rx_out} -q --savefile {tx_out}'
+
+            # Transmit the test file
+            subprocess.run(tx_command.split()).check_returncode()
+
+            # Receive the test file
+            subprocess.run(rx_command.split()).check_returncode()
+
+            # Verify both files match
+            status = filecmp.cmp(test_file, rx_out)
+
+            self.assertEqual(status, True)
+
+
+    def testLeadingFramesLost(self):
+        '''Decode finds the frame geometry when every probed leading frame was lost in place'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        encoded     = f'{TEMP_DIR}/encoded.raw'
+        decoded     = f'{TEMP_DIR}/decoded.raw'
+
+        encode_command = f'{ENCODE} {test_file} -q -s -c 0.5 -o {encoded}'
+        decode_command = f'{DECODE} {encoded} -q -o {decoded}'
+
+        genbytes(test_file, 10, FEC_SYMBOL_SIZE)
+
+        encode = subprocess.run(encode_command.split(), stderr=subprocess.PIPE, text=True)
+        encode.check_returncode()
+
+        # Wipe the first 6 frames, enough repair frames are left to decode
+        n = int(encode.stderr.split('n=')[1].split(',')[0])
+        frame_size = os.path.getsize(encoded) // n
+        with open(encoded, 'r+b') as handle:
+            handle.write(bytes(6 * frame_size))
+
+        subprocess.run(decode_command.split()).check_returncode()
+        self.assertTrue(filecmp.cmp(test_file, decoded, shallow=False))
+
+
+    def testInterleavedErasureCorrection(self):
+        '''Rx fills in lost frames of an interleaved object from the RS erasures'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+
+        tx_command = f'{TX} {test_file} -q --ordered --interleave 16 --packet-loss 0.05 --savefile {tx_out}'
+        rx_command = f'{RX} {rx_out} -q --ordered --add-noise --savefile {tx_out}'
+
+        # Create a single test file
+        genbytes(test_file, 40, FEC_SYMBOL_SIZE) # Create test file
+
+        # Transmit the test file
+        subprocess.run(tx_command.split()).check_returncode()
+
+        # Receive the test file
+        subprocess.run(rx_command.split()).check_returncode()
+
+        # Verify both files match
+        status = filecmp.cmp(test_file, rx_out)
+
+        self.assertEqual(status, True)
+
+
+    def testFECStats(self):
+        '''Encode and decode report the stats of each call with --stats'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        encoded     = f'{TEMP_DIR}/encoded.raw'
+        decoded     = f'{TEMP_DIR}/decoded.raw'
+
+        encode_command = f'{ENCODE} {test_file} -q -s -o {encoded}'
+        decode_command = f'{DECODE} {encoded} -q -s -o {decoded}'
+
+        genbytes(test_file, 10, FEC_SYMBOL_SIZE)
+
+        encode = subprocess.run(encode_command.split(), stderr=subprocess.PIPE, text=True)
+        encode.check_returncode()
+        self.assertIn('FEC stats: n=', encode.stderr)
+        self.assertIn('Repair symbols', encode.stderr)
+
+        # Every source symbol intact
+        decode = subprocess.run(decode_command.split(), stderr=subprocess.PIPE, text=True)
+        decode.check_returncode()
+        self.assertIn('RS decode', decode.stderr)
+        self.assertIn('Systematic: yes', decode.stderr)
+        self.assertTrue(filecmp.cmp(test_file, decoded))
+
+        # Wipe the first frame, the decoder has to fall back on repair symbols
+        n = int(encode.stderr.split('n=')[1].split(',')[0])
+        with open(encoded, 'r+b') as handle:
+            frame_size = os.path.getsize(encoded) // n
+            handle.write(bytes(frame_size))
+
+        decode = subprocess.run(decode_command.split(), stderr=subprocess.PIPE, text=True)
+        decode.check_returncode()
+        self.assertIn('Systematic: no', decode.stderr)
+        self.assertIn('IT decode', decode.stderr)
+        self.assertTrue(filecmp.cmp(test_file, decoded))
+
+
+    def testMLDecodeOddSymbolSizes(self):
+        '''Symbols solved by ML decoding match the source for symbol sizes that aren't a multiple of 8'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        encoded     = f'{TEMP_DIR}/encoded.raw'
+        decoded     = f'{TEMP_DIR}/decoded.raw'
+
+        # 431, 654 and 877 byte symbols end 7, 6 and 5 bytes past a 64-bit word
+        for blocks in (2, 3, 4):
+            with self.subTest(blocks=blocks):
+                symbol_size = blocks * 223 - 15
+
+                encode_command = f'{ENCODE} {test_file} -q -s -b {blocks} -c 0.5 -o {encoded}'
+                decode_command = f'{DECODE} {encoded} -q -s -o {decoded}'
+
+                # Too many symbols for RS, the object is LDPC-Staircase encoded
+                genbytes(test_file, 300, symbol_size)
+
+                encode = subprocess.run(encode_command.split(), stderr=subprocess.PIPE, text=True)
+                encode.check_returncode()
+
+                # Wipe 4 frames out of every 9, more than IT decoding can recover
+                n = int(encode.stderr.split('n=')[1].split(',')[0])
+                frame_size = os.path.getsize(encoded) // n
+                with open(encoded, 'r+b') as handle:
+                    for frame in range(n):
+                        if frame % 9 in (0, 2, 4, 7):
+                            handle.seek(frame * frame_size)
+                            handle.write(bytes(frame_size))
+
+                decode = subprocess.run(decode_command.split(), stderr=subprocess.PIPE, text=True)
+                decode.check_returncode()
+                self.assertIn('ML decoding: yes', decode.stderr)
+                self.assertTrue(filecmp.cmp(test_file, decoded, shallow=False))
+
+
+    def testAutoCodecAtLeastAsRobustAsRS(self):
+        '''The codec chosen automatically decodes every loss pattern RS decodes for the same N and K'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        decoded     = f'{TEMP_DIR}/decoded.raw'
+
+        # K=4, N=8 also fits a 2x2 parity matrix, which isn't MDS
+        genbytes(test_file, 4, FEC_SYMBOL_SIZE)
+
+        encoded = {}
+        for codec in ('auto', 'rs'):
+            encoded[codec] = f'{TEMP_DIR}/encoded_{codec}.raw'
+            encode_command = f'{ENCODE} {test_file} -q -s -c 0.5 --codec {codec} -o {encoded[codec]}'
+            encode = subprocess.run(encode_command.split(), stderr=subprocess.PIPE, text=True)
+            encode.check_returncode()
+            self.assertIn('n=8, k=4', encode.stderr)
+
+        def decodes(codec, lost):
+            damaged = f'{TEMP_DIR}/damaged.raw'
+            shutil.copyfile(encoded[codec], damaged)
+            frame_size = os.path.getsize(damaged) // 8
+            with open(damaged, 'r+b') as handle:
+                for frame in lost:
+                    handle.seek(frame * frame_size)
+                    handle.write(bytes(frame_size))
+            if os.path.exists(decoded):
+                os.remove(decoded)
+            subprocess.run(f'{DECODE} {damaged} -q -o {decoded}'.split(), stderr=subprocess.DEVNULL)
+            return os.path.exists(decoded) and filecmp.cmp(test_file, decoded, shallow=False)
+
+        # RS rebuilds the object from any 4 frames, losing up to N-K never costs it
+        for nlost in range(0, 5):
+            for lost in itertools.combinations(range(8), nlost):
+                with self.subTest(lost=lost):
+                    self.assertTrue(decodes('rs', lost))
+                    self.assertTrue(decodes('auto', lost))
+
+
+    def testAsyncLogging(self):
+        '''Debug logging through the background thread reaches stderr and doesn't disturb the transfer'''
+
+        test_file   = f'{TEMP_DIR}/test.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+
+        tx_command = f'{TX} {test_file} -v --async-log --savefile {tx_out}'
+        rx_command = f'{RX} {rx_out} -v --async-log -t 2 --savefile {tx_out}'
+
+        # Create a single test file
+        genbytes(test_file, 10, FEC_SYMBOL_SIZE) # Create test file
+
+        # Transmit the test file, every frame is logged at debug level
+        tx_proc = subprocess.run(tx_command.split(), stderr=subprocess.PIPE, text=True)
+        tx_proc.check_returncode()
+
+        # Receive the test file
+        subprocess.run(rx_command.split(), stderr=subprocess.DEVNULL).check_returncode()
+
+        # Verify both files match
+        status = filecmp.cmp(test_file, rx_out)
+
+        self.assertEqual(status, True)
+
+        # Every data frame was logged and nothing was dropped
+        self.assertGreaterEqual(tx_proc.stderr.count('Frame: '), 10)
+        self.assertNotIn('Async logger', tx_proc.stderr)
+
+    def testMetricsSocket(self):
+        '''Tx and Rx serve live counters and histograms while they run'''
+
+        test_file   = f'{TEMP_DIR}/test_0.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+        tx_socket   = f'{TEMP_DIR}/tx.sock'
+        rx_socket   = f'{TEMP_DIR}/rx.sock'
+
+        tx_command = f'{TX} {TEMP_DIR} -q --watch-timeout 2 --filter=test_*.raw --metrics-socket {tx_socket} --savefile {tx_out}'
+        rx_command = f'{RX} {rx_out} -q -t 2 --metrics-socket {rx_socket}'
+
+        # Tx stays up listening for files after transmitting this one
+        tx_proc = subprocess.Popen(tx_command.split())
+        sleep(0.05)
+        genbytes(test_file, 10, FEC_SYMBOL_SIZE)
+        sleep(0.5)
+
+        tx_metrics = scrape_metrics(tx_socket)
+
+        tx_proc.wait()
+        self.assertEqual(tx_proc.returncode, 0)
+        self.assertFalse(os.path.exists(tx_socket))
+
+        self.assertEqual(tx_metrics['dxwifi_tx_transmissions_total'], 1)
+        self.assertEqual(tx_metrics['dxwifi_tx_active'], 0)
+        self.assertGreater(tx_metrics['dxwifi_tx_data_frames_total'], 0)
+        self.assertGreater(tx_metrics['dxwifi_tx_control_frames_total'], 0)
+        self.assertEqual(tx_metrics['dxwifi_tx_inject_errors_total'], 0)
+        self.assertEqual(
+            tx_metrics['dxwifi_tx_inject_latency_seconds_count'],
+            tx_metrics['dxwifi_tx_data_frames_total'] + tx_metrics['dxwifi_tx_control_frames_total']
+        )
+        self.assertEqual(
+            tx_metrics['dxwifi_tx_inject_latency_seconds_bucket{le="+Inf"}'],
+            tx_metrics['dxwifi_tx_inject_latency_seconds_count']
+        )
+
+        # Rx captures from stdin, which is held open so it keeps running
+        rx_proc = subprocess.Popen(rx_command.split(), stdin=subprocess.PIPE)
+        with open(tx_out, 'rb') as capture:
+            rx_proc.stdin.write(capture.read())
+            rx_proc.stdin.flush()
+        sleep(0.5)
+
+        rx_metrics = scrape_metrics(rx_socket)
+
+        rx_proc.stdin.close()
+        rx_proc.wait()
+        self.assertEqual(rx_proc.returncode, 0)
+
+        # Frames still sitting in pcap's read buffer aren't counted yet
+        self.assertGreater(rx_metrics['dxwifi_rx_data_frames_total'], 0)
+        self.assertLessEqual(rx_metrics['dxwifi_rx_data_frames_total'], tx_metrics['dxwifi_tx_data_frames_total'])
+        self.assertEqual(rx_metrics['dxwifi_rx_active'], 1)
+        self.assertGreater(rx_metrics['dxwifi_rx_control_frames_total'], 0)
+        self.assertEqual(rx_metrics['dxwifi_rx_dropped_frames_total'], 0)
+        self.assertEqual(rx_metrics['dxwifi_rx_frame_latency_seconds_count'], rx_metrics['dxwifi_rx_data_frames_total'])
+        self.assertTrue(filecmp.cmp(test_file, rx_out))
+
+    def testMetricsSocketKeepsOtherFiles(self):
+        '''Only a stale socket is replaced, anything else at the path fails startup'''
+
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+        not_socket  = f'{TEMP_DIR}/metrics.txt'
+
+        with open(not_socket, 'w') as f:
+            f.write('keep me')
+
+        rx_command = f'{RX} {rx_out} -q -t 1 --metrics-socket {not_socket}'
+        rx_proc = subprocess.run(rx_command.split(), stdin=subprocess.DEVNULL)
+
+        self.assertNotEqual(rx_proc.returncode, 0)
+        with open(not_socket) as f:
+            self.assertEqual(f.read(), 'keep me')
+
+
+    def testStatusSegment(self):
+        '''Tx and Rx publish their status and object progress in shared memory'''
+
+        test_file   = f'{TEMP_DIR}/test_0.raw'
+        tx_out      = f'{TEMP_DIR}/tx.raw'
+        rx_out      = f'{TEMP_DIR}/rx.raw'
+        tx_status   = f'dxwifi_test_tx_{os.getpid()}'
+        rx_status   = f'dxwifi_test_rx_{os.getpid()}'
+
+        tx_command = f'{TX} {TEMP_DIR} -q --watch-timeout 2 --filter=test_*.raw --status-shm {tx_status} --savefile {tx_out}'
+        rx_command = f'{RX} {rx_out} -q -t 2 --status-shm {rx_status}'
+
+        # Tx stays up listening for files after transmitting this one
+        tx_proc = subprocess.Popen(tx_command.split())
+        sleep(0.05)
+        genbytes(test_file, 10, FEC_SYMBOL_SIZE)
+        sleep(0.5)
+
+        tx = read_status(tx_status)
+
+        tx_proc.wait()
+        self.assertEqual(tx_proc.returncode, 0)
+        self.assertFalse(os.path.exists(f'/dev/shm/{tx_status}'))
+
+        self.assertEqual(tx['magic'], 0x54535844)
+        self.assertEqual(tx['role'], 1)
+        self.assertEqual(tx['pid'], tx_proc.pid)
+        self.assertEqual(tx['state'], 0)
+        self.assertEqual(tx['objects'], 1)
+        self.assertEqual(tx['k'], 10)
+        self.assertEqual(tx['esis'], tx['n'])
+        self.assertEqual(tx['source_esis'], tx['k'])
+        self.assertEqual(tx['data_frames'], tx['n'])
+        self.assertEqual(tx['errors'], 0)
+
+        # Rx captures from stdin, which is held open so it keeps running
+        rx_proc = subprocess.Popen(rx_command.split(), stdin=subprocess.PIPE)
+        with open(tx_out, 'rb') as capture:
+            rx_proc.stdin.write(capture.read())
+            rx_proc.stdin.flush()
+        sleep(0.5)
+
+        rx = read_status(rx_status)
+
+        rx_proc.stdin.close()
+        rx_proc.wait()
+        self.assertEqual(rx_proc.returncode, 0)
+        self.assertFalse(os.path.exists(f'/dev/shm/{rx_status}'))
+
+        # Frames still sitting in pcap's read buffer aren't counted yet
+        self.assertEqual(rx['role'], 2)
+        self.assertEqual(rx['state'], 3)
+        self.assertGreater(rx['data_frames'], 0)
+        self.assertEqual((rx['n'], rx['k']), (tx['n'], tx['k']))
+        self.assertEqual(rx['esis'], rx['data_frames'])
+        self.assertLessEqual(rx['esis'], tx['n'])
+        self.assertTrue(filecmp.cmp(test_file, rx_out))
+
+
 if __name__ == '__main__':
     unittest.main()